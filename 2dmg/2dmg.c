@@ -13,21 +13,28 @@
 #include "2dmg_math.h"
 #include "2dmg_geo.h"
 #include "2dmg_plot.h"
+#include "2dmg_marks.h"
+#include "2dmg_pred.h"
+#include "2dmg_frontpool.h"
+#include "2dmg_stream.h"
+#include "2dmg_export.h"
+#include "2dmg_checkpoint.h"
+#include "2dmg_facegeom.h"
 #include <omp.h>
 
 /******************************************************************/
 /* function: mg_free_loop */
-/* frees the memory stored in loop */
-int mg_free_loop(mg_Loop *Loop)
+/* frees the memory stored in loop, front faces go back to Pool */
+int mg_free_loop(mg_FrontPool *Pool, mg_Loop *Loop)
 {
   mg_FrontFace *FFace, *FFaceNext;
   FFace = Loop->head;
   while (FFace != Loop->tail) {
     FFaceNext = FFace->next;
-    mg_free_front_face(FFace);
+    mg_front_face_release(Pool, FFace);
     FFace = FFaceNext;
   }
-  mg_free_front_face(FFace);//destroy the tail also
+  mg_front_face_release(Pool, FFace);//destroy the tail also
   Loop->head = NULL;
   Loop->tail = NULL;
   mg_free_ord_data_list(Loop->FacesInLoop);
@@ -37,8 +44,10 @@ int mg_free_loop(mg_Loop *Loop)
 
 /******************************************************************/
 /* function: mg_build_loop */
-/* builds a closed loop of front faces oriented counter-clockwise*/
-int mg_build_loop(mg_Mesh *Mesh, int faceID, mg_Loop *Loop, int iloop)
+/* builds a closed loop of front faces oriented counter-clockwise.
+ Faces are taken from Pool in loop order */
+int mg_build_loop(mg_Mesh *Mesh, mg_FrontPool *Pool, int faceID,
+                  mg_Loop *Loop, int iloop)
 {
   int ierr, f, nborface = -1, ID, node1;
   bool open, foundnext;
@@ -51,7 +60,7 @@ int mg_build_loop(mg_Mesh *Mesh, int faceID, mg_Loop *Loop, int iloop)
   Loop->FacesInLoop = FacesInLoop;
   mg_init_ord_data_list(Loop->FacesInLoop, sizeof(mg_FrontFace));
   //create loop's head
-  call(mg_alloc((void**)&FFace, 1, sizeof(mg_FrontFace)));
+  call(mg_front_face_new(Pool, &FFace));
   FFace->ID = faceID;
   FFace->iloop = iloop;
   //store pointer to mesh face
@@ -80,7 +89,7 @@ int mg_build_loop(mg_Mesh *Mesh, int faceID, mg_Loop *Loop, int iloop)
     //should have found the next front face
     if (!foundnext)
       return error(err_LOGIC_ERROR);
-    call(mg_alloc((void**)&NextFFace, 1, sizeof(mg_FrontFace)));
+    call(mg_front_face_new(Pool, &NextFFace));
     if (nborface == -1)
       return error(err_LOGIC_ERROR);
     NextFFace->ID = nborface;
@@ -92,6 +101,8 @@ int mg_build_loop(mg_Mesh *Mesh, int faceID, mg_Loop *Loop, int iloop)
     if (NextFFace->ID == Loop->head->ID){
       open = false;
       Loop->tail = NextFFace->prev;
+      //the head is already in the loop
+      mg_front_face_release(Pool, NextFFace);
     }
     else{
       NextFFace->next = NULL;
@@ -120,6 +131,10 @@ int mg_create_front (mg_Mesh *Mesh, mg_Front *Front)
   //initialize front
   Front->nloop = 0;
   Front->loop = NULL;
+  Front->Version = 1;
+  Front->Coord = NULL;
+  Front->Stream = NULL;
+  call(mg_create_front_pool(&Front->Pool));
   //loop over faces, pick a seed face and generate loop.
   //stop when can't find any more seeds
   istack = 0;
@@ -134,7 +149,7 @@ int mg_create_front (mg_Mesh *Mesh, mg_Front *Front)
       //check if it is the first loop
       if (Front->nloop == 0){
         call(mg_alloc((void**)&Loop, 1, sizeof(mg_Loop)));
-        call(mg_build_loop(Mesh, faceID, Loop, 0));
+        call(mg_build_loop(Mesh, Front->Pool, faceID, Loop, 0));
       }
       else {
         foundseed = true;
@@ -148,7 +163,8 @@ int mg_create_front (mg_Mesh *Mesh, mg_Front *Front)
         }
         if (foundseed){
           call(mg_alloc((void**)&Loop, 1, sizeof(mg_Loop)));
-          call(mg_build_loop(Mesh, faceID, Loop, Front->nloop));
+          call(mg_build_loop(Mesh, Front->Pool, faceID, Loop,
+                              Front->nloop));
         }
         else continue;
       }
@@ -161,6 +177,174 @@ int mg_create_front (mg_Mesh *Mesh, mg_Front *Front)
   return err_OK;
 }
 
+/******************************************************************/
+/* function: mg_front_coord_reserve */
+/* makes room for size entries in FC */
+static int mg_front_coord_reserve(mg_FrontCoord *FC, int size)
+{
+  int ierr;
+  
+  if (size <= FC->Size) return err_OK;
+  size = max(size, 2*FC->Size);
+  call(mg_realloc((void**)&FC->x0, size, sizeof(double)));
+  call(mg_realloc((void**)&FC->y0, size, sizeof(double)));
+  call(mg_realloc((void**)&FC->x1, size, sizeof(double)));
+  call(mg_realloc((void**)&FC->y1, size, sizeof(double)));
+  call(mg_realloc((void**)&FC->FFace, size, sizeof(mg_FrontFace*)));
+  call(mg_realloc((void**)&FC->Hit, size, sizeof(unsigned char)));
+  FC->Size = size;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function: mg_front_coord_set */
+/* copies the end points of FFace to its entry, appending one if it
+ has none */
+static int mg_front_coord_set(mg_Mesh *Mesh, mg_FrontCoord *FC,
+                              mg_FrontFace *FFace)
+{
+  int ierr, i;
+  double const *X = Mesh->Coord;
+  
+  if (FFace->Slot < 0) {
+    call(mg_front_coord_reserve(FC, FC->n+1));
+    FFace->Slot = FC->n++;
+  }
+  i = FFace->Slot;
+  FC->x0[i] = X[2*FFace->face->node[0]];
+  FC->y0[i] = X[2*FFace->face->node[0]+1];
+  FC->x1[i] = X[2*FFace->face->node[1]];
+  FC->y1[i] = X[2*FFace->face->node[1]+1];
+  FC->FFace[i] = FFace;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function: mg_front_coord_touch */
+/* queues FFace (new, or pointing to another face) for the next sync of
+ Front->Coord. Nothing to do if the copy is rebuilt anyway */
+static int mg_front_coord_touch(mg_Front *Front, mg_FrontFace *FFace)
+{
+  int ierr;
+  mg_FrontCoord *FC = Front->Coord;
+  
+  if (FC == NULL || FC->Version != Front->Version) return err_OK;
+  if (FC->nDirty == FC->DirtySize) {
+    FC->DirtySize = max(2*FC->DirtySize, 16);
+    call(mg_realloc((void**)&FC->Dirty, FC->DirtySize,
+                    sizeof(mg_FrontFace*)));
+  }
+  FC->Dirty[FC->nDirty++] = FFace;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function: mg_front_coord_drop */
+/* removes the entry of FFace from Front->Coord, the last entry takes
+ its place */
+static void mg_front_coord_drop(mg_Front *Front, mg_FrontFace *FFace)
+{
+  int i, last;
+  mg_FrontCoord *FC = Front->Coord;
+  
+  i = FFace->Slot;
+  FFace->Slot = -1;
+  if (FC == NULL || FC->Version != Front->Version || i < 0) return;
+  last = --FC->n;
+  if (i == last) return;
+  FC->x0[i] = FC->x0[last];
+  FC->y0[i] = FC->y0[last];
+  FC->x1[i] = FC->x1[last];
+  FC->y1[i] = FC->y1[last];
+  FC->FFace[i] = FC->FFace[last];
+  FC->FFace[i]->Slot = i;
+}
+
+/******************************************************************/
+/* function: mg_release_front_face */
+/* takes FFace off the coordinate mirror and returns it to the pool */
+static void mg_release_front_face(mg_Front *Front, mg_FrontFace *FFace)
+{
+  if (FFace == NULL) return;
+  mg_front_coord_drop(Front, FFace);
+  mg_front_face_release(Front->Pool, FFace);
+}
+
+/******************************************************************/
+/* function: mg_sync_front_coord */
+/* brings Front->Coord up to date: the queued faces are copied, unless
+ the front faces moved (Front->Version changed) and the whole copy is
+ rebuilt */
+static int mg_sync_front_coord(mg_Mesh *Mesh, mg_Front *Front)
+{
+  int ierr, iloop, i, n;
+  bool first;
+  mg_FrontCoord *FC;
+  mg_FrontFace *FFace;
+  mg_Loop *Loop;
+  
+  if (Mesh->Dim != 2) return error(err_NOT_SUPPORTED);
+  if (Front->Coord == NULL) {
+    call(mg_alloc((void**)&Front->Coord, 1, sizeof(mg_FrontCoord)));
+    FC = Front->Coord;
+    FC->n = FC->Size = 0;
+    FC->x0 = FC->y0 = FC->x1 = FC->y1 = NULL;
+    FC->FFace = NULL;
+    FC->Hit = NULL;
+    FC->nDirty = FC->DirtySize = 0;
+    FC->Dirty = NULL;
+    FC->Version = Front->Version-1;
+  }
+  FC = Front->Coord;
+  if (FC->Version == Front->Version) {
+    //released faces have no face, faces taken again were queued again
+    for (i = 0; i < FC->nDirty; i++)
+      if (FC->Dirty[i]->face != NULL)
+        call(mg_front_coord_set(Mesh, FC, FC->Dirty[i]));
+    FC->nDirty = 0;
+    return err_OK;
+  }
+  
+  for (n = 0, iloop = 0; iloop < Front->nloop; iloop++)
+    n += Front->loop[iloop]->FacesInLoop->nEntry;
+  call(mg_front_coord_reserve(FC, n));
+  FC->n = FC->nDirty = 0;
+  for (iloop = 0; iloop < Front->nloop; iloop++) {
+    Loop = Front->loop[iloop];
+    if (Loop->FacesInLoop->nEntry == 0) continue;
+    FFace = Loop->head;
+    first = true;
+    while (first || FFace != Loop->head) {
+      first = false;
+      if (FC->n == n) return error(err_MESH_ERROR);
+      FFace->Slot = -1;
+      call(mg_front_coord_set(Mesh, FC, FFace));
+      FFace = FFace->next;
+    }
+  }
+  FC->Version = Front->Version;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function: mg_destroy_front_coord */
+static void mg_destroy_front_coord(mg_FrontCoord *FC)
+{
+  if (FC == NULL) return;
+  mg_free((void*)FC->x0);
+  mg_free((void*)FC->y0);
+  mg_free((void*)FC->x1);
+  mg_free((void*)FC->y1);
+  mg_free((void*)FC->FFace);
+  mg_free((void*)FC->Hit);
+  mg_free((void*)FC->Dirty);
+  mg_free((void*)FC);
+}
+
 /******************************************************************/
 //   FUNCTION Definition: xf_VerifyFront2D
 /* NOTE: this function is for verifying the assumptions of the front
@@ -232,14 +416,16 @@ int xf_VerifyFront2D(mg_Front *Front)
 
 /******************************************************************/
 /* function: mg_find_seed_face */
-/* selects a face to advance from front */
+/* selects a face to advance from front. Faces marked in the
+ current face epoch of Mesh->Marks have been visited already */
 int mg_find_seed_face(mg_Mesh *Mesh, mg_Metric *Metric, mg_Front *Front,
-                      mg_List *VisitedFaces, mg_FrontFace **pSeedFace)
+                      mg_FrontFace **pSeedFace)
 {
   int ierr, iloop;
   double x[4], proj, *na, *nb;
   bool FoundSeed = false, first = true;
   mg_FrontFace *FFace;
+  mg_MarkSet *VisitedFaces = &Mesh->Marks->Face;
   
   if (Front->nloop < 1) return error(err_INPUT_ERROR);
   
@@ -247,13 +433,12 @@ int mg_find_seed_face(mg_Mesh *Mesh, mg_Metric *Metric, mg_Front *Front,
     FFace = Front->loop[iloop]->head;
     if (FFace == NULL) continue;//empty loop
     (*pSeedFace) = FFace;
+    first = true;
     
     while (FFace != Front->loop[iloop]->head || first) {
       first = false;
       
-      ierr = mg_binary_search(FFace->ID, VisitedFaces->Item, 0,
-                              VisitedFaces->nItem-1, NULL);
-      if (VisitedFaces->nItem == 0 || ierr == err_NOT_FOUND){
+      if (!ismarked(VisitedFaces, FFace->ID)){
         //check for convexity
         na = FFace->prev->face->normal;
         nb = FFace->face->normal;
@@ -261,38 +446,31 @@ int mg_find_seed_face(mg_Mesh *Mesh, mg_Metric *Metric, mg_Front *Front,
         if (proj > 0.0){//making a "right" turn
           (*pSeedFace) = FFace;
           FoundSeed = true;
-          call(mg_add_2_ord_set((*pSeedFace)->ID, &VisitedFaces->nItem,
-                                &VisitedFaces->Item, NULL, false));
+          call(mg_mark(VisitedFaces, (*pSeedFace)->ID, NULL));
           break;
         }
       }
-      else if (ierr != err_OK)
-        return error(ierr);
       FFace = FFace->next;
     }
     
     if (FoundSeed)
       break;
     else {
-      //loop is convex, pick smallest face
+      //loop is convex, pick smallest face not visited yet
       first = true;
       while (FFace != Front->loop[iloop]->head || first) {
         first = false;
-        ierr = mg_binary_search(FFace->ID, VisitedFaces->Item, 0,
-                                VisitedFaces->nItem-1, NULL);
-        if (VisitedFaces->nItem == 0 || ierr == err_NOT_FOUND){
-          if (FFace->face->area < (*pSeedFace)->face->area){
-            (*pSeedFace) = FFace;
-            call(mg_add_2_ord_set((*pSeedFace)->ID, &VisitedFaces->nItem,
-                                  &VisitedFaces->Item, NULL, false));
-            FoundSeed = true;
-          }
+        if (!ismarked(VisitedFaces, FFace->ID) &&
+            (!FoundSeed || FFace->face->area < (*pSeedFace)->face->area)){
+          (*pSeedFace) = FFace;
+          FoundSeed = true;
         }
-        else if (ierr != err_OK)
-          return error(ierr);
         FFace = FFace->next;
       }
-      
+      if (FoundSeed) {
+        call(mg_mark(VisitedFaces, (*pSeedFace)->ID, NULL));
+        break;
+      }
     }
   }
   
@@ -301,38 +479,88 @@ int mg_find_seed_face(mg_Mesh *Mesh, mg_Metric *Metric, mg_Front *Front,
   return err_OK;
 }
 
+/******************************************************************/
+/* function: mg_front_visited */
+/* true if every face of Front is marked in the current face epoch */
+static bool mg_front_visited(mg_Mesh *Mesh, mg_Front *Front)
+{
+  int iloop;
+  mg_FrontFace *FFace;
+  
+  for (iloop = 0; iloop < Front->nloop; iloop++) {
+    FFace = Front->loop[iloop]->head;
+    if (FFace == NULL) continue;//empty loop
+    do {
+      if (!ismarked(&Mesh->Marks->Face, FFace->ID)) return false;
+      FFace = FFace->next;
+    } while (FFace != Front->loop[iloop]->head);
+  }
+  
+  return true;
+}
+
+/******************************************************************/
+/* function: mg_front_face_of */
+/* front face of mesh face faceID (NULL if the face is not on the
+ front) */
+static int mg_front_face_of(mg_Front *Front, int faceID,
+                            mg_FrontFace **pFFace)
+{
+  int ierr, iloop, rank;
+  mg_OrderedDataList *Faces;
+  
+  (*pFFace) = NULL;
+  for (iloop = 0; iloop < Front->nloop; iloop++) {
+    Faces = Front->loop[iloop]->FacesInLoop;
+    if (Faces->nEntry == 0) continue;
+    ierr = mg_binary_search(faceID, Faces->Entry, 0, Faces->nEntry-1,
+                            &rank);
+    if (ierr == err_OK) {
+      (*pFFace) = (mg_FrontFace*)(Faces->Data[rank]);
+      return err_OK;
+    }
+    else if (ierr != err_NOT_FOUND) return error(ierr);
+  }
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function: mg_add_2_sorted_list */
+/* inserts entry in List (held in scratch "slot") keeping the items in
+ ascending order and unique */
+static int mg_add_2_sorted_list(int slot, int entry, mg_List *List)
+{
+  int ierr, i;
+  
+  call(mg_scratch_reserve(slot, List->nItem+1, &List->Item));
+  i = List->nItem;
+  while (i > 0 && List->Item[i-1] > entry) i--;
+  if (i > 0 && List->Item[i-1] == entry) return err_OK;
+  memmove(List->Item+i+1, List->Item+i, (List->nItem-i)*sizeof(int));
+  List->Item[i] = entry;
+  List->nItem++;
+  
+  return err_OK;
+}
+
 /******************************************************************/
 /* function: mg_find_node_in_front */
-/* finsd node with "nodeID0" in the front */
+/* finds the front faces of node "nodeID0": their IDs in ascending
+ order, held in the scratch buffer SCRATCHNODEFACES */
 int mg_find_node_in_front(int nodeID0, mg_Mesh *Mesh, mg_Front *Front,
-                          mg_OrderedDataList **pNode2FFace)
+                          mg_List *NodeFaces)
 {
-  int ierr, iface, faceID, iloop, rank;
-  mg_Loop *Loop;
-  mg_OrderedDataList *Node2FFace;
+  int ierr, iface, faceID;
   mg_FrontFace *FFace;
   
-  call(mg_alloc((void**)&Node2FFace, 1, sizeof(mg_OrderedDataList)));
-  mg_init_ord_data_list(Node2FFace, sizeof(mg_FrontFace));
-  
+  NodeFaces->nItem = 0;
   for (iface = 0; iface < Mesh->Node2Face[nodeID0].nItem; iface++) {
     faceID = Mesh->Node2Face[nodeID0].Item[iface];
-    for (iloop = 0; iloop < Front->nloop; iloop++) {
-      Loop = Front->loop[iloop];
-      if (Loop->FacesInLoop->nEntry == 0) continue;
-      ierr = mg_binary_search(faceID, Loop->FacesInLoop->Entry, 0,
-                              Loop->FacesInLoop->nEntry-1, &rank);
-      if (ierr == err_OK){
-        FFace = (mg_FrontFace*)(Loop->FacesInLoop->Data[rank]);
-        call(mg_add_2_ord_data_list(faceID, (void**)&FFace, Node2FFace,
-                                    NULL, true));
-      }
-      else if (ierr != err_NOT_FOUND) return error(ierr);
-    }
+    call(mg_front_face_of(Front, faceID, &FFace));
+    if (FFace != NULL)
+      call(mg_add_2_sorted_list(SCRATCHNODEFACES, faceID, NodeFaces));
   }
-  if (Node2FFace->nEntry == 0)
-    mg_free_ord_data_list(Node2FFace);
-  (*pNode2FFace) = Node2FFace;
   
   return err_OK;
 }
@@ -368,7 +596,9 @@ int mg_comp_mesh_size(mg_Mesh *Mesh, mg_FrontFace *FFace, double **prho,
 /******************************************************************/
 /* function: mg_nodes_frnt_dist_ellipse */
 /* pick nodes in the front that are within an Ellipse
- scaled by "c" */
+ scaled by "c" (every node of the loop if c is INFINITY). NodeList is
+ rebuilt in the SCRATCHNODES buffer and its nodes are marked in a new
+ node epoch of Mesh->Marks */
 static int mg_nodes_frnt_dist_ellipse(mg_Mesh *Mesh, mg_Front *Front,
                                       mg_FrontFace *SelfFace, mg_Ellipse *Ellipse,
                                       double c, mg_List *NodeList)
@@ -378,11 +608,13 @@ static int mg_nodes_frnt_dist_ellipse(mg_Mesh *Mesh, mg_Front *Front,
   bool inside, first = true;
   
   //scale ellipse
-  Ellipse->rho[0] *= c;
-  Ellipse->rho[1] *= c;
+  if (c < INFINITY) {
+    Ellipse->rho[0] *= c;
+    Ellipse->rho[1] *= c;
+  }
   
   NodeList->nItem = 0;
-  NodeList->Item = NULL;
+  mg_new_epoch(&Mesh->Marks->Node);
   dim = Mesh->Dim;
   
   iloop = SelfFace->iloop;
@@ -393,25 +625,29 @@ static int mg_nodes_frnt_dist_ellipse(mg_Mesh *Mesh, mg_Front *Front,
       for (inode1 = 0; inode1 < FFace->face->nNode; inode1++) {
         nodeID1 = FFace->face->node[inode1];
         //check if inside ellipse
-        inside = mg_inside_ellipse(Mesh->Coord+nodeID1*dim, Ellipse);
+        inside = (c == INFINITY ||
+                  mg_inside_ellipse(Mesh->Coord+nodeID1*dim, Ellipse));
         if (inside)
-          call(mg_add_2_ord_set(nodeID1, &NodeList->nItem,
-                                &NodeList->Item, NULL, false));
+          call(mg_add_2_marked_list(&Mesh->Marks->Node, SCRATCHNODES,
+                                    nodeID1, NodeList));
       }
     }
     FFace = FFace->next;
   }
   
   //scale back ellipse
-  Ellipse->rho[0] /= c;
-  Ellipse->rho[1] /= c;
+  if (c < INFINITY) {
+    Ellipse->rho[0] /= c;
+    Ellipse->rho[1] /= c;
+  }
   
   return err_OK;
 }
 
 /******************************************************************/
 /* function: mg_nodes_frnt_dist */
-/* selects nodes in front within a distance "rho" */
+/* selects nodes in front within a distance "rho". Same list handling
+ as mg_nodes_frnt_dist_ellipse */
 static int mg_nodes_frnt_dist(mg_Mesh *Mesh, mg_Front *Front,
                               mg_FrontFace *SelfFace, double *rho, double c,
                               bool IsoFlag, mg_List *NodeList, double Popt[2])
@@ -419,17 +655,20 @@ static int mg_nodes_frnt_dist(mg_Mesh *Mesh, mg_Front *Front,
   int ierr, iloop, inode1, nodeID1, d, dim;
   double distance, delta;
   mg_FrontFace *FFace;
+  bool first;
   
   if (IsoFlag == false) return error(err_NOT_SUPPORTED);
   
   NodeList->nItem = 0;
-  NodeList->Item = NULL;
+  mg_new_epoch(&Mesh->Marks->Node);
   dim = Mesh->Dim;
   //loop over front and compute distances
   for (iloop = 0; iloop < Front->nloop; iloop++) {
-    if (Front->loop+iloop == NULL) continue;
+    if (Front->loop[iloop]->head == NULL) continue;
     FFace = Front->loop[iloop]->head;
-    while (FFace != Front->loop[iloop]->tail) {
+    first = true;
+    while (first || FFace != Front->loop[iloop]->head) {
+      first = false;
       if (FFace != SelfFace) {//skip self face
         for (inode1 = 0; inode1 < FFace->face->nNode; inode1++) {
           nodeID1 = FFace->face->node[inode1];
@@ -440,8 +679,8 @@ static int mg_nodes_frnt_dist(mg_Mesh *Mesh, mg_Front *Front,
           }
           //check if within distance
           if (distance <= c*(*rho)*c*(*rho))
-            call(mg_add_2_ord_set(nodeID1, &NodeList->nItem,
-                                  &NodeList->Item, NULL, false));
+            call(mg_add_2_marked_list(&Mesh->Marks->Node, SCRATCHNODES,
+                                      nodeID1, NodeList));
         }
       }
       FFace = FFace->next;
@@ -676,9 +915,7 @@ int mg_tri_frm_face_node(mg_Mesh *Mesh, mg_FrontFace *FFace, int nodeID2,
     Mesh->Face[faceID0]->elem[RIGHTNEIGHINDEX] = elemID0;
     Mesh->Elem[elemID0].nbor[0] = Mesh->Face[faceID0]->elem[LEFTNEIGHINDEX];
     //face info will be updated later
-    //note: if face came from the stack, these will be NULL already
-    Mesh->Face[faceID0]->normal = NULL;
-    Mesh->Face[faceID0]->centroid = NULL;
+    call(mg_face_geom_touch(Mesh, faceID0));
     Mesh->Face[faceID0]->area = -1.0;
     for (i = 0; i < 2; i++) {
       nodeID = Mesh->Face[faceID0]->node[i];
@@ -711,8 +948,7 @@ int mg_tri_frm_face_node(mg_Mesh *Mesh, mg_FrontFace *FFace, int nodeID2,
     Mesh->Face[faceID1]->elem[RIGHTNEIGHINDEX] = elemID0;
     Mesh->Elem[elemID0].nbor[1] = Mesh->Face[faceID1]->elem[LEFTNEIGHINDEX];
     //face info will be updated later
-    Mesh->Face[faceID1]->normal = NULL;
-    Mesh->Face[faceID1]->centroid = NULL;
+    call(mg_face_geom_touch(Mesh, faceID1));
     Mesh->Face[faceID1]->area = -1.0;
     for (i = 0; i < 2; i++) {
       nodeID = Mesh->Face[faceID1]->node[i];
@@ -763,7 +999,7 @@ int mg_update_front(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *FF2)
   mg_FrontFace *FF2Prev=NULL, *FF2Next=NULL, *FF1Next=NULL;
   mg_FrontFace *FF0Prev=NULL, *FF1Prev=NULL;
   mg_Loop *Loop, *LoopNew;
-  mg_OrderedDataList *Node2FFace;
+  mg_List NodeFaces;
   
   /* FFace should not be a valid front face at this point, i.e.,
    left side of face should not point to HOLLOWNEIGHTAG
@@ -801,20 +1037,22 @@ int mg_update_front(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *FF2)
     if (!face0new || !face1new)
       return error(err_LOGIC_ERROR);
     //create a FrontFace structure for faceID0 and faceID1
-    call(mg_alloc((void**)&FF0, 1, sizeof(mg_FrontFace)));
-    call(mg_alloc((void**)&FF1, 1, sizeof(mg_FrontFace)));
+    call(mg_front_face_new(Front->Pool, &FF0));
+    call(mg_front_face_new(Front->Pool, &FF1));
     FF2Prev = FF2->prev;
     FF2Next = FF2->next;
     //setup face0
     FF0->ID = faceID0;
     FF0->iloop = FF2->iloop;
     FF0->face = Mesh->Face[faceID0];
+    call(mg_front_coord_touch(Front, FF0));
     FF0->next = FF2->next;
     FF0->prev = FF1;
     //setup face1
     FF1->ID = faceID1;
     FF1->iloop = FF2->iloop;
     FF1->face = Mesh->Face[faceID1];
+    call(mg_front_coord_touch(Front, FF1));
     FF1->next = FF0;
     FF1->prev = FF2->prev;
     //stitch loop
@@ -828,7 +1066,7 @@ int mg_update_front(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *FF2)
                                 NULL, false));
     Loop->head = FF0;
     Loop->tail = FF1;
-    mg_free_front_face(FF2);
+    mg_release_front_face(Front, FF2);
   }
   else {
     //one new face
@@ -836,7 +1074,7 @@ int mg_update_front(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *FF2)
       Loop = Front->loop[FF2->iloop];
       if (face0new){// face 0 is new
         //create a FrontFace structure for faceID0
-        call(mg_alloc((void**)&FF0, 1, sizeof(mg_FrontFace)));
+        call(mg_front_face_new(Front->Pool, &FF0));
         FF1 = FF2->prev;
         FF2Next = FF2->next;
         FF1Prev = FF1->prev;
@@ -844,6 +1082,7 @@ int mg_update_front(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *FF2)
         FF0->ID = faceID0;
         FF0->iloop = FF2->iloop;
         FF0->face = Mesh->Face[faceID0];
+        call(mg_front_coord_touch(Front, FF0));
         FF0->next = FF2->next;
         FF0->prev = FF1->prev;
         //stitch loop
@@ -856,12 +1095,12 @@ int mg_update_front(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *FF2)
                                     NULL, false));
         Loop->head = FF0;
         Loop->tail = FF0->prev;
-        mg_free_front_face(FF1);
-        mg_free_front_face(FF2);
+        mg_release_front_face(Front, FF1);
+        mg_release_front_face(Front, FF2);
       }
       else {//face 1 is new
         //create a FrontFace structure for faceID1
-        call(mg_alloc((void**)&FF1, 1, sizeof(mg_FrontFace)));
+        call(mg_front_face_new(Front->Pool, &FF1));
         FF0 = FF2->next;
         FF0Next = FF0->next;
         FF2Prev = FF2->prev;
@@ -869,6 +1108,7 @@ int mg_update_front(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *FF2)
         FF1->ID = faceID1;
         FF1->iloop = FF2->iloop;
         FF1->face = Mesh->Face[faceID1];
+        call(mg_front_coord_touch(Front, FF1));
         FF1->next = FF0->next;
         FF1->prev = FF2->prev;
         //stitch loop
@@ -881,8 +1121,8 @@ int mg_update_front(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *FF2)
                                     NULL, false));
         Loop->head = FF1;
         Loop->tail = FF1->prev;
-        mg_free_front_face(FF0);
-        mg_free_front_face(FF2);
+        mg_release_front_face(Front, FF0);
+        mg_release_front_face(Front, FF2);
       }
     }
     else if (face0new && face1new) {//no new node
@@ -890,18 +1130,19 @@ int mg_update_front(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *FF2)
       //check which loops contain nodeID2
       FF2Prev = FF2->prev;
       FF2Next = FF2->next;
-      call(mg_find_node_in_front(nodeID2, Mesh, Front, &Node2FFace));
+      mg_init_list(&NodeFaces);
+      call(mg_find_node_in_front(nodeID2, Mesh, Front, &NodeFaces));
       sameloop = false;
-      for (f = 0; f < Node2FFace->nEntry; f++){
-        FFace = (mg_FrontFace*)(Node2FFace->Data[f]);
+      for (f = 0; f < NodeFaces.nItem; f++){
+        call(mg_front_face_of(Front, NodeFaces.Item[f], &FFace));
         faceID = FFace->ID;
         if (FFace->iloop == FF2->iloop) {
           sameloop = true;
           break;
         }
       }
-      call(mg_alloc((void**)&FF0, 1, sizeof(mg_FrontFace)));
-      call(mg_alloc((void**)&FF1, 1, sizeof(mg_FrontFace)));
+      call(mg_front_face_new(Front->Pool, &FF0));
+      call(mg_front_face_new(Front->Pool, &FF1));
       if (sameloop) { //we are splitting the loop in 2
         /* Diagram of splitting a loop into 2:
          f1Next     f0Prev
@@ -928,6 +1169,7 @@ int mg_update_front(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *FF2)
         FF1->ID = faceID1;
         FF1->iloop = leftloop;
         FF1->face = Mesh->Face[faceID1];
+        call(mg_front_coord_touch(Front, FF1));
         FF1->next = FF1Next;
         FF1->prev = FF2Prev;
         //stitch left loop
@@ -944,6 +1186,7 @@ int mg_update_front(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *FF2)
         FF0->ID = faceID0;
         FF0->iloop = rightloop;
         FF0->face = Mesh->Face[faceID0];
+        call(mg_front_coord_touch(Front, FF0));
         FF0->next = FF2Next;
         FF0->prev = FF0Prev;
         //stitch right loop
@@ -972,11 +1215,11 @@ int mg_update_front(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *FF2)
         Front->nloop++;
         call(mg_realloc((void**)&Front->loop, Front->nloop, sizeof(mg_Loop)));
         Front->loop[Front->nloop-1] = LoopNew;
-        mg_free_front_face(FF2);
+        mg_release_front_face(Front, FF2);
       }
       else {//merging 2 loops
-        if (Node2FFace->nEntry != 2) return error(err_LOGIC_ERROR);
-        FFace = (mg_FrontFace*)(Node2FFace->Data[0]);
+        if (NodeFaces.nItem != 2) return error(err_LOGIC_ERROR);
+        call(mg_front_face_of(Front, NodeFaces.Item[0], &FFace));
         faceID = FFace->ID;
         if (Mesh->Face[faceID]->node[0] == nodeID2){
           FF1Next = FFace;
@@ -993,12 +1236,14 @@ int mg_update_front(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *FF2)
         FF0->ID = faceID0;
         FF0->iloop = newloop;
         FF0->face = Mesh->Face[faceID0];
+        call(mg_front_coord_touch(Front, FF0));
         FF0->prev = FF0Prev;
         FF0->next = FF2Next;
         //setup FF1
         FF1->ID = faceID1;
         FF1->iloop = newloop;
         FF1->face = Mesh->Face[faceID1];
+        call(mg_front_coord_touch(Front, FF1));
         FF1->prev = FF2Prev;
         FF1->next = FF1Next;
         //stitch loops
@@ -1013,7 +1258,7 @@ int mg_update_front(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *FF2)
         LoopNew->tail = FF1->prev;
         Loop->head = Loop->tail = NULL;
         call(mg_rm_frm_ord_data_list(faceID2, Loop->FacesInLoop));
-        mg_free_front_face(FF2);
+        mg_release_front_face(Front, FF2);
         //add faces to new loop
         call(mg_add_2_ord_data_list(FF0->ID, (void**)&FF0, LoopNew->FacesInLoop,
                                     NULL, false));
@@ -1028,8 +1273,6 @@ int mg_update_front(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *FF2)
           FFace = FFace->next;
         }
         mg_free_ord_data_list(Loop->FacesInLoop);
-        mg_free_ord_data_list(Node2FFace);
-        mg_free(Node2FFace);
       }
     }
     else {
@@ -1042,61 +1285,137 @@ int mg_update_front(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *FF2)
       FF2Prev = FF2->prev;
       if (FF2Prev->ID != faceID1) return error(err_LOGIC_ERROR);
       //now let's remove the loop from the front
-      mg_free_loop(Loop);
+      mg_front_coord_drop(Front, FF2Prev);
+      mg_front_coord_drop(Front, FF2);
+      mg_front_coord_drop(Front, FF2Next);
+      mg_free_loop(Front->Pool, Loop);
     }
   }
   
   return err_OK;
 }
 
+/******************************************************************/
+/* function: mg_keep_nodes_left_of_face */
+/* reduces List in place to the nodes strictly on the left of face,
+ unmarking the others. The whole list is classified with exact
+ orientation tests in batches */
+static void mg_keep_nodes_left_of_face(mg_Mesh *Mesh, mg_FaceData *face,
+                                       mg_List *List)
+{
+  int i0, in, m, nleft = 0, node;
+  double side[PREDBATCH];
+  const double *A = Mesh->Coord+2*face->node[0];
+  const double *B = Mesh->Coord+2*face->node[1];
+  
+  for (i0 = 0; i0 < List->nItem; i0 += PREDBATCH) {
+    m = min(PREDBATCH, List->nItem-i0);
+    mg_orient2d_list(A, B, Mesh->Coord, m, List->Item+i0, side);
+    for (in = 0; in < m; in++) {
+      node = List->Item[i0+in];
+      if (side[in] > 0.0)
+        List->Item[nleft++] = node;
+      else
+        mg_unmark(&Mesh->Marks->Node, node);
+    }
+  }
+  List->nItem = nleft;
+}
+
+/******************************************************************/
+/* function: mg_front_tri_clear */
+/* clear is set to true if the triangle of SelfFace and node nodeID
+ at c holds no front node and its two new edges meet the front at
+ their end points only */
+static int mg_front_tri_clear(mg_Mesh *Mesh, mg_Front *Front,
+                              mg_FrontFace *SelfFace, int nodeID,
+                              double *c, bool *clear)
+{
+  int ierr, i, k, n0, m, f, *node;
+  double Q[4], p[2], *a, *b, *q;
+  mg_FrontCoord *FC;
+  mg_FrontFace *Neigh;
+  
+  (*clear) = false;
+  call(mg_sync_front_coord(Mesh, Front));
+  FC = Front->Coord;
+  a = Mesh->Coord+2*SelfFace->face->node[0];
+  b = Mesh->Coord+2*SelfFace->face->node[1];
+  //every front node starts a face
+  for (i = 0; i < FC->n; i++) {
+    p[0] = FC->x0[i];
+    p[1] = FC->y0[i];
+    if (mg_orient2d(a, b, p) > 0.0 && mg_orient2d(b, c, p) > 0.0 &&
+        mg_orient2d(c, a, p) > 0.0)
+      return err_OK;
+  }
+  for (k = 0; k < 2; k++) {
+    n0 = SelfFace->face->node[k];
+    //an existing edge has to be the neighbor of SelfFace on the front
+    Neigh = (k == 0) ? SelfFace->prev : SelfFace->next;
+    for (i = 0; i < Mesh->Node2Face[n0].nItem; i++) {
+      f = Mesh->Node2Face[n0].Item[i];
+      node = Mesh->Face[f]->node;
+      if ((node[0] == nodeID || node[1] == nodeID) && f != Neigh->ID)
+        return err_OK;
+    }
+    Q[0] = Mesh->Coord[2*n0];
+    Q[1] = Mesh->Coord[2*n0+1];
+    Q[2] = c[0];
+    Q[3] = c[1];
+    if (mg_segs_intersect_list(Q, FC->n, FC->x0, FC->y0, FC->x1, FC->y1,
+                               FC->Hit) == 0)
+      continue;
+    for (i = 0; i < FC->n; i++) {
+      if (!FC->Hit[i]) continue;
+      node = FC->FFace[i]->face->node;
+      if ((node[0] == n0 || node[0] == nodeID) &&
+          (node[1] == n0 || node[1] == nodeID))
+        continue;//the edge is already a front face
+      if (node[0] != n0 && node[0] != nodeID &&
+          node[1] != n0 && node[1] != nodeID)
+        return err_OK;
+      //a face at an end point blocks if it runs along the edge
+      m = (node[0] == n0 || node[0] == nodeID) ? node[1] : node[0];
+      q = Mesh->Coord+2*m;
+      if (mg_orient2d(Q, Q+2, q) == 0.0 &&
+          (q[0]-Q[0])*(Q[2]-q[0])+(q[1]-Q[1])*(Q[3]-q[1]) > 0.0)
+        return err_OK;
+    }
+  }
+  (*clear) = true;
+  
+  return err_OK;
+}
+
 /******************************************************************/
 /* function: mg_bld_tri_frm_close_pts */
-/* build as many triangles possible from list of nearby points */
+/* build as many triangles possible from list of nearby points.
+ CloseNodes is reduced in place to the nodes on the left of SelfFace.
+ The best node that clears the front is taken if its ellipse mismatch
+ is at most Jmax */
 int mg_bld_tri_frm_close_pts_ellipse(mg_Mesh *Mesh, mg_Front *Front,
                                      mg_FrontFace *SelfFace,
-                                     mg_Ellipse *Ellipse_opt,
+                                     mg_Ellipse *Ellipse_opt, double Jmax,
                                      mg_List *CloseNodes, bool *success)
 {
-  int ierr, in, nodeID0, d, dim, nodeID1;
-  double proj, size_ratio, J, Jmin=INFINITY;
+  int ierr, in, imin, nodeID0, dim, nodeID1;
+  double proj, size_ratio, J, Jmin;
+  bool clear;
   mg_FaceData *face = SelfFace->face;
-  mg_List NodesOnLeft;
   mg_Ellipse Ellipse;
   
   dim = Mesh->Dim;
-  NodesOnLeft.nItem = 0;
-  NodesOnLeft.Item = NULL;
   (*success) = false;
-  //get nodes on left side of selfface
-  for (in = 0; in < CloseNodes->nItem; in++) {
-    nodeID0 = CloseNodes->Item[in];
-    proj = 0.0;
-    for (d = 0; d < dim; d++){
-      proj+=face->normal[d]*(Mesh->Coord[nodeID0*dim+d]-face->centroid[d]);
-    }
-    if (proj > 1e-5) {
-      call(mg_add_2_ord_set(nodeID0, &NodesOnLeft.nItem, &NodesOnLeft.Item,
-                            NULL, false));
-    }
-  }
+  //keep only nodes on left side of selfface in CloseNodes
+  mg_keep_nodes_left_of_face(Mesh, face, CloseNodes);
   //loop over nodes on left side and build the triangle with Steiner
   //ellipse closest (orientation and size) to the input ellipse
-  if (NodesOnLeft.nItem > 0) {
-    nodeID0 = NodesOnLeft.Item[0];
-    //build ellipse with nodeID0
-    call(mg_ellipse_frm_face_p(Mesh, SelfFace->face, Mesh->Coord+nodeID0*dim, &Ellipse));
-    proj = Ellipse.V[0]*Ellipse_opt->V[0]+Ellipse.V[2]*Ellipse_opt->V[2];
-    proj = sqrt(fabs(proj));
-    //compare sizes
-    size_ratio = (min(Ellipse_opt->rho[0], Ellipse_opt->rho[1])/
-                  max(Ellipse_opt->rho[0], Ellipse_opt->rho[1]));
-    size_ratio/= (min(Ellipse.rho[0], Ellipse.rho[1])/
-                  max(Ellipse.rho[0], Ellipse.rho[1]));
-    J = sqrt((proj-1.0)*(proj-1.0)+(size_ratio-1.0)*(size_ratio-1.0));
-    Jmin = J;
-    
-    for (in = 1; in < NodesOnLeft.nItem; in++) {
-      nodeID1 = NodesOnLeft.Item[in];
+  while (CloseNodes->nItem > 0) {
+    imin = -1;
+    Jmin = INFINITY;
+    for (in = 0; in < CloseNodes->nItem; in++) {
+      nodeID1 = CloseNodes->Item[in];
       //compare ellipses:
       //projection of first principal directions
       //measures the alignment between the ellipses
@@ -1110,106 +1429,83 @@ int mg_bld_tri_frm_close_pts_ellipse(mg_Mesh *Mesh, mg_Front *Front,
       size_ratio/= (min(Ellipse.rho[0], Ellipse.rho[1])/
                     max(Ellipse.rho[0], Ellipse.rho[1]));
       J = sqrt((proj-1.0)*(proj-1.0)+(size_ratio-1.0)*(size_ratio-1.0));
-      if (J < Jmin){
+      if (imin < 0 || J < Jmin){
         Jmin = J;
-        nodeID0 = nodeID1;
+        imin = in;
       }
     }
+    if (Jmin > Jmax) break;
     //by now, nodeID0 is ideal
-    //build triangle and update front
-    //printf("Jmin: %1.3e\n",Jmin);
-    if (Jmin <= 2.0){
+    nodeID0 = CloseNodes->Item[imin];
+    call(mg_front_tri_clear(Mesh, Front, SelfFace, nodeID0,
+                            Mesh->Coord+nodeID0*dim, &clear));
+    if (clear){
+      //build triangle and update front
       call(mg_tri_frm_face_node(Mesh, SelfFace, nodeID0, NULL));
       call(mg_update_front(Mesh, Front, SelfFace));
       (*success) = true;
+      break;
     }
+    //try the next best node
+    CloseNodes->Item[imin] = CloseNodes->Item[--CloseNodes->nItem];
   }
   
-  //substitute CloseNodes by nodes on the left (not the best way to do this)
-  CloseNodes->nItem = NodesOnLeft.nItem;
-  mg_free((void*)CloseNodes->Item);
-  CloseNodes->Item = NodesOnLeft.Item;
-  
   return err_OK;
 }
 
 /******************************************************************/
 /* function: mg_bld_tri_frm_close_pts */
-/* build as many triangles possible from list of nearby points */
+/* build as many triangles possible from list of nearby points.
+ CloseNodes is reduced in place to the nodes on the left of SelfFace */
 int mg_bld_tri_frm_close_pts(mg_Mesh *Mesh, mg_Front *Front,
                              mg_FrontFace *SelfFace, double *rhomax,
                              bool IsoFlag, mg_List *CloseNodes,
                              bool *success, double *radii)
 {
-  int ierr, in, nodeID0, d, dim, nodeID1, iloop;
-  double proj, radius, center[2], dist2, xint[2], X0[4], X1[4];
-  bool intersect=false, first;
+  int ierr, in, nodeID0, dim, nodeID1, i;
+  double radius, center[2], Q[4];
+  bool intersect=false;
   mg_FaceData *face = SelfFace->face;
-  mg_List NodesOnLeft;
   mg_FrontFace *FFace;
-  mg_Loop *Loop;
+  mg_FrontCoord *FC;
   
   if (!IsoFlag) return error(err_NOT_SUPPORTED);
   
   dim = Mesh->Dim;
-  NodesOnLeft.nItem = 0;
-  NodesOnLeft.Item = NULL;
   (*success) = false;
-  //get nodes on left side of selfface
-  for (in = 0; in < CloseNodes->nItem; in++) {
-    nodeID0 = CloseNodes->Item[in];
-    proj = 0.0;
-    for (d = 0; d < dim; d++){
-      proj+=face->normal[d]*(Mesh->Coord[nodeID0*dim+d]-face->centroid[d]);
-    }
-    if (proj > 1e-5) {
-      call(mg_add_2_ord_set(nodeID0, &NodesOnLeft.nItem, &NodesOnLeft.Item,
-                            NULL, false));
-    }
-  }
+  //keep only nodes on left side of selfface in CloseNodes
+  mg_keep_nodes_left_of_face(Mesh, face, CloseNodes);
   //loop over nodes on left side and build the smallest (in radius) possible triangle
-  if (NodesOnLeft.nItem > 0) {
-    nodeID0 = NodesOnLeft.Item[0];
-    call(mg_build_circle_frm_face(Mesh, face, Mesh->Coord+nodeID0*dim, center,
-                                  &radius));
-    for (in = 1; in < NodesOnLeft.nItem; in++) {
-      nodeID1 = NodesOnLeft.Item[in];
-      dist2 = (Mesh->Coord[nodeID1*dim]-center[0])*(Mesh->Coord[nodeID1*dim]-center[0]);
-      dist2+= (Mesh->Coord[nodeID1*dim+1]-center[1])*(Mesh->Coord[nodeID1*dim+1]-center[1]);
-      if (dist2 < radius*radius) {
+  if (CloseNodes->nItem > 0) {
+    nodeID0 = CloseNodes->Item[0];
+    for (in = 1; in < CloseNodes->nItem; in++) {
+      nodeID1 = CloseNodes->Item[in];
+      //(face, nodeID0) is counter-clockwise
+      if (mg_incircle(Mesh->Coord+face->node[0]*dim,
+                      Mesh->Coord+face->node[1]*dim, Mesh->Coord+nodeID0*dim,
+                      Mesh->Coord+nodeID1*dim) > 0.0)
         nodeID0 = nodeID1;
-        call(mg_build_circle_frm_face(Mesh, face, Mesh->Coord+nodeID0*dim, center,
-                                      &radius));
-      }
     }
+    call(mg_build_circle_frm_face(Mesh, face, Mesh->Coord+nodeID0*dim, center,
+                                  &radius));
     //check is radius is acceptable
     if (radius <= (*rhomax)) {
-      for (iloop = 0; iloop < Front->nloop; iloop++) {
-        Loop = Front->loop[iloop];
-        if (Loop->FacesInLoop->nEntry == 0) continue;
-        FFace = Loop->head;
-        first = true;
-        intersect = false;
-        while ((first || FFace != Loop->head) && !intersect) {
-          first = false;
-          if (FFace != SelfFace && nodeID0 != FFace->face->node[0] && nodeID0 != FFace->face->node[1]){
-            //compute intersection between front face and triangle height vector
-            X0[0] = Mesh->Coord[FFace->face->node[0]*dim];
-            X0[1] = Mesh->Coord[FFace->face->node[0]*dim+1];
-            X0[2] = Mesh->Coord[FFace->face->node[1]*dim];
-            X0[3] = Mesh->Coord[FFace->face->node[1]*dim+1];
-            //trinagle height vector
-            X1[0] = SelfFace->face->centroid[0];
-            X1[1] = SelfFace->face->centroid[1];
-            X1[2] = Mesh->Coord[nodeID0*dim];
-            X1[3] = Mesh->Coord[nodeID0*dim+1];
-            intersect = mg_edges_intersect(X0,X1, xint);
-          }
-          FFace = FFace->next;
+      //triangle height vector against the whole front in one batch
+      call(mg_sync_front_coord(Mesh, Front));
+      FC = Front->Coord;
+      Q[0] = SelfFace->face->centroid[0];
+      Q[1] = SelfFace->face->centroid[1];
+      Q[2] = Mesh->Coord[nodeID0*dim];
+      Q[3] = Mesh->Coord[nodeID0*dim+1];
+      if (mg_segs_intersect_list(Q, FC->n, FC->x0, FC->y0, FC->x1, FC->y1,
+                                 FC->Hit) > 0)
+        for (i = 0; i < FC->n && !intersect; i++) {
+          FFace = FC->FFace[i];
+          //faces touching the height vector at nodeID0 do not block
+          intersect = (FC->Hit[i] && FFace != SelfFace &&
+                       nodeID0 != FFace->face->node[0] &&
+                       nodeID0 != FFace->face->node[1]);
         }
-        if (intersect)
-          break;
-      }
       if (!intersect){
         //build triangle and update front
         call(mg_tri_frm_face_node(Mesh, SelfFace, nodeID0, NULL));
@@ -1219,11 +1515,6 @@ int mg_bld_tri_frm_close_pts(mg_Mesh *Mesh, mg_Front *Front,
     }
   }
   
-  //substitute CloseNodes by nodes on the left (not the best way to do this)
-  CloseNodes->nItem = NodesOnLeft.nItem;
-  mg_free((void*)CloseNodes->Item);
-  CloseNodes->Item = NodesOnLeft.Item;
-  
   (*radii) = radius;//assuming isotropic here
   
   return err_OK;
@@ -1253,9 +1544,19 @@ int mg_find_face_in_frt(mg_Front *Front, int faceID, mg_FrontFace **pFFace)
   return err_OK;
 }
 
+/******************************************************************/
+/* function: mg_elem_frozen */
+/* true if a mesh stream has written elem out: cavities stop at it as
+ at a boundary */
+static bool mg_elem_frozen(mg_Front *Front, int elem)
+{
+  return (Front->Stream != NULL && mg_stream_written(Front->Stream, elem));
+}
+
 /******************************************************************/
 /* function: mg_rm_broken_elems */
-/* removes elements from mesh */
+/* removes elements from mesh. CandidateNodes is a marked list in the
+ current node epoch of Mesh->Marks */
 int mg_rm_broken_elems(mg_Mesh *Mesh, mg_Front *Front,
                        mg_List *BrokenElems,
                        mg_List *CandidateNodes)
@@ -1269,8 +1570,11 @@ int mg_rm_broken_elems(mg_Mesh *Mesh, mg_Front *Front,
   //note: the first nElemInFront of this list are ordered
   for (e = 0; e < BrokenElems->nItem; e++) {
     elem = BrokenElems->Item[e];
+    //the output file already holds it
+    if (mg_elem_frozen(Front, elem)) return error(err_LOGIC_ERROR);
     //loop over faces and fix connectivities
     nf2rm = nf2kp = 0;
+    node2rm = -1;
     for (f = 0; f < Mesh->Elem[elem].nNode; f++) {
       faceID = Mesh->Elem[elem].face[f];
       //set pointer to face
@@ -1306,7 +1610,8 @@ int mg_rm_broken_elems(mg_Mesh *Mesh, mg_Front *Front,
       }
       FFace->ID = Mesh->Elem[elem].face[fIDX2kp[0]];
       FFace->face = Mesh->Face[FFace->ID];
-      call(mg_alloc((void**)&FFaceNew, 1, sizeof(mg_FrontFace)));
+      call(mg_front_coord_touch(Front, FFace));
+      call(mg_front_face_new(Front->Pool, &FFaceNew));
       FFace->next = FFaceNew;
       FFaceNew->prev = FFace;
       FFaceNew->next = FFaceNext;
@@ -1318,6 +1623,7 @@ int mg_rm_broken_elems(mg_Mesh *Mesh, mg_Front *Front,
       //new front face is the second face to keep
       FFaceNew->ID = Mesh->Elem[elem].face[fIDX2kp[1]];
       FFaceNew->face = Mesh->Face[FFaceNew->ID];
+      call(mg_front_coord_touch(Front, FFaceNew));
       call(mg_add_2_ord_data_list(FFace->ID, (void**)&FFace,
                                   Front->loop[FFace->iloop]->FacesInLoop,
                                   NULL, false));
@@ -1328,8 +1634,8 @@ int mg_rm_broken_elems(mg_Mesh *Mesh, mg_Front *Front,
       node2rm = -1;
       //add new front node (opposite to fIDX2rm[0]) to list of candidate nodes
       nodeID = Mesh->Elem[elem].node[fIDX2rm[0]];
-      call(mg_add_2_ord_set(nodeID, &CandidateNodes->nItem,&CandidateNodes->Item,
-                            NULL, false));
+      call(mg_add_2_marked_list(&Mesh->Marks->Node, SCRATCHNODES, nodeID,
+                                CandidateNodes));
     }
     else {//2faces to remove
       //check if we are removing a node too
@@ -1342,15 +1648,18 @@ int mg_rm_broken_elems(mg_Mesh *Mesh, mg_Front *Front,
       faceID = Mesh->Elem[elem].face[fIDX2rm[1]];
       call(mg_find_face_in_frt(Front, faceID, &FF1));
       call(mg_rm_frm_ord_data_list(faceID, Front->loop[FF1->iloop]->FacesInLoop));
+      //FF1 has to run into the node it shares with FF0
+      if (FF1->face->node[1] != FF0->face->node[0]) swap(FF0, FF1, FFace);
       //if faces belong to same loop, we are removing a node, otherwise we keep the node
       if (FF0->iloop != FF1->iloop){
         //FFaceNew will point to the face we are keeping
-        call(mg_alloc((void**)&FFaceNew, 1, sizeof(mg_FrontFace)));
+        call(mg_front_face_new(Front->Pool, &FFaceNew));
         FFacePrev = FF1->prev;
         FFaceNext = FF0->next;
         iloopleft = FFacePrev->iloop;
         FFaceNew->ID = Mesh->Elem[elem].face[fIDX2kp[0]];
         FFaceNew->face = Mesh->Face[FFaceNew->ID];
+        call(mg_front_coord_touch(Front, FFaceNew));
         FFaceNew->prev = FFacePrev;
         FFaceNew->next = FFaceNext;
         FFaceNew->iloop = iloopleft;
@@ -1382,8 +1691,8 @@ int mg_rm_broken_elems(mg_Mesh *Mesh, mg_Front *Front,
         FFace = FF1->next;
         FFace->prev = FF0->prev;
         //free FF0 and FF1
-        mg_free_front_face(FF0);
-        mg_free_front_face(FF1);
+        mg_release_front_face(Front, FF0);
+        mg_release_front_face(Front, FF1);
         //reset head and tail
         Front->loop[iloopleft]->head = FFaceNew;
         Front->loop[iloopleft]->tail = FFaceNew->prev;
@@ -1397,23 +1706,29 @@ int mg_rm_broken_elems(mg_Mesh *Mesh, mg_Front *Front,
         FFacePrev = FFaceStale->prev;
         FFacePrev->next = FFace;
         FFace->prev = FFacePrev;
-        mg_free_front_face(FFaceStale);
+        //the loop must not start or end at the released face
+        if (Front->loop[FFace->iloop]->head == FFaceStale)
+          Front->loop[FFace->iloop]->head = FFace;
+        if (Front->loop[FFace->iloop]->tail == FFaceStale)
+          Front->loop[FFace->iloop]->tail = FFacePrev;
+        mg_release_front_face(Front, FFaceStale);
         //substitute old front face by only face to keep
         FFace->ID = Mesh->Elem[elem].face[fIDX2kp[0]];
         FFace->face = Mesh->Face[FFace->ID];
+        call(mg_front_coord_touch(Front, FFace));
         call(mg_add_2_ord_data_list(FFace->ID, (void**)&FFace,
                                     Front->loop[FFace->iloop]->FacesInLoop,
                                     NULL, false));
         //NOTE: node to remove is the one opposite to the face to keep
         node2rm = Mesh->Elem[elem].node[fIDX2kp[0]];
         //remove node from candidate nodes if it was a candidate
-        call(mg_rm_frm_ord_set(node2rm,&CandidateNodes->nItem,&CandidateNodes->Item, 1, &t));
+        mg_rm_frm_marked_list(&Mesh->Marks->Node, node2rm, CandidateNodes);
         //add nodes from face to keep to list of candidate nodes
         faceID = Mesh->Elem[elem].face[fIDX2kp[0]];
         for (n = 0; n < Mesh->Face[faceID]->nNode; n++) {
           nodeID = Mesh->Face[faceID]->node[n];
-          call(mg_add_2_ord_set(nodeID, &CandidateNodes->nItem,
-                                &CandidateNodes->Item, NULL, false));
+          call(mg_add_2_marked_list(&Mesh->Marks->Node, SCRATCHNODES, nodeID,
+                                    CandidateNodes));
         }
       }
     }
@@ -1452,8 +1767,6 @@ int mg_rm_broken_elems(mg_Mesh *Mesh, mg_Front *Front,
         call(mg_rm_frm_ord_set(faceID, &Mesh->Node2Face[nodeID].nItem,
                                &Mesh->Node2Face[nodeID].Item, 1, &t));
         if (t != 1) error(err_MESH_ERROR);
-        mg_free((void*)Mesh->Face[faceID]->centroid);
-        mg_free((void*)Mesh->Face[faceID]->normal);
         Mesh->Face[faceID]->centroid = NULL;
         Mesh->Face[faceID]->normal = NULL;
       }
@@ -1480,19 +1793,19 @@ int mg_rm_broken_elems(mg_Mesh *Mesh, mg_Front *Front,
   }//BrokenElems.nItem
   
   BrokenElems->nItem = 0;
-  mg_free((void*)BrokenElems->Item);
   
   return err_OK;
 }
 
 /******************************************************************/
 /* function: mg_neigh_srch_brkn_tri */
-/* searches for broken triangles via a neighbor search */
-int mg_neigh_srch_brkn_tri_ellipse(mg_Mesh *Mesh, mg_List *BrokenTri,
-                                   double *newcoord)
+/* searches for broken triangles via a neighbor search. BrokenTri is
+ a marked list (SCRATCHELEMS) in the current element epoch of
+ Mesh->Marks and grows in place */
+int mg_neigh_srch_brkn_tri_ellipse(mg_Mesh *Mesh, mg_Front *Front,
+                                   mg_List *BrokenTri, double *newcoord)
 {
   int ierr, e, elem, n, nbor, oppnode, dim;
-  int *BrokenTriList;
   double *coord;
   mg_FaceData *face;
   mg_Ellipse Ellipse_trial;
@@ -1507,21 +1820,18 @@ int mg_neigh_srch_brkn_tri_ellipse(mg_Mesh *Mesh, mg_List *BrokenTri,
    |     2
    */
   
-  call(mg_alloc((void**)&BrokenTriList, BrokenTri->nItem, sizeof(int)));
-  memcpy(BrokenTriList, BrokenTri->Item, BrokenTri->nItem*sizeof(int));
   dim = Mesh->Dim;
   for (e = 0; e < BrokenTri->nItem; e++) {
     //note: this list will keep expanding while new broken triangles are found
-    elem = BrokenTriList[e];
+    elem = BrokenTri->Item[e];
     //check elem's neighbors
     for (n = 0; n < Mesh->Elem[elem].nNode; n++) {
       //note: number of neighbors is the same as number of nodes
       nbor = Mesh->Elem[elem].nbor[n];
-      if (nbor >= 0){//neighbor is not a boundary
+      //neighbor is not a boundary nor written out
+      if (nbor >= 0 && !mg_elem_frozen(Front, nbor)){
         //check if nbor has been listed before
-        ierr = mg_binary_search(nbor, BrokenTri->Item, 0, BrokenTri->nItem-1,
-                                NULL);
-        if (ierr == err_NOT_FOUND){
+        if (!ismarked(&Mesh->Marks->Elem, nbor)){
           //get first face in neighbor and its opposing node to compute the circumcircle
           face = Mesh->Face[Mesh->Elem[nbor].face[0]];
           oppnode = Mesh->Elem[nbor].node[0]; //look at diagram above
@@ -1533,36 +1843,28 @@ int mg_neigh_srch_brkn_tri_ellipse(mg_Mesh *Mesh, mg_List *BrokenTri,
           
           if (inside) {
             //newcoord is inside nbor's circumellipse
-            //add to ordered list to facilitate search
-            call(mg_add_2_ord_set(nbor, &BrokenTri->nItem, &BrokenTri->Item,
-                                  NULL, false));
-            //non-ordered list
-            call(mg_realloc((void**)&BrokenTriList, BrokenTri->nItem, sizeof(int)));
-            //add new item at end of list
-            BrokenTriList[BrokenTri->nItem-1] = nbor;
+            call(mg_add_2_marked_list(&Mesh->Marks->Elem, SCRATCHELEMS, nbor,
+                                      BrokenTri));
           }
         }
-        else if (ierr != err_OK) return error(ierr);
       }
     }
   }
-  
-  mg_free((void*)BrokenTri->Item);
   //note: the first elements are adjacent to front
-  BrokenTri->Item = BrokenTriList;
   
   return err_OK;
 }
 
 /******************************************************************/
 /* function: mg_neigh_srch_brkn_tri */
-/* searches for broken triangles via a neighbor search */
-int mg_neigh_srch_brkn_tri(mg_Mesh *Mesh, mg_List *BrokenTri,
-                           double *newcoord, double *rhomax)
+/* searches for broken triangles via a neighbor search. Same list
+ handling as mg_neigh_srch_brkn_tri_ellipse */
+int mg_neigh_srch_brkn_tri(mg_Mesh *Mesh, mg_Front *Front,
+                           mg_List *BrokenTri, double *newcoord,
+                           double *rhomax)
 {
-  int ierr, e, elem, n, nbor, oppnode, dim, d;
-  int *BrokenTriList;
-  double *coord, center[2], radius, dist2;
+  int ierr, e, elem, n, nbor, oppnode, dim, *node;
+  double center[2], radius;
   mg_FaceData *face;
   
   /* Local node arrangement diagram:
@@ -1574,50 +1876,37 @@ int mg_neigh_srch_brkn_tri(mg_Mesh *Mesh, mg_List *BrokenTri,
    |     2
    */
   
-  call(mg_alloc((void**)&BrokenTriList, BrokenTri->nItem, sizeof(int)));
-  memcpy(BrokenTriList, BrokenTri->Item, BrokenTri->nItem*sizeof(int));
   dim = Mesh->Dim;
   for (e = 0; e < BrokenTri->nItem; e++) {
     //note: this list will keep expanding while new broken triangles are found
-    elem = BrokenTriList[e];
+    elem = BrokenTri->Item[e];
     //check elem's neighbors
     for (n = 0; n < Mesh->Elem[elem].nNode; n++) {
       //note: number of neighbors is the same as number of nodes
       nbor = Mesh->Elem[elem].nbor[n];
-      if (nbor >= 0){//neighbor is not a boundary
+      //neighbor is not a boundary nor written out
+      if (nbor >= 0 && !mg_elem_frozen(Front, nbor)){
         //check if nbor has been listed before
-        ierr = mg_binary_search(nbor, BrokenTri->Item, 0, BrokenTri->nItem-1,
-                                NULL);
-        if (ierr == err_NOT_FOUND){
-          //get first face in neighbor and its opposing node to compute the circumcircle
-          face = Mesh->Face[Mesh->Elem[nbor].face[0]];
-          oppnode = Mesh->Elem[nbor].node[0]; //look at diagram above
-          coord = Mesh->Coord+oppnode*dim;
-          call(mg_build_circle_frm_face(Mesh, face, coord, center, &radius));
-          dist2 = 0.0;
-          for (d = 0; d < dim; d++)
-            dist2 += (newcoord[d]-center[d])*(newcoord[d]-center[d]);
-          if (dist2 <= radius*radius) {
+        if (!ismarked(&Mesh->Marks->Elem, nbor)){
+          node = Mesh->Elem[nbor].node;
+          if (mg_incircle(Mesh->Coord+node[0]*dim, Mesh->Coord+node[1]*dim,
+                          Mesh->Coord+node[2]*dim, newcoord) >= 0.0) {
             //newcoord is inside nbor's circumcircle
-            //add to ordered list to facilitate search
-            call(mg_add_2_ord_set(nbor, &BrokenTri->nItem, &BrokenTri->Item,
-                                  NULL, false));
-            //non-ordered list
-            call(mg_realloc((void**)&BrokenTriList, BrokenTri->nItem, sizeof(int)));
-            //add new item at end of list
-            BrokenTriList[BrokenTri->nItem-1] = nbor;
+            call(mg_add_2_marked_list(&Mesh->Marks->Elem, SCRATCHELEMS, nbor,
+                                      BrokenTri));
+            //get first face in neighbor and its opposing node to compute the circumcircle
+            face = Mesh->Face[Mesh->Elem[nbor].face[0]];
+            oppnode = node[0]; //look at diagram above
+            call(mg_build_circle_frm_face(Mesh, face, Mesh->Coord+oppnode*dim,
+                                          center, &radius));
             //keep track of maximum allowable circumradius
             if (radius > (*rhomax)) (*rhomax) = radius;
           }
         }
-        else if (ierr != err_OK) return error(ierr);
       }
     }
   }
-  
-  mg_free((void*)BrokenTri->Item);
   //note: the first elements are adjacent to front
-  BrokenTri->Item = BrokenTriList;
   
   return err_OK;
 }
@@ -1625,41 +1914,176 @@ int mg_neigh_srch_brkn_tri(mg_Mesh *Mesh, mg_List *BrokenTri,
 /******************************************************************/
 /* function: mg_cand_nds_2_cand_fcs */
 /* converts a list of candidate nodes to candidate faces for
- forming triangles */
+ forming triangles. CandidateNodes is a marked list in the current node
+ epoch of Mesh->Marks. CandidateFaces gets the IDs of the front faces
+ in ascending order, held in the scratch buffer SCRATCHFACES */
 int mg_cand_nds_2_cand_fcs(mg_Mesh *Mesh, mg_Front *Front,
                            mg_List *CandidateNodes,
-                           mg_OrderedDataList **pCandidateFaces)
+                           mg_List *CandidateFaces)
 {
-  int ierr, inode, nodeID, iface, othernodeID;
-  mg_OrderedDataList *Node2FFace = NULL, *CandidateFaces;
-  mg_FrontFace *FFace;
-  
-  call(mg_alloc((void**)&CandidateFaces, 1, sizeof(mg_OrderedDataList)));
-  mg_init_ord_data_list(CandidateFaces, sizeof(mg_FrontFace));
+  int ierr, inode, nodeID, iface, faceID, othernodeID;
+  mg_List NodeFaces;
   
+  mg_init_list(&NodeFaces);
+  CandidateFaces->nItem = 0;
   for (inode = 0; inode < CandidateNodes->nItem; inode++) {
     nodeID = CandidateNodes->Item[inode];
-    call(mg_find_node_in_front(nodeID, Mesh, Front, &Node2FFace));
-    for (iface = 0; iface < Node2FFace->nEntry; iface++) {
-      FFace = (mg_FrontFace*)Node2FFace->Data[iface];
-      if (FFace->face->node[0] == nodeID)
-        othernodeID = FFace->face->node[1];
+    call(mg_find_node_in_front(nodeID, Mesh, Front, &NodeFaces));
+    for (iface = 0; iface < NodeFaces.nItem; iface++) {
+      faceID = NodeFaces.Item[iface];
+      if (Mesh->Face[faceID]->node[0] == nodeID)
+        othernodeID = Mesh->Face[faceID]->node[1];
       else
-        othernodeID = FFace->face->node[0];
+        othernodeID = Mesh->Face[faceID]->node[0];
       //if othernodeID is a candidate, then faceID is a candidate
-      ierr = mg_binary_search(othernodeID, CandidateNodes->Item, 0,
-                              CandidateNodes->nItem-1, NULL);
-      if (ierr == err_NOT_FOUND){
-        call(mg_add_2_ord_data_list(FFace->ID, (void**)&FFace,
-                                    CandidateFaces, NULL, false));
+      if (!ismarked(&Mesh->Marks->Node, othernodeID))
+        call(mg_add_2_sorted_list(SCRATCHFACES, faceID, CandidateFaces));
+    }
+  }
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function: mg_trim_broken_elems */
+/* cuts BrokenElems before the first element that mg_rm_broken_elems
+ could not peel off once the elements ahead of it are removed: it
+ needs one face on the front, or two faces that are on the front
+ already and either lie in two loops or meet at a node of no other
+ face. Steiner ellipses of neighbors need not nest, so the cavity
+ found by the neighbor search may not peel off element by element */
+static int mg_trim_broken_elems(mg_Mesh *Mesh, mg_Front *Front,
+                                mg_List *BrokenElems)
+{
+  int ierr, e, k, f, elem, nbor, nfront, nnow, faceID[3], node;
+  mg_FrontFace *FF0, *FF1;
+  bool ok;
+  
+  for (e = 0; e < BrokenElems->nItem; e++) {
+    elem = BrokenElems->Item[e];
+    nfront = nnow = 0;
+    for (f = 0; f < Mesh->Elem[elem].nNode; f++) {
+      if (Mesh->Face[Mesh->Elem[elem].face[f]]->elem[LEFTNEIGHINDEX] ==
+          HOLLOWNEIGHTAG) {
+        faceID[nnow++] = Mesh->Elem[elem].face[f];
+        nfront++;
+        continue;
       }
-      else if (ierr != err_OK) return error(ierr);
+      //faces shared with elements removed before are on the front then
+      nbor = Mesh->Elem[elem].nbor[f];
+      for (k = 0; k < e; k++)
+        if (BrokenElems->Item[k] == nbor) {
+          nfront++;
+          break;
+        }
+    }
+    ok = (nfront == 1);
+    if (nfront == 2 && nnow == 2) {
+      call(mg_find_face_in_frt(Front, faceID[0], &FF0));
+      call(mg_find_face_in_frt(Front, faceID[1], &FF1));
+      if (FF0->iloop != FF1->iloop)
+        ok = true;
+      else if (FF0->prev == FF1 || FF1->prev == FF0) {
+        //the shared node is removed with the element
+        node = (FF0->prev == FF1) ? FF0->face->node[0] : FF1->face->node[0];
+        ok = (Mesh->Node2Face[node].nItem == 2);
+      }
+    }
+    if (!ok) {
+      for (k = e; k < BrokenElems->nItem; k++)
+        mg_unmark(&Mesh->Marks->Elem, BrokenElems->Item[k]);
+      BrokenElems->nItem = e;
+      break;
     }
-    if (Node2FFace->nEntry > 0)//non empty
-      mg_free_ord_data_list(Node2FFace);
   }
   
-  (*pCandidateFaces) = CandidateFaces;
+  return err_OK;
+}
+
+/******************************************************************/
+/* function: mg_seg_blocks_tri */
+/* true if the segment of nodes m[0] and m[1] has an end point inside
+ the triangle of nodes na, nb and the new point c, or meets its edges
+ na-c and nb-c other than at a shared end point */
+static bool mg_seg_blocks_tri(mg_Mesh *Mesh, int na, int nb, double *c,
+                              int *m)
+{
+  int j, k, n0;
+  unsigned char hit;
+  double *a = Mesh->Coord+2*na, *b = Mesh->Coord+2*nb, *p, *q, Q[4];
+  
+  for (j = 0; j < 2; j++) {
+    p = Mesh->Coord+2*m[j];
+    if (mg_orient2d(a, b, p) > 0.0 && mg_orient2d(b, c, p) > 0.0 &&
+        mg_orient2d(c, a, p) > 0.0)
+      return true;
+  }
+  for (k = 0; k < 2; k++) {
+    n0 = (k == 0) ? na : nb;
+    Q[0] = Mesh->Coord[2*n0];
+    Q[1] = Mesh->Coord[2*n0+1];
+    Q[2] = c[0];
+    Q[3] = c[1];
+    if (m[0] == n0 || m[1] == n0) {
+      //a segment at the end point blocks if it runs along the edge
+      q = Mesh->Coord+2*((m[0] == n0) ? m[1] : m[0]);
+      if (mg_orient2d(Q, Q+2, q) == 0.0 &&
+          (q[0]-Q[0])*(Q[2]-q[0])+(q[1]-Q[1])*(Q[3]-q[1]) > 0.0)
+        return true;
+      continue;
+    }
+    p = Mesh->Coord+2*m[0];
+    q = Mesh->Coord+2*m[1];
+    if (mg_segs_intersect_list(Q, 1, p, p+1, q, q+1, &hit) > 0)
+      return true;
+  }
+  
+  return false;
+}
+
+/******************************************************************/
+/* function: mg_cavity_tri_clear */
+/* clear is set to true if the triangle of ActiveFace and the new point
+ c blocks no face of the front left once the elements in BrokenElems
+ (marked in the current element epoch) are removed */
+static int mg_cavity_tri_clear(mg_Mesh *Mesh, mg_Front *Front,
+                               mg_FrontFace *ActiveFace,
+                               mg_List *BrokenElems, double *c,
+                               bool *clear)
+{
+  int ierr, i, e, f, elem, nbor, *node, na, nb;
+  mg_FrontCoord *FC;
+  mg_FaceData *face;
+  
+  (*clear) = false;
+  na = ActiveFace->face->node[0];
+  nb = ActiveFace->face->node[1];
+  //the active face has to stay on the front
+  elem = ActiveFace->face->elem[RIGHTNEIGHINDEX];
+  if (elem >= 0 && ismarked(&Mesh->Marks->Elem, elem)) return err_OK;
+  call(mg_sync_front_coord(Mesh, Front));
+  FC = Front->Coord;
+  //front faces that are not removed with their element
+  for (i = 0; i < FC->n; i++) {
+    face = FC->FFace[i]->face;
+    if (FC->FFace[i] == ActiveFace) continue;
+    elem = face->elem[RIGHTNEIGHINDEX];
+    if (elem >= 0 && ismarked(&Mesh->Marks->Elem, elem)) continue;
+    if (mg_seg_blocks_tri(Mesh, na, nb, c, face->node)) return err_OK;
+  }
+  //faces between the removed elements and the rest of the mesh
+  for (e = 0; e < BrokenElems->nItem; e++) {
+    elem = BrokenElems->Item[e];
+    for (f = 0; f < Mesh->Elem[elem].nNode; f++) {
+      face = Mesh->Face[Mesh->Elem[elem].face[f]];
+      if (face->elem[LEFTNEIGHINDEX] == HOLLOWNEIGHTAG) continue;
+      nbor = Mesh->Elem[elem].nbor[f];
+      if (nbor >= 0 && ismarked(&Mesh->Marks->Elem, nbor)) continue;
+      node = face->node;
+      if (mg_seg_blocks_tri(Mesh, na, nb, c, node)) return err_OK;
+    }
+  }
+  (*clear) = true;
   
   return err_OK;
 }
@@ -1673,25 +2097,29 @@ mg_add_new_node_ellipse(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace **pActiveFa
                         mg_List *CandidateNodes, double *newcoord, bool *success)
 {
   int ierr, newnodeID, iloop, elem, idx, oppnode, dim, nBrokenTriInFront;
-  int icface, nsuccess = 0, t;
+  int icface, activeloop;
   double *coord;
   double xint[2], X0[4], X1[4];
-  bool NodeFromStack, first, inside;
-  mg_List *BrokenTri, *BrokenFFace;
+  bool first, inside, clear;
+  mg_List BrokenTri;
   mg_Loop *Loop;
   mg_FrontFace *FFace;
   mg_FaceData *gface;
-  mg_OrderedDataList *CandidateFaces;
+  mg_List CandidateFaces;
   mg_Ellipse Ellipse;
   mg_FrontFace *ActiveFace = (*pActiveFace);
   
   //new node coordinates
   dim = Mesh->Dim;
+  //triangle height vector
+  X1[0] = ActiveFace->face->centroid[0];
+  X1[1] = ActiveFace->face->centroid[1];
+  X1[2] = newcoord[0];
+  X1[3] = newcoord[1];
   //loop over front and check for broken triangles
-  call(mg_alloc((void**)&BrokenTri,1,sizeof(mg_List)));
-  mg_init_list(&BrokenTri[0]);
-  call(mg_alloc((void**)&BrokenFFace,1,sizeof(mg_List)));
-  mg_init_list(&BrokenFFace[0]);
+  mg_init_list(&BrokenTri);
+  mg_init_list(&CandidateFaces);
+  mg_new_epoch(&Mesh->Marks->Elem);
   for (iloop = 0; iloop < Front->nloop; iloop++) {
     Loop = Front->loop[iloop];
     if (Loop->FacesInLoop->nEntry == 0) continue;
@@ -1700,8 +2128,10 @@ mg_add_new_node_ellipse(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace **pActiveFa
     while (first || FFace != Loop->head) {
       first = false;
       if (FFace != ActiveFace){
+        inside = false;
         elem = FFace->face->elem[RIGHTNEIGHINDEX];
-        if (elem >= 0) {//not a boundary
+        //not a boundary nor written out
+        if (elem >= 0 && !mg_elem_frozen(Front, elem)) {
           mg_check_exist(FFace->ID, Mesh->Elem[elem].nNode,
                          Mesh->Elem[elem].face, &idx);
           if (idx < 0) return error(err_MESH_ERROR);
@@ -1714,26 +2144,22 @@ mg_add_new_node_ellipse(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace **pActiveFa
           inside = mg_inside_ellipse(newcoord, &Ellipse);
           if (inside) {
             //elem is not "delaunay" anymore due to new point
-            call(mg_add_2_ord_set(elem,&BrokenTri->nItem,&BrokenTri->Item,NULL, false));
+            call(mg_add_2_marked_list(&Mesh->Marks->Elem, SCRATCHELEMS, elem,
+                                      &BrokenTri));
           }
         }
-        else {
-          //compute intersection between front face and triangle height vector
+        if (!inside) {
+          //compute intersection between front face and triangle height
+          //vector: the point is behind a boundary or an element it does
+          //not break
           X0[0] = Mesh->Coord[FFace->face->node[0]*dim];
           X0[1] = Mesh->Coord[FFace->face->node[0]*dim+1];
           X0[2] = Mesh->Coord[FFace->face->node[1]*dim];
           X0[3] = Mesh->Coord[FFace->face->node[1]*dim+1];
-          //triangle height vector
-          X1[0] = ActiveFace->face->centroid[0];
-          X1[1] = ActiveFace->face->centroid[1];
-          X1[2] = newcoord[0];
-          X1[3] = newcoord[1];
           if (mg_edges_intersect(X0,X1, xint)) {
             //change seedface and exit
             (*pActiveFace) = FFace;
             (*success) = false;
-            BrokenTri->nItem = 0;
-            mg_free((void*)BrokenTri->Item);
             return err_OK;
           }
         }
@@ -1742,68 +2168,71 @@ mg_add_new_node_ellipse(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace **pActiveFa
     }
   }
   
-  NodeFromStack = false;
-  if (Mesh->Stack->Node->nItem > 0){
+  if (Mesh->Stack->Node->nItem > 0)
     newnodeID = Mesh->Stack->Node->Item[0];
-    NodeFromStack = true;
-  }
   else
     newnodeID = Mesh->nNode;
   
-  nBrokenTriInFront = BrokenTri->nItem;
-  if (nBrokenTriInFront == 0 && BrokenFFace->nItem == 0) {
+  nBrokenTriInFront = BrokenTri.nItem;
+  if (nBrokenTriInFront == 0) {
     //no bronken triangles, accept point and update front
-    //build triangle and update front
-    call(mg_tri_frm_face_node(Mesh, ActiveFace, newnodeID, newcoord));
-    call(mg_update_front(Mesh, Front, ActiveFace));
-    (*success) = true;
+    call(mg_front_tri_clear(Mesh, Front, ActiveFace, newnodeID, newcoord,
+                            &clear));
+    if (clear) {
+      //build triangle and update front
+      call(mg_tri_frm_face_node(Mesh, ActiveFace, newnodeID, newcoord));
+      call(mg_update_front(Mesh, Front, ActiveFace));
+      (*success) = true;
+    }
   }
   else {
     //initiate neighbor search with ellipse information
-    call(mg_neigh_srch_brkn_tri_ellipse(Mesh, BrokenTri, newcoord));
+    call(mg_neigh_srch_brkn_tri_ellipse(Mesh, Front, &BrokenTri, newcoord));
+    call(mg_trim_broken_elems(Mesh, Front, &BrokenTri));
+    //the active face triangle has to fit in the cavity, so that the
+    //elements are not removed for nothing
+    call(mg_cavity_tri_clear(Mesh, Front, ActiveFace, &BrokenTri, newcoord,
+                             &clear));
+    if (!clear) return err_OK;
     /*remove intersected triangles, update list of candidate nodes, and include
      removed mesh components in the mesh stack*/
-    call(mg_rm_broken_elems(Mesh, Front, BrokenTri, CandidateNodes));
+    call(mg_rm_broken_elems(Mesh, Front, &BrokenTri, CandidateNodes));
     //convert candidate nodes into cadidate front faces
     call(mg_cand_nds_2_cand_fcs(Mesh, Front, CandidateNodes, &CandidateFaces));
     //may have removed a node from mesh, so check if it is coming from stack
     if (newnodeID > Mesh->nNode) {
-      if (Mesh->Stack->Node->nItem > 0){
+      if (Mesh->Stack->Node->nItem > 0)
         newnodeID = Mesh->Stack->Node->Item[0];
-        NodeFromStack = true;
-      }
       else
         return error(err_LOGIC_ERROR);
     }
     
-    //loop over candidate faces and build triangles
-    nsuccess = 0;
-    for (icface = 0; icface < CandidateFaces->nEntry; icface++) {
-      FFace = (mg_FrontFace*)CandidateFaces->Data[icface];
-      gface = FFace->face;
+    //the active face first, then the candidate faces (the faces
+    //closed by the front updates are no longer on the front)
+    activeloop = ActiveFace->iloop;
+    call(mg_tri_frm_face_node(Mesh, ActiveFace, newnodeID, newcoord));
+    call(mg_update_front(Mesh, Front, ActiveFace));
+    for (icface = 0; icface < CandidateFaces.nItem; icface++) {
+      call(mg_front_face_of(Front, CandidateFaces.Item[icface], &FFace));
       //cannot merge across loops
-      if (FFace->iloop != (*pActiveFace)->iloop)
+      if (FFace == NULL || FFace->iloop != activeloop)
         continue;
+      gface = FFace->face;
       //is node on left of face?
       if ((gface->normal[0]*(newcoord[0]-gface->centroid[0])+
            gface->normal[1]*(newcoord[1]-gface->centroid[1]))/
           sqrt(pow((newcoord[0]-gface->centroid[0]),2.0)+
                pow((newcoord[1]-gface->centroid[1]),2.0)) > 1.0e-5){
-            //form triangle
-            call(mg_tri_frm_face_node(Mesh, FFace, newnodeID, (nsuccess == 0)?
-                                      newcoord:NULL));
-            //            if (nsuccess == 0 && NodeFromStack == true){
-            //              //first success, it means newnode is not new anymore
-            //              call(mg_rm_frm_ord_set(newnodeID, &Mesh->Stack->Node->nItem,
-            //                                     &Mesh->Stack->Node->Item, 1, &t));
-            //              if (t != 1)
-            //                return error(err_MESH_ERROR);
-            //            }
-            nsuccess++;
-            call(mg_update_front(Mesh, Front, FFace));
-          }
+        //the cavity need not be star-shaped w.r.t. the new node
+        call(mg_front_tri_clear(Mesh, Front, FFace, newnodeID, newcoord,
+                                &clear));
+        if (!clear) continue;
+        //form triangle
+        call(mg_tri_frm_face_node(Mesh, FFace, newnodeID, NULL));
+        call(mg_update_front(Mesh, Front, FFace));
+      }
     }
-    if (nsuccess > 0) (*success) = true;
+    (*success) = true;
   }
   
   return err_OK;
@@ -1818,16 +2247,16 @@ mg_add_new_node(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *ActiveFace,
                 mg_List *CandidateNodes, bool isoflag, double rhomax,
                 double c, bool *success)
 {
-  int ierr, newnodeID, d, iloop, elem, idx, oppnode, dim, nBrokenTriInFront;
-  int icface, nsuccess, t, n;
-  double UpperRBound, LowerRBound, newcoord[3], *coord, center[2], radius, dist2;
+  int ierr, newnodeID, d, iloop, elem, idx, dim, nBrokenTriInFront;
+  int icface, nsuccess, n, nBrokenFFace, *node;
+  double UpperRBound, LowerRBound, newcoord[3], center[2], radius;
   double newrhomax, xint[2], X0[4], X1[4];
-  bool NodeFromStack, first;
-  mg_List *BrokenTri, *BrokenFFace;
+  bool first;
+  mg_List BrokenTri;
   mg_Loop *Loop;
   mg_FrontFace *FFace;
   mg_FaceData *gface;
-  mg_OrderedDataList *CandidateFaces;
+  mg_List CandidateFaces;
   
   if (!isoflag) return error(err_NOT_SUPPORTED);
   
@@ -1840,10 +2269,10 @@ mg_add_new_node(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *ActiveFace,
   for (d = 0; d < dim; d++)
     newcoord[d] = ActiveFace->face->centroid[d]+(HALFSQRT3*UpperRBound+SQRT3*LowerRBound)/(2.0)*ActiveFace->face->normal[d];
   //loop over front and check for broken triangles
-  call(mg_alloc((void**)&BrokenTri,1,sizeof(mg_List)));
-  mg_init_list(&BrokenTri[0]);
-  call(mg_alloc((void**)&BrokenFFace,1,sizeof(mg_List)));
-  mg_init_list(&BrokenFFace[0]);
+  mg_init_list(&BrokenTri);
+  mg_init_list(&CandidateFaces);
+  mg_new_epoch(&Mesh->Marks->Elem);
+  nBrokenFFace = 0;
   for (iloop = 0; iloop < Front->nloop; iloop++) {
     Loop = Front->loop[iloop];
     if (Loop->FacesInLoop->nEntry == 0) continue;
@@ -1853,19 +2282,18 @@ mg_add_new_node(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *ActiveFace,
       first = false;
       if (FFace != ActiveFace){
         elem = FFace->face->elem[RIGHTNEIGHINDEX];
-        if (elem >= 0) {//not a boundary
+        //written elements are kept as boundaries are
+        if (elem >= 0 && !mg_elem_frozen(Front, elem)) {
           mg_check_exist(FFace->ID, Mesh->Elem[elem].nNode,
                          Mesh->Elem[elem].face, &idx);
           if (idx < 0) return error(err_MESH_ERROR);
-          //point to opposite node to FFace
-          oppnode = Mesh->Elem[elem].node[idx];
-          coord = Mesh->Coord+oppnode*dim;
-          call(mg_build_circle_frm_face(Mesh, FFace->face, coord, center, &radius));
-          dist2 = 0.0;
-          for (d = 0; d < dim; d++)dist2 += (newcoord[d]-center[d])*(newcoord[d]-center[d]);
-          if (dist2 <= radius*radius) {
+          //elements are counter-clockwise
+          node = Mesh->Elem[elem].node;
+          if (mg_incircle(Mesh->Coord+node[0]*dim, Mesh->Coord+node[1]*dim,
+                          Mesh->Coord+node[2]*dim, newcoord) >= 0.0) {
             //elem is not delaunay anymore due to new point
-            call(mg_add_2_ord_set(elem,&BrokenTri->nItem,&BrokenTri->Item,NULL, false));
+            call(mg_add_2_marked_list(&Mesh->Marks->Elem, SCRATCHELEMS, elem,
+                                      &BrokenTri));
           }
         }
         else {
@@ -1880,12 +2308,13 @@ mg_add_new_node(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *ActiveFace,
           X1[2] = newcoord[0];
           X1[3] = newcoord[1];
           if (mg_edges_intersect(X0,X1, xint)) {
-            call(mg_add_2_ord_set(FFace->ID,&BrokenFFace->nItem,&BrokenFFace->Item,NULL, false));
+            //each front face is visited once, a counter is enough
+            nBrokenFFace++;
             if (FFace->face->area > rhomax)
               rhomax = FFace->face->area/2.0;
             for (n = 0; n < FFace->face->nNode; n++)
-              call(mg_add_2_ord_set(FFace->face->node[n],&CandidateNodes->nItem,&CandidateNodes->Item,
-                                    NULL, false));
+              call(mg_add_2_marked_list(&Mesh->Marks->Node, SCRATCHNODES,
+                                        FFace->face->node[n], CandidateNodes));
           }
         }
       }
@@ -1893,26 +2322,20 @@ mg_add_new_node(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *ActiveFace,
     }
   }
   
-  if (BrokenFFace->nItem > 0){
+  if (nBrokenFFace > 0){
     call(mg_bld_tri_frm_close_pts(Mesh, Front, ActiveFace, &rhomax, isoflag,
                                   CandidateNodes, success, &radius));
-    if ((*success)){
-      BrokenFFace->nItem = 0;
-      mg_free((void*)BrokenFFace->Item);
+    if ((*success))
       return err_OK;
-    }
   }
   
-  NodeFromStack = false;
-  if (Mesh->Stack->Node->nItem > 0){
+  if (Mesh->Stack->Node->nItem > 0)
     newnodeID = Mesh->Stack->Node->Item[0];
-    NodeFromStack = true;
-  }
   else
     newnodeID = Mesh->nNode;
   
-  nBrokenTriInFront = BrokenTri->nItem;
-  if (nBrokenTriInFront == 0 && BrokenFFace->nItem == 0) {//no bronken triangles, accept point and update front
+  nBrokenTriInFront = BrokenTri.nItem;
+  if (nBrokenTriInFront == 0 && nBrokenFFace == 0) {//no bronken triangles, accept point and update front
     //build triangle and update front
     call(mg_tri_frm_face_node(Mesh, ActiveFace, newnodeID, newcoord));
     call(mg_update_front(Mesh, Front, ActiveFace));
@@ -1921,39 +2344,45 @@ mg_add_new_node(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *ActiveFace,
   else {
     newrhomax = rhomax;
     //initiate neighbor search
-    call(mg_neigh_srch_brkn_tri(Mesh, BrokenTri, newcoord, &newrhomax));
+    call(mg_neigh_srch_brkn_tri(Mesh, Front, &BrokenTri, newcoord,
+                                &newrhomax));
     if (newrhomax > rhomax) {
       //update list of close nodes
       call(mg_nodes_frnt_dist(Mesh, Front, ActiveFace, &newrhomax,2.0,
-                              isoflag,CandidateNodes, NULL));
+                              isoflag,CandidateNodes, newcoord));
     }
     /*remove intersected triangles, update list of candidate nodes, and include
      removed mesh components in the mesh stack*/
-    call(mg_rm_broken_elems(Mesh, Front, BrokenTri, CandidateNodes));
+    call(mg_rm_broken_elems(Mesh, Front, &BrokenTri, CandidateNodes));
     //convert candidate nodes into cadidate front faces
     call(mg_cand_nds_2_cand_fcs(Mesh, Front, CandidateNodes, &CandidateFaces));
+    //may have removed a node from mesh, so check if it is coming from stack
+    if (newnodeID > Mesh->nNode) {
+      if (Mesh->Stack->Node->nItem > 0)
+        newnodeID = Mesh->Stack->Node->Item[0];
+      else
+        return error(err_LOGIC_ERROR);
+    }
     //loop over candidate faces and build triangles
     
     nsuccess = 0;
-    for (icface = 0; icface < CandidateFaces->nEntry; icface++) {
-      FFace = (mg_FrontFace*)CandidateFaces->Data[icface];
+    for (icface = 0; icface < CandidateFaces.nItem; icface++) {
+      //faces closed by the triangles built so far are skipped
+      call(mg_front_face_of(Front, CandidateFaces.Item[icface], &FFace));
+      if (FFace == NULL) continue;
       gface = FFace->face;
       call(mg_build_circle_frm_face(Mesh, gface, newcoord, center, &radius));
       if (radius < newrhomax){
         //form circle
+        //note: mg_tri_frm_face_node takes newnodeID off the node stack
         call(mg_tri_frm_face_node(Mesh, FFace, newnodeID, (nsuccess == 0)?
                                   newcoord:NULL));
-        if (nsuccess == 0 && NodeFromStack == true){
-          //first success, it means newnode is not new anymore
-          call(mg_rm_frm_ord_set(newnodeID, &Mesh->Stack->Node->nItem,
-                                 &Mesh->Stack->Node->Item, 1, &t));
-          if (t != 1) return error(err_MESH_ERROR);
-        }
         nsuccess++;
         call(mg_update_front(Mesh, Front, FFace));
       }
     }
-    if (nsuccess > 0) (*success) = true;
+    //nothing built: another seed face is tried
+    (*success) = (nsuccess > 0);
   }
   
   return err_OK;
@@ -1966,39 +2395,26 @@ mg_add_new_node(mg_Mesh *Mesh, mg_Front *Front, mg_FrontFace *ActiveFace,
 static int mg_find_p_opt(mg_Mesh *Mesh, mg_Metric *Metric,
                          mg_FrontFace *FFace, double *Popt)
 {
-  int ierr, d, it, dim = Mesh->Dim;
-  double *coord, lref, lA, lB, rho, alpha, *c, *coordA, *coordB;
-  double *A, *B, w = 0.25, *dA, *dB, *PAopt, *PBopt, nA, nB, wA, wB;
+  int ierr, d, it;
+  double lref, lA, lB, rho, alpha, w = 0.25, nA, nB, wA, wB, PAopt, PBopt;
+  double coordA[4], coordB[4];
   mg_FaceData *face = FFace->face;
   
-  coord  = malloc(2*dim*sizeof(double));
-  coordA = malloc(2*dim*sizeof(double));
-  coordB = malloc(2*dim*sizeof(double));
-  A      = malloc(dim*sizeof(double));
-  B      = malloc(dim*sizeof(double));
-  c      = malloc(dim*sizeof(double));
-  dA     = malloc(dim*sizeof(double));
-  dB     = malloc(dim*sizeof(double));
-  PAopt  = malloc(dim*sizeof(double));
-  PBopt  = malloc(dim*sizeof(double));
-  
-  //get front edge length (= 2*rho*cos(30))
-  for (d = 0; d < dim; d++){
-    coord[d*dim+0] = Mesh->Coord[face->node[0]*dim+d];
-    coord[d*dim+1] = Mesh->Coord[face->node[1]*dim+d];
-  }
-  call(mg_metric_dist(Metric, Metric->order, coord, &lref));
+  if (Mesh->Dim != 2) return error(err_NOT_SUPPORTED);
+  
+  //target edge length is unity in the metric (= 2*rho*cos(30))
   lref = 1.0;
   rho = lref/SQRT3;
   
   alpha = rho/2.0;
-  for (d=0;d<dim;d++){
-    c[d] = face->centroid[d]+alpha*face->normal[d];
-    Popt[d] = c[d]+rho*face->normal[d];
-    coordA[d*dim] = Mesh->Coord[face->node[0]*dim+d];
-    coordB[d*dim] = Mesh->Coord[face->node[1]*dim+d];
-    coordA[d*dim+1] = Popt[d];
-    coordB[d*dim+1] = Popt[d];
+  //segments from each face node to the trial point as (x0,x1,y0,y1)
+  for (d = 0; d < 2; d++){
+    Popt[d] = face->centroid[d]+alpha*face->normal[d];
+    Popt[d] += rho*face->normal[d];
+    coordA[2*d]   = Mesh->Coord[face->node[0]*2+d];
+    coordB[2*d]   = Mesh->Coord[face->node[1]*2+d];
+    coordA[2*d+1] = Popt[d];
+    coordB[2*d+1] = Popt[d];
   }
   
   for (it = 0; it < 25; it++) {
@@ -2013,120 +2429,227 @@ static int mg_find_p_opt(mg_Mesh *Mesh, mg_Metric *Metric,
     nB = (lref/lB);
     wA = fabs(nA-1.0);
     wB = fabs(nB-1.0);
-    for (d=0;d<dim;d++){
-      dA[d]    = coordA[d*dim+1]-coordA[d*dim];
-      dB[d]    = coordB[d*dim+1]-coordB[d*dim];
-      PAopt[d] = coordA[d*dim] + nA* dA[d];
-      PBopt[d] = coordB[d*dim] + nB* dB[d];
-      Popt[d]     = (wA*PAopt[d]+wB*PBopt[d])/(wA+wB);
+    for (d = 0; d < 2; d++){
+      PAopt = coordA[2*d]+nA*(coordA[2*d+1]-coordA[2*d]);
+      PBopt = coordB[2*d]+nB*(coordB[2*d+1]-coordB[2*d]);
+      Popt[d] = (wA*PAopt+wB*PBopt)/(wA+wB);
       //update segments
-      coordA[d*dim+1] = w*(Popt[d]-coordA[d*dim+1])+coordA[d*dim+1];
-      coordB[d*dim+1] = w*(Popt[d]-coordB[d*dim+1])+coordB[d*dim+1];
+      coordA[2*d+1] = w*(Popt[d]-coordA[2*d+1])+coordA[2*d+1];
+      coordB[2*d+1] = w*(Popt[d]-coordB[2*d+1])+coordB[2*d+1];
     }
   }
   
-  free(coord);
-  free(coordA);
-  free(coordB);
-  free(A);
-  free(B);
-  free(c);
-  free(dA);
-  free(dB);
-  free(PAopt);
-  free(PBopt);
+  return err_OK;
+}
+
+
+/******************************************************************/
+/* function: mg_find_p_opt_iso */
+/* optimal point for an isotropic metric: apex of the isosceles
+ triangle of side h on FFace, h being the metric size at the face
+ centroid bounded by CIRCLEMINSIZE and CIRCLEMAXSIZE face lengths */
+static int mg_find_p_opt_iso(mg_Mesh *Mesh, mg_Metric *Metric,
+                             mg_FrontFace *FFace, double *Popt, double *h)
+{
+  int ierr, d;
+  double M[3], L, height;
+  mg_FaceData *face = FFace->face;
+  
+  call(mg_get_metric(Metric, face->centroid, face->centroid+1, 1, M));
+  if (M[0] <= 0.0) return error(err_INPUT_ERROR);
+  L = face->area;
+  (*h) = 1.0/sqrt(M[0]);
+  (*h) = max((*h), CIRCLEMINSIZE*L);
+  (*h) = min((*h), CIRCLEMAXSIZE*L);
+  height = sqrt((*h)*(*h)-0.25*L*L);
+  for (d = 0; d < Mesh->Dim; d++)
+    Popt[d] = face->centroid[d]+height*face->normal[d];
   
   return err_OK;
 }
 
+/******************************************************************/
+/* function: mg_frnt_blocking_nodes */
+/* finds the first face of the loop of SeedFace (in loop order) that
+ crosses the segment from the centroid of SeedFace to Popt. If that
+ face is on the boundary, its nodes are added to CloseNodes */
+static int mg_frnt_blocking_nodes(mg_Mesh *Mesh, mg_Front *Front,
+                                  mg_FrontFace *SeedFace, double *Popt,
+                                  mg_List *CloseNodes)
+{
+  int ierr, i, n;
+  double Q[4];
+  bool first;
+  mg_FrontFace *FFace = NULL;
+  mg_FrontCoord *FC;
+  mg_Loop *Loop = Front->loop[SeedFace->iloop];
+  
+  call(mg_sync_front_coord(Mesh, Front));
+  FC = Front->Coord;
+  //triangle height vector against the whole front
+  Q[0] = SeedFace->face->centroid[0];
+  Q[1] = SeedFace->face->centroid[1];
+  Q[2] = Popt[0];
+  Q[3] = Popt[1];
+  if (mg_segs_intersect_list(Q, FC->n, FC->x0, FC->y0, FC->x1, FC->y1,
+                             FC->Hit) == 0)
+    return err_OK;
+  //crossing faces of the loop of SeedFace
+  for (n = 0, i = 0; i < FC->n; i++) {
+    if (!FC->Hit[i] || FC->FFace[i] == SeedFace ||
+        FC->FFace[i]->iloop != SeedFace->iloop)
+      FC->Hit[i] = 0;
+    else {
+      FFace = FC->FFace[i];
+      n++;
+    }
+  }
+  if (n == 0) return err_OK;
+  //the first one in loop order if there are several
+  if (n > 1) {
+    first = true;
+    for (FFace = Loop->head; first || FFace != Loop->head;
+         FFace = FFace->next) {
+      first = false;
+      if (FC->Hit[FFace->Slot]) break;
+    }
+  }
+  //if it is a boundary, add its nodes to list
+  if (FFace->face->elem[RIGHTNEIGHINDEX] < 0) {
+    call(mg_add_2_marked_list(&Mesh->Marks->Node, SCRATCHNODES,
+                              FFace->face->node[0], CloseNodes));
+    call(mg_add_2_marked_list(&Mesh->Marks->Node, SCRATCHNODES,
+                              FFace->face->node[1], CloseNodes));
+  }
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function: mg_advance_front_circle */
+/* isotropic engine: same steps as mg_advance_front with circumcircle
+ tests instead of Steiner ellipses and no metric quadrature. Existing
+ nodes are accepted for circumradii up to the local size h */
+static int mg_advance_front_circle(mg_Mesh *Mesh, mg_Metric *Metric,
+                                   mg_Front *Front)
+{
+  int ierr;
+  double Popt[2], h, radius;
+  bool success = false;
+  mg_FrontFace *SeedFace;
+  mg_List CloseNodes;
+  
+  mg_new_epoch(&Mesh->Marks->Face);
+  mg_init_list(&CloseNodes);
+  
+  call(mg_find_seed_face(Mesh, Metric, Front, &SeedFace));
+  
+  while (!success) {
+    //optimal point and local size
+    call(mg_find_p_opt_iso(Mesh, Metric, SeedFace, Popt, &h));
+    //front nodes within h of the optimal point
+    call(mg_nodes_frnt_dist(Mesh, Front, SeedFace, &h, 1.0, true,
+                            &CloseNodes, Popt));
+    call(mg_frnt_blocking_nodes(Mesh, Front, SeedFace, Popt, &CloseNodes));
+    if (CloseNodes.nItem > 0){
+      //attempt to build element with existing nodes
+      call(mg_bld_tri_frm_close_pts(Mesh, Front, SeedFace, &h, true,
+                                    &CloseNodes, &success, &radius));
+    }
+    CloseNodes.nItem = 0;
+    mg_new_epoch(&Mesh->Marks->Node);
+    
+    if (!success) {
+      //add node and check if new node is inside any of
+      //the other triangles circumcircles
+      call(mg_add_new_node(Mesh, Front, SeedFace, &CloseNodes, true, h, 1.0,
+                           &success));
+      
+      if (!success){//find another seedface
+        call(mg_find_seed_face(Mesh, Metric, Front, &SeedFace));
+      }
+    }
+  }
+  
+  return err_OK;
+}
 
 /******************************************************************/
 /* function: mg_advance_front */
-/* advances the mesh front */
+/* advances the mesh front with the engine selected in Metric (see
+ mge_Engine). The temporary sets of a step (close nodes, broken
+ elements, candidate faces) live in Mesh->Marks and in the scratch
+ buffers of the calling thread, so they allocate no heap memory once
+ these have grown to their working size. The mesh, its adjacency and
+ the front loops still grow with the elements that are added */
 int mg_advance_front(mg_Mesh *Mesh, mg_Metric *Metric, mg_Front *Front)
 {
-  int ierr, iloop, dim = Mesh->Dim, nodeID0;
-  double Popt[2], X0[4], X1[4], xint[2];
-  bool success = false, first = true, intersect = false;
-  mg_FrontFace *SeedFace, *FFace;
-  mg_List *CloseNodes, *VisitedSeedFaces;
+  int ierr;
+  double Popt[2], Jmax = ELLIPSEMAXJ;
+  bool success = false;
+  mg_FrontFace *SeedFace;
+  mg_List CloseNodes;
   mg_Ellipse Ellipse;
   
-  call(mg_alloc((void**)&VisitedSeedFaces, 1, sizeof(mg_List)));
-  mg_init_list(VisitedSeedFaces);
-  //allocate list for nodes that arecandidates for connection
-  call(mg_alloc((void**)&CloseNodes, 1, sizeof(mg_List)));
-  mg_init_list(CloseNodes);
-  
+  if (Mesh->Marks == NULL)
+    call(mg_create_marks(&Mesh->Marks));
+  //no front face is referenced between steps: regroup the loops in
+  //memory once enough faces have been recycled
+  call(mg_compact_front(Front, false));
+  if (Metric->engine == mge_Engine_Circle)
+    return mg_advance_front_circle(Mesh, Metric, Front);
+  //visited seed faces are marked in a new face epoch
+  mg_new_epoch(&Mesh->Marks->Face);
+  //list of nodes that are candidates for connection
+  mg_init_list(&CloseNodes);
   
-  call(mg_find_seed_face(Mesh, Metric, Front, VisitedSeedFaces, &SeedFace));
+  call(mg_find_seed_face(Mesh, Metric, Front, &SeedFace));
   
   while (!success) {
+    //a loop of 3 faces is the last triangle of its region
+    if (SeedFace->next->next->next == SeedFace) {
+      call(mg_tri_frm_face_node(Mesh, SeedFace,
+                                SeedFace->next->face->node[1], NULL));
+      call(mg_update_front(Mesh, Front, SeedFace));
+      break;
+    }
     //compute optimal point location
     call(mg_find_p_opt(Mesh, Metric, SeedFace, Popt));
     call(mg_ellipse_frm_face_p(Mesh, SeedFace->face, Popt, &Ellipse));
     
-    //build list of nodes within ellipse
+    //build list of nodes within ellipse, the whole loop once every
+    //face has failed (mg_front_tri_clear checks them)
     call(mg_nodes_frnt_dist_ellipse(Mesh, Front, SeedFace, &Ellipse,
-                                    SQRT2, CloseNodes));
+                                    (Jmax < INFINITY) ? SQRT2 : INFINITY,
+                                    &CloseNodes));
     //check if point intersects front
-    iloop = SeedFace->iloop;
-    FFace = Front->loop[iloop]->head;
-    first = true;
-    intersect = false;
-    nodeID0 = SeedFace->face->node[0];
-    while ((first || FFace != Front->loop[iloop]->head)
-           && !intersect) {
-      first = false;
-      if (FFace != SeedFace){
-        //compute intersection between front face and triangle height vector
-        X0[0] = Mesh->Coord[FFace->face->node[0]*dim];
-        X0[1] = Mesh->Coord[FFace->face->node[0]*dim+1];
-        X0[2] = Mesh->Coord[FFace->face->node[1]*dim];
-        X0[3] = Mesh->Coord[FFace->face->node[1]*dim+1];
-        //trinagle height vector
-        X1[0] = SeedFace->face->centroid[0];
-        X1[1] = SeedFace->face->centroid[1];
-        X1[2] = Popt[0];
-        X1[3] = Popt[1];
-        intersect = mg_edges_intersect(X0,X1, xint);
-        if (intersect) {
-          //if it is a boundary, add point to list otherwise break loop
-          if (FFace->face->elem[RIGHTNEIGHINDEX] >= 0)
-            continue;
-          //add nodes to list
-          call(mg_add_2_ord_set(FFace->face->node[0], &CloseNodes->nItem,
-                                &CloseNodes->Item, NULL, false));
-          call(mg_add_2_ord_set(FFace->face->node[1], &CloseNodes->nItem,
-                                &CloseNodes->Item, NULL, false));
-        }
-      }
-      FFace = FFace->next;
-    }
-    if (CloseNodes->nItem > 0){
+    if (Jmax < INFINITY)
+      call(mg_frnt_blocking_nodes(Mesh, Front, SeedFace, Popt, &CloseNodes));
+    if (CloseNodes.nItem > 0){
       //attempt to build element with existing nodes
       call(mg_bld_tri_frm_close_pts_ellipse(Mesh, Front, SeedFace, &Ellipse,
-                                            CloseNodes, &success));
+                                            Jmax, &CloseNodes, &success));
     }
-    CloseNodes[0].nItem = 0;
-    mg_free((void*)CloseNodes[0].Item);
+    CloseNodes.nItem = 0;
+    mg_new_epoch(&Mesh->Marks->Node);
     
     //if no node is acceptable
     if (!success) {
       //add node and check if new node is inside any of
       //the other triangles ellipses
-      call(mg_add_new_node_ellipse(Mesh, Front, &SeedFace, CloseNodes, Popt,
+      call(mg_add_new_node_ellipse(Mesh, Front, &SeedFace, &CloseNodes, Popt,
                                    &success));
       
       if (!success){//find another seedface
-        call(mg_find_seed_face(Mesh, Metric, Front, VisitedSeedFaces, &SeedFace));
+        //every face failed: sweep again taking the best existing node
+        if (Jmax < INFINITY && mg_front_visited(Mesh, Front)) {
+          Jmax = INFINITY;
+          mg_new_epoch(&Mesh->Marks->Face);
+        }
+        call(mg_find_seed_face(Mesh, Metric, Front, &SeedFace));
       }
     }
   }
-  VisitedSeedFaces->nItem = 0;
-  mg_free((void*)VisitedSeedFaces[0].Item);
-  mg_free((void*)VisitedSeedFaces);
-  mg_free((void*)CloseNodes);
   
   return err_OK;
 }
@@ -2225,21 +2748,27 @@ int mg_prealloc_msh_comp(mg_Mesh *Mesh, int nElem, int nFace, int nNode)
 /* Main program */
 int main(int argc, char *argv[])
 {
-  int ierr, len, i, tid;
-  char ParFile[MAXSTRLEN], *InFile, *OutFile,*pext;
+  int ierr, len, i = 0, tid, k, CkptInterval = CKPTINTERVAL;
+  char ParFile[MAXSTRLEN], *InFile, *OutFile,*pext, *CacheDir, *TolStr;
+  char *TypeStr, *ExportFile, *CkptFile = NULL;
+  bool resume;
   char cmd[5];
   mg_Mesh *Mesh;
   mg_Front Front;
   mg_Geometry *Geo;
-  mg_Metric *Metric;
+  mg_Metric *Metric = NULL;
+  mg_MeshStream *Stream = NULL;
+  mg_Checkpoint *Ckpt = NULL;
   
   
   /* Check number of arguments */
-  if( argc != 2 ){
+  resume = (argc == 3 && strcmp(argv[2], "--resume") == 0);
+  if( argc != 2 && !resume ){
     printf("Usage:\n");
-    printf("2dmg <parfile>\n");
+    printf("2dmg <parfile> [--resume]\n");
     printf("\n");
     printf("Where <parfile> is the name of the parameter file.\n");
+    printf("--resume continues from the file given as Checkpoint.\n");
     printf("\n");
     return error(err_INPUT_ERROR);
   }
@@ -2248,12 +2777,27 @@ int main(int argc, char *argv[])
   strcpy(ParFile, argv[1]);
   //parse input file an put in hash table
   call(mg_read_input_file(ParFile));
+  //optional checkpoints of the front advancement
+  if (mg_find_input_char("Checkpoint", &CkptFile) == err_OK &&
+      strcmp(CkptFile, "None") == 0)
+    CkptFile = NULL;
+  if (mg_find_input_char("CheckpointInterval", &TolStr) == err_OK)
+    CkptInterval = max(atoi(TolStr), 1);
   
   
   //Read boundary discretization or geometry file
   call(mg_get_input_char("BoundaryMesh", &InFile));
   len = (int)strlen(InFile);
-  if (strcmp(InFile, "None") != 0) {
+  if (resume) {
+    //the checkpoint replaces the boundary discretization and front
+    if (CkptFile == NULL) {
+      printf("--resume needs a Checkpoint file\n");
+      return error(err_INPUT_ERROR);
+    }
+    call(mg_read_checkpoint(CkptFile, &Mesh, &Front, &Metric, &i));
+    printf("Resuming %s at it = %d\n", CkptFile, i);
+  }
+  else if (strcmp(InFile, "None") != 0) {
     if (len < 5) {
       printf("Invalid BoundaryMesh filename");
       return err_INPUT_ERROR;
@@ -2269,32 +2813,75 @@ int main(int argc, char *argv[])
   else {//read geometry file
     call(mg_get_input_char("GeometryFile", &InFile));
     call(mg_read_geo(&Geo, InFile));
+    //optional cache of boundary discretizations
+    if (mg_find_input_char("SegmentCache", &CacheDir) == err_OK &&
+        strcmp(CacheDir, "None") != 0)
+      call(mg_create_seg_cache(&Geo->Cache, CacheDir));
     //mesh boundary and create initial front
     int nNodeInSeg[5]={19,19,19,19,25};
     Metric = malloc(sizeof(mg_Metric));
     //    Metric->type = mge_Metric_Uniform;
     Metric->type = mge_Metric_Analitic2;
+    //optional metric type (see mge_MetricName)
+    if (mg_find_input_char("MetricType", &TypeStr) == err_OK) {
+      for (k = 0; k < mge_Metric_Last; k++)
+        if (strcmp(TypeStr, mge_MetricName[k]) == 0) break;
+      if (k == mge_Metric_Last) return error(err_INPUT_ERROR);
+      Metric->type = (enum mge_Metric)k;
+    }
+    //optional front advancement engine (see mge_EngineName)
+    Metric->engine = mge_Engine_Auto;
+    if (mg_find_input_char("FrontEngine", &TypeStr) == err_OK) {
+      for (k = 0; k < mge_Engine_Last; k++)
+        if (strcmp(TypeStr, mge_EngineName[k]) == 0) break;
+      if (k == mge_Engine_Last) return error(err_INPUT_ERROR);
+      Metric->engine = (enum mge_Engine)k;
+    }
     Metric->order = 8;
+    Metric->tol = METRICQUADTOL;
+    //optional tolerance of metric length quadrature (<= 0: fixed order)
+    if (mg_find_input_char("MetricTolerance", &TolStr) == err_OK)
+      Metric->tol = atof(TolStr);
     //      Metric->type = mge_Metric_Uniform;
     //  Metric.order = 1;
     call(mg_create_mesh(&Metric->BGMesh));
     Metric->BGMesh->Dim = 2;
     call(mg_create_mesh(&Mesh));
     call(mg_create_bmesh_from_geo(Geo, Metric, nNodeInSeg, Mesh, &Front));
+    mg_seg_cache_report(Geo->Cache);
+    mg_destroy_seg_cache(Geo->Cache);
+    Geo->Cache = NULL;
+    //circles are enough if the metric type is isotropic
+    if (Metric->engine == mge_Engine_Auto)
+      Metric->engine = (mg_metric_isotropic(Metric))?mge_Engine_Circle:
+                                                     mge_Engine_Ellipse;
+    printf("Front engine: %s\n", mge_EngineName[Metric->engine]);
     //    mg_destroy_mesh(Metric->BGMesh);
     //    mg_free((void*)Metric);
   }
-  
-  //fill in face information
-  call(mg_calc_face_info(Mesh));
-  //fill in connectivities
-  call(mg_build_connectivity(Mesh));
-  //call(mg_prealloc_msh_comp(Mesh, 3, 15, 20));
-  //create front
-  call(mg_create_front(Mesh, &Front));
-
-  call(mg_mesh_2_matlab(Mesh, &Front, "mesh_initial.m"));
-  i = 0;
+  //face metric lengths use the generator's metric
+  call(mg_face_geom_set_metric(Mesh, Metric));
+  
+  if (!resume) {
+    //fill in face information
+    call(mg_calc_face_info(Mesh));
+    //fill in connectivities
+    call(mg_build_connectivity(Mesh));
+    //call(mg_prealloc_msh_comp(Mesh, 3, 15, 20));
+    //create front
+    call(mg_create_front(Mesh, &Front));
+    
+    call(mg_mesh_2_matlab(Mesh, &Front, "mesh_initial.m"));
+  }
+  call(mg_get_input_char("OutputMesh", &OutFile));
+  //optional streaming of final elements while the front advances
+  if (mg_find_input_char("StreamBound", &TolStr) == err_OK &&
+      strcmp(TolStr, "None") != 0) {
+    call(mg_open_mesh_stream(Mesh, OutFile, atof(TolStr), &Stream));
+    Front.Stream = Stream;
+  }
+  if (CkptFile != NULL)
+    call(mg_open_checkpoint(CkptFile, &Ckpt));
   //fork two threads: 1 for plotting and 1 for generating the mesh
 #pragma omp parallel num_threads(2) shared(i,Mesh, Front) private(tid)
   {
@@ -2317,7 +2904,17 @@ int main(int argc, char *argv[])
         //DEBUGGING
         //call(xf_VerifyFront2D(&Front));
         i++;
+        if (Stream != NULL && i%STREAMSWEEP == 0) {
+          ierr = error(mg_stream_sweep(Stream, Mesh, Metric, &Front));
+          if (ierr != err_OK) break;
+        }
+        if (Ckpt != NULL && i%CkptInterval == 0) {
+          ierr = error(mg_checkpoint(Ckpt, Mesh, &Front, Metric, i));
+          if (ierr != err_OK) break;
+        }
       }
+      //scratch buffers are private to this thread
+      mg_scratch_release();
     }
     else{
       printf("tid: %d\n",tid);
@@ -2330,13 +2927,25 @@ int main(int argc, char *argv[])
     }
   }
   //call(mg_plot_mesh(Mesh));
-  call(mg_get_input_char("OutputMesh", &OutFile));
-  call(mg_write_mesh(Mesh, OutFile));
+  call(mg_close_checkpoint(Ckpt));
+  Front.Stream = NULL;
+  if (Stream != NULL)
+    call(mg_close_mesh_stream(Stream, Mesh));
+  else
+    call(mg_write_mesh(Mesh, OutFile));
+  //optional export for visualization/solvers (VTUEXT or MSHEXT)
+  if (mg_find_input_char("ExportMesh", &ExportFile) == err_OK &&
+      strcmp(ExportFile, "None") != 0)
+    call(mg_export_mesh(Mesh, Metric, (Metric != NULL) ?
+                        EXPORTQUALITY|EXPORTMETRIC : EXPORTQUALITY,
+                        ExportFile));
   call(mg_mesh_2_matlab(Mesh, &Front, "mesh_final.m"));
   printf("Number of triangles: %d\nDone.\n",Mesh->nElem);
   
   call(mg_show_mesh(Mesh, NULL));
   
+  mg_destroy_front_coord(Front.Coord);
+  mg_destroy_front_pool(Front.Pool);
   mg_destroy_mesh(Mesh);
   //destroy hash table
   hdestroy();
@@ -0,0 +1,373 @@
+//
+//  2dmg_bmesh.c
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_utils.h"
+#include "2dmg_io.h"
+#include "2dmg_bmesh.h"
+
+//marker of the writer's byte order
+#define BMESHENDIAN       0x01020304
+//elements/faces gathered per write
+#define BMESHCHUNK        4096
+
+/******************************************************************/
+/* arrays of a binary mesh file, in file order */
+enum mge_BMeshArray {
+  mge_BMeshNames,
+  mge_BMeshBface,
+  mge_BMeshCoord,
+  mge_BMeshElemNode,
+  mge_BMeshFaceNode,
+  mge_BMeshFaceElem,
+  mge_BMeshArrayLast
+};
+
+/******************************************************************/
+/* file header */
+typedef struct
+{
+  char magic[8];
+  int version, endian;
+  int Dim, nNode, nFace, nElem, nBfg, nElemNode;
+  uint64_t Offset[mge_BMeshArrayLast]; //byte offset of each array
+  uint64_t Length[mge_BMeshArrayLast]; //byte length of each array
+  uint64_t Size; //file size
+}
+mg_BMeshHeader;
+
+/******************************************************************/
+/* function:  mg_bmesh_layout */
+/* fills lengths and aligned offsets of the arrays and the file size */
+static void mg_bmesh_layout(mg_BMeshHeader *Header)
+{
+  int k;
+  uint64_t off;
+  
+  Header->Length[mge_BMeshNames] = (uint64_t)Header->nBfg*MAXSTRLEN;
+  Header->Length[mge_BMeshBface] = (uint64_t)Header->nBfg*sizeof(int);
+  Header->Length[mge_BMeshCoord] =
+    (uint64_t)Header->nNode*Header->Dim*sizeof(double);
+  Header->Length[mge_BMeshElemNode] =
+    (uint64_t)Header->nElem*Header->nElemNode*sizeof(int);
+  Header->Length[mge_BMeshFaceNode] = (uint64_t)Header->nFace*2*sizeof(int);
+  Header->Length[mge_BMeshFaceElem] = (uint64_t)Header->nFace*2*sizeof(int);
+  off = sizeof(mg_BMeshHeader);
+  for (k = 0; k < mge_BMeshArrayLast; k++) {
+    off = (off+BMESHALIGN-1)/BMESHALIGN*BMESHALIGN;
+    Header->Offset[k] = off;
+    off += Header->Length[k];
+  }
+  Header->Size = off;
+}
+
+/******************************************************************/
+/* function:  mg_bmesh_pad */
+/* writes zeros up to byte offset "to" */
+static int mg_bmesh_pad(FILE *fid, uint64_t *pos, uint64_t to)
+{
+  static const char zero[BMESHALIGN] = {0};
+  
+  if (to < (*pos) || to-(*pos) > BMESHALIGN)
+    return err_LOGIC_ERROR;
+  if (to > (*pos) && fwrite(zero, 1, to-(*pos), fid) != to-(*pos))
+    return err_READWRITE_ERROR;
+  (*pos) = to;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_bmesh_put */
+/* writes n bytes of data at the current position */
+static int mg_bmesh_put(FILE *fid, uint64_t *pos, const void *data,
+                        size_t n)
+{
+  if (n > 0 && fwrite(data, 1, n, fid) != n)
+    return err_READWRITE_ERROR;
+  (*pos) += n;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_bmesh_write_arrays */
+/* writes the header and every array of Mesh to fid */
+static int mg_bmesh_write_arrays(mg_Mesh *Mesh, mg_BMeshHeader *Header,
+                                 FILE *fid, int *buf)
+{
+  int ierr, i, i0, n, j;
+  char Name[MAXSTRLEN];
+  uint64_t pos = 0;
+  
+  call(mg_bmesh_put(fid, &pos, Header, sizeof(mg_BMeshHeader)));
+  //boundary groups
+  call(mg_bmesh_pad(fid, &pos, Header->Offset[mge_BMeshNames]));
+  for (i = 0; i < Mesh->nBfg; i++) {
+    memset(Name, 0, MAXSTRLEN);
+    strncpy(Name, Mesh->BNames[i], MAXSTRLEN-1);
+    call(mg_bmesh_put(fid, &pos, Name, MAXSTRLEN));
+  }
+  call(mg_bmesh_pad(fid, &pos, Header->Offset[mge_BMeshBface]));
+  call(mg_bmesh_put(fid, &pos, Mesh->nBface, Header->Length[mge_BMeshBface]));
+  //coordinates are already contiguous
+  call(mg_bmesh_pad(fid, &pos, Header->Offset[mge_BMeshCoord]));
+  call(mg_bmesh_put(fid, &pos, Mesh->Coord, Header->Length[mge_BMeshCoord]));
+  //element-to-node, gathered in chunks
+  call(mg_bmesh_pad(fid, &pos, Header->Offset[mge_BMeshElemNode]));
+  for (i0 = 0; i0 < Mesh->nElem; i0 += BMESHCHUNK) {
+    n = min(BMESHCHUNK, Mesh->nElem-i0);
+    for (i = 0; i < n; i++)
+      for (j = 0; j < 3; j++)
+        buf[3*i+j] = Mesh->Elem[i0+i].node[j];
+    call(mg_bmesh_put(fid, &pos, buf, 3*n*sizeof(int)));
+  }
+  //face-to-node
+  call(mg_bmesh_pad(fid, &pos, Header->Offset[mge_BMeshFaceNode]));
+  for (i0 = 0; i0 < Mesh->nFace; i0 += BMESHCHUNK) {
+    n = min(BMESHCHUNK, Mesh->nFace-i0);
+    for (i = 0; i < n; i++) {
+      buf[2*i+0] = Mesh->Face[i0+i]->node[0];
+      buf[2*i+1] = Mesh->Face[i0+i]->node[1];
+    }
+    call(mg_bmesh_put(fid, &pos, buf, 2*n*sizeof(int)));
+  }
+  //face-to-element
+  call(mg_bmesh_pad(fid, &pos, Header->Offset[mge_BMeshFaceElem]));
+  for (i0 = 0; i0 < Mesh->nFace; i0 += BMESHCHUNK) {
+    n = min(BMESHCHUNK, Mesh->nFace-i0);
+    for (i = 0; i < n; i++) {
+      buf[2*i+0] = Mesh->Face[i0+i]->elem[LEFTNEIGHINDEX];
+      buf[2*i+1] = Mesh->Face[i0+i]->elem[RIGHTNEIGHINDEX];
+    }
+    call(mg_bmesh_put(fid, &pos, buf, 2*n*sizeof(int)));
+  }
+  if (pos != Header->Size) return error(err_LOGIC_ERROR);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_write_bmesh */
+/* writes Mesh to FileName in the binary format */
+int mg_write_bmesh(mg_Mesh *Mesh, const char *FileName)
+{
+  int ierr, i, *buf;
+  char TmpName[MAXLONGLINELEN+32];
+  mg_BMeshHeader Header;
+  FILE *fid;
+  
+  for (i = 0; i < Mesh->nElem; i++)
+    if (Mesh->Elem[i].nNode != 3) return error(err_NOT_SUPPORTED);
+  for (i = 0; i < Mesh->nFace; i++)
+    if (Mesh->Face[i]->nNode != 2) return error(err_NOT_SUPPORTED);
+  
+  memset(&Header, 0, sizeof(mg_BMeshHeader));
+  memcpy(Header.magic, BMESHMAGIC, 8);
+  Header.version = BMESHVERSION;
+  Header.endian = BMESHENDIAN;
+  Header.Dim = Mesh->Dim;
+  Header.nNode = Mesh->nNode;
+  Header.nFace = Mesh->nFace;
+  Header.nElem = Mesh->nElem;
+  Header.nBfg = Mesh->nBfg;
+  Header.nElemNode = 3;
+  mg_bmesh_layout(&Header);
+  
+  //write to a private file and rename so readers never map a
+  //partially written mesh
+  snprintf(TmpName, MAXLONGLINELEN+32, "%s.%d.tmp", FileName,
+           (int)getpid());
+  if ((fid = fopen(TmpName, "wb")) == NULL)
+    return error(err_READWRITE_ERROR);
+  if ((ierr = error(mg_alloc((void**)&buf, 3*BMESHCHUNK,
+                             sizeof(int)))) != err_OK) {
+    fclose(fid);
+    remove(TmpName);
+    return ierr;
+  }
+  ierr = error(mg_bmesh_write_arrays(Mesh, &Header, fid, buf));
+  mg_free((void*)buf);
+  if (ierr != err_OK) {
+    fclose(fid);
+    remove(TmpName);
+    return ierr;
+  }
+  if (fclose(fid) != 0 || rename(TmpName, FileName) != 0){
+    remove(TmpName);
+    return error(err_READWRITE_ERROR);
+  }
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_bmesh_check */
+/* validates a header against the size of the mapped file */
+static int mg_bmesh_check(const mg_BMeshHeader *Header, size_t Size)
+{
+  int k;
+  mg_BMeshHeader Ref;
+  
+  if (memcmp(Header->magic, BMESHMAGIC, 8) != 0)
+    return err_READWRITE_ERROR;
+  if (Header->version != BMESHVERSION || Header->endian != BMESHENDIAN)
+    return err_NOT_SUPPORTED;
+  if (Header->Dim != 2 || Header->nElemNode != 3 || Header->nNode < 0 ||
+      Header->nFace < 0 || Header->nElem < 0 || Header->nBfg < 0)
+    return err_READWRITE_ERROR;
+  //the layout is a function of the counts: recompute and compare
+  memcpy(&Ref, Header, sizeof(mg_BMeshHeader));
+  mg_bmesh_layout(&Ref);
+  for (k = 0; k < mge_BMeshArrayLast; k++)
+    if (Ref.Offset[k] != Header->Offset[k] ||
+        Ref.Length[k] != Header->Length[k])
+      return err_READWRITE_ERROR;
+  if (Ref.Size != Header->Size || Header->Size > (uint64_t)Size)
+    return err_READWRITE_ERROR;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_map_bmesh */
+/* maps a binary mesh file read-only */
+int mg_map_bmesh(const char *FileName, mg_BMesh **pBMesh)
+{
+  int ierr, fd;
+  struct stat st;
+  void *Base;
+  char *c;
+  const mg_BMeshHeader *Header;
+  mg_BMesh *BMesh;
+  
+  if ((fd = open(FileName, O_RDONLY)) < 0)
+    return error(err_READWRITE_ERROR);
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(mg_BMeshHeader)){
+    close(fd);
+    return error(err_READWRITE_ERROR);
+  }
+  Base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  //the mapping keeps the file referenced
+  close(fd);
+  if (Base == MAP_FAILED)
+    return error(err_READWRITE_ERROR);
+  Header = (const mg_BMeshHeader*)Base;
+  if ((ierr = error(mg_bmesh_check(Header, (size_t)st.st_size))) != err_OK){
+    munmap(Base, (size_t)st.st_size);
+    return ierr;
+  }
+  if ((ierr = error(mg_alloc((void**)&BMesh, 1, sizeof(mg_BMesh)))) != err_OK){
+    munmap(Base, (size_t)st.st_size);
+    return ierr;
+  }
+  c = (char*)Base;
+  BMesh->Base = Base;
+  BMesh->Size = (size_t)st.st_size;
+  BMesh->Dim = Header->Dim;
+  BMesh->nNode = Header->nNode;
+  BMesh->nFace = Header->nFace;
+  BMesh->nElem = Header->nElem;
+  BMesh->nBfg = Header->nBfg;
+  BMesh->nElemNode = Header->nElemNode;
+  BMesh->BNames = (const char*)(c+Header->Offset[mge_BMeshNames]);
+  BMesh->nBface = (const int*)(c+Header->Offset[mge_BMeshBface]);
+  BMesh->Coord = (const double*)(c+Header->Offset[mge_BMeshCoord]);
+  BMesh->ElemNode = (const int*)(c+Header->Offset[mge_BMeshElemNode]);
+  BMesh->FaceNode = (const int*)(c+Header->Offset[mge_BMeshFaceNode]);
+  BMesh->FaceElem = (const int*)(c+Header->Offset[mge_BMeshFaceElem]);
+  (*pBMesh) = BMesh;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_unmap_bmesh */
+/* unmaps the file, arrays of BMesh become invalid */
+void mg_unmap_bmesh(mg_BMesh *BMesh)
+{
+  if (BMesh == NULL) return;
+  if (BMesh->Base != NULL)
+    munmap(BMesh->Base, BMesh->Size);
+  mg_free((void*)BMesh);
+}
+
+/******************************************************************/
+/* function:  mg_bmesh_2_mesh */
+/* builds an mg_Mesh from the arrays of BMesh, derived data pending */
+int mg_bmesh_2_mesh(mg_BMesh *BMesh, mg_Mesh **pMesh)
+{
+  int ierr, i, j;
+  mg_Mesh *Mesh;
+  mg_FaceData *Face;
+  mg_ElemData *Elem;
+  
+  //node and face indices are trusted by the linking below
+  for (i = 0; i < BMesh->nElem*BMesh->nElemNode; i++)
+    if (BMesh->ElemNode[i] < 0 || BMesh->ElemNode[i] >= BMesh->nNode)
+      return error(err_READWRITE_ERROR);
+  for (i = 0; i < 2*BMesh->nFace; i++) {
+    if (BMesh->FaceNode[i] < 0 || BMesh->FaceNode[i] >= BMesh->nNode ||
+        BMesh->FaceElem[i] >= BMesh->nElem)
+      return error(err_READWRITE_ERROR);
+  }
+  
+  call(mg_create_mesh(&Mesh));
+  Mesh->Dim   = BMesh->Dim;
+  Mesh->nNode = BMesh->nNode;
+  Mesh->nFace = BMesh->nFace;
+  Mesh->nElem = BMesh->nElem;
+  Mesh->nBfg  = BMesh->nBfg;
+  call(mg_alloc((void **)&Mesh->Coord, Mesh->nNode*Mesh->Dim,
+                sizeof(double)));
+  if (Mesh->nNode > 0)
+    memcpy(Mesh->Coord, BMesh->Coord,
+           Mesh->nNode*Mesh->Dim*sizeof(double));
+  call(mg_alloc2((void ***)&Mesh->BNames, Mesh->nBfg, MAXSTRLEN,
+                 sizeof(char)));
+  call(mg_alloc((void **)&Mesh->nBface, Mesh->nBfg, sizeof(int)));
+  for (i = 0; i < Mesh->nBfg; i++) {
+    strncpy(Mesh->BNames[i], BMesh->BNames+i*MAXSTRLEN, MAXSTRLEN-1);
+    Mesh->BNames[i][MAXSTRLEN-1] = '\0';
+    Mesh->nBface[i] = BMesh->nBface[i];
+  }
+  
+  //elements (face and neighbor entries are set from the faces when
+  //first required)
+  call(mg_alloc((void**)&Mesh->Elem, Mesh->nElem, sizeof(mg_ElemData)));
+  for (i = 0; i < Mesh->nElem; i++) {
+    Elem = Mesh->Elem+i;
+    Elem->nNode = BMesh->nElemNode;
+    call(mg_alloc((void**)&Elem->node, Elem->nNode, sizeof(int)));
+    Elem->face = Elem->nbor = NULL;
+    for (j = 0; j < Elem->nNode; j++)
+      Elem->node[j] = BMesh->ElemNode[i*Elem->nNode+j];
+  }
+  //faces
+  call(mg_alloc((void**)&Mesh->Face, Mesh->nFace, sizeof(mg_FaceData*)));
+  for (i = 0; i < Mesh->nFace; i++) {
+    call(mg_alloc((void**)&Face, 1, sizeof(mg_FaceData)));
+    mg_init_face(Face);
+    Mesh->Face[i] = Face;
+    Face->nNode = 2;
+    call(mg_alloc((void**)&Face->node, Face->nNode, sizeof(int)));
+    for (j = 0; j < Face->nNode; j++)
+      Face->node[j] = BMesh->FaceNode[2*i+j];
+    Face->elem[LEFTNEIGHINDEX] = BMesh->FaceElem[2*i+0];
+    Face->elem[RIGHTNEIGHINDEX] = BMesh->FaceElem[2*i+1];
+  }
+  Mesh->Pending = MESHALL;
+  
+  (*pMesh) = Mesh;
+  
+  return err_OK;
+}
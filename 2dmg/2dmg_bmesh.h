@@ -0,0 +1,54 @@
+//
+//  2dmg_bmesh.h
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#ifndef ___dmg___dmg_bmesh__
+#define ___dmg___dmg_bmesh__
+
+#include <stdio.h>
+#include <stdint.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+
+/******************************************************************/
+/* binary mesh file: a fixed header with the counts and the byte
+ offset of every array, followed by the raw arrays (native byte order,
+ each starting on a BMESHALIGN boundary):
+ boundary group names (MAXSTRLEN chars each), faces per group,
+ coordinates, element-to-node, face-to-node and face-to-element
+ (left, right). The file can be mapped and used in place */
+#define BMESHVERSION      1
+#define BMESHMAGIC        "2DMGBMSH"
+#define BMESHEXT          ".bmsh"
+#define BMESHALIGN        64
+
+/******************************************************************/
+/* function:  mg_write_bmesh */
+/* writes Mesh to FileName in the binary format. Only triangles are
+ supported */
+int mg_write_bmesh(mg_Mesh *Mesh, const char *FileName);
+
+/******************************************************************/
+/* function:  mg_map_bmesh */
+/* maps a binary mesh file read-only and points the arrays of
+ (*pBMesh) into the mapping. Fails with err_READWRITE_ERROR if the
+ file is truncated or not a binary mesh and err_NOT_SUPPORTED if it
+ was written with another version or byte order */
+int mg_map_bmesh(const char *FileName, mg_BMesh **pBMesh);
+
+/******************************************************************/
+/* function:  mg_unmap_bmesh */
+/* unmaps the file, arrays of BMesh become invalid */
+void mg_unmap_bmesh(mg_BMesh *BMesh);
+
+/******************************************************************/
+/* function:  mg_bmesh_2_mesh */
+/* builds an mg_Mesh from the arrays of BMesh, mapped from a binary
+ file or parsed from text. Connectivities, element links, face
+ geometry and the quadtree are left to mg_mesh_require */
+int mg_bmesh_2_mesh(mg_BMesh *BMesh, mg_Mesh **pMesh);
+
+#endif
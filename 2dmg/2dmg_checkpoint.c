@@ -0,0 +1,662 @@
+//
+//  2dmg_checkpoint.c
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <unistd.h>
+#include <omp.h>
+#include "2dmg_checkpoint.h"
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_utils.h"
+#include "2dmg_frontpool.h"
+#include "2dmg_facegeom.h"
+
+//written after the version to detect files from the other byte order
+#define CKPTBYTEORDER     0x01020304
+
+/******************************************************************/
+/* function:  mg_ckpt_put */
+/* appends n bytes to the snapshot. The buffer grows with realloc
+ since a snapshot can exceed the int sizes of mg_realloc */
+static int mg_ckpt_put(mg_Checkpoint *Ckpt, const void *p, size_t n)
+{
+  size_t Cap;
+  unsigned char *Data;
+  
+  if (Ckpt->Len+n > Ckpt->Cap) {
+    Cap = max(2*Ckpt->Cap, Ckpt->Len+n);
+    if ((Data = (unsigned char*)realloc(Ckpt->Data, Cap)) == NULL)
+      return error(err_MEMORY_ERROR);
+    Ckpt->Data = Data;
+    Ckpt->Cap = Cap;
+  }
+  if (n > 0) memcpy(Ckpt->Data+Ckpt->Len, p, n);
+  Ckpt->Len += n;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_ckpt_put_int */
+static int mg_ckpt_put_int(mg_Checkpoint *Ckpt, int v)
+{
+  return mg_ckpt_put(Ckpt, &v, sizeof(int));
+}
+
+/******************************************************************/
+/* function:  mg_ckpt_put_list */
+static int mg_ckpt_put_list(mg_Checkpoint *Ckpt, mg_List *List)
+{
+  int ierr;
+  
+  call(mg_ckpt_put_int(Ckpt, List->nItem));
+  call(mg_ckpt_put(Ckpt, List->Item, List->nItem*sizeof(int)));
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_ckpt_put_mesh */
+/* appends Mesh, all component slots included */
+static int mg_ckpt_put_mesh(mg_Checkpoint *Ckpt, mg_Mesh *Mesh)
+{
+  int ierr, i, g, nNode, nElem, nFace, flags;
+  char Name[MAXSTRLEN];
+  mg_ElemData *Elem;
+  mg_FaceData *Face;
+  
+  call(mg_ckpt_put_int(Ckpt, Mesh->Dim));
+  call(mg_ckpt_put_int(Ckpt, Mesh->Pending));
+  call(mg_ckpt_put_int(Ckpt, Mesh->nNode));
+  call(mg_ckpt_put_int(Ckpt, Mesh->nElem));
+  call(mg_ckpt_put_int(Ckpt, Mesh->nFace));
+  call(mg_ckpt_put_int(Ckpt, Mesh->nBfg));
+  for (g = 0; g < Mesh->nBfg; g++) {
+    //padded with zeros so that equal states give equal files
+    memset(Name, 0, MAXSTRLEN);
+    strncpy(Name, Mesh->BNames[g], MAXSTRLEN-1);
+    call(mg_ckpt_put(Ckpt, Name, MAXSTRLEN));
+    call(mg_ckpt_put_int(Ckpt, Mesh->nBface[g]));
+  }
+  call(mg_ckpt_put_list(Ckpt, Mesh->Stack->Node));
+  call(mg_ckpt_put_list(Ckpt, Mesh->Stack->Elem));
+  call(mg_ckpt_put_list(Ckpt, Mesh->Stack->Face));
+  nNode = Mesh->nNode+Mesh->Stack->Node->nItem;
+  nElem = Mesh->nElem+Mesh->Stack->Elem->nItem;
+  nFace = Mesh->nFace+Mesh->Stack->Face->nItem;
+  //nodes
+  call(mg_ckpt_put(Ckpt, Mesh->Coord, nNode*Mesh->Dim*sizeof(double)));
+  flags = (Mesh->Node2Elem != NULL)|((Mesh->Node2Face != NULL) << 1);
+  call(mg_ckpt_put_int(Ckpt, flags));
+  for (i = 0; i < nNode; i++) {
+    if (Mesh->Node2Elem != NULL)
+      call(mg_ckpt_put_list(Ckpt, Mesh->Node2Elem+i));
+    if (Mesh->Node2Face != NULL)
+      call(mg_ckpt_put_list(Ckpt, Mesh->Node2Face+i));
+  }
+  //elements
+  for (i = 0; i < nElem; i++) {
+    Elem = Mesh->Elem+i;
+    call(mg_ckpt_put_int(Ckpt, Elem->nNode));
+    call(mg_ckpt_put(Ckpt, Elem->node, Elem->nNode*sizeof(int)));
+    //links not built yet are left out
+    if (Mesh->Pending & MESHLINKS) continue;
+    call(mg_ckpt_put(Ckpt, Elem->face, Elem->nNode*sizeof(int)));
+    call(mg_ckpt_put(Ckpt, Elem->nbor, Elem->nNode*sizeof(int)));
+  }
+  //faces (normal and centroid are NULL until the face info is set)
+  for (i = 0; i < nFace; i++) {
+    Face = Mesh->Face[i];
+    call(mg_ckpt_put_int(Ckpt, Face->nNode));
+    call(mg_ckpt_put(Ckpt, Face->node, Face->nNode*sizeof(int)));
+    call(mg_ckpt_put(Ckpt, Face->elem, 2*sizeof(int)));
+    flags = (Face->normal != NULL)|((Face->centroid != NULL) << 1);
+    call(mg_ckpt_put_int(Ckpt, flags));
+    if (Face->normal != NULL)
+      call(mg_ckpt_put(Ckpt, Face->normal, Mesh->Dim*sizeof(double)));
+    if (Face->centroid != NULL)
+      call(mg_ckpt_put(Ckpt, Face->centroid, Mesh->Dim*sizeof(double)));
+    //Marea is computed again once the metric is set on resume
+    call(mg_ckpt_put(Ckpt, &Face->area, sizeof(double)));
+  }
+  
+  return err_OK;
+}
+
+//front face and its position in the loop traversals
+typedef struct
+{
+  mg_FrontFace *FFace;
+  int pos;
+}
+mg_CkptFace;
+
+/******************************************************************/
+/* function:  mg_ckpt_compare_face */
+/* qsort/bsearch comparison of mg_CkptFace by face address */
+static int mg_ckpt_compare_face(const void *a, const void *b)
+{
+  uintptr_t pa = (uintptr_t)((const mg_CkptFace*)a)->FFace;
+  uintptr_t pb = (uintptr_t)((const mg_CkptFace*)b)->FFace;
+  
+  return (pa > pb)-(pa < pb);
+}
+
+/******************************************************************/
+/* function:  mg_ckpt_put_front */
+/* appends the loops of Front, each in traversal order from its head,
+ followed by their ordered face lists as they stand, with the faces
+ numbered in that traversal order. Loops emptied by the advancement
+ keep their place */
+static int mg_ckpt_put_front(mg_Checkpoint *Ckpt, mg_Front *Front)
+{
+  int ierr, iloop, i, n, nTotal, tail;
+  mg_Loop *Loop;
+  mg_FrontFace *FFace, **Visit;
+  mg_CkptFace *Sorted, Key, *Found;
+  mg_OrderedDataList *List;
+  
+  call(mg_ckpt_put_int(Ckpt, Front->nloop));
+  call(mg_ckpt_put(Ckpt, &Front->Version, sizeof(unsigned int)));
+  //releases since the last compaction decide when the next one runs
+  call(mg_ckpt_put_int(Ckpt, Front->Pool->nRelease));
+  call(mg_alloc((void**)&Visit, Front->Pool->nActive,
+                sizeof(mg_FrontFace*)));
+  nTotal = 0;
+  for (iloop = 0; iloop < Front->nloop; iloop++) {
+    Loop = Front->loop[iloop];
+    call(mg_ckpt_put_int(Ckpt, Loop != NULL));
+    if (Loop == NULL) continue;
+    call(mg_ckpt_put_int(Ckpt, Loop->FacesInLoop->DataSize));
+    //a loop closes on its head within the active records
+    n = 0;
+    tail = -1;
+    if ((FFace = Loop->head) != NULL) {
+      do {
+        if (nTotal+n == Front->Pool->nActive) {
+          mg_free((void*)Visit);
+          return error(err_LOGIC_ERROR);
+        }
+        if (FFace == Loop->tail) tail = n;
+        Visit[nTotal+n++] = FFace;
+        FFace = FFace->next;
+      } while (FFace != Loop->head);
+      if (tail < 0) {
+        mg_free((void*)Visit);
+        return error(err_LOGIC_ERROR);
+      }
+    }
+    call(mg_ckpt_put_int(Ckpt, n));
+    for (i = nTotal; i < nTotal+n; i++) {
+      call(mg_ckpt_put_int(Ckpt, Visit[i]->ID));
+      call(mg_ckpt_put_int(Ckpt, Visit[i]->iloop));
+    }
+    if (n > 0) call(mg_ckpt_put_int(Ckpt, tail));
+    nTotal += n;
+  }
+  //face lists, their data as positions in the traversals
+  call(mg_alloc((void**)&Sorted, nTotal, sizeof(mg_CkptFace)));
+  for (i = 0; i < nTotal; i++) {
+    Sorted[i].FFace = Visit[i];
+    Sorted[i].pos = i;
+  }
+  if (nTotal > 0)
+    qsort(Sorted, nTotal, sizeof(mg_CkptFace), mg_ckpt_compare_face);
+  for (iloop = 0; iloop < Front->nloop; iloop++) {
+    if (Front->loop[iloop] == NULL) continue;
+    List = Front->loop[iloop]->FacesInLoop;
+    call(mg_ckpt_put_int(Ckpt, List->nEntry));
+    for (i = 0; i < List->nEntry; i++) {
+      Key.FFace = (mg_FrontFace*)List->Data[i];
+      Found = (nTotal > 0)?bsearch(&Key, Sorted, nTotal,
+                                   sizeof(mg_CkptFace),
+                                   mg_ckpt_compare_face):NULL;
+      call(mg_ckpt_put_int(Ckpt, List->Entry[i]));
+      call(mg_ckpt_put_int(Ckpt, (Found != NULL)?Found->pos:-1));
+    }
+  }
+  mg_free((void*)Visit);
+  mg_free((void*)Sorted);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_ckpt_writer */
+/* writes the snapshot next to the checkpoint and renames it over */
+static void *mg_ckpt_writer(void *arg)
+{
+  int ierr = err_OK;
+  char *TmpName;
+  size_t len;
+  FILE *fid;
+  mg_Checkpoint *Ckpt = (mg_Checkpoint*)arg;
+  
+  len = strlen(Ckpt->FileName)+5;
+  if ((TmpName = (char*)malloc(len)) == NULL)
+    ierr = error(err_MEMORY_ERROR);
+  else {
+    snprintf(TmpName, len, "%s.tmp", Ckpt->FileName);
+    if ((fid = fopen(TmpName, "wb")) == NULL)
+      ierr = error(err_READWRITE_ERROR);
+    else {
+      if (fwrite(Ckpt->Data, 1, Ckpt->Len, fid) != Ckpt->Len ||
+          fflush(fid) != 0 || fsync(fileno(fid)) != 0)
+        ierr = error(err_READWRITE_ERROR);
+      if (fclose(fid) != 0 && ierr == err_OK)
+        ierr = error(err_READWRITE_ERROR);
+      if (ierr == err_OK && rename(TmpName, Ckpt->FileName) != 0)
+        ierr = error(err_READWRITE_ERROR);
+    }
+    free(TmpName);
+  }
+  pthread_mutex_lock(&Ckpt->Lock);
+  if (ierr != err_OK && Ckpt->ierr == err_OK) Ckpt->ierr = ierr;
+  Ckpt->Busy = false;
+  pthread_mutex_unlock(&Ckpt->Lock);
+  
+  return NULL;
+}
+
+/******************************************************************/
+/* function:  mg_open_checkpoint */
+/* creates a writer for checkpoints in FileName */
+int mg_open_checkpoint(const char *FileName, mg_Checkpoint **pCkpt)
+{
+  int ierr;
+  mg_Checkpoint *Ckpt;
+  
+  call(mg_alloc((void**)&Ckpt, 1, sizeof(mg_Checkpoint)));
+  memset(Ckpt, 0, sizeof(mg_Checkpoint));
+  call(mg_alloc((void**)&Ckpt->FileName, (int)strlen(FileName)+1,
+                sizeof(char)));
+  strcpy(Ckpt->FileName, FileName);
+  pthread_mutex_init(&Ckpt->Lock, NULL);
+  (*pCkpt) = Ckpt;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_checkpoint */
+/* takes a snapshot of the advancement state and hands it to the
+ writer thread */
+int mg_checkpoint(mg_Checkpoint *Ckpt, mg_Mesh *Mesh, mg_Front *Front,
+                  mg_Metric *Metric, int Iter)
+{
+  int ierr;
+  unsigned int order = CKPTBYTEORDER;
+  bool busy;
+  double t0;
+  
+  pthread_mutex_lock(&Ckpt->Lock);
+  busy = Ckpt->Busy;
+  ierr = Ckpt->ierr;
+  pthread_mutex_unlock(&Ckpt->Lock);
+  if (ierr != err_OK) return ierr;
+  //the loop does not wait for a slow disk
+  if (busy) {
+    Ckpt->nSkip++;
+    return err_OK;
+  }
+  if (Ckpt->Started) {
+    pthread_join(Ckpt->Thread, NULL);
+    Ckpt->Started = false;
+  }
+  
+  t0 = omp_get_wtime();
+  Ckpt->Len = 0;
+  call(mg_ckpt_put(Ckpt, CKPTMAGIC, 8));
+  call(mg_ckpt_put_int(Ckpt, CKPTVERSION));
+  call(mg_ckpt_put(Ckpt, &order, sizeof(unsigned int)));
+  call(mg_ckpt_put_int(Ckpt, Iter));
+  call(mg_ckpt_put_int(Ckpt, Metric != NULL));
+  if (Metric != NULL) {
+    call(mg_ckpt_put_int(Ckpt, Metric->type));
+    call(mg_ckpt_put_int(Ckpt, Metric->engine));
+    call(mg_ckpt_put_int(Ckpt, Metric->order));
+    call(mg_ckpt_put(Ckpt, &Metric->tol, sizeof(double)));
+    call(mg_ckpt_put_int(Ckpt, Metric->BGMesh != NULL));
+    if (Metric->BGMesh != NULL)
+      call(mg_ckpt_put_mesh(Ckpt, Metric->BGMesh));
+  }
+  call(mg_ckpt_put_mesh(Ckpt, Mesh));
+  call(mg_ckpt_put_front(Ckpt, Front));
+  call(mg_ckpt_put(Ckpt, CKPTMAGIC, 8));
+  Ckpt->Seconds += omp_get_wtime()-t0;
+  Ckpt->nWrite++;
+  
+  Ckpt->Busy = Ckpt->Started = true;
+  if (pthread_create(&Ckpt->Thread, NULL, mg_ckpt_writer, Ckpt) != 0) {
+    Ckpt->Busy = Ckpt->Started = false;
+    return error(err_MEMORY_ERROR);
+  }
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_close_checkpoint */
+/* waits for the writer, reports and frees Ckpt */
+int mg_close_checkpoint(mg_Checkpoint *Ckpt)
+{
+  int ierr;
+  
+  if (Ckpt == NULL) return err_OK;
+  if (Ckpt->Started) pthread_join(Ckpt->Thread, NULL);
+  ierr = Ckpt->ierr;
+  printf("Checkpoints %s: %d written, %d skipped (writer busy), %1.3f s in snapshots\n",
+         Ckpt->FileName, Ckpt->nWrite, Ckpt->nSkip, Ckpt->Seconds);
+  pthread_mutex_destroy(&Ckpt->Lock);
+  free(Ckpt->Data);
+  mg_free((void*)Ckpt->FileName);
+  mg_free((void*)Ckpt);
+  
+  return ierr;
+}
+
+/******************************************************************/
+/* function:  mg_ckpt_get */
+/* reads n bytes, err_READWRITE_ERROR if the file ends first */
+static int mg_ckpt_get(FILE *fid, void *p, size_t n)
+{
+  if (n > 0 && fread(p, 1, n, fid) != n) return err_READWRITE_ERROR;
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_ckpt_get_count */
+/* reads an int in [0, limit] */
+static int mg_ckpt_get_count(FILE *fid, int limit, int *n)
+{
+  if (mg_ckpt_get(fid, n, sizeof(int)) != err_OK ||
+      (*n) < 0 || (*n) > limit)
+    return err_READWRITE_ERROR;
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_ckpt_get_array */
+/* reads n items of size bytes into a new array */
+static int mg_ckpt_get_array(FILE *fid, int n, int size, void **pArray)
+{
+  int ierr;
+  
+  if (n > INT_MAX/max(size, 1)) return err_READWRITE_ERROR;
+  call(mg_alloc(pArray, n, size));
+  return mg_ckpt_get(fid, (*pArray), (size_t)n*size);
+}
+
+/******************************************************************/
+/* function:  mg_ckpt_get_list */
+static int mg_ckpt_get_list(FILE *fid, mg_List *List)
+{
+  mg_init_list(List);
+  if (mg_ckpt_get_count(fid, INT_MAX/sizeof(int), &List->nItem) != err_OK)
+    return err_READWRITE_ERROR;
+  return mg_ckpt_get_array(fid, List->nItem, sizeof(int),
+                           (void**)&List->Item);
+}
+
+/******************************************************************/
+/* function:  mg_ckpt_get_mesh */
+/* inverse of mg_ckpt_put_mesh */
+static int mg_ckpt_get_mesh(FILE *fid, mg_Mesh **pMesh)
+{
+  int ierr, i, g, nNode, nElem, nFace, flags;
+  mg_Mesh *Mesh;
+  mg_ElemData *Elem;
+  mg_FaceData *Face;
+  mg_FaceGeom *Geom;
+  
+  call(mg_create_mesh(&Mesh));
+  (*pMesh) = Mesh;
+  if (mg_ckpt_get_count(fid, 3, &Mesh->Dim) != err_OK ||
+      mg_ckpt_get_count(fid, MESHALL, &Mesh->Pending) != err_OK ||
+      mg_ckpt_get_count(fid, INT_MAX, &Mesh->nNode) != err_OK ||
+      mg_ckpt_get_count(fid, INT_MAX, &Mesh->nElem) != err_OK ||
+      mg_ckpt_get_count(fid, INT_MAX, &Mesh->nFace) != err_OK ||
+      mg_ckpt_get_count(fid, INT_MAX/MAXSTRLEN, &Mesh->nBfg) != err_OK)
+    return error(err_READWRITE_ERROR);
+  call(mg_alloc2((void ***)&Mesh->BNames, Mesh->nBfg, MAXSTRLEN,
+                 sizeof(char)));
+  call(mg_alloc((void**)&Mesh->nBface, Mesh->nBfg, sizeof(int)));
+  for (g = 0; g < Mesh->nBfg; g++) {
+    if (mg_ckpt_get(fid, Mesh->BNames[g], MAXSTRLEN) != err_OK ||
+        mg_ckpt_get(fid, Mesh->nBface+g, sizeof(int)) != err_OK)
+      return error(err_READWRITE_ERROR);
+    Mesh->BNames[g][MAXSTRLEN-1] = '\0';
+  }
+  if (mg_ckpt_get_list(fid, Mesh->Stack->Node) != err_OK ||
+      mg_ckpt_get_list(fid, Mesh->Stack->Elem) != err_OK ||
+      mg_ckpt_get_list(fid, Mesh->Stack->Face) != err_OK)
+    return error(err_READWRITE_ERROR);
+  nNode = Mesh->nNode+Mesh->Stack->Node->nItem;
+  nElem = Mesh->nElem+Mesh->Stack->Elem->nItem;
+  nFace = Mesh->nFace+Mesh->Stack->Face->nItem;
+  if (nNode < 0 || nElem < 0 || nFace < 0 ||
+      nNode > INT_MAX/(max(Mesh->Dim, 1)*(int)sizeof(double)) ||
+      nElem > INT_MAX/(int)sizeof(mg_ElemData) ||
+      nFace > INT_MAX/(int)sizeof(mg_FaceData*))
+    return error(err_READWRITE_ERROR);
+  //nodes
+  if (mg_ckpt_get_array(fid, nNode*Mesh->Dim, sizeof(double),
+                        (void**)&Mesh->Coord) != err_OK ||
+      mg_ckpt_get_count(fid, 3, &flags) != err_OK)
+    return error(err_READWRITE_ERROR);
+  if (flags & 1)
+    call(mg_alloc((void**)&Mesh->Node2Elem, nNode, sizeof(mg_List)));
+  if (flags & 2)
+    call(mg_alloc((void**)&Mesh->Node2Face, nNode, sizeof(mg_List)));
+  for (i = 0; i < nNode; i++) {
+    if ((flags & 1) && mg_ckpt_get_list(fid, Mesh->Node2Elem+i) != err_OK)
+      return error(err_READWRITE_ERROR);
+    if ((flags & 2) && mg_ckpt_get_list(fid, Mesh->Node2Face+i) != err_OK)
+      return error(err_READWRITE_ERROR);
+  }
+  //elements
+  call(mg_alloc((void**)&Mesh->Elem, nElem, sizeof(mg_ElemData)));
+  for (i = 0; i < nElem; i++) {
+    Elem = Mesh->Elem+i;
+    Elem->node = Elem->face = Elem->nbor = NULL;
+    if (mg_ckpt_get_count(fid, INT_MAX/sizeof(int), &Elem->nNode) != err_OK ||
+        mg_ckpt_get_array(fid, Elem->nNode, sizeof(int),
+                          (void**)&Elem->node) != err_OK)
+      return error(err_READWRITE_ERROR);
+    if (Mesh->Pending & MESHLINKS) continue;
+    if (mg_ckpt_get_array(fid, Elem->nNode, sizeof(int),
+                          (void**)&Elem->face) != err_OK ||
+        mg_ckpt_get_array(fid, Elem->nNode, sizeof(int),
+                          (void**)&Elem->nbor) != err_OK)
+      return error(err_READWRITE_ERROR);
+  }
+  //faces, their geometry restored to the arrays of the mesh
+  call(mg_alloc((void**)&Mesh->Face, nFace, sizeof(mg_FaceData*)));
+  call(mg_face_geom_reserve(Mesh, nFace));
+  Geom = Mesh->FaceGeom;
+  for (i = 0; i < nFace; i++) {
+    call(mg_alloc((void**)&Face, 1, sizeof(mg_FaceData)));
+    mg_init_face(Face);
+    Mesh->Face[i] = Face;
+    if (mg_ckpt_get_count(fid, INT_MAX/sizeof(int), &Face->nNode) != err_OK ||
+        mg_ckpt_get_array(fid, Face->nNode, sizeof(int),
+                          (void**)&Face->node) != err_OK ||
+        mg_ckpt_get(fid, Face->elem, 2*sizeof(int)) != err_OK ||
+        mg_ckpt_get_count(fid, 3, &flags) != err_OK)
+      return error(err_READWRITE_ERROR);
+    //normal and centroid are set together
+    if (flags == 1 || flags == 2) return error(err_READWRITE_ERROR);
+    if (flags == 3) {
+      Face->normal = Geom->Normal+Mesh->Dim*i;
+      Face->centroid = Geom->Centroid+Mesh->Dim*i;
+      if (mg_ckpt_get(fid, Face->normal, Mesh->Dim*sizeof(double)) != err_OK ||
+          mg_ckpt_get(fid, Face->centroid,
+                      Mesh->Dim*sizeof(double)) != err_OK)
+        return error(err_READWRITE_ERROR);
+    }
+    if (mg_ckpt_get(fid, &Face->area, sizeof(double)) != err_OK)
+      return error(err_READWRITE_ERROR);
+    Geom->Length[i] = Face->area;
+    Geom->MLength[i] = Face->Marea = -1.0;
+  }
+  call(mg_face_geom_sync(Mesh));
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_ckpt_get_front */
+/* inverse of mg_ckpt_put_front: faces are taken from a new pool in
+ loop order, as a compaction would leave them */
+static int mg_ckpt_get_front(FILE *fid, mg_Mesh *Mesh, mg_Front *Front)
+{
+  int ierr, iloop, i, n, nTotal, present, DataSize, tail, nRelease, pos;
+  int nFace = Mesh->nFace+Mesh->Stack->Face->nItem;
+  mg_Loop *Loop;
+  mg_FrontFace **FFace = NULL;
+  mg_OrderedDataList *List;
+  
+  Front->nloop = 0;
+  Front->loop = NULL;
+  Front->Coord = NULL;
+  Front->Stream = NULL;
+  call(mg_create_front_pool(&Front->Pool));
+  if (mg_ckpt_get_count(fid, INT_MAX/sizeof(mg_Loop*), &n) != err_OK ||
+      mg_ckpt_get(fid, &Front->Version, sizeof(unsigned int)) != err_OK ||
+      mg_ckpt_get_count(fid, INT_MAX, &nRelease) != err_OK)
+    return error(err_READWRITE_ERROR);
+  call(mg_alloc((void**)&Front->loop, n, sizeof(mg_Loop*)));
+  Front->nloop = n;
+  nTotal = 0;
+  for (iloop = 0; iloop < Front->nloop; iloop++) {
+    Front->loop[iloop] = NULL;
+    if (mg_ckpt_get_count(fid, 1, &present) != err_OK)
+      return error(err_READWRITE_ERROR);
+    if (!present) continue;
+    call(mg_alloc((void**)&Loop, 1, sizeof(mg_Loop)));
+    Front->loop[iloop] = Loop;
+    Loop->head = Loop->tail = NULL;
+    call(mg_alloc((void**)&Loop->FacesInLoop, 1,
+                  sizeof(mg_OrderedDataList)));
+    if (mg_ckpt_get_count(fid, INT_MAX, &DataSize) != err_OK ||
+        mg_ckpt_get_count(fid, nFace, &n) != err_OK ||
+        nTotal > (int)(INT_MAX/sizeof(mg_FrontFace*))-n)
+      return error(err_READWRITE_ERROR);
+    mg_init_ord_data_list(Loop->FacesInLoop, DataSize);
+    if (n == 0) continue;
+    //traversal order
+    call(mg_realloc((void**)&FFace, nTotal+n, sizeof(mg_FrontFace*)));
+    for (i = nTotal; i < nTotal+n; i++) {
+      call(mg_front_face_new(Front->Pool, FFace+i));
+      if (mg_ckpt_get_count(fid, nFace-1, &FFace[i]->ID) != err_OK ||
+          mg_ckpt_get(fid, &FFace[i]->iloop, sizeof(int)) != err_OK)
+        return error(err_READWRITE_ERROR);
+      FFace[i]->face = Mesh->Face[FFace[i]->ID];
+    }
+    for (i = 0; i < n; i++) {
+      FFace[nTotal+i]->next = FFace[nTotal+(i+1)%n];
+      FFace[nTotal+i]->prev = FFace[nTotal+(i+n-1)%n];
+    }
+    if (mg_ckpt_get_count(fid, n-1, &tail) != err_OK)
+      return error(err_READWRITE_ERROR);
+    Loop->head = FFace[nTotal];
+    Loop->tail = FFace[nTotal+tail];
+    nTotal += n;
+  }
+  //ordered face lists
+  for (iloop = 0; iloop < Front->nloop; iloop++) {
+    if ((Loop = Front->loop[iloop]) == NULL) continue;
+    List = Loop->FacesInLoop;
+    if (mg_ckpt_get_count(fid, nFace, &n) != err_OK)
+      return error(err_READWRITE_ERROR);
+    if (n == 0) continue;
+    if (List->DataSize < (int)sizeof(void*) || n > INT_MAX/List->DataSize)
+      return error(err_READWRITE_ERROR);
+    call(mg_alloc((void**)&List->Entry, n, sizeof(int)));
+    call(mg_alloc((void**)&List->Data, n, List->DataSize));
+    List->nEntry = n;
+    for (i = 0; i < n; i++) {
+      if (mg_ckpt_get_count(fid, nFace-1, List->Entry+i) != err_OK ||
+          mg_ckpt_get(fid, &pos, sizeof(int)) != err_OK ||
+          pos < -1 || pos >= nTotal)
+        return error(err_READWRITE_ERROR);
+      List->Data[i] = (pos >= 0)?FFace[pos]:NULL;
+    }
+  }
+  mg_free((void*)FFace);
+  Front->Pool->nRelease = nRelease;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_ckpt_read */
+/* reads the checkpoint from fid */
+static int mg_ckpt_read(FILE *fid, mg_Mesh **pMesh, mg_Front *Front,
+                        mg_Metric **pMetric, int *pIter)
+{
+  int ierr, version, present, v;
+  unsigned int order;
+  char magic[8];
+  mg_Metric *Metric;
+  
+  if (mg_ckpt_get(fid, magic, 8) != err_OK ||
+      memcmp(magic, CKPTMAGIC, 8) != 0 ||
+      mg_ckpt_get(fid, &version, sizeof(int)) != err_OK ||
+      mg_ckpt_get(fid, &order, sizeof(unsigned int)) != err_OK)
+    return error(err_READWRITE_ERROR);
+  if (version != CKPTVERSION || order != CKPTBYTEORDER)
+    return error(err_NOT_SUPPORTED);
+  if (mg_ckpt_get_count(fid, INT_MAX, pIter) != err_OK ||
+      mg_ckpt_get_count(fid, 1, &present) != err_OK)
+    return error(err_READWRITE_ERROR);
+  (*pMetric) = NULL;
+  if (present) {
+    call(mg_alloc((void**)&Metric, 1, sizeof(mg_Metric)));
+    memset(Metric, 0, sizeof(mg_Metric));
+    (*pMetric) = Metric;
+    if (mg_ckpt_get_count(fid, mge_Metric_Last-1, &v) != err_OK)
+      return error(err_READWRITE_ERROR);
+    Metric->type = (enum mge_Metric)v;
+    if (mg_ckpt_get_count(fid, mge_Engine_Last-1, &v) != err_OK)
+      return error(err_READWRITE_ERROR);
+    Metric->engine = (enum mge_Engine)v;
+    if (mg_ckpt_get(fid, &Metric->order, sizeof(int)) != err_OK ||
+        mg_ckpt_get(fid, &Metric->tol, sizeof(double)) != err_OK ||
+        mg_ckpt_get_count(fid, 1, &present) != err_OK)
+      return error(err_READWRITE_ERROR);
+    if (present)
+      call(mg_ckpt_get_mesh(fid, &Metric->BGMesh));
+  }
+  call(mg_ckpt_get_mesh(fid, pMesh));
+  call(mg_ckpt_get_front(fid, (*pMesh), Front));
+  if (mg_ckpt_get(fid, magic, 8) != err_OK ||
+      memcmp(magic, CKPTMAGIC, 8) != 0)
+    return error(err_READWRITE_ERROR);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_read_checkpoint */
+/* restores the advancement state from FileName */
+int mg_read_checkpoint(const char *FileName, mg_Mesh **pMesh,
+                       mg_Front *Front, mg_Metric **pMetric, int *pIter)
+{
+  int ierr;
+  FILE *fid;
+  
+  if ((fid = fopen(FileName, "rb")) == NULL)
+    return error(err_READWRITE_ERROR);
+  ierr = error(mg_ckpt_read(fid, pMesh, Front, pMetric, pIter));
+  fclose(fid);
+  
+  return ierr;
+}
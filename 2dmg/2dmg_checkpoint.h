@@ -0,0 +1,61 @@
+//
+//  2dmg_checkpoint.h
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#ifndef ___dmg___dmg_checkpoint__
+#define ___dmg___dmg_checkpoint__
+
+#include <stdio.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_metric_struct.h"
+
+/******************************************************************/
+/* checkpoints of an in-progress front advancement. A checkpoint
+ holds, in native byte order, the iteration count, the metric
+ configuration (with its background mesh), the mesh with every
+ component slot (removed ones included), its component stacks and the
+ derived data it has built (see mg_mesh_require), and every front
+ loop in traversal order from its head along with its ordered face
+ list as it stands. Restoring it gives the state the advancement had,
+ so the generation continues exactly as it would have. mg_checkpoint
+ copies the state into memory and a writer thread puts it in the file
+ (through a temporary file and a rename, so a crash while writing
+ keeps the previous checkpoint) */
+#define CKPTVERSION       1
+#define CKPTMAGIC         "2DMGCKPT"
+//front advancement steps between checkpoints
+#define CKPTINTERVAL      1000
+
+/******************************************************************/
+/* function:  mg_open_checkpoint */
+/* creates a writer for checkpoints in FileName */
+int mg_open_checkpoint(const char *FileName, mg_Checkpoint **pCkpt);
+
+/******************************************************************/
+/* function:  mg_checkpoint */
+/* takes a snapshot of the advancement state after Iter steps and
+ hands it to the writer thread. Returns without a snapshot if the
+ previous one is still being written */
+int mg_checkpoint(mg_Checkpoint *Ckpt, mg_Mesh *Mesh, mg_Front *Front,
+                  mg_Metric *Metric, int Iter);
+
+/******************************************************************/
+/* function:  mg_close_checkpoint */
+/* waits for the writer, reports and frees Ckpt. Returns the first
+ error of the writer */
+int mg_close_checkpoint(mg_Checkpoint *Ckpt);
+
+/******************************************************************/
+/* function:  mg_read_checkpoint */
+/* restores the mesh, front, metric (NULL if none was checkpointed)
+ and iteration count from FileName. Fails with err_READWRITE_ERROR if
+ the file is truncated or not a checkpoint and err_NOT_SUPPORTED if
+ it was written with another version or byte order */
+int mg_read_checkpoint(const char *FileName, mg_Mesh **pMesh,
+                       mg_Front *Front, mg_Metric **pMetric, int *pIter);
+
+#endif
@@ -0,0 +1,741 @@
+//
+//  2dmg_cmesh.c
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include <omp.h>
+#include "2dmg_cmesh.h"
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_utils.h"
+#include "2dmg_math.h"
+#include "2dmg_bmesh.h"
+
+/******************************************************************/
+/* function:  mg_cmesh_compare_key */
+/* qsort comparison of the first uint64_t of two items */
+static int mg_cmesh_compare_key(const void *a, const void *b)
+{
+  uint64_t ka = *(const uint64_t*)a, kb = *(const uint64_t*)b;
+  
+  return (ka > kb)-(ka < kb);
+}
+
+/******************************************************************/
+/* function:  mg_cmesh_bucket_sort */
+/* stable order of n items by their Key in [0, nKey): item Order[i]
+ goes in position i */
+static int mg_cmesh_bucket_sort(int n, const int *Key, int nKey,
+                                int *Order)
+{
+  int ierr, i, *Start;
+  
+  call(mg_alloc((void**)&Start, nKey+1, sizeof(int)));
+  for (i = 0; i <= nKey; i++) Start[i] = 0;
+  for (i = 0; i < n; i++) Start[Key[i]+1]++;
+  for (i = 0; i < nKey; i++) Start[i+1] += Start[i];
+  for (i = 0; i < n; i++) Order[Start[Key[i]]++] = i;
+  mg_free((void*)Start);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_cmesh_zigzag */
+/* maps signed deltas to unsigned ones with small magnitudes first */
+static inline uint64_t mg_cmesh_zigzag(int64_t v)
+{
+  return ((uint64_t)v << 1)^(uint64_t)(v >> 63);
+}
+
+/******************************************************************/
+/* function:  mg_cmesh_unzigzag */
+static inline int64_t mg_cmesh_unzigzag(uint64_t u)
+{
+  return (int64_t)(u >> 1)^(-(int64_t)(u & 1));
+}
+
+/******************************************************************/
+/* function:  mg_cmesh_order */
+/* lists the nodes, elements and faces in use in the order they are
+ written. NodeMap and ElemMap give the new number of each node and
+ element slot, ElemNode the element-to-node array in new numbers.
+ An element or face on a removed node is a mesh error */
+static int mg_cmesh_order(mg_Mesh *Mesh, int Flags, int *pnNode,
+                          int **pNode, int **pNodeMap, int *pnElem,
+                          int **pElemNode, int **pElemMap, int *pnFace,
+                          int **pFace)
+{
+  int ierr, nSlot, i, j, k, n, r, *Node, *NodeMap, *Elem, *ElemNode;
+  int *ElemMap, *Face, *Sorted, *Key, *Order, *node;
+  double c[2], ds[2], range[4], *X;
+  uint64_t *Pair;
+  bool reorder = ((Flags & CMESHREORDER) != 0);
+  mg_lqtree *Tree;
+  
+  //elements and faces in use may only reference nodes in use
+  if (Mesh->Stack->Node->nItem > 0) {
+    nSlot = Mesh->nElem+Mesh->Stack->Elem->nItem;
+    for (i = 0; i < nSlot; i++) {
+      if (mg_is_stacked(Mesh->Stack->Elem, i)) continue;
+      for (j = 0; j < 3; j++)
+        if (mg_is_stacked(Mesh->Stack->Node, Mesh->Elem[i].node[j]))
+          return error(err_MESH_ERROR);
+    }
+    nSlot = Mesh->nFace+Mesh->Stack->Face->nItem;
+    for (i = 0; i < nSlot; i++) {
+      if (mg_is_stacked(Mesh->Stack->Face, i)) continue;
+      node = Mesh->Face[i]->node;
+      if (mg_is_stacked(Mesh->Stack->Node, node[0]) ||
+          mg_is_stacked(Mesh->Stack->Node, node[1]))
+        return error(err_MESH_ERROR);
+    }
+  }
+  
+  //nodes, in Morton order of their coordinates if reordering
+  nSlot = Mesh->nNode+Mesh->Stack->Node->nItem;
+  call(mg_alloc((void**)&Node, max(nSlot, 1), sizeof(int)));
+  call(mg_alloc((void**)&NodeMap, max(nSlot, 1), sizeof(int)));
+  n = mg_live_slots(Mesh->Stack->Node, nSlot, Node, NodeMap);
+  if (reorder && n > 1) {
+    range[0] = range[2] = INFINITY;
+    range[1] = range[3] = -INFINITY;
+    for (i = 0; i < n; i++) {
+      X = Mesh->Coord+2*Node[i];
+      range[0] = min(range[0], X[0]);
+      range[1] = max(range[1], X[0]);
+      range[2] = min(range[2], X[1]);
+      range[3] = max(range[3], X[1]);
+    }
+    c[0] = 0.5*(range[0]+range[1]);
+    c[1] = 0.5*(range[2]+range[3]);
+    //slightly inflated so that rounding of c+-ds keeps every node in
+    ds[0] = 0.5*(range[1]-range[0])*(1.0+1.0e-10)+1.0e-14*(1.0+fabs(c[0]));
+    ds[1] = 0.5*(range[3]-range[2])*(1.0+1.0e-10)+1.0e-14*(1.0+fabs(c[1]));
+    call(mg_create_lqtree(&Tree, c, ds, 0));
+    //(key, node) pairs sort by key
+    call(mg_alloc((void**)&Pair, 2*n, sizeof(uint64_t)));
+    for (i = 0; i < n; i++) {
+      call(mg_lqtree_key(Tree, Mesh->Coord+2*Node[i], Pair+2*i));
+      Pair[2*i+1] = (uint64_t)Node[i];
+    }
+    mg_destroy_lqtree(Tree);
+    qsort(Pair, n, 2*sizeof(uint64_t), mg_cmesh_compare_key);
+    for (i = 0; i < n; i++)
+      Node[i] = (int)Pair[2*i+1];
+    mg_free((void*)Pair);
+  }
+  for (i = 0; i < n; i++)
+    NodeMap[Node[i]] = i;
+  (*pnNode) = n;
+  
+  //elements, lowest node first (rotation keeps the orientation)
+  nSlot = Mesh->nElem+Mesh->Stack->Elem->nItem;
+  call(mg_alloc((void**)&Elem, max(nSlot, 1), sizeof(int)));
+  call(mg_alloc((void**)&ElemMap, max(nSlot, 1), sizeof(int)));
+  call(mg_alloc((void**)&ElemNode, 3*max(nSlot, 1), sizeof(int)));
+  n = mg_live_slots(Mesh->Stack->Elem, nSlot, Elem, ElemMap);
+  for (i = 0; i < n; i++) {
+    node = ElemNode+3*i;
+    for (j = 0; j < 3; j++)
+      node[j] = NodeMap[Mesh->Elem[Elem[i]].node[j]];
+    if (reorder) {
+      k = (node[1] < node[0])?1:0;
+      if (node[2] < node[k]) k = 2;
+      for (j = 0; j < k; j++) {
+        r = node[0];
+        node[0] = node[1];
+        node[1] = node[2];
+        node[2] = r;
+      }
+    }
+  }
+  if (reorder && n > 1) {
+    call(mg_alloc((void**)&Key, n, sizeof(int)));
+    call(mg_alloc((void**)&Order, n, sizeof(int)));
+    call(mg_alloc((void**)&Sorted, 3*n, sizeof(int)));
+    for (i = 0; i < n; i++)
+      Key[i] = ElemNode[3*i];
+    call(mg_cmesh_bucket_sort(n, Key, (*pnNode), Order));
+    for (i = 0; i < n; i++) {
+      memcpy(Sorted+3*i, ElemNode+3*Order[i], 3*sizeof(int));
+      Key[i] = Elem[Order[i]];
+    }
+    memcpy(Elem, Key, n*sizeof(int));
+    mg_free((void*)ElemNode);
+    ElemNode = Sorted;
+    mg_free((void*)Key);
+    mg_free((void*)Order);
+  }
+  for (i = 0; i < n; i++)
+    ElemMap[Elem[i]] = i;
+  mg_free((void*)Elem);
+  (*pnElem) = n;
+  
+  //faces, by their lowest node (their orientation is kept)
+  nSlot = Mesh->nFace+Mesh->Stack->Face->nItem;
+  call(mg_alloc((void**)&Face, max(nSlot, 1), sizeof(int)));
+  n = mg_live_slots(Mesh->Stack->Face, nSlot, Face, NULL);
+  if (reorder && n > 1) {
+    call(mg_alloc((void**)&Key, n, sizeof(int)));
+    call(mg_alloc((void**)&Order, n, sizeof(int)));
+    for (i = 0; i < n; i++) {
+      node = Mesh->Face[Face[i]]->node;
+      Key[i] = min(NodeMap[node[0]], NodeMap[node[1]]);
+    }
+    call(mg_cmesh_bucket_sort(n, Key, (*pnNode), Order));
+    for (i = 0; i < n; i++)
+      Key[i] = Face[Order[i]];
+    memcpy(Face, Key, n*sizeof(int));
+    mg_free((void*)Key);
+    mg_free((void*)Order);
+  }
+  (*pnFace) = n;
+  
+  (*pNode) = Node;
+  (*pNodeMap) = NodeMap;
+  (*pElemNode) = ElemNode;
+  (*pElemMap) = ElemMap;
+  (*pFace) = Face;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_cmesh_open_io */
+/* attaches a CMESHBUFFER-byte buffer to fid */
+static int mg_cmesh_open_io(mg_CMeshIO *IO, FILE *fid)
+{
+  int ierr;
+  
+  memset(IO, 0, sizeof(mg_CMeshIO));
+  IO->fid = fid;
+  IO->Cap = CMESHBUFFER;
+  call(mg_alloc((void**)&IO->Buf, (int)IO->Cap, sizeof(unsigned char)));
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_cmesh_flush */
+/* writes the buffered bytes */
+static int mg_cmesh_flush(mg_CMeshIO *IO)
+{
+  if (IO->Len > 0 && fwrite(IO->Buf, 1, IO->Len, IO->fid) != IO->Len)
+    return error(err_READWRITE_ERROR);
+  IO->Total += IO->Len;
+  IO->Len = 0;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_cmesh_reserve */
+/* makes room for n <= CMESHBUFFER bytes in the buffer */
+static inline int mg_cmesh_reserve(mg_CMeshIO *IO, size_t n)
+{
+  if (IO->Len+n <= IO->Cap) return err_OK;
+  return mg_cmesh_flush(IO);
+}
+
+/******************************************************************/
+/* function:  mg_cmesh_put */
+/* appends n bytes */
+static int mg_cmesh_put(mg_CMeshIO *IO, const void *p, size_t n)
+{
+  int ierr;
+  size_t m;
+  
+  while (n > 0) {
+    call(mg_cmesh_reserve(IO, 1));
+    m = min(n, IO->Cap-IO->Len);
+    memcpy(IO->Buf+IO->Len, p, m);
+    IO->Len += m;
+    p = (const unsigned char*)p+m;
+    n -= m;
+  }
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_cmesh_put_varint */
+/* appends v in 7-bit groups, low bits first */
+static inline int mg_cmesh_put_varint(mg_CMeshIO *IO, uint64_t v)
+{
+  int ierr;
+  
+  call(mg_cmesh_reserve(IO, 10));
+  while (v >= 0x80) {
+    IO->Buf[IO->Len++] = (unsigned char)(v|0x80);
+    v >>= 7;
+  }
+  IO->Buf[IO->Len++] = (unsigned char)v;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_cmesh_put_real */
+/* appends v as is, or XORed with (*prev) and trimmed of zero bytes if
+ pack */
+static inline int mg_cmesh_put_real(mg_CMeshIO *IO, double v,
+                                    uint64_t *prev, bool pack)
+{
+  int ierr, lz, tz, k;
+  uint64_t b, x;
+  
+  memcpy(&b, &v, sizeof(uint64_t));
+  call(mg_cmesh_reserve(IO, 9));
+  if (!pack) {
+    for (k = 0; k < 8; k++)
+      IO->Buf[IO->Len++] = (unsigned char)(b >> 8*k);
+    return err_OK;
+  }
+  x = b^(*prev);
+  (*prev) = b;
+  if (x == 0) {
+    IO->Buf[IO->Len++] = 0x80;
+    return err_OK;
+  }
+  lz = __builtin_clzll(x)/8;
+  tz = __builtin_ctzll(x)/8;
+  IO->Buf[IO->Len++] = (unsigned char)((lz << 4)|tz);
+  for (k = tz; k < 8-lz; k++)
+    IO->Buf[IO->Len++] = (unsigned char)(x >> 8*k);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_cmesh_put_elem */
+/* appends a face-to-element entry: elements relative to (*ref), the
+ last element written, negative tags as they are */
+static inline int mg_cmesh_put_elem(mg_CMeshIO *IO, int64_t e,
+                                    int64_t *ref)
+{
+  if (e < 0)
+    return mg_cmesh_put_varint(IO, ((uint64_t)(-e-1) << 1)|1);
+  e -= (*ref);
+  (*ref) += e;
+  return mg_cmesh_put_varint(IO, mg_cmesh_zigzag(e) << 1);
+}
+
+/******************************************************************/
+/* function:  mg_cmesh_encode */
+/* writes the whole file through IO */
+static int mg_cmesh_encode(mg_CMeshIO *IO, mg_Mesh *Mesh, int Flags,
+                           int nNode, const int *Node, const int *NodeMap,
+                           int nElem, const int *ElemNode,
+                           const int *ElemMap, int nFace, const int *Face)
+{
+  int ierr, i, g, d, s, len, e;
+  int64_t n0, last, ref;
+  uint64_t prev[2] = {0, 0};
+  bool pack = ((Flags & CMESHFLOATS) != 0);
+  mg_FaceData *F;
+  
+  call(mg_cmesh_put(IO, CMESHMAGIC, 8));
+  call(mg_cmesh_put_varint(IO, CMESHVERSION));
+  call(mg_cmesh_put_varint(IO, (uint64_t)Flags));
+  call(mg_cmesh_put_varint(IO, (uint64_t)Mesh->Dim));
+  call(mg_cmesh_put_varint(IO, (uint64_t)nNode));
+  call(mg_cmesh_put_varint(IO, (uint64_t)nFace));
+  call(mg_cmesh_put_varint(IO, (uint64_t)nElem));
+  call(mg_cmesh_put_varint(IO, (uint64_t)Mesh->nBfg));
+  for (g = 0; g < Mesh->nBfg; g++) {
+    len = (int)strnlen(Mesh->BNames[g], MAXSTRLEN-1);
+    call(mg_cmesh_put_varint(IO, (uint64_t)len));
+    call(mg_cmesh_put(IO, Mesh->BNames[g], len));
+    call(mg_cmesh_put_varint(IO, (uint64_t)Mesh->nBface[g]));
+  }
+  //coordinates
+  for (i = 0; i < nNode; i++)
+    for (d = 0; d < 2; d++)
+      call(mg_cmesh_put_real(IO, Mesh->Coord[2*Node[i]+d], prev+d, pack));
+  //elements
+  for (i = 0, last = 0; i < nElem; i++) {
+    n0 = ElemNode[3*i];
+    call(mg_cmesh_put_varint(IO, mg_cmesh_zigzag(n0-last)));
+    call(mg_cmesh_put_varint(IO, mg_cmesh_zigzag(ElemNode[3*i+1]-n0)));
+    call(mg_cmesh_put_varint(IO, mg_cmesh_zigzag(ElemNode[3*i+2]-n0)));
+    last = n0;
+  }
+  //faces
+  for (i = 0, last = ref = 0; i < nFace; i++) {
+    F = Mesh->Face[Face[i]];
+    n0 = NodeMap[F->node[0]];
+    call(mg_cmesh_put_varint(IO, mg_cmesh_zigzag(n0-last)));
+    call(mg_cmesh_put_varint(IO,
+                             mg_cmesh_zigzag(NodeMap[F->node[1]]-n0)));
+    last = n0;
+    for (s = 0; s < 2; s++) {
+      e = F->elem[s];
+      if (e >= 0 && (e = ElemMap[e]) < 0)
+        return error(err_MESH_ERROR);
+      call(mg_cmesh_put_elem(IO, e, &ref));
+    }
+  }
+  call(mg_cmesh_put(IO, CMESHMAGIC, 8));
+  call(mg_cmesh_flush(IO));
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_cmesh_raw_bytes */
+/* size of the same arrays stored uncompressed */
+static size_t mg_cmesh_raw_bytes(int Dim, int nNode, int nFace,
+                                 int nElem, int nBfg)
+{
+  return ((size_t)nBfg*(MAXSTRLEN+sizeof(int))+
+          (size_t)nNode*Dim*sizeof(double)+
+          ((size_t)nElem*3+(size_t)nFace*4)*sizeof(int));
+}
+
+/******************************************************************/
+/* function:  mg_write_cmesh */
+/* writes Mesh to FileName in the compressed format */
+int mg_write_cmesh(mg_Mesh *Mesh, const char *FileName, int Flags,
+                   mg_CMeshStats *Stats)
+{
+  int ierr, i, nNode = 0, nElem = 0, nFace = 0, *Node = NULL;
+  int *NodeMap = NULL, *ElemNode = NULL, *ElemMap = NULL, *Face = NULL;
+  double t0;
+  FILE *fid;
+  mg_CMeshIO IO;
+  
+  t0 = omp_get_wtime();
+  if (Mesh->Dim != 2) return error(err_NOT_SUPPORTED);
+  for (i = 0; i < Mesh->nElem; i++)
+    if (Mesh->Elem[i].nNode != 3) return error(err_NOT_SUPPORTED);
+  
+  call(mg_cmesh_order(Mesh, Flags, &nNode, &Node, &NodeMap, &nElem,
+                      &ElemNode, &ElemMap, &nFace, &Face));
+  if ((fid = fopen(FileName, "wb")) == NULL)
+    ierr = error(err_READWRITE_ERROR);
+  else {
+    if ((ierr = error(mg_cmesh_open_io(&IO, fid))) == err_OK) {
+      ierr = error(mg_cmesh_encode(&IO, Mesh, Flags, nNode, Node, NodeMap,
+                                   nElem, ElemNode, ElemMap, nFace, Face));
+      mg_free((void*)IO.Buf);
+    }
+    if (fclose(fid) != 0 && ierr == err_OK)
+      ierr = error(err_READWRITE_ERROR);
+  }
+  mg_free((void*)Node);
+  mg_free((void*)NodeMap);
+  mg_free((void*)ElemNode);
+  mg_free((void*)ElemMap);
+  mg_free((void*)Face);
+  if (ierr != err_OK) return ierr;
+  
+  if (Stats != NULL) {
+    Stats->RawBytes = mg_cmesh_raw_bytes(Mesh->Dim, nNode, nFace, nElem,
+                                         Mesh->nBfg);
+    Stats->PackedBytes = IO.Total;
+    Stats->Seconds = omp_get_wtime()-t0;
+  }
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_cmesh_fill */
+/* tops the buffer up from the file so that n bytes are available if
+ the file has them */
+static inline void mg_cmesh_fill(mg_CMeshIO *IO, size_t n)
+{
+  size_t r;
+  
+  if (IO->Len-IO->Pos >= n) return;
+  memmove(IO->Buf, IO->Buf+IO->Pos, IO->Len-IO->Pos);
+  IO->Len -= IO->Pos;
+  IO->Pos = 0;
+  r = fread(IO->Buf+IO->Len, 1, IO->Cap-IO->Len, IO->fid);
+  IO->Len += r;
+  IO->Total += r;
+}
+
+/******************************************************************/
+/* function:  mg_cmesh_get */
+/* reads n bytes */
+static int mg_cmesh_get(mg_CMeshIO *IO, void *p, size_t n)
+{
+  size_t m;
+  
+  while (n > 0) {
+    mg_cmesh_fill(IO, 1);
+    if (IO->Pos == IO->Len) return err_READWRITE_ERROR;
+    m = min(n, IO->Len-IO->Pos);
+    memcpy(p, IO->Buf+IO->Pos, m);
+    IO->Pos += m;
+    p = (unsigned char*)p+m;
+    n -= m;
+  }
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_cmesh_get_varint */
+/* decodes a varint, err_READWRITE_ERROR if truncated or too long */
+static inline int mg_cmesh_get_varint(mg_CMeshIO *IO, uint64_t *v)
+{
+  int shift;
+  unsigned char b;
+  
+  mg_cmesh_fill(IO, 10);
+  (*v) = 0;
+  for (shift = 0; shift < 64; shift += 7) {
+    if (IO->Pos == IO->Len) return err_READWRITE_ERROR;
+    b = IO->Buf[IO->Pos++];
+    (*v) |= (uint64_t)(b & 0x7f) << shift;
+    if (b < 0x80) return err_OK;
+  }
+  
+  return err_READWRITE_ERROR;
+}
+
+/******************************************************************/
+/* function:  mg_cmesh_get_int */
+/* decodes a varint into an int in [lo, hi] */
+static inline int mg_cmesh_get_int(mg_CMeshIO *IO, int lo, int hi, int *v)
+{
+  int ierr;
+  uint64_t u;
+  
+  if ((ierr = mg_cmesh_get_varint(IO, &u)) != err_OK) return ierr;
+  if (u < (uint64_t)lo || u > (uint64_t)hi) return err_READWRITE_ERROR;
+  (*v) = (int)u;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_cmesh_get_real */
+/* inverse of mg_cmesh_put_real */
+static inline int mg_cmesh_get_real(mg_CMeshIO *IO, double *v,
+                                    uint64_t *prev, bool pack)
+{
+  int lz, tz, k;
+  unsigned char c;
+  uint64_t x = 0;
+  
+  mg_cmesh_fill(IO, 9);
+  if (!pack) {
+    if (IO->Len-IO->Pos < 8) return err_READWRITE_ERROR;
+    for (k = 0; k < 8; k++)
+      x |= (uint64_t)IO->Buf[IO->Pos++] << 8*k;
+    memcpy(v, &x, sizeof(double));
+    return err_OK;
+  }
+  if (IO->Pos == IO->Len) return err_READWRITE_ERROR;
+  c = IO->Buf[IO->Pos++];
+  lz = c >> 4;
+  tz = c & 0xf;
+  if (lz+tz > 8 || IO->Len-IO->Pos < (size_t)(8-lz-tz))
+    return err_READWRITE_ERROR;
+  for (k = tz; k < 8-lz; k++)
+    x |= (uint64_t)IO->Buf[IO->Pos++] << 8*k;
+  (*prev) ^= x;
+  memcpy(v, prev, sizeof(double));
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_cmesh_get_node */
+/* decodes zigzag(n-base) into a node number below nNode */
+static inline int mg_cmesh_get_node(mg_CMeshIO *IO, int64_t base,
+                                    int nNode, int *n)
+{
+  int ierr;
+  uint64_t u;
+  int64_t v;
+  
+  if ((ierr = mg_cmesh_get_varint(IO, &u)) != err_OK) return ierr;
+  v = base+mg_cmesh_unzigzag(u);
+  if (v < 0 || v >= nNode) return err_READWRITE_ERROR;
+  (*n) = (int)v;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_cmesh_get_elem */
+/* inverse of mg_cmesh_put_elem */
+static inline int mg_cmesh_get_elem(mg_CMeshIO *IO, int nElem, int *e,
+                                    int64_t *ref)
+{
+  int ierr;
+  uint64_t u;
+  int64_t v;
+  
+  if ((ierr = mg_cmesh_get_varint(IO, &u)) != err_OK) return ierr;
+  if (u & 1) {
+    v = -(int64_t)(u >> 1)-1;
+    if (v < INT_MIN) return err_READWRITE_ERROR;
+  }
+  else {
+    v = (*ref)+mg_cmesh_unzigzag(u >> 1);
+    if (v < 0 || v >= nElem) return err_READWRITE_ERROR;
+    (*ref) = v;
+  }
+  (*e) = (int)v;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_cmesh_decode */
+/* reads the whole file through IO into the arrays of View, which are
+ allocated here */
+static int mg_cmesh_decode(mg_CMeshIO *IO, mg_BMesh *View)
+{
+  int ierr, i, g, d, s, len, Flags, Dim, nNode, nFace, nElem, nBfg;
+  int *nBface, *ElemNode, *FaceNode, *FaceElem;
+  int64_t last, ref;
+  uint64_t u, prev[2] = {0, 0};
+  char magic[8], *BNames;
+  double *Coord;
+  bool pack;
+  
+  if (mg_cmesh_get(IO, magic, 8) != err_OK ||
+      memcmp(magic, CMESHMAGIC, 8) != 0)
+    return error(err_READWRITE_ERROR);
+  if (mg_cmesh_get_varint(IO, &u) != err_OK)
+    return error(err_READWRITE_ERROR);
+  if (u != CMESHVERSION) return error(err_NOT_SUPPORTED);
+  //counts bounded so that every allocation size fits an int
+  if (mg_cmesh_get_int(IO, 0, CMESHFLOATS|CMESHREORDER, &Flags) != err_OK ||
+      mg_cmesh_get_int(IO, 0, INT_MAX, &Dim) != err_OK ||
+      mg_cmesh_get_int(IO, 0, INT_MAX/(2*sizeof(double)), &nNode) != err_OK ||
+      mg_cmesh_get_int(IO, 0, INT_MAX/(2*sizeof(int)), &nFace) != err_OK ||
+      mg_cmesh_get_int(IO, 0, INT_MAX/(3*sizeof(int)), &nElem) != err_OK ||
+      mg_cmesh_get_int(IO, 0, INT_MAX/MAXSTRLEN, &nBfg) != err_OK)
+    return error(err_READWRITE_ERROR);
+  if (Dim != 2) return error(err_NOT_SUPPORTED);
+  pack = ((Flags & CMESHFLOATS) != 0);
+  View->Dim = Dim;
+  View->nNode = nNode;
+  View->nFace = nFace;
+  View->nElem = nElem;
+  View->nBfg = nBfg;
+  View->nElemNode = 3;
+  
+  call(mg_alloc((void**)&BNames, max(nBfg, 1)*MAXSTRLEN, sizeof(char)));
+  memset(BNames, 0, max(nBfg, 1)*MAXSTRLEN);
+  View->BNames = BNames;
+  call(mg_alloc((void**)&nBface, max(nBfg, 1), sizeof(int)));
+  View->nBface = nBface;
+  for (g = 0; g < nBfg; g++) {
+    if (mg_cmesh_get_int(IO, 0, MAXSTRLEN-1, &len) != err_OK ||
+        mg_cmesh_get(IO, BNames+g*MAXSTRLEN, len) != err_OK ||
+        mg_cmesh_get_int(IO, 0, INT_MAX, nBface+g) != err_OK)
+      return error(err_READWRITE_ERROR);
+  }
+  //coordinates
+  call(mg_alloc((void**)&Coord, 2*max(nNode, 1), sizeof(double)));
+  View->Coord = Coord;
+  for (i = 0; i < nNode; i++)
+    for (d = 0; d < 2; d++)
+      if (mg_cmesh_get_real(IO, Coord+2*i+d, prev+d, pack) != err_OK)
+        return error(err_READWRITE_ERROR);
+  //elements
+  call(mg_alloc((void**)&ElemNode, 3*max(nElem, 1), sizeof(int)));
+  View->ElemNode = ElemNode;
+  for (i = 0, last = 0; i < nElem; i++) {
+    if (mg_cmesh_get_node(IO, last, nNode, ElemNode+3*i) != err_OK ||
+        mg_cmesh_get_node(IO, ElemNode[3*i], nNode,
+                          ElemNode+3*i+1) != err_OK ||
+        mg_cmesh_get_node(IO, ElemNode[3*i], nNode,
+                          ElemNode+3*i+2) != err_OK)
+      return error(err_READWRITE_ERROR);
+    last = ElemNode[3*i];
+  }
+  //faces
+  call(mg_alloc((void**)&FaceNode, 2*max(nFace, 1), sizeof(int)));
+  View->FaceNode = FaceNode;
+  call(mg_alloc((void**)&FaceElem, 2*max(nFace, 1), sizeof(int)));
+  View->FaceElem = FaceElem;
+  for (i = 0, last = ref = 0; i < nFace; i++) {
+    if (mg_cmesh_get_node(IO, last, nNode, FaceNode+2*i) != err_OK ||
+        mg_cmesh_get_node(IO, FaceNode[2*i], nNode,
+                          FaceNode+2*i+1) != err_OK)
+      return error(err_READWRITE_ERROR);
+    last = FaceNode[2*i];
+    for (s = 0; s < 2; s++)
+      if (mg_cmesh_get_elem(IO, nElem, FaceElem+2*i+s, &ref) != err_OK)
+        return error(err_READWRITE_ERROR);
+  }
+  if (mg_cmesh_get(IO, magic, 8) != err_OK ||
+      memcmp(magic, CMESHMAGIC, 8) != 0)
+    return error(err_READWRITE_ERROR);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_read_cmesh */
+/* decodes FileName and builds (*pMesh) */
+int mg_read_cmesh(const char *FileName, mg_Mesh **pMesh,
+                  mg_CMeshStats *Stats)
+{
+  int ierr;
+  double t0;
+  FILE *fid;
+  mg_CMeshIO IO;
+  mg_BMesh View;
+  
+  t0 = omp_get_wtime();
+  if ((fid = fopen(FileName, "rb")) == NULL)
+    return error(err_READWRITE_ERROR);
+  if ((ierr = error(mg_cmesh_open_io(&IO, fid))) != err_OK) {
+    fclose(fid);
+    return ierr;
+  }
+  memset(&View, 0, sizeof(mg_BMesh));
+  ierr = error(mg_cmesh_decode(&IO, &View));
+  mg_free((void*)IO.Buf);
+  fclose(fid);
+  t0 = omp_get_wtime()-t0;
+  if (ierr == err_OK)
+    ierr = error(mg_bmesh_2_mesh(&View, pMesh));
+  mg_free((void*)View.BNames);
+  mg_free((void*)View.nBface);
+  mg_free((void*)View.Coord);
+  mg_free((void*)View.ElemNode);
+  mg_free((void*)View.FaceNode);
+  mg_free((void*)View.FaceElem);
+  if (ierr != err_OK) return ierr;
+  
+  if (Stats != NULL) {
+    Stats->RawBytes = mg_cmesh_raw_bytes(View.Dim, View.nNode, View.nFace,
+                                         View.nElem, View.nBfg);
+    Stats->PackedBytes = IO.Total;
+    Stats->Seconds = t0;
+  }
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_cmesh_report */
+/* prints the compression ratio and throughput (uncompressed bytes per
+ second) in Stats */
+void mg_cmesh_report(const char *Action, mg_CMeshStats *Stats)
+{
+  if (Stats == NULL) return;
+  printf("Compressed mesh %s: %zu byte(s) for %zu raw, ratio %1.2f, %1.1f MB/s\n",
+         Action, Stats->PackedBytes, Stats->RawBytes,
+         (double)Stats->RawBytes/max((double)Stats->PackedBytes, 1.0),
+         Stats->RawBytes/1.0e6/max(Stats->Seconds, MEPS));
+}
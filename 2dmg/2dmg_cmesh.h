@@ -0,0 +1,64 @@
+//
+//  2dmg_cmesh.h
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#ifndef ___dmg___dmg_cmesh__
+#define ___dmg___dmg_cmesh__
+
+#include <stdio.h>
+#include <stdint.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+
+/******************************************************************/
+/* compressed mesh file for archiving and transfer. After CMESHMAGIC
+ every integer is a LEB128 varint (7 bits per byte, low bits first):
+ version, flags, Dim, nNode, nFace, nElem, nBfg, the boundary group
+ names (length and characters) and faces per group, then
+ coordinates: 8 bytes each, or with CMESHFLOATS XORed with the same
+   component of the previous node and stored as one byte holding the
+   number of leading (high nibble) and trailing (low nibble) zero
+   bytes followed by the bytes in between (lossless)
+ elements: zigzag deltas n0-n0(previous element), n1-n0, n2-n0
+ faces: zigzag deltas n0-n0(previous face), n1-n0, then the left and
+   right element: e >= 0 as zigzag(e-ref)<<1 with ref the previous
+   left element, negative tags (boundary codes) as ((-e-1)<<1)|1
+ and CMESHMAGIC again. Components on the removal stacks are left out
+ and the rest renumbered. With CMESHREORDER nodes are put in Morton
+ order and elements and faces sorted by their lowest node (element
+ nodes rotated so that it comes first), which keeps the deltas small;
+ the mesh read back is the renumbered one */
+#define CMESHVERSION      1
+#define CMESHMAGIC        "2DMGCMSH"
+#define CMESHEXT          ".cmsh"
+#define CMESHBUFFER       65536
+
+#define CMESHFLOATS       1
+#define CMESHREORDER      2
+
+/******************************************************************/
+/* function:  mg_write_cmesh */
+/* writes Mesh to FileName in the compressed format. Only triangles
+ are supported. Stats may be NULL */
+int mg_write_cmesh(mg_Mesh *Mesh, const char *FileName, int Flags,
+                   mg_CMeshStats *Stats);
+
+/******************************************************************/
+/* function:  mg_read_cmesh */
+/* decodes FileName while it is read through a CMESHBUFFER-byte
+ buffer and builds (*pMesh). Fails with err_READWRITE_ERROR if the
+ file is truncated or corrupt and err_NOT_SUPPORTED if it was written
+ with another version. Stats may be NULL; its time covers the decode,
+ not the construction of the mesh connectivity */
+int mg_read_cmesh(const char *FileName, mg_Mesh **pMesh,
+                  mg_CMeshStats *Stats);
+
+/******************************************************************/
+/* function:  mg_cmesh_report */
+/* prints the compression ratio and throughput in Stats */
+void mg_cmesh_report(const char *Action, mg_CMeshStats *Stats);
+
+#endif
@@ -0,0 +1,222 @@
+//
+//  2dmg_csr.c
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#include <string.h>
+#include <omp.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_utils.h"
+#include "2dmg_csr.h"
+
+/******************************************************************/
+/* function:  mg_csr_comp */
+/* nodes of element (or face if Face) i */
+static inline void mg_csr_comp(mg_Mesh *Mesh, bool Face, int i, int *n,
+                               int **node)
+{
+  if (Face) {
+    (*n) = Mesh->Face[i]->nNode;
+    (*node) = Mesh->Face[i]->node;
+  }
+  else {
+    (*n) = Mesh->Elem[i].nNode;
+    (*node) = Mesh->Elem[i].node;
+  }
+}
+
+/******************************************************************/
+/* function:  mg_csr_sort_row */
+/* sorts n entries of row by insertion (rows are short) and drops
+ repetitions. Returns the number of distinct entries */
+static int mg_csr_sort_row(int *row, int n)
+{
+  int i, j, v, u;
+  
+  for (i = 1; i < n; i++) {
+    v = row[i];
+    for (j = i; j > 0 && row[j-1] > v; j--)
+      row[j] = row[j-1];
+    row[j] = v;
+  }
+  for (i = 1, u = min(n, 1); i < n; i++)
+    if (row[i] != row[u-1]) row[u++] = row[i];
+  
+  return u;
+}
+
+/******************************************************************/
+/* function:  mg_build_csr */
+/* node connectivity of the elements, or the faces if Face */
+static int mg_build_csr(mg_Mesh *Mesh, bool Face, mg_CSR **pCSR)
+{
+  int ierr, i, j, k, n, u, pos, nRow, nComp, nbad = 0, ndup = 0;
+  int *node, *Offset, *Index, *Cursor;
+  unsigned char *Skip = NULL;
+  mg_List *Stack = (Face) ? Mesh->Stack->Face : Mesh->Stack->Elem;
+  mg_CSR *CSR;
+  
+  nRow = Mesh->nNode+Mesh->Stack->Node->nItem;
+  nComp = ((Face) ? Mesh->nFace : Mesh->nElem)+Stack->nItem;
+  call(mg_alloc((void**)&CSR, 1, sizeof(mg_CSR)));
+  CSR->nRow = nRow;
+  CSR->Index = NULL;
+  if ((ierr = error(mg_alloc((void**)&CSR->Offset, nRow+1,
+                             sizeof(int)))) != err_OK) {
+    mg_destroy_csr(CSR);
+    return ierr;
+  }
+  Offset = CSR->Offset;
+  memset(Offset, 0, (nRow+1)*sizeof(int));
+  //removed components keep their slots
+  if (Stack->nItem > 0) {
+    if ((ierr = error(mg_alloc((void**)&Skip, nComp,
+                               sizeof(unsigned char)))) != err_OK) {
+      mg_destroy_csr(CSR);
+      return ierr;
+    }
+    memset(Skip, 0, nComp);
+    for (k = 0; k < Stack->nItem; k++)
+      if (Stack->Item[k] >= 0 && Stack->Item[k] < nComp)
+        Skip[Stack->Item[k]] = 1;
+  }
+  
+  //degrees, counted in the offset of the next row
+#pragma omp parallel for schedule(static) private(j, n, node) reduction(+:nbad) if(nComp > CSRPARMIN)
+  for (i = 0; i < nComp; i++) {
+    if (Skip != NULL && Skip[i]) continue;
+    mg_csr_comp(Mesh, Face, i, &n, &node);
+    for (j = 0; j < n; j++) {
+      if (node[j] < 0 || node[j] >= nRow) {
+        nbad++;
+        continue;
+      }
+#pragma omp atomic
+      Offset[node[j]+1]++;
+    }
+  }
+  if (nbad > 0) {
+    mg_free((void*)Skip);
+    mg_destroy_csr(CSR);
+    return error(err_LOGIC_ERROR);
+  }
+  for (i = 0; i < nRow; i++)
+    Offset[i+1] += Offset[i];
+  
+  //scatter, rows come out in arbitrary order
+  if ((ierr = error(mg_alloc((void**)&CSR->Index, Offset[nRow],
+                             sizeof(int)))) == err_OK)
+    ierr = error(mg_alloc((void**)&Cursor, nRow, sizeof(int)));
+  if (ierr != err_OK) {
+    mg_free((void*)Skip);
+    mg_destroy_csr(CSR);
+    return ierr;
+  }
+  Index = CSR->Index;
+  if (nRow > 0) memcpy(Cursor, Offset, nRow*sizeof(int));
+#pragma omp parallel for schedule(static) private(j, n, node, pos) if(nComp > CSRPARMIN)
+  for (i = 0; i < nComp; i++) {
+    if (Skip != NULL && Skip[i]) continue;
+    mg_csr_comp(Mesh, Face, i, &n, &node);
+    for (j = 0; j < n; j++) {
+#pragma omp atomic capture
+      pos = Cursor[node[j]]++;
+      Index[pos] = i;
+    }
+  }
+  mg_free((void*)Skip);
+  
+  //sorted rows, Cursor now holds their distinct entries
+#pragma omp parallel for schedule(static) reduction(+:ndup) if(nRow > CSRPARMIN)
+  for (i = 0; i < nRow; i++) {
+    Cursor[i] = mg_csr_sort_row(Index+Offset[i], Offset[i+1]-Offset[i]);
+    ndup += Offset[i+1]-Offset[i]-Cursor[i];
+  }
+  //only a component repeating a node leaves gaps to close
+  if (ndup > 0) {
+    for (i = 0, k = 0; i < nRow; i++) {
+      u = Cursor[i];
+      memmove(Index+k, Index+Offset[i], u*sizeof(int));
+      Offset[i] = k;
+      k += u;
+    }
+    Offset[nRow] = k;
+  }
+  mg_free((void*)Cursor);
+  (*pCSR) = CSR;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_build_node2elem_csr */
+/* builds the node-to-element connectivity of Mesh */
+int mg_build_node2elem_csr(mg_Mesh *Mesh, mg_CSR **pCSR)
+{
+  return error(mg_build_csr(Mesh, false, pCSR));
+}
+
+/******************************************************************/
+/* function:  mg_build_node2face_csr */
+/* builds the node-to-face connectivity of Mesh */
+int mg_build_node2face_csr(mg_Mesh *Mesh, mg_CSR **pCSR)
+{
+  return error(mg_build_csr(Mesh, true, pCSR));
+}
+
+/******************************************************************/
+/* function:  mg_destroy_csr */
+void mg_destroy_csr(mg_CSR *CSR)
+{
+  if (CSR == NULL) return;
+  mg_free((void*)CSR->Offset);
+  mg_free((void*)CSR->Index);
+  mg_free((void*)CSR);
+}
+
+/******************************************************************/
+/* function:  mg_csr_2_lists */
+/* copies the rows of CSR to the ordered lists (*pList) */
+int mg_csr_2_lists(mg_CSR *CSR, mg_List **pList)
+{
+  int ierr, i, k, n, nerr = 0;
+  mg_List *List;
+  
+  if ((*pList) == NULL) {
+    //one allocation per row instead of one per entry
+    call(mg_alloc((void**)pList, CSR->nRow, sizeof(mg_List)));
+    List = (*pList);
+#pragma omp parallel for schedule(static) private(n) reduction(+:nerr) if(CSR->nRow > CSRPARMIN)
+    for (i = 0; i < CSR->nRow; i++) {
+      mg_init_list(List+i);
+      n = CSR->Offset[i+1]-CSR->Offset[i];
+      if (mg_alloc((void**)&List[i].Item, n, sizeof(int)) != err_OK) {
+        nerr++;
+        continue;
+      }
+      if (n > 0)
+        memcpy(List[i].Item, CSR->Index+CSR->Offset[i], n*sizeof(int));
+      List[i].nItem = n;
+    }
+    //rows filled so far are freed, the lists stay unbuilt
+    if (nerr > 0) {
+      for (i = 0; i < CSR->nRow; i++)
+        mg_free((void*)List[i].Item);
+      mg_free((void*)List);
+      (*pList) = NULL;
+      return error(err_MEMORY_ERROR);
+    }
+  
+    return err_OK;
+  }
+  List = (*pList);
+  for (i = 0; i < CSR->nRow; i++)
+    for (k = CSR->Offset[i]; k < CSR->Offset[i+1]; k++)
+      call(mg_add_2_ord_set(CSR->Index[k], &List[i].nItem, &List[i].Item,
+                            NULL, false));
+  
+  return err_OK;
+}
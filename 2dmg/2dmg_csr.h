@@ -0,0 +1,49 @@
+//
+//  2dmg_csr.h
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#ifndef ___dmg___dmg_csr__
+#define ___dmg___dmg_csr__
+
+#include <stdio.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+
+/******************************************************************/
+/* compressed (CSR) node connectivities. Row i lists, in increasing
+ order and without repetitions, the elements (or faces) that have
+ node i: Index[Offset[i]..Offset[i+1]). There is a row for every node
+ slot and components on the removal stacks are left out. A CSR is
+ built in two counting passes over the components, in parallel: the
+ node degrees are counted, offsets taken from their running sum and
+ every component scattered to the rows of its nodes, which are then
+ sorted. Unlike Node2Elem and Node2Face it is not updated by the
+ front advancement and has to be rebuilt after the mesh changes */
+//components below which a CSR is built by one thread
+#define CSRPARMIN         16384
+
+/******************************************************************/
+/* function:  mg_build_node2elem_csr */
+/* builds the node-to-element connectivity of Mesh */
+int mg_build_node2elem_csr(mg_Mesh *Mesh, mg_CSR **pCSR);
+
+/******************************************************************/
+/* function:  mg_build_node2face_csr */
+/* builds the node-to-face connectivity of Mesh */
+int mg_build_node2face_csr(mg_Mesh *Mesh, mg_CSR **pCSR);
+
+/******************************************************************/
+/* function:  mg_destroy_csr */
+void mg_destroy_csr(mg_CSR *CSR);
+
+/******************************************************************/
+/* function:  mg_csr_2_lists */
+/* copies the rows of CSR to the ordered lists (*pList), allocated
+ with one list per row if NULL. Rows are merged into lists that
+ exist already */
+int mg_csr_2_lists(mg_CSR *CSR, mg_List **pList);
+
+#endif
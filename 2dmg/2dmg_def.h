@@ -40,6 +40,9 @@
 #define SQRT2             1.41421356237310
 #define HALFSQRT2         0.707106781186548
 #define NPARAMLIST        100 //hash table size
+#define CIRCLEMINSIZE     0.55 //min target size/face length (circle engine)
+#define CIRCLEMAXSIZE     2.0 //max target size/face length (circle engine)
+#define ELLIPSEMAXJ       2.0 //max ellipse mismatch of an existing node (ellipse engine)
 
 /******************************************************************/
 /* Useful macros */
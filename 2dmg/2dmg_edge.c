@@ -0,0 +1,402 @@
+//
+//  2dmg_edge.c
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <omp.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_utils.h"
+#include "2dmg_math.h"
+#include "2dmg_csr.h"
+#include "2dmg_facegeom.h"
+#include "2dmg_edge.h"
+
+#define EDGEEMPTY UINT64_MAX
+#define EDGENOSIDE INT_MAX
+#define EDGEGOLDEN 0x9E3779B97F4A7C15ULL
+
+/******************************************************************/
+/* slot of the edge table, 16 bytes so an insertion touches one cache
+ line. Side[1] of a boundary edge holds its boundary tag once matched */
+typedef struct
+{
+  uint64_t Key; //sorted node pair (EDGEEMPTY if unused)
+  int Side[2]; //element sides on the edge (EDGENOSIDE if none)
+}
+mg_EdgeSlot;
+
+/******************************************************************/
+/* open-addressing table of the element edges */
+typedef struct
+{
+  int Shift; //64 minus the log2 of the length
+  uint64_t Mask; //length minus one
+  mg_EdgeSlot *Slot;
+}
+mg_EdgeTable;
+
+/******************************************************************/
+/* function:  mg_edge_key */
+/* key of the edge between nodes a and b, whatever the direction */
+static inline uint64_t mg_edge_key(const int a, const int b)
+{
+  if (a > b) return ((uint64_t)b << 32) | (uint32_t)a;
+  return ((uint64_t)a << 32) | (uint32_t)b;
+}
+
+/******************************************************************/
+/* function:  mg_create_edge_table */
+/* allocates an empty table with room for nSide sides */
+static int mg_create_edge_table(mg_EdgeTable *Table, int nSide)
+{
+  int ierr, nbit = 4;
+  uint64_t i, n;
+  
+  //two thirds full at most, if no two sides share an edge (a third
+  //in a conforming mesh)
+  while (((uint64_t)1 << nbit) < 3*(uint64_t)nSide/2+1) nbit++;
+  n = (uint64_t)1 << nbit;
+  Table->Shift = 64-nbit;
+  Table->Mask = n-1;
+  call(mg_alloc((void**)&Table->Slot, (int)n, sizeof(mg_EdgeSlot)));
+#pragma omp parallel for schedule(static) if(n > EDGEPARMIN)
+  for (i = 0; i < n; i++) {
+    Table->Slot[i].Key = EDGEEMPTY;
+    Table->Slot[i].Side[0] = Table->Slot[i].Side[1] = EDGENOSIDE;
+  }
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_destroy_edge_table */
+static void mg_destroy_edge_table(mg_EdgeTable *Table)
+{
+  mg_free((void*)Table->Slot);
+}
+
+/******************************************************************/
+/* function:  mg_edge_insert */
+/* slot of key, claimed if new. Threads may insert concurrently: an
+ empty slot is claimed by compare-and-swap and keys never move */
+static uint64_t mg_edge_insert(mg_EdgeTable *Table, uint64_t key)
+{
+  uint64_t h, old;
+  
+  for (h = (key*EDGEGOLDEN) >> Table->Shift;; h = (h+1) & Table->Mask) {
+    old = Table->Slot[h].Key;
+    if (old == EDGEEMPTY)
+      old = __sync_val_compare_and_swap(&Table->Slot[h].Key, EDGEEMPTY, key);
+    if (old == EDGEEMPTY || old == key) return h;
+  }
+}
+
+/******************************************************************/
+/* function:  mg_edge_find */
+/* slot of key, -1 if it is not in the table */
+static int mg_edge_find(mg_EdgeTable *Table, uint64_t key)
+{
+  uint64_t h;
+  
+  for (h = (key*EDGEGOLDEN) >> Table->Shift;; h = (h+1) & Table->Mask) {
+    if (Table->Slot[h].Key == key) return (int)h;
+    if (Table->Slot[h].Key == EDGEEMPTY) return -1;
+  }
+}
+
+/******************************************************************/
+/* function:  mg_edge_partner */
+/* other side on the edge of slot h than s, -1 on the boundary */
+static inline int mg_edge_partner(mg_EdgeTable *Table, int h, int s)
+{
+  int *Side = Table->Slot[h].Side;
+  
+  if (Side[1] < 0 || Side[1] == EDGENOSIDE) return -1;
+  return (Side[0] == s) ? Side[1] : Side[0];
+}
+
+/******************************************************************/
+/* function:  mg_edge_add_group */
+/* appends boundary group EDGEBNAME to Mesh and re-encodes the tags of
+ its boundary faces, whose limit grows with the number of groups */
+static int mg_edge_add_group(mg_Mesh *Mesh, int nFace, mg_FaceData **Face,
+                             int nNew)
+{
+  int ierr, f, m, k, g, e, knew = 0;
+  char **BNames;
+  mg_ElemData *Elem;
+  
+  call(mg_alloc2((void***)&BNames, Mesh->nBfg+1, MAXSTRLEN, sizeof(char)));
+  memset(BNames[0], 0, (Mesh->nBfg+1)*MAXSTRLEN);
+  for (g = 0; g < Mesh->nBfg; g++)
+    strncpy(BNames[g], Mesh->BNames[g], MAXSTRLEN-1);
+  strncpy(BNames[Mesh->nBfg], EDGEBNAME, MAXSTRLEN-1);
+  mg_free2((void**)Mesh->BNames);
+  Mesh->BNames = BNames;
+  call(mg_realloc((void**)&Mesh->nBface, Mesh->nBfg+1, sizeof(int)));
+  Mesh->nBface[Mesh->nBfg] = nNew;
+  
+  for (f = 0; f < nFace; f++) {
+    if (Face[f]->elem[RIGHTNEIGHINDEX] >= 0) continue;
+    if (Face[f]->elem[RIGHTNEIGHINDEX] == HOLLOWNEIGHTAG) {
+      k = knew++;
+      g = Mesh->nBfg;
+    }
+    else
+      call(mg_limited_pair_inv(&k, &g, -Face[f]->elem[RIGHTNEIGHINDEX]-1,
+                               Mesh->nBfg));
+    call(mg_limited_pair(k, g, &e, Mesh->nBfg+1));
+    Face[f]->elem[RIGHTNEIGHINDEX] = -(e+1);
+    //boundary faces are on the right of their only element
+    Elem = Mesh->Elem+Face[f]->elem[LEFTNEIGHINDEX];
+    for (m = 0; m < Elem->nNode; m++)
+      if (Elem->face[m] == f) Elem->nbor[m] = -(e+1);
+  }
+  printf("%d boundary faces without a group put in %s\n", nNew, EDGEBNAME);
+  Mesh->nBfg++;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_edge_free_faces */
+/* frees the nFace faces of Face (NULL entries are skipped) and Face */
+static void mg_edge_free_faces(int nFace, mg_FaceData **Face)
+{
+  int f;
+  
+  if (Face == NULL) return;
+  for (f = 0; f < nFace; f++) {
+    if (Face[f] == NULL) continue;
+    mg_free((void*)Face[f]->node);
+    mg_free((void*)Face[f]);
+  }
+  mg_free((void*)Face);
+}
+
+/******************************************************************/
+/* function:  mg_edge_free_sides */
+/* frees the side arrays and the edge table of mg_build_faces */
+static void mg_edge_free_sides(mg_EdgeTable *Table, int *SideStart,
+                               int *SideElem, int *SideSlot,
+                               int *FaceStart)
+{
+  mg_destroy_edge_table(Table);
+  mg_free((void*)FaceStart);
+  mg_free((void*)SideSlot);
+  mg_free((void*)SideElem);
+  mg_free((void*)SideStart);
+}
+
+/******************************************************************/
+/* function:  mg_build_faces */
+/* replaces the faces of Mesh by the edges of its elements */
+int mg_build_faces(mg_Mesh *Mesh)
+{
+  int ierr, i, j, k, m, c, n, s, s2, e2, j2, h, f, tag, nRow, nSide;
+  int *Side;
+  int nFace, nbad = 0, nlost = 0, nerr = 0, nNew = 0;
+  int *SideStart, *SideElem = NULL, *SideSlot = NULL, *FaceStart = NULL;
+  int *node;
+  mg_EdgeTable Table;
+  mg_FaceData **Face = NULL, *face;
+  mg_ElemData *Elem;
+  mg_CSR *CSR;
+  
+  if (Mesh->Stack->Elem->nItem > 0 || Mesh->Stack->Face->nItem > 0)
+    return error(err_NOT_SUPPORTED);
+  nRow = Mesh->nNode+Mesh->Stack->Node->nItem;
+  //sides of element i: [SideStart[i], SideStart[i+1])
+  call(mg_alloc((void**)&SideStart, Mesh->nElem+1, sizeof(int)));
+  SideStart[0] = 0;
+  for (i = 0; i < Mesh->nElem; i++)
+    SideStart[i+1] = SideStart[i]+Mesh->Elem[i].nNode;
+  nSide = SideStart[Mesh->nElem];
+  Table.Slot = NULL;
+  if ((ierr = error(mg_alloc((void**)&SideElem, nSide,
+                             sizeof(int)))) == err_OK &&
+      (ierr = error(mg_alloc((void**)&SideSlot, nSide,
+                             sizeof(int)))) == err_OK)
+    ierr = error(mg_create_edge_table(&Table, nSide));
+  if (ierr != err_OK) {
+    mg_edge_free_sides(&Table, SideStart, SideElem, SideSlot, FaceStart);
+    return ierr;
+  }
+  
+  //every side goes to the slot of its edge
+#pragma omp parallel for schedule(static) private(j, k, n, s, h, node, Side) reduction(+:nbad) if(nSide > EDGEPARMIN)
+  for (i = 0; i < Mesh->nElem; i++) {
+    n = Mesh->Elem[i].nNode;
+    node = Mesh->Elem[i].node;
+    for (j = 0; j < n; j++) {
+      k = nextincycle(j, n);
+      s = SideStart[i]+j;
+      SideElem[s] = i;
+      SideSlot[s] = -1;
+      if (node[j] < 0 || node[j] >= nRow || node[k] < 0 ||
+          node[k] >= nRow || node[j] == node[k]) {
+        nbad++;
+        continue;
+      }
+      h = (int)mg_edge_insert(&Table, mg_edge_key(node[j], node[k]));
+      SideSlot[s] = h;
+      Side = Table.Slot[h].Side;
+      //more than two sides on an edge
+      if (!__sync_bool_compare_and_swap(Side, EDGENOSIDE, s) &&
+          !__sync_bool_compare_and_swap(Side+1, EDGENOSIDE, s))
+        nbad++;
+    }
+  }
+  
+  //boundary groups of the faces given
+#pragma omp parallel for schedule(static) private(h, tag, face) reduction(+:nlost) if(Mesh->nFace > EDGEPARMIN)
+  for (f = 0; f < Mesh->nFace; f++) {
+    face = Mesh->Face[f];
+    tag = face->elem[RIGHTNEIGHINDEX];
+    if (tag >= 0 || tag == HOLLOWNEIGHTAG || face->nNode != 2) continue;
+    h = mg_edge_find(&Table, mg_edge_key(face->node[0], face->node[1]));
+    if (h < 0 || Table.Slot[h].Side[1] != EDGENOSIDE) nlost++;
+    else Table.Slot[h].Side[1] = tag;
+  }
+  if (nbad > 0 || nlost > 0) {
+    if (nlost > 0)
+      printf("%d boundary faces are not boundary edges\n", nlost);
+    mg_edge_free_sides(&Table, SideStart, SideElem, SideSlot, FaceStart);
+    return error(err_MESH_ERROR);
+  }
+  
+  //an edge is a face of the first of its sides, so faces are numbered
+  //in element order
+  if ((ierr = error(mg_alloc((void**)&FaceStart, Mesh->nElem+1,
+                             sizeof(int)))) != err_OK) {
+    mg_edge_free_sides(&Table, SideStart, SideElem, SideSlot, FaceStart);
+    return ierr;
+  }
+  FaceStart[0] = 0;
+#pragma omp parallel for schedule(static) private(s, s2, c) if(nSide > EDGEPARMIN)
+  for (i = 0; i < Mesh->nElem; i++) {
+    for (s = SideStart[i], c = 0; s < SideStart[i+1]; s++) {
+      s2 = mg_edge_partner(&Table, SideSlot[s], s);
+      if (s2 < 0 || s < s2) c++;
+    }
+    FaceStart[i+1] = c;
+  }
+  for (i = 0; i < Mesh->nElem; i++)
+    FaceStart[i+1] += FaceStart[i];
+  nFace = FaceStart[Mesh->nElem];
+  
+  //from here on the element entries are overwritten: on failure they
+  //are left to be linked again to the faces kept
+  for (i = 0; i < Mesh->nElem && ierr == err_OK; i++) {
+    Elem = Mesh->Elem+i;
+    if (Elem->face == NULL)
+      ierr = error(mg_alloc((void**)&Elem->face, Elem->nNode, sizeof(int)));
+    if (Elem->nbor == NULL && ierr == err_OK)
+      ierr = error(mg_alloc((void**)&Elem->nbor, Elem->nNode, sizeof(int)));
+  }
+  if (ierr == err_OK)
+    ierr = error(mg_alloc((void**)&Face, nFace, sizeof(mg_FaceData*)));
+  if (ierr != err_OK) {
+    mg_edge_free_sides(&Table, SideStart, SideElem, SideSlot, FaceStart);
+    Mesh->Pending |= MESHLINKS;
+    return ierr;
+  }
+  if (nFace > 0) memset(Face, 0, nFace*sizeof(mg_FaceData*));
+  //faces and the element entries on both of their sides
+#pragma omp parallel for schedule(static) private(j, k, m, n, s, s2, e2, j2, h, f, node, face, Elem) reduction(+:nbad,nerr,nNew) if(nSide > EDGEPARMIN)
+  for (i = 0; i < Mesh->nElem; i++) {
+    n = Mesh->Elem[i].nNode;
+    node = Mesh->Elem[i].node;
+    for (j = 0, f = FaceStart[i]; j < n; j++) {
+      s = SideStart[i]+j;
+      h = SideSlot[s];
+      s2 = mg_edge_partner(&Table, h, s);
+      if (s2 >= 0 && s2 < s) continue;
+      k = nextincycle(j, n);
+      if (mg_alloc((void**)&face, 1, sizeof(mg_FaceData)) != err_OK) {
+        nerr++;
+        f++;
+        continue;
+      }
+      mg_init_face(face);
+      Face[f] = face;
+      if (mg_alloc((void**)&face->node, 2, sizeof(int)) != err_OK) {
+        nerr++;
+        f++;
+        continue;
+      }
+      face->nNode = 2;
+      face->node[0] = node[j];
+      face->node[1] = node[k];
+      face->elem[LEFTNEIGHINDEX] = i;
+      if (s2 >= 0) {
+        //the right element goes along the edge the other way
+        e2 = SideElem[s2];
+        j2 = s2-SideStart[e2];
+        Elem = Mesh->Elem+e2;
+        m = nextincycle(j2, Elem->nNode);
+        if (Elem->node[m] != node[j]) nbad++;
+        face->elem[RIGHTNEIGHINDEX] = e2;
+        m = nextincycle(m, Elem->nNode);
+        Elem->face[m] = f;
+        Elem->nbor[m] = i;
+      }
+      else if (Table.Slot[h].Side[1] < 0)
+        face->elem[RIGHTNEIGHINDEX] = Table.Slot[h].Side[1];
+      else {
+        face->elem[RIGHTNEIGHINDEX] = HOLLOWNEIGHTAG;
+        nNew++;
+      }
+      m = previncycle(j, n);
+      Mesh->Elem[i].face[m] = f;
+      Mesh->Elem[i].nbor[m] = face->elem[RIGHTNEIGHINDEX];
+      f++;
+    }
+  }
+  mg_edge_free_sides(&Table, SideStart, SideElem, SideSlot, FaceStart);
+  if (nerr > 0)
+    ierr = error(err_MEMORY_ERROR);
+  else if (nbad > 0) {
+    printf("%d edges traversed the same way by both elements\n", nbad);
+    ierr = error(err_MESH_ERROR);
+  }
+  else if (nNew > 0)
+    ierr = error(mg_edge_add_group(Mesh, nFace, Face, nNew));
+  if (ierr != err_OK) {
+    mg_edge_free_faces(nFace, Face);
+    Mesh->Pending |= MESHLINKS;
+    return ierr;
+  }
+  
+  //swap the face table, whose geometry starts over
+  mg_edge_free_faces(Mesh->nFace, Mesh->Face);
+  mg_destroy_face_geom(Mesh->FaceGeom);
+  Mesh->FaceGeom = NULL;
+  Mesh->Face = Face;
+  Mesh->nFace = nFace;
+  Mesh->Pending &= ~MESHLINKS;
+  Mesh->Pending |= MESHFACEGEOM;
+  //node-to-face lists already built are refilled in place (the node
+  //quadtree points to them)
+  if (Mesh->Node2Face != NULL) {
+    for (i = 0; i < nRow; i++) {
+      mg_free((void*)Mesh->Node2Face[i].Item);
+      mg_init_list(Mesh->Node2Face+i);
+    }
+    //emptied lists are filled again on demand if this fails
+    Mesh->Pending |= MESHNODE2FACE;
+    call(mg_build_node2face_csr(Mesh, &CSR));
+    ierr = error(mg_csr_2_lists(CSR, &Mesh->Node2Face));
+    mg_destroy_csr(CSR);
+    if (ierr != err_OK) return ierr;
+    Mesh->Pending &= ~MESHNODE2FACE;
+  }
+  
+  return err_OK;
+}
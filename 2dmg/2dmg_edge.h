@@ -0,0 +1,39 @@
+//
+//  2dmg_edge.h
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#ifndef ___dmg___dmg_edge__
+#define ___dmg___dmg_edge__
+
+#include <stdio.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+
+/******************************************************************/
+/* faces of a mesh given by its elements. Every element side goes in
+ an open-addressing table keyed on its sorted node pair, filled in
+ parallel, so sides sharing an edge meet on the same slot in expected
+ constant time. Each edge becomes a face numbered after the first
+ element that has it, with that element on its left; boundary edges
+ take the group of the boundary face with the same nodes */
+//sides below which the table is filled by one thread
+#define EDGEPARMIN        16384
+//name of the group of boundary edges without a matching face
+#define EDGEBNAME         "Boundary"
+
+/******************************************************************/
+/* function:  mg_build_faces */
+/* replaces the faces of Mesh by the edges of its elements and sets
+ the face and neighbor entries of the elements. Faces of Mesh with a
+ boundary tag on the right give the group (and number within it) of
+ the boundary edge with their nodes; boundary edges matching none go
+ in a new group EDGEBNAME. Elements must be oriented counterclockwise
+ and the component stacks empty. Fails with err_MESH_ERROR if an edge
+ has more than two elements, two elements traverse it the same way or
+ a boundary face is not a boundary edge */
+int mg_build_faces(mg_Mesh *Mesh);
+
+#endif
@@ -0,0 +1,574 @@
+//
+//  2dmg_export.c
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "2dmg_export.h"
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_utils.h"
+#include "2dmg_math.h"
+#include "2dmg_io.h"
+
+/******************************************************************/
+/* function:  mg_export_prepare */
+/* lists the nodes and elements in use, NodeMap gives the new number
+ of each node slot. Boundary faces are sorted by group: those of group
+ g are BFace[GroupStart[g]] to BFace[GroupStart[g+1]-1] */
+static int mg_export_prepare(mg_Mesh *Mesh, int *pnNode, int **pNode,
+                             int **pNodeMap, int *pnElem, int **pElem,
+                             int **pGroupStart, int **pBFace)
+{
+  int ierr, nSlot, i, s, g, k, tag, *Node, *NodeMap, *Elem;
+  int *GroupStart, *BFace, *Group;
+  mg_FaceData *Face;
+  
+  //nodes
+  nSlot = Mesh->nNode+Mesh->Stack->Node->nItem;
+  call(mg_alloc((void**)&Node, max(nSlot, 1), sizeof(int)));
+  call(mg_alloc((void**)&NodeMap, max(nSlot, 1), sizeof(int)));
+  (*pnNode) = mg_live_slots(Mesh->Stack->Node, nSlot, Node, NodeMap);
+  //elements
+  nSlot = Mesh->nElem+Mesh->Stack->Elem->nItem;
+  call(mg_alloc((void**)&Elem, max(nSlot, 1), sizeof(int)));
+  (*pnElem) = mg_live_slots(Mesh->Stack->Elem, nSlot, Elem, NULL);
+  //boundary faces carry -(code+1) on one side, code = (index, group)
+  nSlot = Mesh->nFace+Mesh->Stack->Face->nItem;
+  call(mg_alloc((void**)&Group, max(nSlot, 1), sizeof(int)));
+  call(mg_alloc((void**)&GroupStart, Mesh->nBfg+1, sizeof(int)));
+  for (g = 0; g <= Mesh->nBfg; g++) GroupStart[g] = 0;
+  for (i = 0; i < nSlot; i++) {
+    Group[i] = -1;
+    if (mg_is_stacked(Mesh->Stack->Face, i)) continue;
+    Face = Mesh->Face[i];
+    for (s = 0; s < 2; s++) {
+      tag = Face->elem[s];
+      if (tag >= 0 || tag == HOLLOWNEIGHTAG) continue;
+      call(mg_limited_pair_inv(&k, &g, -tag-1, Mesh->nBfg));
+      if (g >= 0 && g < Mesh->nBfg) Group[i] = g;
+    }
+    if (Group[i] >= 0) GroupStart[Group[i]+1]++;
+  }
+  for (g = 0; g < Mesh->nBfg; g++)
+    GroupStart[g+1] += GroupStart[g];
+  call(mg_alloc((void**)&BFace, max(GroupStart[Mesh->nBfg], 1),
+                sizeof(int)));
+  for (i = 0; i < nSlot; i++)
+    if (Group[i] >= 0) BFace[GroupStart[Group[i]]++] = i;
+  //filling advanced every start to the next one
+  for (g = Mesh->nBfg; g > 0; g--)
+    GroupStart[g] = GroupStart[g-1];
+  GroupStart[0] = 0;
+  mg_free((void*)Group);
+  
+  (*pNode) = Node;
+  (*pNodeMap) = NodeMap;
+  (*pElem) = Elem;
+  (*pGroupStart) = GroupStart;
+  (*pBFace) = BFace;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_export_fields */
+/* evaluates the requested fields on the nElem elements in Elem:
+ Quality (1 per element) and Tensor (9 per element) */
+static int mg_export_fields(mg_Mesh *Mesh, mg_Metric *Metric, int Fields,
+                            int nElem, const int *Elem, double **pQuality,
+                            double **pTensor)
+{
+  int ierr, i, k, *node;
+  double *x, *y, *M = NULL, *Quality = NULL, *Tensor = NULL;
+  double Mi[3], *X[3], e[2], L2, A;
+  
+  (*pQuality) = (*pTensor) = NULL;
+  if (Fields == 0 || nElem == 0) return err_OK;
+  if ((Fields & EXPORTMETRIC) && Metric == NULL)
+    return error(err_INPUT_ERROR);
+  //metric at the centroids in one call
+  if (Metric != NULL) {
+    call(mg_alloc((void**)&x, nElem, sizeof(double)));
+    call(mg_alloc((void**)&y, nElem, sizeof(double)));
+    call(mg_alloc((void**)&M, 3*nElem, sizeof(double)));
+    for (i = 0; i < nElem; i++) {
+      node = Mesh->Elem[Elem[i]].node;
+      x[i] = (Mesh->Coord[2*node[0]]+Mesh->Coord[2*node[1]]+
+              Mesh->Coord[2*node[2]])/3.0;
+      y[i] = (Mesh->Coord[2*node[0]+1]+Mesh->Coord[2*node[1]+1]+
+              Mesh->Coord[2*node[2]+1])/3.0;
+    }
+    ierr = error(mg_get_metric(Metric, x, y, nElem, M));
+    mg_free((void*)x);
+    mg_free((void*)y);
+    if (ierr != err_OK) {
+      mg_free((void*)M);
+      return ierr;
+    }
+  }
+  if (Fields & EXPORTQUALITY) {
+    call(mg_alloc((void**)&Quality, nElem, sizeof(double)));
+    for (i = 0; i < nElem; i++) {
+      node = Mesh->Elem[Elem[i]].node;
+      if (M != NULL)
+        memcpy(Mi, M+3*i, 3*sizeof(double));
+      else {
+        Mi[0] = Mi[2] = 1.0;
+        Mi[1] = 0.0;
+      }
+      for (k = 0; k < 3; k++) X[k] = Mesh->Coord+2*node[k];
+      //squared metric lengths of the edges
+      for (L2 = 0.0, k = 0; k < 3; k++) {
+        e[0] = X[(k+1)%3][0]-X[k][0];
+        e[1] = X[(k+1)%3][1]-X[k][1];
+        L2 += Mi[0]*e[0]*e[0]+2.0*Mi[1]*e[0]*e[1]+Mi[2]*e[1]*e[1];
+      }
+      A = 0.5*((X[1][0]-X[0][0])*(X[2][1]-X[0][1])-
+               (X[1][1]-X[0][1])*(X[2][0]-X[0][0]));
+      A *= sqrt(max(Mi[0]*Mi[2]-Mi[1]*Mi[1], 0.0));
+      Quality[i] = (L2 > 0.0) ? 4.0*SQRT3*A/L2 : 0.0;
+    }
+  }
+  if (Fields & EXPORTMETRIC) {
+    if ((ierr = error(mg_alloc((void**)&Tensor, 9*nElem,
+                               sizeof(double)))) != err_OK) {
+      mg_free((void*)M);
+      mg_free((void*)Quality);
+      return ierr;
+    }
+    memset(Tensor, 0, 9*nElem*sizeof(double));
+    for (i = 0; i < nElem; i++) {
+      Tensor[9*i+0] = M[3*i+0];
+      Tensor[9*i+1] = Tensor[9*i+3] = M[3*i+1];
+      Tensor[9*i+4] = M[3*i+2];
+    }
+  }
+  mg_free((void*)M);
+  (*pQuality) = Quality;
+  (*pTensor) = Tensor;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_xml_name */
+/* writes s as an XML attribute value */
+static void mg_xml_name(FILE *fid, const char *s)
+{
+  for (; (*s) != '\0'; s++) {
+    switch (*s) {
+      case '&': fputs("&amp;", fid); break;
+      case '<': fputs("&lt;", fid); break;
+      case '>': fputs("&gt;", fid); break;
+      case '"': fputs("&quot;", fid); break;
+      default: fputc(*s, fid);
+    }
+  }
+}
+
+/******************************************************************/
+/* function:  mg_vtu_array */
+/* declares an appended data array and advances the offset past it */
+static void mg_vtu_array(FILE *fid, const char *type, const char *name,
+                         int nComp, size_t bytes, uint64_t *poffset)
+{
+  fprintf(fid, "        <DataArray type=\"%s\" Name=\"%s\" "
+          "NumberOfComponents=\"%d\" format=\"appended\" offset=\"%llu\"/>\n",
+          type, name, nComp, (unsigned long long)(*poffset));
+  (*poffset) += sizeof(uint64_t)+bytes;
+}
+
+/******************************************************************/
+/* function:  mg_vtu_block */
+/* writes an appended block: its length in bytes, then the data */
+static int mg_vtu_block(FILE *fid, const void *data, size_t bytes)
+{
+  uint64_t len = (uint64_t)bytes;
+  
+  if (fwrite(&len, sizeof(uint64_t), 1, fid) != 1) return err_READWRITE_ERROR;
+  if (bytes > 0 && fwrite(data, 1, bytes, fid) != bytes)
+    return err_READWRITE_ERROR;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_write_vtu_data */
+/* writes the file once the lists and fields are ready */
+static int mg_write_vtu_data(FILE *fid, mg_Mesh *Mesh, int nNode,
+                             const int *Node, const int *NodeMap,
+                             int nElem, const int *Elem,
+                             const int *GroupStart, const int *BFace,
+                             const double *Quality, const double *Tensor)
+{
+  int ierr, i, k, g, c, nBFace, nCell, one = 1;
+  uint64_t offset = 0;
+  size_t nData;
+  int64_t *I64 = NULL;
+  int32_t *I32 = NULL;
+  uint8_t *Type = NULL;
+  double *R = NULL;
+  
+  nBFace = GroupStart[Mesh->nBfg];
+  nCell = nElem+nBFace;
+  //header with every array declared up front
+  fprintf(fid, "<?xml version=\"1.0\"?>\n");
+  fprintf(fid, "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" "
+          "byte_order=\"%s\" header_type=\"UInt64\">\n",
+          (*(char*)&one == 1) ? "LittleEndian" : "BigEndian");
+  fprintf(fid, "  <UnstructuredGrid>\n");
+  fprintf(fid, "    <FieldData>\n");
+  for (g = 0; g < Mesh->nBfg; g++) {
+    fprintf(fid, "      <DataArray type=\"Int32\" Name=\"");
+    mg_xml_name(fid, Mesh->BNames[g]);
+    fprintf(fid, "\" NumberOfTuples=\"1\" format=\"ascii\">%d</DataArray>\n",
+            g+1);
+  }
+  fprintf(fid, "    </FieldData>\n");
+  fprintf(fid, "    <Piece NumberOfPoints=\"%d\" NumberOfCells=\"%d\">\n",
+          nNode, nCell);
+  fprintf(fid, "      <Points>\n");
+  mg_vtu_array(fid, "Float64", "Points", 3, 3*nNode*sizeof(double), &offset);
+  fprintf(fid, "      </Points>\n");
+  fprintf(fid, "      <Cells>\n");
+  mg_vtu_array(fid, "Int64", "connectivity", 1,
+               (3*nElem+2*nBFace)*sizeof(int64_t), &offset);
+  mg_vtu_array(fid, "Int64", "offsets", 1, nCell*sizeof(int64_t), &offset);
+  mg_vtu_array(fid, "UInt8", "types", 1, nCell*sizeof(uint8_t), &offset);
+  fprintf(fid, "      </Cells>\n");
+  fprintf(fid, "      <CellData>\n");
+  mg_vtu_array(fid, "Int32", "BoundaryGroup", 1, nCell*sizeof(int32_t),
+               &offset);
+  if (Quality != NULL)
+    mg_vtu_array(fid, "Float64", "Quality", 1, nCell*sizeof(double),
+                 &offset);
+  if (Tensor != NULL)
+    mg_vtu_array(fid, "Float64", "Metric", 9, 9*nCell*sizeof(double),
+                 &offset);
+  fprintf(fid, "      </CellData>\n");
+  fprintf(fid, "    </Piece>\n");
+  fprintf(fid, "  </UnstructuredGrid>\n");
+  fprintf(fid, "  <AppendedData encoding=\"raw\">\n_");
+  
+  //data, in the order declared. Boundary faces follow the triangles
+  nData = max(max(3*nNode, 9*nCell), 3*nElem+2*nBFace);
+  call(mg_alloc((void**)&R, max(nData, 1), sizeof(double)));
+  if ((ierr = error(mg_alloc((void**)&I64, max(nData, 1),
+                             sizeof(int64_t)))) != err_OK) {
+    mg_free((void*)R);
+    return ierr;
+  }
+  for (i = 0; i < nNode; i++) {
+    R[3*i] = Mesh->Coord[2*Node[i]];
+    R[3*i+1] = Mesh->Coord[2*Node[i]+1];
+    R[3*i+2] = 0.0;
+  }
+  ierr = mg_vtu_block(fid, R, 3*nNode*sizeof(double));
+  for (c = i = 0; i < nElem; i++)
+    for (k = 0; k < 3; k++)
+      I64[c++] = NodeMap[Mesh->Elem[Elem[i]].node[k]];
+  for (i = 0; i < nBFace; i++)
+    for (k = 0; k < 2; k++)
+      I64[c++] = NodeMap[Mesh->Face[BFace[i]]->node[k]];
+  if (ierr == err_OK) ierr = mg_vtu_block(fid, I64, c*sizeof(int64_t));
+  for (c = i = 0; i < nCell; i++)
+    I64[i] = (c += (i < nElem) ? 3 : 2);
+  if (ierr == err_OK) ierr = mg_vtu_block(fid, I64, nCell*sizeof(int64_t));
+  //narrower arrays reuse the same buffer
+  Type = (uint8_t*)I64;
+  for (i = 0; i < nCell; i++)
+    Type[i] = (i < nElem) ? 5 : 3; //VTK_TRIANGLE, VTK_LINE
+  if (ierr == err_OK) ierr = mg_vtu_block(fid, Type, nCell*sizeof(uint8_t));
+  I32 = (int32_t*)I64;
+  for (i = 0; i < nElem; i++) I32[i] = 0;
+  for (g = 0; g < Mesh->nBfg; g++)
+    for (i = GroupStart[g]; i < GroupStart[g+1]; i++)
+      I32[nElem+i] = g+1;
+  if (ierr == err_OK) ierr = mg_vtu_block(fid, I32, nCell*sizeof(int32_t));
+  //fields are not defined on boundary faces
+  if (Quality != NULL) {
+    memcpy(R, Quality, nElem*sizeof(double));
+    for (i = nElem; i < nCell; i++) R[i] = NAN;
+    if (ierr == err_OK) ierr = mg_vtu_block(fid, R, nCell*sizeof(double));
+  }
+  if (Tensor != NULL) {
+    memcpy(R, Tensor, 9*nElem*sizeof(double));
+    for (i = 9*nElem; i < 9*nCell; i++) R[i] = NAN;
+    if (ierr == err_OK) ierr = mg_vtu_block(fid, R, 9*nCell*sizeof(double));
+  }
+  mg_free((void*)R);
+  mg_free((void*)I64);
+  if (ierr != err_OK) return error(ierr);
+  fprintf(fid, "\n  </AppendedData>\n</VTKFile>\n");
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_write_vtu */
+/* writes Mesh as a VTK unstructured grid with appended binary data */
+int mg_write_vtu(mg_Mesh *Mesh, mg_Metric *Metric, int Fields,
+                 const char *FileName)
+{
+  int ierr, nNode, nElem, *Node, *NodeMap, *Elem, *GroupStart, *BFace;
+  double *Quality, *Tensor;
+  FILE *fid;
+  
+  if (Mesh->Dim != 2) return error(err_NOT_SUPPORTED);
+  call(mg_export_prepare(Mesh, &nNode, &Node, &NodeMap, &nElem, &Elem,
+                         &GroupStart, &BFace));
+  ierr = error(mg_export_fields(Mesh, Metric, Fields, nElem, Elem,
+                                &Quality, &Tensor));
+  if (ierr == err_OK) {
+    if ((fid = fopen(FileName, "wb")) == NULL)
+      ierr = error(err_READWRITE_ERROR);
+    else {
+      ierr = error(mg_write_vtu_data(fid, Mesh, nNode, Node, NodeMap,
+                                     nElem, Elem, GroupStart, BFace,
+                                     Quality, Tensor));
+      if (fclose(fid) != 0 && ierr == err_OK)
+        ierr = error(err_READWRITE_ERROR);
+    }
+    mg_free((void*)Quality);
+    mg_free((void*)Tensor);
+  }
+  mg_free((void*)Node);
+  mg_free((void*)NodeMap);
+  mg_free((void*)Elem);
+  mg_free((void*)GroupStart);
+  mg_free((void*)BFace);
+  
+  return ierr;
+}
+
+/******************************************************************/
+/* function:  mg_msh_bbox */
+/* writes the bounding box (min xyz, max xyz) of the n faces (or
+ elements) in List */
+static void mg_msh_bbox(FILE *fid, mg_Mesh *Mesh, int n, const int *List,
+                        bool faces)
+{
+  int i, k, d, nPer, node;
+  double b[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+  
+  for (i = 0; i < n; i++) {
+    nPer = (faces) ? 2 : 3;
+    for (k = 0; k < nPer; k++) {
+      node = (faces) ? Mesh->Face[List[i]]->node[k] :
+                       Mesh->Elem[List[i]].node[k];
+      for (d = 0; d < 2; d++) {
+        if ((i == 0 && k == 0) || Mesh->Coord[2*node+d] < b[d])
+          b[d] = Mesh->Coord[2*node+d];
+        if ((i == 0 && k == 0) || Mesh->Coord[2*node+d] > b[3+d])
+          b[3+d] = Mesh->Coord[2*node+d];
+      }
+    }
+  }
+  fwrite(b, sizeof(double), 6, fid);
+}
+
+/******************************************************************/
+/* function:  mg_msh_element_data */
+/* writes an $ElementData section for the triangles, tagged from tag0.
+ Unlike the element section, the data tags are binary ints */
+static void mg_msh_element_data(FILE *fid, const char *name, int nComp,
+                                int nElem, int tag0, const double *v)
+{
+  int i, tag;
+  
+  fprintf(fid, "$ElementData\n1\n\"%s\"\n1\n0\n3\n0\n%d\n%d\n", name, nComp,
+          nElem);
+  for (i = 0; i < nElem; i++) {
+    tag = tag0+i;
+    fwrite(&tag, sizeof(int), 1, fid);
+    fwrite(v+i*nComp, sizeof(double), nComp, fid);
+  }
+  fprintf(fid, "\n$EndElementData\n");
+}
+
+/******************************************************************/
+/* function:  mg_write_msh_data */
+/* writes the file once the lists and fields are ready */
+static int mg_write_msh_data(FILE *fid, mg_Mesh *Mesh, int nNode,
+                             const int *Node, const int *NodeMap,
+                             int nElem, const int *Elem,
+                             const int *GroupStart, const int *BFace,
+                             const double *Quality, const double *Tensor)
+{
+  int ierr, i, k, g, iv[4], one = 1, nBFace;
+  size_t sv[4], *S;
+  double *R;
+  
+  nBFace = GroupStart[Mesh->nBfg];
+  fprintf(fid, "$MeshFormat\n4.1 1 %d\n", (int)sizeof(size_t));
+  fwrite(&one, sizeof(int), 1, fid);
+  fprintf(fid, "\n$EndMeshFormat\n");
+  //group g is physical curve g+1, the triangles physical surface 1
+  fprintf(fid, "$PhysicalNames\n%d\n", Mesh->nBfg+1);
+  for (g = 0; g < Mesh->nBfg; g++)
+    fprintf(fid, "1 %d \"%s\"\n", g+1, Mesh->BNames[g]);
+  fprintf(fid, "2 1 \"Domain\"\n$EndPhysicalNames\n");
+  
+  //entities: a curve per group bounding one surface
+  fprintf(fid, "$Entities\n");
+  sv[0] = 0;
+  sv[1] = Mesh->nBfg;
+  sv[2] = 1;
+  sv[3] = 0;
+  fwrite(sv, sizeof(size_t), 4, fid);
+  for (g = 0; g < Mesh->nBfg; g++) {
+    iv[0] = g+1;
+    fwrite(iv, sizeof(int), 1, fid);
+    mg_msh_bbox(fid, Mesh, GroupStart[g+1]-GroupStart[g],
+                BFace+GroupStart[g], true);
+    sv[0] = 1;
+    fwrite(sv, sizeof(size_t), 1, fid);
+    fwrite(iv, sizeof(int), 1, fid);
+    sv[0] = 0;
+    fwrite(sv, sizeof(size_t), 1, fid);
+  }
+  iv[0] = 1;
+  fwrite(iv, sizeof(int), 1, fid);
+  mg_msh_bbox(fid, Mesh, nElem, Elem, false);
+  sv[0] = 1;
+  fwrite(sv, sizeof(size_t), 1, fid);
+  fwrite(iv, sizeof(int), 1, fid);
+  sv[0] = Mesh->nBfg;
+  fwrite(sv, sizeof(size_t), 1, fid);
+  for (g = 0; g < Mesh->nBfg; g++) {
+    iv[0] = g+1;
+    fwrite(iv, sizeof(int), 1, fid);
+  }
+  fprintf(fid, "\n$EndEntities\n");
+  
+  //nodes, all classified on the surface
+  call(mg_alloc((void**)&S, max(max(nNode, 4*nElem), 1), sizeof(size_t)));
+  if ((ierr = error(mg_alloc((void**)&R, max(3*nNode, 1),
+                             sizeof(double)))) != err_OK) {
+    mg_free((void*)S);
+    return ierr;
+  }
+  fprintf(fid, "$Nodes\n");
+  sv[0] = 1;
+  sv[1] = nNode;
+  sv[2] = 1;
+  sv[3] = nNode;
+  fwrite(sv, sizeof(size_t), 4, fid);
+  iv[0] = 2;
+  iv[1] = 1;
+  iv[2] = 0;
+  fwrite(iv, sizeof(int), 3, fid);
+  sv[0] = nNode;
+  fwrite(sv, sizeof(size_t), 1, fid);
+  for (i = 0; i < nNode; i++) {
+    S[i] = i+1;
+    R[3*i] = Mesh->Coord[2*Node[i]];
+    R[3*i+1] = Mesh->Coord[2*Node[i]+1];
+    R[3*i+2] = 0.0;
+  }
+  fwrite(S, sizeof(size_t), nNode, fid);
+  fwrite(R, sizeof(double), 3*nNode, fid);
+  fprintf(fid, "\n$EndNodes\n");
+  mg_free((void*)R);
+  
+  //elements: boundary faces first (tags 1..nBFace), then triangles
+  fprintf(fid, "$Elements\n");
+  sv[0] = Mesh->nBfg+1;
+  sv[1] = nBFace+nElem;
+  sv[2] = 1;
+  sv[3] = nBFace+nElem;
+  fwrite(sv, sizeof(size_t), 4, fid);
+  for (g = 0; g < Mesh->nBfg; g++) {
+    iv[0] = 1;
+    iv[1] = g+1;
+    iv[2] = 1; //2-node line
+    fwrite(iv, sizeof(int), 3, fid);
+    sv[0] = GroupStart[g+1]-GroupStart[g];
+    fwrite(sv, sizeof(size_t), 1, fid);
+    for (i = GroupStart[g]; i < GroupStart[g+1]; i++) {
+      sv[0] = i+1;
+      for (k = 0; k < 2; k++)
+        sv[1+k] = NodeMap[Mesh->Face[BFace[i]]->node[k]]+1;
+      fwrite(sv, sizeof(size_t), 3, fid);
+    }
+  }
+  iv[0] = 2;
+  iv[1] = 1;
+  iv[2] = 2; //3-node triangle
+  fwrite(iv, sizeof(int), 3, fid);
+  sv[0] = nElem;
+  fwrite(sv, sizeof(size_t), 1, fid);
+  for (i = 0; i < nElem; i++) {
+    S[4*i] = nBFace+i+1;
+    for (k = 0; k < 3; k++)
+      S[4*i+1+k] = NodeMap[Mesh->Elem[Elem[i]].node[k]]+1;
+  }
+  fwrite(S, sizeof(size_t), 4*nElem, fid);
+  fprintf(fid, "\n$EndElements\n");
+  mg_free((void*)S);
+  
+  if (Quality != NULL)
+    mg_msh_element_data(fid, "Quality", 1, nElem, nBFace+1, Quality);
+  if (Tensor != NULL)
+    mg_msh_element_data(fid, "Metric", 9, nElem, nBFace+1, Tensor);
+  if (ferror(fid)) return error(err_READWRITE_ERROR);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_write_msh */
+/* writes Mesh in the Gmsh MSH 4.1 binary format */
+int mg_write_msh(mg_Mesh *Mesh, mg_Metric *Metric, int Fields,
+                 const char *FileName)
+{
+  int ierr, nNode, nElem, *Node, *NodeMap, *Elem, *GroupStart, *BFace;
+  double *Quality, *Tensor;
+  FILE *fid;
+  
+  if (Mesh->Dim != 2) return error(err_NOT_SUPPORTED);
+  call(mg_export_prepare(Mesh, &nNode, &Node, &NodeMap, &nElem, &Elem,
+                         &GroupStart, &BFace));
+  ierr = error(mg_export_fields(Mesh, Metric, Fields, nElem, Elem,
+                                &Quality, &Tensor));
+  if (ierr == err_OK) {
+    if ((fid = fopen(FileName, "wb")) == NULL)
+      ierr = error(err_READWRITE_ERROR);
+    else {
+      ierr = error(mg_write_msh_data(fid, Mesh, nNode, Node, NodeMap,
+                                     nElem, Elem, GroupStart, BFace,
+                                     Quality, Tensor));
+      if (fclose(fid) != 0 && ierr == err_OK)
+        ierr = error(err_READWRITE_ERROR);
+    }
+    mg_free((void*)Quality);
+    mg_free((void*)Tensor);
+  }
+  mg_free((void*)Node);
+  mg_free((void*)NodeMap);
+  mg_free((void*)Elem);
+  mg_free((void*)GroupStart);
+  mg_free((void*)BFace);
+  
+  return ierr;
+}
+
+/******************************************************************/
+/* function:  mg_export_mesh */
+/* picks the exporter from the extension of FileName */
+int mg_export_mesh(mg_Mesh *Mesh, mg_Metric *Metric, int Fields,
+                   const char *FileName)
+{
+  if (mg_has_ext(FileName, VTUEXT))
+    return error(mg_write_vtu(Mesh, Metric, Fields, FileName));
+  if (mg_has_ext(FileName, MSHEXT))
+    return error(mg_write_msh(Mesh, Metric, Fields, FileName));
+  
+  return error(err_NOT_SUPPORTED);
+}
@@ -0,0 +1,57 @@
+//
+//  2dmg_export.h
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#ifndef ___dmg___dmg_export__
+#define ___dmg___dmg_export__
+
+#include <stdio.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_metric_struct.h"
+
+/******************************************************************/
+/* binary exporters for visualization and solver tools. Both write the
+ triangles and the boundary faces (as line elements), renumbered
+ without the components on the removal stacks. The boundary group of
+ a face becomes its physical tag (group index + 1, named after
+ Mesh->BNames). Optional per-triangle fields:
+ EXPORTQUALITY: 4*sqrt(3)*area/(sum of squared edge lengths) measured
+ in the metric at the centroid (Euclidean if no metric is given),
+ 1 for an equilateral triangle.
+ EXPORTMETRIC: metric tensor at the centroid (3x3, z row and column
+ zero) */
+#define EXPORTQUALITY     1
+#define EXPORTMETRIC      2
+
+#define VTUEXT            ".vtu"
+#define MSHEXT            ".msh"
+
+/******************************************************************/
+/* function:  mg_write_vtu */
+/* writes Mesh as a VTK XML unstructured grid with raw appended
+ binary data (native byte order, UInt64 block headers). Boundary
+ groups go in the cell array BoundaryGroup (0 for triangles) and as
+ one field array per group, named after it, holding its tag */
+int mg_write_vtu(mg_Mesh *Mesh, mg_Metric *Metric, int Fields,
+                 const char *FileName);
+
+/******************************************************************/
+/* function:  mg_write_msh */
+/* writes Mesh in the Gmsh MSH 4.1 binary format: one surface entity
+ for the triangles and one curve entity per boundary group, each with
+ its physical name. Fields go in $ElementData sections */
+int mg_write_msh(mg_Mesh *Mesh, mg_Metric *Metric, int Fields,
+                 const char *FileName);
+
+/******************************************************************/
+/* function:  mg_export_mesh */
+/* calls mg_write_vtu or mg_write_msh depending on the extension of
+ FileName */
+int mg_export_mesh(mg_Mesh *Mesh, mg_Metric *Metric, int Fields,
+                   const char *FileName);
+
+#endif
@@ -0,0 +1,233 @@
+//
+//  2dmg_facegeom.c
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_metric_struct.h"
+#include "2dmg_utils.h"
+#include "2dmg_math.h"
+#include "2dmg_facegeom.h"
+
+/******************************************************************/
+/* function:  mg_face_geom_touch */
+/* marks the geometry of face faceID stale */
+int mg_face_geom_touch(mg_Mesh *Mesh, int faceID)
+{
+  int ierr;
+  mg_FaceGeom *Geom = Mesh->FaceGeom;
+  
+  Mesh->Face[faceID]->normal = NULL;
+  Mesh->Face[faceID]->centroid = NULL;
+  //slots past the last update are computed anyway
+  if (Geom == NULL || Geom->All || faceID >= Geom->nSlot ||
+      Geom->IsDirty[faceID])
+    return err_OK;
+  if (Geom->nDirty == Geom->DirtySize) {
+    Geom->DirtySize = max(2*Geom->DirtySize, 16);
+    call(mg_realloc((void**)&Geom->Dirty, Geom->DirtySize, sizeof(int)));
+  }
+  Geom->Dirty[Geom->nDirty++] = faceID;
+  Geom->IsDirty[faceID] = 1;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_face_geom_reserve */
+/* makes room for nSlot face slots */
+int mg_face_geom_reserve(mg_Mesh *Mesh, int nSlot)
+{
+  int ierr, f, n, Dim = Mesh->Dim;
+  mg_FaceGeom *Geom = Mesh->FaceGeom;
+  mg_FaceData *Face;
+  
+  if (Geom == NULL) {
+    call(mg_alloc((void**)&Geom, 1, sizeof(mg_FaceGeom)));
+    memset(Geom, 0, sizeof(mg_FaceGeom));
+    Geom->All = true;
+    Mesh->FaceGeom = Geom;
+  }
+  if (nSlot <= Geom->Size) return err_OK;
+  //doubling keeps the growth linear as the front adds faces
+  n = max(nSlot, 2*Geom->Size);
+  call(mg_realloc((void**)&Geom->Normal, Dim*n, sizeof(double)));
+  call(mg_realloc((void**)&Geom->Centroid, Dim*n, sizeof(double)));
+  call(mg_realloc((void**)&Geom->Length, n, sizeof(double)));
+  call(mg_realloc((void**)&Geom->MLength, n, sizeof(double)));
+  call(mg_realloc((void**)&Geom->IsDirty, n, sizeof(unsigned char)));
+  memset(Geom->IsDirty+Geom->Size, 0, n-Geom->Size);
+  Geom->Size = n;
+  for (f = 0; f < Geom->nSlot; f++) {
+    Face = Mesh->Face[f];
+    if (Face->normal == NULL) continue;
+    Face->normal = Geom->Normal+Dim*f;
+    Face->centroid = Geom->Centroid+Dim*f;
+  }
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_face_geom_sync */
+/* takes the geometry set in the storage as current */
+int mg_face_geom_sync(mg_Mesh *Mesh)
+{
+  int ierr, f, nSlot = Mesh->nFace+Mesh->Stack->Face->nItem;
+  
+  call(mg_face_geom_reserve(Mesh, nSlot));
+  Mesh->FaceGeom->All = false;
+  Mesh->FaceGeom->nSlot = nSlot;
+  for (f = 0; f < nSlot; f++) {
+    if (mg_is_stacked(Mesh->Stack->Face, f)) continue;
+    if (Mesh->Face[f]->normal == NULL)
+      call(mg_face_geom_touch(Mesh, f));
+  }
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_face_geom_set_metric */
+/* sets the metric of the metric lengths */
+int mg_face_geom_set_metric(mg_Mesh *Mesh, mg_Metric *Metric)
+{
+  int ierr;
+  
+  call(mg_face_geom_reserve(Mesh, 0));
+  if (Mesh->FaceGeom->Metric == (void*)Metric) return err_OK;
+  Mesh->FaceGeom->Metric = (void*)Metric;
+  Mesh->FaceGeom->All = true;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_face_geom_block */
+/* computes the geometry of the n (at most FACEGEOMBLOCK) faces in List */
+static int mg_face_geom_block(mg_Mesh *Mesh, mg_Metric *Metric,
+                              int *List, int n)
+{
+  int ierr, i, f, *node;
+  double X0[FACEGEOMBLOCK], Y0[FACEGEOMBLOCK], X1[FACEGEOMBLOCK];
+  double Y1[FACEGEOMBLOCK], Nx[FACEGEOMBLOCK], Ny[FACEGEOMBLOCK];
+  double Cx[FACEGEOMBLOCK], Cy[FACEGEOMBLOCK], L[FACEGEOMBLOCK];
+  double M[3*FACEGEOMBLOCK], dx, dy, d[2], dl2;
+  mg_FaceGeom *Geom = Mesh->FaceGeom;
+  mg_FaceData *Face;
+  
+  //end nodes gathered in contiguous arrays
+  for (i = 0; i < n; i++) {
+    node = Mesh->Face[List[i]]->node;
+    X0[i] = Mesh->Coord[2*node[0]+0];
+    Y0[i] = Mesh->Coord[2*node[0]+1];
+    X1[i] = Mesh->Coord[2*node[1]+0];
+    Y1[i] = Mesh->Coord[2*node[1]+1];
+  }
+  //lengths, normals and centroids, unit stride only
+#pragma omp simd private(dx, dy)
+  for (i = 0; i < n; i++) {
+    dx = X1[i]-X0[i];
+    dy = Y1[i]-Y0[i];
+    L[i] = sqrt(dx*dx+dy*dy);
+    Nx[i] = -dy/L[i];
+    Ny[i] = dx/L[i];
+    Cx[i] = X0[i]/2+X1[i]/2;
+    Cy[i] = Y0[i]/2+Y1[i]/2;
+  }
+  //metric at the centroids in one call
+  if (Metric != NULL)
+    call(mg_get_metric(Metric, Cx, Cy, n, M));
+  
+  //back to the face slots
+  for (i = 0; i < n; i++) {
+    f = List[i];
+    Face = Mesh->Face[f];
+    Geom->Normal[2*f+0] = Nx[i];
+    Geom->Normal[2*f+1] = Ny[i];
+    Geom->Centroid[2*f+0] = Cx[i];
+    Geom->Centroid[2*f+1] = Cy[i];
+    Geom->Length[f] = L[i];
+    Geom->MLength[f] = -1.0;
+    if (Metric != NULL) {
+      d[0] = X1[i]-X0[i];
+      d[1] = Y1[i]-Y0[i];
+      dl2 = metriclen(d, (M+3*i));
+      Geom->MLength[f] = sqrt(max(dl2, 0.0));
+    }
+    Face->normal = Geom->Normal+2*f;
+    Face->centroid = Geom->Centroid+2*f;
+    Face->area = Geom->Length[f];
+    Face->Marea = Geom->MLength[f];
+  }
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_face_geom_update */
+/* computes the geometry of the faces that need it */
+int mg_face_geom_update(mg_Mesh *Mesh, mg_Metric *Metric)
+{
+  int ierr, i, f, k, n, b, nBlock, nSlot, nerr = 0, *List;
+  mg_List *Stack = Mesh->Stack->Face;
+  mg_FaceGeom *Geom;
+  
+  if (Mesh->Dim != 2) return error(err_NOT_SUPPORTED);
+  nSlot = Mesh->nFace+Stack->nItem;
+  call(mg_face_geom_reserve(Mesh, nSlot));
+  Geom = Mesh->FaceGeom;
+  //every live face the first time, then the touched ones and the new
+  //slots
+  n = (Geom->All) ? nSlot : Geom->nDirty+max(nSlot-Geom->nSlot, 0);
+  call(mg_alloc((void**)&List, n, sizeof(int)));
+  n = 0;
+  if (Geom->All)
+    n = mg_live_slots(Stack, nSlot, List, NULL);
+  else {
+    for (i = 0; i < Geom->nDirty; i++) {
+      f = Geom->Dirty[i];
+      Geom->IsDirty[f] = 0;
+      if (f < nSlot && !mg_is_stacked(Stack, f)) List[n++] = f;
+    }
+    for (f = Geom->nSlot; f < nSlot; f++)
+      if (!mg_is_stacked(Stack, f)) List[n++] = f;
+  }
+  Geom->nDirty = 0;
+  Geom->All = false;
+  Geom->nSlot = max(Geom->nSlot, nSlot);
+  
+  //blocks small enough to stay in cache, split among threads
+  nBlock = (n+FACEGEOMBLOCK-1)/FACEGEOMBLOCK;
+#pragma omp parallel for schedule(static) private(k) reduction(+:nerr) if(n > FACEGEOMPARMIN)
+  for (b = 0; b < nBlock; b++) {
+    k = b*FACEGEOMBLOCK;
+    if (mg_face_geom_block(Mesh, Metric, List+k,
+                           min(FACEGEOMBLOCK, n-k)) != err_OK)
+      nerr++;
+  }
+  mg_free((void*)List);
+  if (nerr > 0) return error(err_NOT_SUPPORTED);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_destroy_face_geom */
+void mg_destroy_face_geom(mg_FaceGeom *Geom)
+{
+  if (Geom == NULL) return;
+  mg_free((void*)Geom->Normal);
+  mg_free((void*)Geom->Centroid);
+  mg_free((void*)Geom->Length);
+  mg_free((void*)Geom->MLength);
+  mg_free((void*)Geom->Dirty);
+  mg_free((void*)Geom->IsDirty);
+  mg_free((void*)Geom);
+}
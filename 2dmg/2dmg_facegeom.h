@@ -0,0 +1,65 @@
+//
+//  2dmg_facegeom.h
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#ifndef ___dmg___dmg_facegeom__
+#define ___dmg___dmg_facegeom__
+
+#include <stdio.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_metric_struct.h"
+
+/******************************************************************/
+/* face geometry kept in arrays by face slot: unit normals and
+ centroids (Dim per face), lengths and metric lengths. The normal and
+ centroid of a face point into them (NULL while stale) and its area and
+ Marea mirror the lengths. A face whose nodes change is touched; an
+ update computes the touched faces and the slots appended since the
+ last one, the first update every face. The faces to compute go by
+ blocks gathered in contiguous arrays, so the arithmetic vectorizes,
+ and the blocks are split among threads when there are many */
+//faces below which the geometry is computed by one thread
+#define FACEGEOMPARMIN    4096
+//faces gathered at a time
+#define FACEGEOMBLOCK     256
+
+/******************************************************************/
+/* function:  mg_face_geom_touch */
+/* marks the geometry of face faceID stale */
+int mg_face_geom_touch(mg_Mesh *Mesh, int faceID);
+
+/******************************************************************/
+/* function:  mg_face_geom_reserve */
+/* makes room for nSlot face slots, creating the storage of Mesh if it
+ has none. Faces with geometry are pointed to the new arrays */
+int mg_face_geom_reserve(mg_Mesh *Mesh, int nSlot);
+
+/******************************************************************/
+/* function:  mg_face_geom_sync */
+/* takes the geometry set directly in the storage as current (faces
+ with a normal) and touches the faces without one */
+int mg_face_geom_sync(mg_Mesh *Mesh);
+
+/******************************************************************/
+/* function:  mg_face_geom_set_metric */
+/* sets the metric mg_calc_face_info computes metric lengths with
+ (NULL for none). Every face is computed again at the next update if
+ the metric changes */
+int mg_face_geom_set_metric(mg_Mesh *Mesh, mg_Metric *Metric);
+
+/******************************************************************/
+/* function:  mg_face_geom_update */
+/* computes the geometry of the faces that need it. Their metric
+ lengths are computed as well if Metric is not NULL, at the centroid,
+ and set to -1 otherwise. Faces on the removal stack are skipped */
+int mg_face_geom_update(mg_Mesh *Mesh, mg_Metric *Metric);
+
+/******************************************************************/
+/* function:  mg_destroy_face_geom */
+void mg_destroy_face_geom(mg_FaceGeom *Geom);
+
+#endif
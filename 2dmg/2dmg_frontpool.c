@@ -0,0 +1,186 @@
+//
+//  2dmg_frontpool.c
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#include "2dmg_frontpool.h"
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_utils.h"
+#include "2dmg_math.h"
+
+/******************************************************************/
+/* function:  mg_clear_front_face */
+static void mg_clear_front_face(mg_FrontFace *FFace)
+{
+  FFace->ID = -1;
+  FFace->iloop = -1;
+  FFace->Slot = -1;
+  FFace->face = NULL;
+  FFace->next = FFace->prev = NULL;
+}
+
+/******************************************************************/
+/* function:  mg_thread_free_records */
+/* pushes records [begin,end) of Block on the free list so that they
+ are handed out in increasing address order */
+static void mg_thread_free_records(mg_FrontPool *Pool, mg_FrontFace *Block,
+                                   int begin, int end)
+{
+  int i;
+  
+  for (i = end-1; i >= begin; i--) {
+    mg_clear_front_face(Block+i);
+    Block[i].next = Pool->Free;
+    Pool->Free = Block+i;
+  }
+}
+
+/******************************************************************/
+/* function:  mg_create_front_pool */
+/* creates an empty pool */
+int mg_create_front_pool(mg_FrontPool **pPool)
+{
+  int ierr;
+  mg_FrontPool *Pool;
+  
+  call(mg_alloc((void**)&Pool, 1, sizeof(mg_FrontPool)));
+  Pool->nBlock = 0;
+  Pool->Block = NULL;
+  Pool->nRecord = Pool->nActive = Pool->nRelease = 0;
+  Pool->Free = NULL;
+  (*pPool) = Pool;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_destroy_front_pool */
+/* frees all blocks of Pool */
+void mg_destroy_front_pool(mg_FrontPool *Pool)
+{
+  int i;
+  
+  if (Pool == NULL) return;
+  for (i = 0; i < Pool->nBlock; i++)
+    mg_free((void*)Pool->Block[i]);
+  mg_free((void*)Pool->Block);
+  mg_free((void*)Pool);
+}
+
+/******************************************************************/
+/* function:  mg_front_face_new */
+/* takes a cleared front face record from Pool */
+int mg_front_face_new(mg_FrontPool *Pool, mg_FrontFace **pFFace)
+{
+  int ierr, size;
+  mg_FrontFace *Block;
+  
+  if (Pool->Free == NULL) {
+    //grow geometrically, old blocks stay where they are
+    size = max(Pool->nRecord, FRONTPOOLCHUNK);
+    call(mg_alloc((void**)&Block, size, sizeof(mg_FrontFace)));
+    call(mg_realloc((void**)&Pool->Block, Pool->nBlock+1,
+                    sizeof(mg_FrontFace*)));
+    Pool->Block[Pool->nBlock++] = Block;
+    Pool->nRecord += size;
+    mg_thread_free_records(Pool, Block, 0, size);
+  }
+  (*pFFace) = Pool->Free;
+  Pool->Free = Pool->Free->next;
+  (*pFFace)->next = NULL;
+  Pool->nActive++;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_front_face_release */
+/* returns FFace (may be NULL) to Pool */
+void mg_front_face_release(mg_FrontPool *Pool, mg_FrontFace *FFace)
+{
+  if (FFace == NULL) return;
+  mg_clear_front_face(FFace);
+  FFace->next = Pool->Free;
+  Pool->Free = FFace;
+  Pool->nActive--;
+  Pool->nRelease++;
+}
+
+/******************************************************************/
+/* function:  mg_compact_front */
+/* moves the faces of every loop into one block in loop order */
+int mg_compact_front(mg_Front *Front, bool force)
+{
+  int ierr, iloop, i, k, k0, size;
+  bool first;
+  mg_FrontPool *Pool = Front->Pool;
+  mg_FrontFace *Block, *FFace;
+  mg_Loop *Loop;
+  mg_OrderedDataList *FacesInLoop;
+  
+  if (Pool == NULL) return error(err_INPUT_ERROR);
+  if (!force && Pool->nRelease < max(FRONTCOMPACTMIN, Pool->nActive))
+    return err_OK;
+  
+  //leave room to grow before a new block is needed
+  size = max(2*Pool->nActive, FRONTPOOLCHUNK);
+  call(mg_alloc((void**)&Block, size, sizeof(mg_FrontFace)));
+  k = 0;
+  for (iloop = 0; iloop < Front->nloop; iloop++) {
+    Loop = Front->loop[iloop];
+    if (Loop->FacesInLoop->nEntry == 0 || Loop->head == NULL) continue;
+    k0 = k;
+    first = true;
+    for (FFace = Loop->head; first || FFace != Loop->head;
+         FFace = FFace->next) {
+      first = false;
+      //more faces linked than in use: the loop is corrupt
+      if (k == size) {
+        mg_free((void*)Block);
+        return error(err_MESH_ERROR);
+      }
+      Block[k] = (*FFace);
+      //the old record forwards to its copy (only next is followed)
+      FFace->prev = Block+k;
+      k++;
+    }
+    //relink the copies as a ring
+    for (i = k0; i < k; i++) {
+      Block[i].next = Block+((i+1 < k) ? i+1 : k0);
+      Block[i].prev = Block+((i > k0) ? i-1 : k-1);
+    }
+    Loop->head = Block+k0;
+    Loop->tail = Block+k-1;
+  }
+  //the ordered lists point to the faces too. Records released to the
+  //free list have prev == NULL and are not forwarded
+  for (iloop = 0; iloop < Front->nloop; iloop++) {
+    FacesInLoop = Front->loop[iloop]->FacesInLoop;
+    for (i = 0; i < FacesInLoop->nEntry; i++) {
+      FFace = (mg_FrontFace*)FacesInLoop->Data[i];
+      if (FFace != NULL && FFace->prev >= Block && FFace->prev < Block+k)
+        FacesInLoop->Data[i] = (void*)FFace->prev;
+      else
+        FacesInLoop->Data[i] = NULL;
+    }
+  }
+  
+  //the copies replace every old block
+  for (i = 0; i < Pool->nBlock; i++)
+    mg_free((void*)Pool->Block[i]);
+  call(mg_realloc((void**)&Pool->Block, 1, sizeof(mg_FrontFace*)));
+  Pool->Block[0] = Block;
+  Pool->nBlock = 1;
+  Pool->nRecord = size;
+  Pool->nActive = k;
+  Pool->nRelease = 0;
+  Pool->Free = NULL;
+  mg_thread_free_records(Pool, Block, k, size);
+  //pointers into the old blocks (e.g. Front->Coord) are stale
+  Front->Version++;
+  
+  return err_OK;
+}
@@ -0,0 +1,58 @@
+//
+//  2dmg_frontpool.h
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#ifndef ___dmg___dmg_frontpool__
+#define ___dmg___dmg_frontpool__
+
+#include <stdio.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+
+/******************************************************************/
+/* front faces are kept in a pool of large blocks instead of one heap
+ allocation each. Loops stay doubly linked through next/prev, but
+ mg_compact_front periodically copies all active faces into a single
+ block in traversal order, so walking a loop reads memory
+ sequentially */
+
+//records per block (minimum)
+#define FRONTPOOLCHUNK    256
+//releases before compaction is considered at all
+#define FRONTCOMPACTMIN   64
+
+/******************************************************************/
+/* function:  mg_create_front_pool */
+/* creates an empty pool */
+int mg_create_front_pool(mg_FrontPool **pPool);
+
+/******************************************************************/
+/* function:  mg_destroy_front_pool */
+/* frees all blocks of Pool. Front faces taken from it become invalid */
+void mg_destroy_front_pool(mg_FrontPool *Pool);
+
+/******************************************************************/
+/* function:  mg_front_face_new */
+/* takes a cleared front face record from Pool */
+int mg_front_face_new(mg_FrontPool *Pool, mg_FrontFace **pFFace);
+
+/******************************************************************/
+/* function:  mg_front_face_release */
+/* returns FFace (may be NULL) to Pool. Replaces mg_free_front_face
+ for faces taken from a pool */
+void mg_front_face_release(mg_FrontPool *Pool, mg_FrontFace *FFace);
+
+/******************************************************************/
+/* function:  mg_compact_front */
+/* if enough faces were released since the last compaction (always if
+ force == true), moves the faces of every loop of Front into one
+ block in loop order, starting at the head. Pointers to front faces
+ held outside the loops become invalid, so it is to be called only
+ between front advancement steps. Bumps Front->Version if it moved
+ the faces */
+int mg_compact_front(mg_Front *Front, bool force);
+
+#endif
@@ -23,6 +23,7 @@ int mg_create_geo(mg_Geometry **pGeo, int nBoundary, int nPoint,
   call(mg_alloc((void**)&((*pGeo)->Coord), nPoint*Dim,
                 sizeof(double)));
   (*pGeo)->nBoundary = nBoundary;
+  (*pGeo)->Cache = NULL;
   call(mg_alloc((void**)&((*pGeo)->Boundary), nBoundary,
                 sizeof(mg_Segment)));
   //init boundaries
@@ -35,6 +36,8 @@ int mg_create_geo(mg_Geometry **pGeo, int nBoundary, int nPoint,
     (*pGeo)->Boundary[i]->s  = NULL;
     (*pGeo)->Boundary[i]->interp = NULL;
     (*pGeo)->Boundary[i]->accel  = NULL;
+    (*pGeo)->Boundary[i]->Spline = NULL;
+    (*pGeo)->Boundary[i]->Table = NULL;
     (*pGeo)->Boundary[i]->Mij = NULL;
     (*pGeo)->Boundary[i]->Mij_interp = NULL;
     (*pGeo)->Boundary[i]->Mij_accel  = NULL;
@@ -67,6 +70,8 @@ void mg_destroy_geo(mg_Geometry *Geo)
       mg_free((void*)Geo->Boundary[i]->interp);
       mg_free((void*)Geo->Boundary[i]->accel);
     }
+    mg_destroy_spline(Geo->Boundary[i]->Spline);
+    mg_destroy_seg_table(Geo->Boundary[i]->Table);
     mg_free((void*)Geo->Boundary[i]);
   }
   mg_free((void*)Geo->Boundary);
@@ -78,7 +83,7 @@ void mg_destroy_geo(mg_Geometry *Geo)
 /* initializes the interpolant of a mg_Segment  */
 int mg_init_segment(mg_Geometry *Geo, int iseg)
 {
-  int i;
+  int ierr, i;
   mg_Segment *Seg = Geo->Boundary[iseg];
   
   switch (Seg->interp_type) {
@@ -114,11 +119,280 @@ int mg_init_segment(mg_Geometry *Geo, int iseg)
         Seg->accel[i] = gsl_interp_accel_alloc();
       }
       break;
+    case mge_Akima:
+      for (i = 0; i < Geo->Dim; i++) {
+        Seg->interp[i] = gsl_interp_alloc(gsl_interp_akima,Seg->nPoint);
+        gsl_interp_init(Seg->interp[i], Seg->s,Seg->Coord
+                        +(i*Seg->nPoint), Seg->nPoint);
+        Seg->accel[i] = gsl_interp_accel_alloc();
+      }
+      break;
+    case mge_AkimaPeriodic:
+      for (i = 0; i < Geo->Dim; i++) {
+        Seg->interp[i] = gsl_interp_alloc(gsl_interp_akima_periodic,Seg->nPoint);
+        gsl_interp_init(Seg->interp[i], Seg->s,Seg->Coord
+                        +(i*Seg->nPoint), Seg->nPoint);
+        Seg->accel[i] = gsl_interp_accel_alloc();
+      }
+      break;
     default:
       return error(err_NOT_SUPPORTED);
       break;
   }
   
+  //native evaluator used in the hot loops
+  if (Geo->Dim != 2) return error(err_NOT_SUPPORTED);
+  call(mg_create_spline(Seg));
+  //arc-length table (metric part is built by mg_update_seg_table)
+  call(mg_create_seg_table(Seg, 0));
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_seg_table_fill */
+/* integrates the physical (Metric == NULL) or metric speed of a
+ segment over the table intervals and stores the cumulative length L
+ and its derivative dL at the breakpoints. Derivatives are limited
+ (Fritsch-Carlson) so that the Hermite interpolant is monotone */
+static int mg_seg_table_fill(mg_Segment *Seg, mg_Metric *Metric,
+                             double *L, double *dL)
+{
+  int ierr, k, iq, nq, n = Seg->Table->n, np;
+  double *tq, *wq, *X, *dX, *M, *sp, h, ab[2], delta, a, b, tau;
+  double const *t = Seg->Table->t, *xgl, *wgl;
+  
+  call(mg_gl_rule(SEGTABLEORDER, &xgl, &wgl));
+  nq = SEGTABLEORDER;
+  //quadrature points of all intervals followed by the breakpoints
+  np = n*nq+n+1;
+  call(mg_alloc((void**)&tq, 8*np+nq, sizeof(double)));
+  X  = tq+np;
+  dX = tq+3*np;
+  M  = tq+5*np;
+  wq = tq+8*np;
+  h = t[1]-t[0];
+  for (iq = 0; iq < nq; iq++) {
+    tq[iq] = xgl[iq];
+    wq[iq] = wgl[iq];
+  }
+  for (k = n-1; k >= 0; k--)
+    for (iq = 0; iq < nq; iq++)
+      tq[k*nq+iq] = t[k]+h*tq[iq];
+  for (k = 0; k <= n; k++)
+    tq[n*nq+k] = t[k];
+  mg_spline_eval(Seg->Spline, np, tq, X, dX, NULL);
+  //speeds are stored in place of the parametric coordinates
+  sp = tq;
+  if (Metric != NULL){
+    call(mg_get_metric(Metric, X, X+np, np, M));
+    for (k = 0; k < np; k++) {
+      ab[0] = dX[k];
+      ab[1] = dX[np+k];
+      sp[k] = metriclen(ab, (M+3*k));
+      sp[k] = sqrt(max(sp[k], 0.0));
+    }
+  }
+  else
+    for (k = 0; k < np; k++)
+      sp[k] = sqrt(dX[k]*dX[k]+dX[np+k]*dX[np+k]);
+  
+  L[0] = 0.0;
+  for (k = 0; k < n; k++) {
+    L[k+1] = 0.0;
+    for (iq = 0; iq < nq; iq++)
+      L[k+1] += wq[iq]*sp[k*nq+iq];
+    L[k+1] = L[k]+h*L[k+1];
+  }
+  for (k = 0; k <= n; k++)
+    dL[k] = sp[n*nq+k];
+  for (k = 0; k < n; k++) {
+    delta = (L[k+1]-L[k])/h;
+    if (delta <= 0.0) {
+      dL[k] = dL[k+1] = 0.0;
+      continue;
+    }
+    a = dL[k]/delta;
+    b = dL[k+1]/delta;
+    if (a*a+b*b > 9.0) {
+      tau = 3.0/sqrt(a*a+b*b);
+      dL[k]   = tau*a*delta;
+      dL[k+1] = tau*b*delta;
+    }
+  }
+  
+  mg_free((void*)tq);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_create_seg_table */
+/* builds the arc-length table of a segment with n intervals (n <= 0
+ picks a default) and sets Seg->Length */
+int mg_create_seg_table(mg_Segment *Seg, int n)
+{
+  int ierr, k;
+  mg_SegTable *Table;
+  double s0 = Seg->s[0], s1 = Seg->s[Seg->nPoint-1];
+  
+  if (Seg->Spline == NULL) return error(err_INPUT_ERROR);
+  if (n <= 0)
+    n = max(SEGTABLEMIN, SEGTABLEPERINT*Seg->Spline->nInt);
+  
+  mg_destroy_seg_table(Seg->Table);
+  call(mg_alloc((void**)&Table, 1, sizeof(mg_SegTable)));
+  Table->n = n;
+  call(mg_alloc((void**)&Table->t, 3*(n+1), sizeof(double)));
+  Table->L  = Table->t+(n+1);
+  Table->dL = Table->t+2*(n+1);
+  Table->Lm = Table->dLm = NULL;
+  Table->Metric = NULL;
+  Table->MetricType = -1;
+  Table->MetricOrder = -1;
+  for (k = 0; k <= n; k++)
+    Table->t[k] = s0+(s1-s0)*k/n;
+  Table->t[n] = s1;
+  Seg->Table = Table;
+  
+  call(mg_seg_table_fill(Seg, NULL, Table->L, Table->dL));
+  Seg->Length = Table->L[n];
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_destroy_seg_table */
+/* frees a mg_SegTable structure */
+void mg_destroy_seg_table(mg_SegTable *Table)
+{
+  if (Table == NULL) return;
+  mg_free((void*)Table->t);
+  mg_free((void*)Table->Lm);
+  mg_free((void*)Table);
+}
+
+/******************************************************************/
+/* function:  mg_update_seg_table */
+/* (re)builds the metric-length table of a segment if it was not built
+ for Metric and sets Seg->Lm */
+int mg_update_seg_table(mg_Segment *Seg, mg_Metric *Metric)
+{
+  int ierr;
+  mg_SegTable *Table = Seg->Table;
+  
+  if (Table == NULL || Metric == NULL) return error(err_INPUT_ERROR);
+  if (Table->Lm != NULL && Table->Metric == (void*)Metric &&
+      Table->MetricType == (int)Metric->type &&
+      Table->MetricOrder == Metric->order)
+    return err_OK;
+  
+  if (Table->Lm == NULL){
+    call(mg_alloc((void**)&Table->Lm, 2*(Table->n+1), sizeof(double)));
+    Table->dLm = Table->Lm+(Table->n+1);
+  }
+  call(mg_seg_table_fill(Seg, Metric, Table->Lm, Table->dLm));
+  Table->Metric = (void*)Metric;
+  Table->MetricType = (int)Metric->type;
+  Table->MetricOrder = Metric->order;
+  Seg->Lm = Table->Lm[Table->n];
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_seg_table_hermite */
+/* cubic Hermite value and derivative (w.r.t. u) on a table interval */
+static void mg_seg_table_hermite(double L0, double L1, double d0,
+                                 double d1, double h, double u,
+                                 double *l, double *dl)
+{
+  double u2 = u*u, u3 = u2*u;
+  
+  (*l) = (2.0*u3-3.0*u2+1.0)*L0+(u3-2.0*u2+u)*h*d0+
+         (-2.0*u3+3.0*u2)*L1+(u3-u2)*h*d1;
+  if (dl != NULL)
+    (*dl) = (6.0*u2-6.0*u)*(L0-L1)+(3.0*u2-4.0*u+1.0)*h*d0+
+            (3.0*u2-2.0*u)*h*d1;
+}
+
+/******************************************************************/
+/* function:  mg_seg_table_length */
+/* arc length (metric length if "metric") from the beginning of the
+ segment to parametric coordinate t */
+int mg_seg_table_length(mg_Segment *Seg, bool metric, double t,
+                        double *l)
+{
+  int k;
+  mg_SegTable *Table = Seg->Table;
+  double *L, *dL, h, u;
+  
+  if (Table == NULL) return error(err_INPUT_ERROR);
+  L  = (metric) ? Table->Lm : Table->L;
+  dL = (metric) ? Table->dLm : Table->dL;
+  if (L == NULL) return error(err_INPUT_ERROR);
+  
+  h = Table->t[1]-Table->t[0];
+  k = (int)floor((t-Table->t[0])/h);
+  k = max(0, min(k, Table->n-1));
+  u = (t-Table->t[k])/h;
+  mg_seg_table_hermite(L[k], L[k+1], dL[k], dL[k+1], h, u, l, NULL);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_seg_table_param */
+/* parametric coordinate at which the arc length (metric length if
+ "metric") measured from the beginning of the segment equals l */
+int mg_seg_table_param(mg_Segment *Seg, bool metric, double l,
+                       double *t)
+{
+  int k, m, it;
+  mg_SegTable *Table = Seg->Table;
+  double *L, *dL, h, u, ulo, uhi, f, df, unew;
+  
+  if (Table == NULL) return error(err_INPUT_ERROR);
+  L  = (metric) ? Table->Lm : Table->L;
+  dL = (metric) ? Table->dLm : Table->dL;
+  if (L == NULL) return error(err_INPUT_ERROR);
+  
+  if (l <= L[0]){
+    (*t) = Table->t[0];
+    return err_OK;
+  }
+  if (l >= L[Table->n]){
+    (*t) = Table->t[Table->n];
+    return err_OK;
+  }
+  //bisection for L[k] <= l < L[k+1]
+  k = 0;
+  it = Table->n;
+  while (it > k+1) {
+    m = (it+k)/2;
+    if (L[m] > l)
+      it = m;
+    else
+      k = m;
+  }
+  h = Table->t[1]-Table->t[0];
+  //safeguarded Newton on the monotone Hermite interpolant
+  ulo = 0.0;
+  uhi = 1.0;
+  u = (L[k+1] > L[k]) ? (l-L[k])/(L[k+1]-L[k]) : 0.0;
+  for (it = 0; it < 50; it++) {
+    mg_seg_table_hermite(L[k], L[k+1], dL[k], dL[k+1], h, u, &f, &df);
+    f -= l;
+    if (fabs(f) <= 1e-15*L[Table->n]) break;
+    if (f > 0.0) uhi = u;
+    else ulo = u;
+    unew = (df > 0.0) ? u-f/df : -1.0;
+    if (unew <= ulo || unew >= uhi)
+      unew = 0.5*(ulo+uhi);
+    if (fabs(unew-u) <= 1e-16) break;
+    u = unew;
+  }
+  (*t) = Table->t[k]+u*h;
   
   return err_OK;
 }
@@ -136,7 +410,7 @@ int mg_create_bmesh_from_geo(mg_Geometry *Geo, mg_Metric *Metric,
   mg_Segment *Seg;
   mg_FaceData *Face;
   struct mg_Item *seg_root, *seg_curr;
-  double scale, *t;
+  double scale, *t, *X;
   
   call(mg_alloc((void**)&SegList, 1, sizeof(mg_List)));
   //initialize list with contiguous set of segments
@@ -145,6 +419,10 @@ int mg_create_bmesh_from_geo(mg_Geometry *Geo, mg_Metric *Metric,
   for (iseg = 0; iseg < Geo->nBoundary; iseg++)
     SegList->Item[iseg] = iseg;
   
+  //metric lengths of all segments for this metric
+  for (iseg = 0; iseg < Geo->nBoundary; iseg++)
+    call(mg_update_seg_table(Geo->Boundary[iseg], Metric));
+  
   //create space for nodes in mesh
   //assume empty mesh
   Mesh->nNode = 0;
@@ -169,7 +447,7 @@ int mg_create_bmesh_from_geo(mg_Geometry *Geo, mg_Metric *Metric,
     //check if segment is a closed loop
     if (Seg->Point[0] == Seg->Point[Seg->nPoint-1]) {
       //segment closes on itself
-      call(mg_mesh_segment(Seg,Metric,nNodeInSeg[iseg],&scale,&t));
+      call(mg_mesh_segment_cached(Geo->Cache,Seg,Metric,nNodeInSeg[iseg],&scale,&t));
       nNodeInSeg[iseg]--;//subtract last repeated node
       //update node list
       Mesh->nNode += nNodeInSeg[iseg];
@@ -179,12 +457,11 @@ int mg_create_bmesh_from_geo(mg_Geometry *Geo, mg_Metric *Metric,
       call(mg_realloc((void**)&Mesh->Face, Mesh->nFace+nNodeInSeg[iseg],
                       sizeof(mg_FaceData)));
       //get global coordinates and create loop. 
+      call(mg_alloc((void**)&X, 2*nNodeInSeg[iseg], sizeof(double)));
+      mg_spline_eval(Seg->Spline, nNodeInSeg[iseg], t, X, NULL, NULL);
       for (in = 0; in < nNodeInSeg[iseg]; in++) {
-        for (d = 0; d < Mesh->Dim; d++) {
-          Mesh->Coord[(inode+in)*Mesh->Dim+d] = gsl_interp_eval(Seg->interp[d],Seg->s,
-                                                                Seg->Coord+d*Seg->nPoint,t[in],
-                                                                Seg->accel[d]);
-        }
+        for (d = 0; d < Mesh->Dim; d++)
+          Mesh->Coord[(inode+in)*Mesh->Dim+d] = X[d*nNodeInSeg[iseg]+in];
         call(mg_alloc((void**)&Face, 1, sizeof(mg_FaceData)));
         mg_init_face(Face);
         Face->nNode = 2;
@@ -206,6 +483,7 @@ int mg_create_bmesh_from_geo(mg_Geometry *Geo, mg_Metric *Metric,
       Mesh->nBface[iseg] = nNodeInSeg[iseg];
       Mesh->nFace += Mesh->nBface[iseg];
       mg_free((void*)t);
+      mg_free((void*)X);
       //remove segment from list
       call(mg_rm_frm_ord_set(iseg, &SegList->nItem, &SegList->Item, 1, &nrmd));
       if (nrmd != 1) return error(err_LOGIC_ERROR);
@@ -251,7 +529,7 @@ int mg_create_bmesh_from_geo(mg_Geometry *Geo, mg_Metric *Metric,
       while (seg_curr->next != NULL){
         iseg = seg_curr->Id;
         Seg = Geo->Boundary[iseg];
-        call(mg_mesh_segment(Seg,Metric,nNodeInSeg[iseg],&scale,&t));
+        call(mg_mesh_segment_cached(Geo->Cache,Seg,Metric,nNodeInSeg[iseg],&scale,&t));
         //allocate space for new nodes
         nNodeInSeg[iseg]--;
         Mesh->nNode += nNodeInSeg[iseg];
@@ -264,11 +542,11 @@ int mg_create_bmesh_from_geo(mg_Geometry *Geo, mg_Metric *Metric,
         //get global coordinates and create faces.
         //discard last node as it is the last node of previous segment
 //        printf("%s:\n",Seg->Name);
+        call(mg_alloc((void**)&X, 2*nNodeInSeg[iseg], sizeof(double)));
+        mg_spline_eval(Seg->Spline, nNodeInSeg[iseg], t, X, NULL, NULL);
         for (in = 0; in < nNodeInSeg[iseg]; in++) {
           for (d = 0; d < Mesh->Dim; d++) {
-            Mesh->Coord[(inode+in)*Mesh->Dim+d] = gsl_interp_eval(Seg->interp[d],Seg->s,
-                                                                  Seg->Coord+d*Seg->nPoint,t[in],
-                                                                  Seg->accel[d]);
+            Mesh->Coord[(inode+in)*Mesh->Dim+d] = X[d*nNodeInSeg[iseg]+in];
 //            printf("%1.8f ",Mesh->Coord[(inode+in)*Mesh->Dim+d]);
           }
 //          printf("\n");
@@ -290,6 +568,7 @@ int mg_create_bmesh_from_geo(mg_Geometry *Geo, mg_Metric *Metric,
         Mesh->nBface[iseg] = nNodeInSeg[iseg];
         Mesh->nFace += Mesh->nBface[iseg];
         mg_free((void*)t);
+        mg_free((void*)X);
         seg_curr = seg_curr->next;
       }
       //fix last node id
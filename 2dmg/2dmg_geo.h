@@ -13,10 +13,18 @@
 #include "2dmg_utils.h"
 #include "2dmg_math.h"
 #include "2dmg_plot.h"
+#include "2dmg_segcache.h"
+#include "2dmg_spline.h"
 
 #ifndef _dmg__dmg_geo_h
 #define _dmg__dmg_geo_h
 
+/******************************************************************/
+/* segment length table resolution */
+#define SEGTABLEMIN       64 //minimum number of table intervals
+#define SEGTABLEPERINT    8 //table intervals per geometry interval
+#define SEGTABLEORDER     8 //quadrature points per table interval
+
 /******************************************************************/
 /* function:  mg_create_geo */
 /* creates a mg_Geometry structure with "nBoundary" boundaries  */
@@ -40,4 +48,35 @@ int mg_create_bmesh_from_geo(mg_Geometry *Geo, mg_Metric *Metric,
                              int *nNodeInSeg, mg_Mesh *Mesh,
                              mg_Front *Front);
 
+/******************************************************************/
+/* function:  mg_create_seg_table */
+/* builds the arc-length table of a segment with n intervals (n <= 0
+ picks a default) and sets Seg->Length */
+int mg_create_seg_table(mg_Segment *Seg, int n);
+
+/******************************************************************/
+/* function:  mg_destroy_seg_table */
+/* frees a mg_SegTable structure */
+void mg_destroy_seg_table(mg_SegTable *Table);
+
+/******************************************************************/
+/* function:  mg_update_seg_table */
+/* (re)builds the metric-length table of a segment if it was not built
+ for Metric and sets Seg->Lm */
+int mg_update_seg_table(mg_Segment *Seg, mg_Metric *Metric);
+
+/******************************************************************/
+/* function:  mg_seg_table_length */
+/* arc length (metric length if "metric") from the beginning of the
+ segment to parametric coordinate t */
+int mg_seg_table_length(mg_Segment *Seg, bool metric, double t,
+                        double *l);
+
+/******************************************************************/
+/* function:  mg_seg_table_param */
+/* parametric coordinate at which the arc length (metric length if
+ "metric") measured from the beginning of the segment equals l */
+int mg_seg_table_param(mg_Segment *Seg, bool metric, double l,
+                       double *t);
+
 #endif
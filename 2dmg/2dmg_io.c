@@ -14,6 +14,10 @@
 #include "2dmg_math.h"
 #include "2dmg_geo.h"
 #include "2dmg_io.h"
+#include "2dmg_bmesh.h"
+#include "2dmg_text.h"
+#include "2dmg_export.h"
+#include "2dmg_cmesh.h"
 
 /******************************************************************/
 /* function:  mg_scan_n_num */
@@ -89,39 +93,31 @@ int mg_scan_n_num( const char *line, int *n, int *vi, double *vr)
 }
 
 /******************************************************************/
-/* function:  mg_read_bgri_file */
-/* reads a boundary discretization file  */
-int mg_read_bgri_file(const char *InFile, mg_Mesh *Mesh)
+/* function:  mg_read_bgri_text */
+/* reads a boundary discretization from a mapped file */
+static int mg_read_bgri_text(mg_TextMap *Text, mg_Mesh *Mesh)
 {
-  int ierr, nnode, nface, dim, i, n, nbfg, k, nk, nj, e;
-  int node[3], j;
+  int ierr, nnode, nface, dim, i, n, nbfg, k, nk, nj, e, iline;
+  int vi[3], j, *node;
   char line[MAXLONGLINELEN];
-  FILE *bgri = NULL;
   mg_FaceData *Face;
   
-  printf("Reading %s file:\n",InFile);
-  //open boundary mesh file
-  bgri = fopen(InFile, "r");
-  if (!bgri) return error(err_READWRITE_ERROR);
-  rewind(bgri);
-  
-  if (fscanf(bgri, "%d %d %d\n",&nnode,&nface,&dim) != 3)
-    return error(err_READWRITE_ERROR);
+  iline = 0;
+  call(mg_text_scan_n_int(Text, iline++, 3, &n, vi));
+  if (n != 3) return error(err_READWRITE_ERROR);
+  nnode = vi[0];
+  nface = vi[1];
+  dim = vi[2];
   if (dim != 2) return error(err_NOT_SUPPORTED);
   
   Mesh->nNode = nnode;
   Mesh->Dim = dim;
   //allocate and read coordinates
   call(mg_alloc((void**)&Mesh->Coord, Mesh->nNode*Mesh->Dim, sizeof(double)));
-  for (i = 0; i < Mesh->nNode; i++) {
-    if (fgets(line, MAXLONGLINELEN, bgri) == NULL)
-      return error(err_READWRITE_ERROR);
-    call(mg_scan_n_num(line, &k, NULL, Mesh->Coord+i*dim));
-    if (k != dim) return error(err_READWRITE_ERROR);
-  }
+  call(mg_text_read_real(Text, iline, nnode, dim, Mesh->Coord));
+  iline += nnode;
   //get number of boundary groups
-  if (fgets(line, MAXLONGLINELEN, bgri) == NULL)
-    return error(err_READWRITE_ERROR);
+  call(mg_text_get_line(Text, iline++, line, MAXLONGLINELEN));
   if (sscanf(line, "%d",&nbfg) != 1)
     return error(err_READWRITE_ERROR);
   Mesh->nBfg = nbfg;
@@ -132,25 +128,25 @@ int mg_read_bgri_file(const char *InFile, mg_Mesh *Mesh)
   Mesh->nFace = nface;
   n = 0;
   for (i = 0; i < nbfg; i++) {
-    if (fgets(line, MAXLONGLINELEN, bgri) == NULL)
-      return error(err_READWRITE_ERROR);
+    call(mg_text_get_line(Text, iline++, line, MAXLONGLINELEN));
     if (sscanf(line, "%d %d %s",&nk,&nj,Mesh->BNames[i]) != 3)
       return error(err_READWRITE_ERROR);
     Mesh->nBface[i] = nk;
     if (nj != 2) return error(err_NOT_SUPPORTED);//for now
+    if (nk < 0 || n+nk > nface) return error(err_READWRITE_ERROR);
     printf("Read BGroup: %s\n",Mesh->BNames[i]);
+    //face nodes of the whole group at once
+    call(mg_alloc((void**)&node, nk*nj, sizeof(int)));
+    call(mg_text_read_int(Text, iline, nk, nj, node));
+    iline += nk;
     for (k = 0; k < nk; k++) {
-      if (fgets(line, MAXLONGLINELEN, bgri) == NULL)
-        return error(err_READWRITE_ERROR);
       call(mg_alloc((void**)&Face, 1, sizeof(mg_FaceData)));
       mg_init_face(Face);
       //nodes
       call(mg_alloc((void**)&Face->node, Mesh->Dim, sizeof(int)));
-      call(mg_scan_n_num(line, &j, node, NULL));
-      if (j != nj)return error(err_READWRITE_ERROR);
       Face->nNode = nj;
       //convert to 0-based numbering
-      for (j=0;j<nj;j++) Face->node[j] = node[j]-1;
+      for (j=0;j<nj;j++) Face->node[j] = node[k*nj+j]-1;
       //left element will be the interior
       Face->elem[LEFTNEIGHINDEX] = HOLLOWNEIGHTAG;
       //encode face number and boundary group into one integer
@@ -160,17 +156,33 @@ int mg_read_bgri_file(const char *InFile, mg_Mesh *Mesh)
       Mesh->Face[n] = Face;
       n++;
     }
+    mg_free((void*)node);
   }
   if (n != nface){
     printf("File indicates nface = %d but I only read %d.\n",nface,n);
     return error(err_READWRITE_ERROR);
   }
   
-  fclose(bgri);
-  
   return err_OK;
 }
 
+/******************************************************************/
+/* function:  mg_read_bgri_file */
+/* reads a boundary discretization file  */
+int mg_read_bgri_file(const char *InFile, mg_Mesh *Mesh)
+{
+  int ierr;
+  mg_TextMap *Text;
+  
+  printf("Reading %s file:\n",InFile);
+  //map boundary mesh file
+  call(mg_map_text(InFile, &Text));
+  ierr = error(mg_read_bgri_text(Text, Mesh));
+  mg_unmap_text(Text);
+  
+  return ierr;
+}
+
 /******************************************************************/
 /* function:  mg_parse_input_line */
 int mg_parse_input_line(char line[MAXLINELEN], char **pkey,
@@ -253,6 +265,24 @@ int mg_get_input_char(char const ParamName[], char **pvalue)
   return err_OK;
 }
 
+/******************************************************************/
+/* function:  mg_find_input_char */
+/* same as mg_get_input_char but for optional parameters: returns
+ err_NOT_FOUND without reporting an error if ParamName is not set */
+int mg_find_input_char(char const ParamName[], char **pvalue)
+{
+  ENTRY *e, target;
+  char key[MAXSTRLEN];
+  
+  snprintf(key, MAXSTRLEN, "%s",ParamName);
+  target.key = key;
+  if ((e = hsearch(target, FIND)) == NULL)
+    return err_NOT_FOUND;
+  (*pvalue) = (char*)e->data;
+  
+  return err_OK;
+}
+
 /******************************************************************/
 /* function: mg_mesh_2_matlab */
 /* converts mesh to matlab format */
@@ -318,14 +348,114 @@ int mg_mesh_2_matlab(mg_Mesh *Mesh, mg_Front *Front, char *FileName)
   return err_OK;
 }
 
+/******************************************************************/
+/* function: mg_has_ext */
+/* true if FileName ends with extension ext */
+bool mg_has_ext(const char *FileName, const char *ext)
+{
+  size_t len = strlen(FileName), elen = strlen(ext);
+  
+  return (len > elen && strcmp(FileName+len-elen, ext) == 0);
+}
+
+/******************************************************************/
+/* function: mg_link_face */
+/* sets the face and neighbor entries of the elements on both sides
+ of face faceID from its nodes and elem[] */
+int mg_link_face(mg_Mesh *Mesh, int faceID)
+{
+  int j, n, elemL, elemR;
+  mg_FaceData *Face = Mesh->Face[faceID];
+  
+  elemL = Face->elem[LEFTNEIGHINDEX];
+  elemR = Face->elem[RIGHTNEIGHINDEX];
+  //left element
+  if (elemL >= 0){
+    for (j = 0; j < Mesh->Elem[elemL].nNode; j++) {
+      if (Mesh->Elem[elemL].node[j] == Face->node[0]) {
+        n = nextincycle(j, Mesh->Elem[elemL].nNode);
+        if (Face->node[Face->nNode-1] != Mesh->Elem[elemL].node[n])
+          return error(err_LOGIC_ERROR);
+        n = previncycle(j, Mesh->Elem[elemL].nNode);
+        Mesh->Elem[elemL].face[n] = faceID;
+        Mesh->Elem[elemL].nbor[n] = elemR;
+      }
+    }
+  }
+  //right element
+  if (elemR >= 0){
+    for (j = 0; j < Mesh->Elem[elemR].nNode; j++) {
+      if (Mesh->Elem[elemR].node[j] == Face->node[0]) {
+        n = previncycle(j, Mesh->Elem[elemR].nNode);
+        if (Face->node[Face->nNode-1] != Mesh->Elem[elemR].node[n])
+          return error(err_LOGIC_ERROR);
+        n = nextincycle(j, Mesh->Elem[elemR].nNode);
+        Mesh->Elem[elemR].face[n] = faceID;
+        Mesh->Elem[elemR].nbor[n] = elemL;
+      }
+    }
+  }
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function: mg_build_node_qtree */
+/* centers Mesh->QuadTree on the nodal bounding box and inserts every
+ node (Node2Face must be allocated) */
+int mg_build_node_qtree(mg_Mesh *Mesh)
+{
+  int ierr, i, j;
+  double range[6];
+  
+  //init range
+  for (j = 0; j < Mesh->Dim; j++) {
+    range[j*Mesh->Dim+0] = INFINITY;
+    range[j*Mesh->Dim+1] = -INFINITY;
+  }
+  for (i = 0 ; i < Mesh->nNode; i++) {
+    //keep track of range
+    for (j = 0; j < Mesh->Dim; j++){
+      //get minimum of coordinade "j"
+      if (Mesh->Coord[i*Mesh->Dim+j] < range[j*Mesh->Dim+0])
+        range[j*Mesh->Dim+0] = Mesh->Coord[i*Mesh->Dim+j];
+      //get maximum of coordinade "j"
+      if (Mesh->Coord[i*Mesh->Dim+j] > range[j*Mesh->Dim+1])
+        range[j*Mesh->Dim+1] = Mesh->Coord[i*Mesh->Dim+j];
+    }
+  }
+  for (j = 0; j < Mesh->Dim; j++){
+    Mesh->QuadTree->c[j] = 0.5*(range[j*Mesh->Dim+0]+
+                                range[j*Mesh->Dim+1]);
+    Mesh->QuadTree->ds[j] = range[j*Mesh->Dim+1]-Mesh->QuadTree->c[j];
+  }
+  for (i = 0 ; i < Mesh->nNode; i++) {
+    call(mg_add_qtree_entry(Mesh->Coord+i*Mesh->Dim,
+                            (void**)&(Mesh->Node2Face[i]),
+                            Mesh->QuadTree));
+  }
+  
+  return err_OK;
+}
+
 /******************************************************************/
 /* function: mg_write_mesh */
 /* writes mesh to a file with connectivities and boundary information */
 int mg_write_mesh(mg_Mesh *Mesh, char *FileName)
 {
-  int i, d;
+  int ierr, i, d;
   FILE *fid;
+  mg_CMeshStats Stats;
   
+  if (mg_has_ext(FileName, BMESHEXT))
+    return error(mg_write_bmesh(Mesh, FileName));
+  if (mg_has_ext(FileName, CMESHEXT)) {
+    call(mg_write_cmesh(Mesh, FileName, CMESHFLOATS|CMESHREORDER, &Stats));
+    mg_cmesh_report("write", &Stats);
+    return err_OK;
+  }
+  if (mg_has_ext(FileName, VTUEXT) || mg_has_ext(FileName, MSHEXT))
+    return error(mg_export_mesh(Mesh, NULL, EXPORTQUALITY, FileName));
   if ((fid = fopen(FileName, "w")) == NULL)
     return error(err_READWRITE_ERROR);
   //write header
@@ -365,171 +495,76 @@ int mg_write_mesh(mg_Mesh *Mesh, char *FileName)
 }
 
 /******************************************************************/
-/* function: mg_read_mesh */
-/* reads mesh from file with connectivities and boundary information */
-int mg_read_mesh(mg_Mesh **pMesh, char *FileName)
+/* function: mg_read_mesh_text */
+/* parses a mapped mesh text file into newly allocated arrays of View */
+static int mg_read_mesh_text(mg_TextMap *Text, mg_BMesh *View)
 {
-  int ierr, n, vi[5], i, j, elemL, elemR;
-  char line[MAXLINELEN];
-  double range[6];
-  mg_Mesh *Mesh;
-  mg_FaceData *Face;
-  FILE *fid = fopen(FileName, "r");
-  
-  call(mg_create_mesh(&Mesh));
+  int ierr, n, vi[5], i, iline = 0;
+  int *nBface, *ElemNode, *Row, *FaceNode, *FaceElem;
+  char line[MAXLINELEN], *BNames;
+  double *Coord;
   
   //get mesh info
-  fgets(line, MAXLINELEN, fid);
-  while (line[0] == '%') {//skip comments
-    fgets(line, MAXLINELEN, fid);
-  }
-  call(mg_scan_n_num(line, &n, vi, NULL));
+  if (mg_text_skip_comments(Text, &iline) != err_OK)
+    return error(err_READWRITE_ERROR);
+  call(mg_text_scan_n_int(Text, iline++, 5, &n, vi));
   if (n != 5) return error(err_READWRITE_ERROR);
-  Mesh->Dim   = vi[0];
-  Mesh->nNode = vi[1];
-  Mesh->nFace = vi[2];
-  Mesh->nElem = vi[3];
-  Mesh->nBfg  = vi[4];
-  call(mg_alloc((void **)&Mesh->Coord, Mesh->nNode*Mesh->Dim,
-                sizeof(double)));
-  call(mg_alloc((void**)&Mesh->Elem, Mesh->nElem, sizeof(mg_ElemData)));
-  call(mg_alloc2((void ***)&Mesh->BNames, Mesh->nBfg, MAXSTRLEN,
-                 sizeof(char)));
-  call(mg_alloc((void **)&Mesh->nBface, Mesh->nBfg,
-                sizeof(int)));
-  
-  //allocate node lists
-  call(mg_alloc((void**)&Mesh->Node2Elem, Mesh->nNode, sizeof(mg_List)));
-  call(mg_alloc((void**)&Mesh->Node2Face, Mesh->nNode, sizeof(mg_List)));
+  View->Dim   = vi[0];
+  View->nNode = vi[1];
+  View->nFace = vi[2];
+  View->nElem = vi[3];
+  View->nBfg  = vi[4];
+  View->nElemNode = 3;
+  if (View->nNode < 0 || View->nFace < 0 || View->nElem < 0 ||
+      View->nBfg < 0)
+    return error(err_READWRITE_ERROR);
   
   //get coordinates
-  fgets(line, MAXLINELEN, fid);
-  while (line[0] == '%') {//skip comments
-    fgets(line, MAXLINELEN, fid);
-  }
-  //init range
-  for (n = 0; n < Mesh->Dim; n++) {
-    range[n*Mesh->Dim+0] = INFINITY;
-    range[n*Mesh->Dim+1] = -INFINITY;
-  }
-  for (i = 0 ; i < Mesh->nNode; i++) {
-    //init node lists
-    mg_init_list(Mesh->Node2Elem+i);
-    mg_init_list(Mesh->Node2Face+i);
-    
-    call(mg_scan_n_num(line, &n, NULL, Mesh->Coord+i*Mesh->Dim));
-    fgets(line, MAXLINELEN, fid);
-    if (n != Mesh->Dim) return error(err_READWRITE_ERROR);
-    //keep track of range
-    for (j = 0; j < Mesh->Dim; j++){
-      //get minimum of coordinade "j"
-      if (Mesh->Coord[i*Mesh->Dim+j] < range[j*Mesh->Dim+0])
-        range[j*Mesh->Dim+0] = Mesh->Coord[i*Mesh->Dim+j];
-      //get maximum of coordinade "j"
-      if (Mesh->Coord[i*Mesh->Dim+j] > range[j*Mesh->Dim+1])
-        range[j*Mesh->Dim+1] = Mesh->Coord[i*Mesh->Dim+j];
-    }
-  }
-  //setup quadtree
-  for (j = 0; j < Mesh->Dim; j++){
-    Mesh->QuadTree->c[j] = 0.5*(range[j*Mesh->Dim+0]+
-                                range[j*Mesh->Dim+1]);
-    Mesh->QuadTree->ds[j] = range[j*Mesh->Dim+1]-Mesh->QuadTree->c[j];
-  }
-  for (i = 0 ; i < Mesh->nNode; i++) {
-    call(mg_add_qtree_entry(Mesh->Coord+i*Mesh->Dim,
-                            (void**)&(Mesh->Node2Face[i]),
-                            Mesh->QuadTree));
-  }
-  
+  mg_text_skip_comments(Text, &iline);
+  call(mg_alloc((void**)&Coord, View->nNode*View->Dim, sizeof(double)));
+  View->Coord = Coord;
+  call(mg_text_read_real(Text, iline, View->nNode, View->Dim, Coord));
+  iline += View->nNode;
   
   //get boundary groups
-  while (line[0] == '%') {//skip comments
-    fgets(line, MAXLINELEN, fid);
-  }
-  for (i = 0; i < Mesh->nBfg; i++) {
-    sscanf(line,"%s %d",Mesh->BNames[i],&Mesh->nBface[i]);
-    fgets(line, MAXLINELEN, fid);
+  mg_text_skip_comments(Text, &iline);
+  call(mg_alloc((void**)&BNames, View->nBfg*MAXSTRLEN, sizeof(char)));
+  View->BNames = BNames;
+  call(mg_alloc((void**)&nBface, View->nBfg, sizeof(int)));
+  View->nBface = nBface;
+  for (i = 0; i < View->nBfg; i++) {
+    call(mg_text_get_line(Text, iline++, line, MAXLINELEN));
+    if (strlen(line) >= MAXSTRLEN ||
+        sscanf(line, "%s %d", BNames+i*MAXSTRLEN, nBface+i) != 2)
+      return error(err_READWRITE_ERROR);
   }
   //element-to-node connectivity
-  while (line[0] == '%') {//skip comments
-    fgets(line, MAXLINELEN, fid);
-  }
-  for (i = 0; i < Mesh->nElem; i++) {
-    call(mg_scan_n_num(line, &n, vi, NULL));
-    //for now, complain if elem is not a triangle
-    if (n != 3) return error(err_NOT_SUPPORTED);
-    Mesh->Elem[i].nNode = n;
-    call(mg_alloc((void**)&(Mesh->Elem[i].face), Mesh->Elem[i].nNode,
-                  sizeof(int)));
-    call(mg_alloc((void**)&(Mesh->Elem[i].nbor), Mesh->Elem[i].nNode,
-                  sizeof(int)));
-    call(mg_alloc((void**)&(Mesh->Elem[i].node), Mesh->Elem[i].nNode,
-                  sizeof(int)));
-    for (j = 0; j < Mesh->Elem[i].nNode; j++){
-      Mesh->Elem[i].node[j] = vi[j];
-      call(mg_add_2_ord_set(i, &Mesh->Node2Elem[vi[j]].nItem,
-                            &Mesh->Node2Elem[vi[j]].Item, NULL, false));
-    }
-    fgets(line, MAXLINELEN, fid);
-  }
-  //face information
-  call(mg_alloc((void**)&Mesh->Face, Mesh->nFace, sizeof(mg_FaceData)));
-  while (line[0] == '%') {//skip comments
-    fgets(line, MAXLINELEN, fid);
-  }
-  for (i = 0; i < Mesh->nFace; i++) {
-    call(mg_scan_n_num(line, &n, vi, NULL));
-    //may have to change this check because of multinode faces in the future
-    if (n != 4) return error(err_READWRITE_ERROR);
-    call(mg_alloc((void**)&Face, 1, sizeof(mg_FaceData)));
-    mg_init_face(Face);
-    Mesh->Face[i] = Face;
-    Face->nNode = n-2;//number of entries read minus element numbers
-    call(mg_alloc((void**)&Face->node, Face->nNode, sizeof(int)));
-    for (j = 0; j < Face->nNode; j++){
-      Face->node[j] = vi[j];
-      call(mg_add_2_ord_set(i, &Mesh->Node2Face[vi[j]].nItem,
-                            &Mesh->Node2Face[vi[j]].Item, NULL, false));
-    }
-    elemL = vi[n-2];
-    elemR = vi[n-1];
-    Face->elem[LEFTNEIGHINDEX] = elemL;
-    Face->elem[RIGHTNEIGHINDEX] = elemR;
-    Mesh->Face[i] = Face;
-    //figure out which face this is
-    //left element
-    if (elemL >= 0){
-      for (j = 0; j < Mesh->Elem[elemL].nNode; j++) {
-        if (Mesh->Elem[elemL].node[j] == Face->node[0]) {
-          n = nextincycle(j, Mesh->Elem[elemL].nNode);
-          if (Face->node[Face->nNode-1] != Mesh->Elem[elemL].node[n])
-            return error(err_LOGIC_ERROR);
-          n = previncycle(j, Mesh->Elem[elemL].nNode);
-          Mesh->Elem[elemL].face[n] = i;
-          Mesh->Elem[elemL].nbor[n] = elemR;
-        }
-      }
-    }
-    //right element
-    if (elemR >= 0){
-      for (j = 0; j < Mesh->Elem[elemR].nNode; j++) {
-        if (Mesh->Elem[elemR].node[j] == Face->node[0]) {
-          n = previncycle(j, Mesh->Elem[elemR].nNode);
-          if (Face->node[Face->nNode-1] != Mesh->Elem[elemR].node[n])
-            return error(err_LOGIC_ERROR);
-          n = nextincycle(j, Mesh->Elem[elemR].nNode);
-          Mesh->Elem[elemR].face[n] = i;
-          Mesh->Elem[elemR].nbor[n] = elemL;
-        }
-      }
-    }
-    fgets(line, MAXLINELEN, fid);
-  }
-  
-  
-  (*pMesh) = Mesh;
-  fclose(fid);
+  mg_text_skip_comments(Text, &iline);
+  call(mg_alloc((void**)&ElemNode, 3*View->nElem, sizeof(int)));
+  View->ElemNode = ElemNode;
+  //for now, complain if elem is not a triangle
+  if (mg_text_read_int(Text, iline, View->nElem, 3, ElemNode) != err_OK)
+    return error(err_NOT_SUPPORTED);
+  iline += View->nElem;
+  //face information: n0 n1 eL eR
+  mg_text_skip_comments(Text, &iline);
+  call(mg_alloc((void**)&FaceNode, 2*View->nFace, sizeof(int)));
+  View->FaceNode = FaceNode;
+  call(mg_alloc((void**)&FaceElem, 2*View->nFace, sizeof(int)));
+  View->FaceElem = FaceElem;
+  call(mg_alloc((void**)&Row, 4*View->nFace, sizeof(int)));
+  if ((ierr = error(mg_text_read_int(Text, iline, View->nFace, 4,
+                                     Row))) != err_OK) {
+    mg_free((void*)Row);
+    return ierr;
+  }
+  for (i = 0; i < View->nFace; i++) {
+    FaceNode[2*i+0] = Row[4*i+0];
+    FaceNode[2*i+1] = Row[4*i+1];
+    FaceElem[2*i+0] = Row[4*i+2];
+    FaceElem[2*i+1] = Row[4*i+3];
+  }
+  mg_free((void*)Row);
   
   return err_OK;
 }
@@ -537,73 +572,115 @@ int mg_read_mesh(mg_Mesh **pMesh, char *FileName)
 /******************************************************************/
 /* function: mg_read_mesh */
 /* reads mesh from file with connectivities and boundary information */
-int mg_read_geo(mg_Geometry **pGeo, char *FileName)
+int mg_read_mesh(mg_Mesh **pMesh, char *FileName)
+{
+  int ierr;
+  mg_BMesh *BMesh, View;
+  mg_TextMap *Text;
+  mg_CMeshStats Stats;
+  
+  //binary meshes are mapped instead of parsed
+  if (mg_has_ext(FileName, BMESHEXT)) {
+    call(mg_map_bmesh(FileName, &BMesh));
+    ierr = mg_bmesh_2_mesh(BMesh, pMesh);
+    mg_unmap_bmesh(BMesh);
+    return error(ierr);
+  }
+  if (mg_has_ext(FileName, CMESHEXT)) {
+    call(mg_read_cmesh(FileName, pMesh, &Stats));
+    mg_cmesh_report("read", &Stats);
+    return err_OK;
+  }
+  
+  //text meshes are parsed into the same arrays a binary mesh holds
+  call(mg_map_text(FileName, &Text));
+  memset(&View, 0, sizeof(mg_BMesh));
+  ierr = error(mg_read_mesh_text(Text, &View));
+  mg_unmap_text(Text);
+  if (ierr == err_OK)
+    ierr = error(mg_bmesh_2_mesh(&View, pMesh));
+  mg_free((void*)View.BNames);
+  mg_free((void*)View.nBface);
+  mg_free((void*)View.Coord);
+  mg_free((void*)View.ElemNode);
+  mg_free((void*)View.FaceNode);
+  mg_free((void*)View.FaceElem);
+  
+  return ierr;
+}
+
+/******************************************************************/
+/* function: mg_read_geo_text */
+/* reads a geometry from a mapped file */
+static int mg_read_geo_text(mg_TextMap *Text, mg_Geometry **pGeo)
 {
-  int ierr, n, vi[5], i, nB, id, nP, d;
+  int ierr, n, vi[3], i, nB, id, nP, d, iline = 0;
   double ds;
   char line[MAXLINELEN], type[MAXSTRLEN];
-  FILE *fid = fopen(FileName, "r");
+  mg_Segment *Seg;
   
   //get geo info
-  fgets(line, MAXLINELEN, fid);
-  while (line[0] == '%') {//skip comments
-    fgets(line, MAXLINELEN, fid);
-  }
-  call(mg_scan_n_num(line, &n, vi, NULL));
+  if (mg_text_skip_comments(Text, &iline) != err_OK)
+    return error(err_READWRITE_ERROR);
+  call(mg_text_scan_n_int(Text, iline++, 3, &n, vi));
   if (n != 3) return error(err_READWRITE_ERROR);
   //create geo structure
   call(mg_create_geo(pGeo, vi[2], vi[1], vi[0]));
-  //read coordinates
-  fgets(line, MAXLINELEN, fid);
-  while (line[0] == '%') {//skip comments
-    fgets(line, MAXLINELEN, fid);
-  }
+  //read coordinates (comments may come between them)
   for (i = 0; i < (*pGeo)->nPoint; i++) {
-    call(mg_scan_n_num(line, &n, NULL, (*pGeo)->Coord+i*(*pGeo)->Dim));
-    fgets(line, MAXLINELEN, fid);
-    while (line[0] == '%') {//skip comments
-      fgets(line, MAXLINELEN, fid);
-    }
+    mg_text_skip_comments(Text, &iline);
+    call(mg_text_read_real(Text, iline++, 1, (*pGeo)->Dim,
+                           (*pGeo)->Coord+i*(*pGeo)->Dim));
   }
   //read segments
   for (nB = 0; nB < (*pGeo)->nBoundary; nB++) {
-    while (line[0] == '%') {//skip comments
-      fgets(line, MAXLINELEN, fid);
-    }
-    sscanf(line, "%s %s %d",(*pGeo)->Boundary[nB]->Name,type,&nP);
-    (*pGeo)->Boundary[nB]->nPoint = nP;
+    Seg = (*pGeo)->Boundary[nB];
+    mg_text_skip_comments(Text, &iline);
+    call(mg_text_get_line(Text, iline++, line, MAXLINELEN));
+    if (sscanf(line, "%s %s %d",Seg->Name,type,&nP) != 3 || nP < 2)
+      return error(err_READWRITE_ERROR);
+    Seg->nPoint = nP;
     ds = 1.0/(nP-1);
     call(mg_value_2_enum(type, mge_GeoInterpName,(int)mge_GeoInterpLast,
-                         (int*)&((*pGeo)->Boundary[nB]->interp_type)));
+                         (int*)&(Seg->interp_type)));
     //allocate and read points
-    call(mg_alloc((void**)&((*pGeo)->Boundary[nB]->Coord),
-                  (*pGeo)->Boundary[nB]->nPoint*(*pGeo)->Dim,
+    call(mg_alloc((void**)&(Seg->Coord), Seg->nPoint*(*pGeo)->Dim,
                   sizeof(double)));
-    call(mg_alloc((void**)&((*pGeo)->Boundary[nB]->s),
-                  (*pGeo)->Boundary[nB]->nPoint,sizeof(double)));
-    call(mg_alloc((void**)&((*pGeo)->Boundary[nB]->Point),
-                  (*pGeo)->Boundary[nB]->nPoint,sizeof(int)));
-    call(mg_alloc((void**)&((*pGeo)->Boundary[nB]->interp),(*pGeo)->Dim,
+    call(mg_alloc((void**)&(Seg->s), Seg->nPoint,sizeof(double)));
+    call(mg_alloc((void**)&(Seg->Point), Seg->nPoint,sizeof(int)));
+    call(mg_alloc((void**)&(Seg->interp),(*pGeo)->Dim,
                   sizeof(gsl_interp)));
-    call(mg_alloc((void**)&((*pGeo)->Boundary[nB]->accel),(*pGeo)->Dim,
+    call(mg_alloc((void**)&(Seg->accel),(*pGeo)->Dim,
                   sizeof(gsl_interp_accel)));
+    call(mg_text_read_int(Text, iline, nP, 1, Seg->Point));
+    iline += nP;
     for (i = 0; i < nP; i++) {
-      fscanf(fid, "%d\n",&id);
-      id--;
-      (*pGeo)->Boundary[nB]->Point[i] = id;
+      id = --Seg->Point[i];
+      if (id < 0 || id >= (*pGeo)->nPoint)
+        return error(err_READWRITE_ERROR);
       for (d = 0; d < (*pGeo)->Dim; d++){
-        (*pGeo)->Boundary[nB]->Coord[d*nP+i] = (*pGeo)->Coord[id*(*pGeo)->Dim+d];
+        Seg->Coord[d*nP+i] = (*pGeo)->Coord[id*(*pGeo)->Dim+d];
       }
-      (*pGeo)->Boundary[nB]->s[i] = i*ds;
+      Seg->s[i] = i*ds;
     }
     //initialize interpolants
     call(mg_init_segment((*pGeo), nB));
-    
-    fgets(line, MAXLINELEN, fid);
   }
   
-  fclose(fid);
-  
   return err_OK;
 }
 
+/******************************************************************/
+/* function: mg_read_geo */
+/* reads a geometry file: points and the segments through them */
+int mg_read_geo(mg_Geometry **pGeo, char *FileName)
+{
+  int ierr;
+  mg_TextMap *Text;
+  
+  call(mg_map_text(FileName, &Text));
+  ierr = error(mg_read_geo_text(Text, pGeo));
+  mg_unmap_text(Text);
+  
+  return ierr;
+}
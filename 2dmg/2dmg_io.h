@@ -36,19 +36,51 @@ int mg_read_input_file(char const ParamFile[]);
 /* function:  mg_read_input_file */
 int mg_get_input_char(char const ParamName[], char **pvalue);
 
+/******************************************************************/
+/* function:  mg_find_input_char */
+/* same as mg_get_input_char but for optional parameters: returns
+ err_NOT_FOUND without reporting an error if ParamName is not set */
+int mg_find_input_char(char const ParamName[], char **pvalue);
+
 /******************************************************************/
 /* function: mg_mesh_2_matlab */
 /* converts mesh to matlab format */
 int mg_mesh_2_matlab(mg_Mesh *Mesh, mg_Front *Front, char *FileName);
 
+/******************************************************************/
+/* function: mg_has_ext */
+/* true if FileName ends with extension ext */
+bool mg_has_ext(const char *FileName, const char *ext);
+
+/******************************************************************/
+/* function: mg_link_face */
+/* sets the face and neighbor entries of the elements on both sides
+ of face faceID from its nodes and elem[] */
+int mg_link_face(mg_Mesh *Mesh, int faceID);
+
+/******************************************************************/
+/* function: mg_build_node_qtree */
+/* centers Mesh->QuadTree on the nodal bounding box and inserts every
+ node (Node2Face must be allocated) */
+int mg_build_node_qtree(mg_Mesh *Mesh);
+
 /******************************************************************/
 /* function: mg_write_mesh */
-/* writes mesh to a file with connectivities and boundary information */
+/* writes mesh to a file with connectivities and boundary information.
+ Files ending in BMESHEXT are written in the binary format of
+ 2dmg_bmesh.h, those ending in CMESHEXT compressed and renumbered (see
+ 2dmg_cmesh.h), those ending in VTUEXT or MSHEXT are exported with the
+ element quality (see 2dmg_export.h) */
 int mg_write_mesh(mg_Mesh *Mesh, char *FileName);
 
 /******************************************************************/
 /* function: mg_read_mesh */
-/* reads mesh from file with connectivities and boundary information */
+/* reads mesh from file with connectivities and boundary information.
+ Files ending in BMESHEXT are mapped as binary meshes, those ending
+ in CMESHEXT are decoded as compressed meshes. Node connectivities,
+ element links, face geometry and the quadtree are built on first use
+ (see mg_mesh_require). The face section may hold only the boundary
+ faces, or none: the rest is rebuilt from the elements */
 int mg_read_mesh(mg_Mesh **pMesh, char *FileName);
 
 /******************************************************************/
@@ -0,0 +1,479 @@
+//
+//  2dmg_locate.c
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#include <stdint.h>
+#include <omp.h>
+#include "2dmg_locate.h"
+#include "2dmg_def.h"
+#include "2dmg_pred.h"
+#include "2dmg_struct.h"
+#include "2dmg_math.h"
+#include "2dmg_utils.h"
+
+/******************************************************************/
+/* function:  mg_elem_centroid */
+/* centroid of element elem */
+static void mg_elem_centroid(mg_Mesh *Mesh, int elem, double xc[2])
+{
+  int i, node;
+  
+  xc[0] = xc[1] = 0.0;
+  for (i = 0; i < Mesh->Elem[elem].nNode; i++) {
+    node = Mesh->Elem[elem].node[i];
+    xc[0] += Mesh->Coord[node*Mesh->Dim+0];
+    xc[1] += Mesh->Coord[node*Mesh->Dim+1];
+  }
+  xc[0] /= Mesh->Elem[elem].nNode;
+  xc[1] /= Mesh->Elem[elem].nNode;
+}
+
+/******************************************************************/
+/* function:  mg_elem_slots */
+/* number of element slots in use (live elements plus the stacked ones
+ below them) and the element stack (NULL if none) */
+static int mg_elem_slots(mg_Mesh *Mesh, mg_List **pStack)
+{
+  (*pStack) = (Mesh->Stack != NULL) ? Mesh->Stack->Elem : NULL;
+  
+  return Mesh->nElem+(((*pStack) != NULL) ? (*pStack)->nItem : 0);
+}
+
+/******************************************************************/
+/* function:  mg_scan_for_point */
+/* tests every live element for coord. Returns err_NOT_FOUND (not
+ reported) if none contains it */
+static int mg_scan_for_point(mg_Mesh *Mesh, double coord[2], int *pelem)
+{
+  int elem, i, n, nSlot, dim = Mesh->Dim;
+  mg_List *Stack;
+  mg_ElemData *E;
+  
+  nSlot = mg_elem_slots(Mesh, &Stack);
+  for (elem = 0; elem < nSlot; elem++) {
+    E = Mesh->Elem+elem;
+    n = E->nNode;
+    if (n <= 0 || mg_is_stacked(Stack, elem)) continue;
+    for (i = 0; i < n; i++)
+      if (mg_orient2d(Mesh->Coord+E->node[(i+1)%n]*dim,
+                      Mesh->Coord+E->node[(i+2)%n]*dim, coord) < 0.0)
+        break;
+    if (i == n) {
+      (*pelem) = elem;
+      return err_OK;
+    }
+  }
+  
+  return err_NOT_FOUND;
+}
+
+/******************************************************************/
+/* function:  mg_walk */
+/* visibility walk of at most maxstep elements. Returns err_OK,
+ err_NOT_FOUND (left the mesh) or err_OUT_OF_BOUNDS (maxstep reached),
+ none of which is reported */
+static int mg_walk(mg_Mesh *Mesh, int elem_start, double coord[2],
+                   int maxstep, int *pelem, int *nstep)
+{
+  int elem = elem_start, next, step = 0, i, j, k0, n, a, b;
+  int const dim = Mesh->Dim;
+  unsigned int seed = (unsigned int)elem_start;
+  bool outside;
+  mg_ElemData *E;
+  
+  while (true) {
+    E = Mesh->Elem+elem;
+    n = E->nNode;
+    next = -1;
+    outside = false;
+    //random first face so that the walk cannot cycle
+    seed = seed*1103515245u+12345u;
+    k0 = (int)((seed >> 16)%n);
+    for (j = 0; j < n; j++) {
+      i = (k0+j)%n;
+      //face i is opposite to node i, elements are counter-clockwise
+      a = E->node[(i+1)%n];
+      b = E->node[(i+2)%n];
+      //exact side test, neighbors agree on their shared face
+      if (mg_orient2d(Mesh->Coord+a*dim, Mesh->Coord+b*dim, coord) < 0.0) {
+        if (E->nbor[i] >= 0) {
+          next = E->nbor[i];
+          break;
+        }
+        outside = true;
+      }
+    }
+    if (next < 0) break;
+    if (step == maxstep) {
+      outside = false;
+      break;
+    }
+    elem = next;
+    step++;
+  }
+  
+  (*pelem) = elem;
+  (*nstep) = step;
+  if (outside) return err_NOT_FOUND;
+  if (next >= 0) return err_OUT_OF_BOUNDS;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_walk_to_point */
+/* iterative visibility walk from elem_start to the element containing
+ coord. A walk stopped by a boundary face is followed by a scan of all
+ elements, since in a non-convex domain the point may lie behind it.
+ Returns err_NOT_FOUND (not reported) if coord is outside the mesh,
+ pelem then holds the last element visited. nstep (may be NULL)
+ receives the number of elements crossed */
+int mg_walk_to_point(mg_Mesh *Mesh, int elem_start, double coord[2],
+                     int *pelem, int *nstep)
+{
+  int ierr, step, nSlot;
+  mg_List *Stack;
+  
+  nSlot = mg_elem_slots(Mesh, &Stack);
+  if (elem_start < 0 || elem_start >= nSlot ||
+      mg_is_stacked(Stack, elem_start))
+    return error(err_INPUT_ERROR);
+  call(mg_mesh_require(Mesh, MESHLINKS));
+  ierr = mg_walk(Mesh, elem_start, coord, nSlot, pelem, &step);
+  if (nstep != NULL) (*nstep) = step;
+  //a walk crossing every element is cycling
+  if (ierr == err_OUT_OF_BOUNDS) return error(err_LOGIC_ERROR);
+  //pelem keeps the boundary element if no element holds coord
+  if (ierr == err_NOT_FOUND &&
+      mg_scan_for_point(Mesh, coord, &step) == err_OK) {
+    (*pelem) = step;
+    ierr = err_OK;
+  }
+  
+  return ierr;
+}
+
+/******************************************************************/
+/* function:  mg_create_locator */
+/* builds a point locator seeded by a linear quadtree of the element
+ centroids of Mesh (and the element links of Mesh if they are still
+ pending). Must be rebuilt if the mesh changes */
+int mg_create_locator(mg_Mesh *Mesh, mg_Locator **pLoc)
+{
+  int ierr, elem, n, nSlot;
+  double *X, c[2], ds[2], range[4];
+  void **data;
+  mg_Locator *Loc;
+  mg_List *Stack;
+  
+  if (Mesh->nElem <= 0 || Mesh->Dim != 2) return error(err_INPUT_ERROR);
+  //the walks cross elements through their neighbors
+  call(mg_mesh_require(Mesh, MESHLINKS));
+  nSlot = mg_elem_slots(Mesh, &Stack);
+  
+  call(mg_alloc((void**)pLoc, 1, sizeof(mg_Locator)));
+  Loc = (*pLoc);
+  Loc->Tree = NULL;
+  Loc->Last = -1;
+  Loc->nLocate = 0;
+  Loc->MaxStep = 0;
+  Loc->nStep = 0;
+  
+  //centroids of elements in use
+  call(mg_alloc((void**)&X, 2*Mesh->nElem, sizeof(double)));
+  call(mg_alloc((void**)&data, Mesh->nElem, sizeof(void*)));
+  range[0] = range[2] = INFINITY;
+  range[1] = range[3] = -INFINITY;
+  for (n = 0, elem = 0; elem < nSlot; elem++) {
+    if (Mesh->Elem[elem].nNode <= 0) continue;
+    if (mg_is_stacked(Stack, elem)) continue;
+    mg_elem_centroid(Mesh, elem, X+2*n);
+    range[0] = min(range[0], X[2*n]);
+    range[1] = max(range[1], X[2*n]);
+    range[2] = min(range[2], X[2*n+1]);
+    range[3] = max(range[3], X[2*n+1]);
+    data[n] = (void*)(intptr_t)elem;
+    if (Loc->Last < 0) Loc->Last = elem;
+    n++;
+  }
+  if (n == 0) return error(err_INPUT_ERROR);
+  c[0] = 0.5*(range[0]+range[1]);
+  c[1] = 0.5*(range[2]+range[3]);
+  //slightly inflated so that rounding of c+-ds keeps every centroid in
+  ds[0] = 0.5*(range[1]-range[0])*(1.0+1.0e-10)+1.0e-14*(1.0+fabs(c[0]));
+  ds[1] = 0.5*(range[3]-range[2])*(1.0+1.0e-10)+1.0e-14*(1.0+fabs(c[1]));
+  call(mg_create_lqtree(&Loc->Tree, c, ds, LQTREECAPACITY));
+  call(mg_lqtree_bulk_load(Loc->Tree, n, X, data));
+  
+  mg_free((void*)X);
+  mg_free((void*)data);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_destroy_locator */
+void mg_destroy_locator(mg_Locator *Loc)
+{
+  if (Loc == NULL) return;
+  mg_destroy_lqtree(Loc->Tree);
+  mg_free((void*)Loc);
+}
+
+/******************************************************************/
+/* function:  mg_locate_from */
+/* short walk from last (if >= 0) followed, if needed, by a walk from
+ the element with the centroid closest to coord */
+static int mg_locate_from(mg_Mesh *Mesh, mg_lqtree *Tree, int last,
+                          double coord[2], int *pelem, int *nstep)
+{
+  int ierr = err_NOT_FOUND, start, step = 0, step2;
+  mg_data_entry *entry;
+  
+  //coherent queries end close to the last hit
+  if (last >= 0)
+    ierr = mg_walk(Mesh, last, coord, LOCATELASTSTEP, pelem, &step);
+  if (ierr != err_OK) {
+    start = max(last, 0);
+    if (mg_lqtree_nearest(Tree, coord, &entry) == err_OK)
+      start = (int)(intptr_t)entry->data;
+    ierr = mg_walk_to_point(Mesh, start, coord, pelem, &step2);
+    if (ierr != err_OK && ierr != err_NOT_FOUND) return error(ierr);
+    step += step2;
+  }
+  (*nstep) = step;
+  
+  return ierr;
+}
+
+/******************************************************************/
+/* function:  mg_locate_point */
+/* finds the element containing coord. A short walk from the last
+ element found is tried first; otherwise the walk starts from the
+ element with the nearest centroid. Same return values as
+ mg_walk_to_point */
+int mg_locate_point(mg_Mesh *Mesh, mg_Locator *Loc, double coord[2],
+                    int *pelem, int *nstep)
+{
+  int ierr, step;
+  
+  ierr = mg_locate_from(Mesh, Loc->Tree, Loc->Last, coord, pelem, &step);
+  if (ierr != err_OK && ierr != err_NOT_FOUND) return error(ierr);
+  Loc->nLocate++;
+  Loc->nStep += step;
+  Loc->MaxStep = max(Loc->MaxStep, step);
+  if (nstep != NULL) (*nstep) = step;
+  if (ierr == err_OK) Loc->Last = (*pelem);
+  
+  return ierr;
+}
+
+/******************************************************************/
+/* function:  mg_hilbert_key */
+/* index of cell (x,y) along the Hilbert curve filling a 2^16x2^16 grid */
+static uint32_t mg_hilbert_key(uint32_t x, uint32_t y)
+{
+  uint32_t rx, ry, s, d = 0, t;
+  
+  for (s = 1u << 15; s > 0; s >>= 1) {
+    rx = (x & s) > 0;
+    ry = (y & s) > 0;
+    d += s*s*((3*rx)^ry);
+    //rotate quadrant
+    if (ry == 0) {
+      if (rx == 1) {
+        x = s-1-x;
+        y = s-1-y;
+      }
+      t = x; x = y; y = t;
+    }
+  }
+  return d;
+}
+
+/******************************************************************/
+/* function:  mg_hilbert_sort */
+/* permutation sorting n interleaved coordinates along a Hilbert curve
+ over their bounding box (two 16 bit radix passes) */
+static int mg_hilbert_sort(int n, double *X, int *perm)
+{
+  int ierr, i, pass, d, sum, t, *cnt, *ptmp;
+  uint32_t *key, *ktmp, q[2];
+  double lo[2], hi[2], h[2];
+  
+  lo[0] = lo[1] = INFINITY;
+  hi[0] = hi[1] = -INFINITY;
+  for (i = 0; i < n; i++) {
+    lo[0] = min(lo[0], X[2*i]);
+    hi[0] = max(hi[0], X[2*i]);
+    lo[1] = min(lo[1], X[2*i+1]);
+    hi[1] = max(hi[1], X[2*i+1]);
+  }
+  h[0] = (hi[0] > lo[0]) ? 65535.0/(hi[0]-lo[0]) : 0.0;
+  h[1] = (hi[1] > lo[1]) ? 65535.0/(hi[1]-lo[1]) : 0.0;
+  
+  call(mg_alloc((void**)&key, 2*n, sizeof(uint32_t)));
+  call(mg_alloc((void**)&ptmp, n, sizeof(int)));
+  call(mg_alloc((void**)&cnt, 1 << 16, sizeof(int)));
+  ktmp = key+n;
+  for (i = 0; i < n; i++) {
+    q[0] = (uint32_t)((X[2*i]-lo[0])*h[0]);
+    q[1] = (uint32_t)((X[2*i+1]-lo[1])*h[1]);
+    key[i] = mg_hilbert_key(q[0], q[1]);
+    perm[i] = i;
+  }
+  for (pass = 0; pass < 2; pass++) {
+    memset(cnt, 0, (1 << 16)*sizeof(int));
+    for (i = 0; i < n; i++)
+      cnt[(key[i] >> (16*pass)) & 0xFFFF]++;
+    for (sum = 0, d = 0; d < (1 << 16); d++) {
+      t = cnt[d];
+      cnt[d] = sum;
+      sum += t;
+    }
+    for (i = 0; i < n; i++) {
+      d = (key[i] >> (16*pass)) & 0xFFFF;
+      ktmp[cnt[d]] = key[i];
+      ptmp[cnt[d]] = perm[i];
+      cnt[d]++;
+    }
+    memcpy(key, ktmp, n*sizeof(uint32_t));
+    memcpy(perm, ptmp, n*sizeof(int));
+  }
+  
+  mg_free((void*)key);
+  mg_free((void*)ptmp);
+  mg_free((void*)cnt);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_barycentric */
+/* barycentric coordinates of coord in triangle elem. Negative values
+ (coord outside) are clipped and the rest renormalized */
+static void mg_barycentric(mg_Mesh *Mesh, int elem, double coord[2],
+                           double lambda[3])
+{
+  int i, dim = Mesh->Dim, *node = Mesh->Elem[elem].node;
+  double *a, *b, sum;
+  
+  for (sum = 0.0, i = 0; i < 3; i++) {
+    //area opposite to node i
+    a = Mesh->Coord+node[(i+1)%3]*dim;
+    b = Mesh->Coord+node[(i+2)%3]*dim;
+    lambda[i] = (b[0]-a[0])*(coord[1]-a[1])-(b[1]-a[1])*(coord[0]-a[0]);
+    lambda[i] = max(lambda[i], 0.0);
+    sum += lambda[i];
+  }
+  for (i = 0; i < 3; i++)
+    lambda[i] = (sum > 0.0) ? lambda[i]/sum : 1.0/3.0;
+}
+
+/******************************************************************/
+/* function:  mg_locate_points */
+/* locates n points with interleaved coordinates X. Queries are sorted
+ along a Hilbert curve and split in contiguous chunks among threads,
+ each walk starting from the previous hit of its thread. elem[i] is
+ the element containing point i or -(e+1) if the point is outside the
+ mesh, e being the boundary element where the walk stopped (such points
+ cost a scan of all elements). bary (may be NULL) receives 3 barycentric
+ coordinates per point (clipped for points outside). rate (may be NULL)
+ receives points per second */
+int mg_locate_points(mg_Mesh *Mesh, mg_Locator *Loc, int n, double *X,
+                     int *elem, double *bary, double *rate)
+{
+  int ierr, k, i, e, last, step, nerr = 0, maxstep = 0, *perm;
+  long nstep = 0;
+  double t0;
+  
+  if (n <= 0) return err_OK;
+  t0 = omp_get_wtime();
+  call(mg_alloc((void**)&perm, n, sizeof(int)));
+  call(mg_hilbert_sort(n, X, perm));
+  
+#pragma omp parallel private(k, i, e, last, step, ierr) reduction(+:nerr,nstep) reduction(max:maxstep)
+  {
+    last = -1;
+#pragma omp for schedule(static)
+    for (k = 0; k < n; k++) {
+      i = perm[k];
+      ierr = mg_locate_from(Mesh, Loc->Tree, last, X+2*i, &e, &step);
+      if (ierr == err_OK) {
+        elem[i] = last = e;
+      }
+      else if (ierr == err_NOT_FOUND) {
+        elem[i] = -(e+1);
+      }
+      else {
+        elem[i] = -1;
+        e = 0;
+        nerr++;
+      }
+      if (bary != NULL) mg_barycentric(Mesh, e, X+2*i, bary+3*i);
+      nstep += step;
+      maxstep = max(maxstep, step);
+    }
+  }
+  
+  mg_free((void*)perm);
+  Loc->nLocate += n;
+  Loc->nStep += nstep;
+  Loc->MaxStep = max(Loc->MaxStep, maxstep);
+  if (rate != NULL) (*rate) = n/max(omp_get_wtime()-t0, MEPS);
+  if (nerr > 0) return error(err_LOGIC_ERROR);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_transfer_node_field */
+/* interpolates the nodal field U (nvar values per node of Mesh)
+ linearly at n points X into V (nvar values per point). Points outside
+ Mesh are interpolated in the boundary element where their walk
+ stopped with clipped barycentric coordinates. rate (may be NULL)
+ receives points per second */
+int mg_transfer_node_field(mg_Mesh *Mesh, mg_Locator *Loc, int nvar,
+                           double *U, int n, double *X, double *V,
+                           double *rate)
+{
+  int ierr, i, j, k, e, *elem, *node;
+  double t0, *bary;
+  
+  if (n <= 0) return err_OK;
+  t0 = omp_get_wtime();
+  call(mg_alloc((void**)&elem, n, sizeof(int)));
+  call(mg_alloc((void**)&bary, 3*n, sizeof(double)));
+  call(mg_locate_points(Mesh, Loc, n, X, elem, bary, NULL));
+  
+#pragma omp parallel for schedule(static) private(j, k, e, node)
+  for (i = 0; i < n; i++) {
+    e = (elem[i] >= 0) ? elem[i] : -elem[i]-1;
+    node = Mesh->Elem[e].node;
+    for (k = 0; k < nvar; k++) {
+      V[i*nvar+k] = 0.0;
+      for (j = 0; j < 3; j++)
+        V[i*nvar+k] += bary[3*i+j]*U[node[j]*nvar+k];
+    }
+  }
+  
+  mg_free((void*)elem);
+  mg_free((void*)bary);
+  if (rate != NULL) (*rate) = n/max(omp_get_wtime()-t0, MEPS);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_locator_report */
+/* prints walk statistics */
+void mg_locator_report(mg_Locator *Loc)
+{
+  if (Loc == NULL) return;
+  printf("Point location: %d queries, %1.2f average walk, %d longest\n",
+         Loc->nLocate, (Loc->nLocate > 0) ? (double)Loc->nStep/Loc->nLocate
+         : 0.0, Loc->MaxStep);
+}
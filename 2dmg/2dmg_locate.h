@@ -0,0 +1,80 @@
+//
+//  2dmg_locate.h
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#ifndef ___dmg___dmg_locate__
+#define ___dmg___dmg_locate__
+
+#include <stdio.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+
+/******************************************************************/
+/* maximum walk from the last element found before seeding from the
+ centroid quadtree */
+#define LOCATELASTSTEP    4
+
+/******************************************************************/
+/* function:  mg_walk_to_point */
+/* iterative visibility walk from elem_start to the element containing
+ coord. A walk stopped by a boundary face is followed by a scan of all
+ elements, since in a non-convex domain the point may lie behind it.
+ Returns err_NOT_FOUND (not reported) if coord is outside the mesh,
+ pelem then holds the last element visited. nstep (may be NULL)
+ receives the number of elements crossed */
+int mg_walk_to_point(mg_Mesh *Mesh, int elem_start, double coord[2],
+                     int *pelem, int *nstep);
+
+/******************************************************************/
+/* function:  mg_create_locator */
+/* builds a point locator seeded by a linear quadtree of the element
+ centroids of Mesh (and the element links of Mesh if they are still
+ pending). Must be rebuilt if the mesh changes */
+int mg_create_locator(mg_Mesh *Mesh, mg_Locator **pLoc);
+
+/******************************************************************/
+/* function:  mg_destroy_locator */
+void mg_destroy_locator(mg_Locator *Loc);
+
+/******************************************************************/
+/* function:  mg_locate_point */
+/* finds the element containing coord. A short walk from the last
+ element found is tried first; otherwise the walk starts from the
+ element with the nearest centroid. Same return values as
+ mg_walk_to_point */
+int mg_locate_point(mg_Mesh *Mesh, mg_Locator *Loc, double coord[2],
+                    int *pelem, int *nstep);
+
+/******************************************************************/
+/* function:  mg_locate_points */
+/* locates n points with interleaved coordinates X. Queries are sorted
+ along a Hilbert curve and split in contiguous chunks among threads,
+ each walk starting from the previous hit of its thread. elem[i] is
+ the element containing point i or -(e+1) if the point is outside the
+ mesh, e being the boundary element where the walk stopped (such points
+ cost a scan of all elements). bary (may be NULL) receives 3 barycentric
+ coordinates per point (clipped for points outside). rate (may be NULL)
+ receives points per second */
+int mg_locate_points(mg_Mesh *Mesh, mg_Locator *Loc, int n, double *X,
+                     int *elem, double *bary, double *rate);
+
+/******************************************************************/
+/* function:  mg_transfer_node_field */
+/* interpolates the nodal field U (nvar values per node of Mesh)
+ linearly at n points X into V (nvar values per point). Points outside
+ Mesh are interpolated in the boundary element where their walk
+ stopped with clipped barycentric coordinates. rate (may be NULL)
+ receives points per second */
+int mg_transfer_node_field(mg_Mesh *Mesh, mg_Locator *Loc, int nvar,
+                           double *U, int n, double *X, double *V,
+                           double *rate);
+
+/******************************************************************/
+/* function:  mg_locator_report */
+/* prints walk statistics */
+void mg_locator_report(mg_Locator *Loc);
+
+#endif
@@ -0,0 +1,170 @@
+//
+//  2dmg_marks.c
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#include <string.h>
+#include "2dmg_marks.h"
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_utils.h"
+
+/******************************************************************/
+/* scratch buffers of the calling thread */
+typedef struct
+{
+  int Size; //allocated length
+  int *Item;
+}
+mg_Scratch;
+
+static mg_Scratch Scratch[SCRATCHNSLOT];
+#pragma omp threadprivate(Scratch)
+
+/******************************************************************/
+/* function:  mg_init_mark_set */
+static void mg_init_mark_set(mg_MarkSet *Set)
+{
+  Set->Epoch = 1;
+  Set->Size = 0;
+  Set->Mark = NULL;
+}
+
+/******************************************************************/
+/* function:  mg_create_marks */
+/* creates empty node, face and element mark sets */
+int mg_create_marks(mg_Marks **pMarks)
+{
+  int ierr;
+  
+  call(mg_alloc((void**)pMarks, 1, sizeof(mg_Marks)));
+  mg_init_mark_set(&(*pMarks)->Node);
+  mg_init_mark_set(&(*pMarks)->Face);
+  mg_init_mark_set(&(*pMarks)->Elem);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_destroy_marks */
+void mg_destroy_marks(mg_Marks *Marks)
+{
+  if (Marks == NULL) return;
+  mg_free((void*)Marks->Node.Mark);
+  mg_free((void*)Marks->Face.Mark);
+  mg_free((void*)Marks->Elem.Mark);
+  mg_free((void*)Marks);
+}
+
+/******************************************************************/
+/* function:  mg_new_epoch */
+/* unmarks every index of Set in O(1) */
+void mg_new_epoch(mg_MarkSet *Set)
+{
+  Set->Epoch++;
+  if (Set->Epoch == 0) {
+    //counter wrapped around, stale marks could match again
+    if (Set->Size > 0)
+      memset(Set->Mark, 0, Set->Size*sizeof(unsigned int));
+    Set->Epoch = 1;
+  }
+}
+
+/******************************************************************/
+/* function:  mg_mark */
+/* marks index i, growing Set if needed */
+int mg_mark(mg_MarkSet *Set, int i, bool *added)
+{
+  int ierr, size;
+  
+  if (i < 0) return error(err_INPUT_ERROR);
+  if (i >= Set->Size) {
+    //grow geometrically so that meshing does not realloc per node
+    size = max(2*Set->Size, i+1);
+    size = max(size, SCRATCHMINSIZE);
+    call(mg_realloc((void**)&Set->Mark, size, sizeof(unsigned int)));
+    memset(Set->Mark+Set->Size, 0, (size-Set->Size)*sizeof(unsigned int));
+    Set->Size = size;
+  }
+  if (added != NULL) (*added) = (Set->Mark[i] != Set->Epoch);
+  Set->Mark[i] = Set->Epoch;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_unmark */
+void mg_unmark(mg_MarkSet *Set, int i)
+{
+  if (i >= 0 && i < Set->Size) Set->Mark[i] = 0;
+}
+
+/******************************************************************/
+/* function:  mg_scratch_reserve */
+/* makes the buffer in "slot" hold at least n ints */
+int mg_scratch_reserve(int slot, int n, int **pbuf)
+{
+  int ierr, size;
+  mg_Scratch *S;
+  
+  if (slot < 0 || slot >= SCRATCHNSLOT) return error(err_INPUT_ERROR);
+  S = Scratch+slot;
+  if (n > S->Size) {
+    size = max(2*S->Size, n);
+    size = max(size, SCRATCHMINSIZE);
+    call(mg_realloc((void**)&S->Item, size, sizeof(int)));
+    S->Size = size;
+  }
+  (*pbuf) = S->Item;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_scratch_release */
+/* frees the scratch buffers of the calling thread */
+void mg_scratch_release(void)
+{
+  int slot;
+  
+  for (slot = 0; slot < SCRATCHNSLOT; slot++) {
+    mg_free((void*)Scratch[slot].Item);
+    Scratch[slot].Item = NULL;
+    Scratch[slot].Size = 0;
+  }
+}
+
+/******************************************************************/
+/* function:  mg_add_2_marked_list */
+/* appends entry to List unless it is already marked in Set */
+int mg_add_2_marked_list(mg_MarkSet *Set, int slot, int entry,
+                         mg_List *List)
+{
+  int ierr;
+  bool added;
+  
+  call(mg_mark(Set, entry, &added));
+  if (!added) return err_OK;
+  call(mg_scratch_reserve(slot, List->nItem+1, &List->Item));
+  List->Item[List->nItem++] = entry;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_rm_frm_marked_list */
+/* unmarks entry and removes it from List */
+void mg_rm_frm_marked_list(mg_MarkSet *Set, int entry, mg_List *List)
+{
+  int i;
+  
+  if (!ismarked(Set, entry)) return;
+  mg_unmark(Set, entry);
+  for (i = 0; i < List->nItem; i++)
+    if (List->Item[i] == entry) break;
+  if (i == List->nItem) return;
+  memmove(List->Item+i, List->Item+i+1, (List->nItem-i-1)*sizeof(int));
+  List->nItem--;
+}
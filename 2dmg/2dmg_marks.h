@@ -0,0 +1,79 @@
+//
+//  2dmg_marks.h
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#ifndef ___dmg___dmg_marks__
+#define ___dmg___dmg_marks__
+
+#include <stdio.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+
+/******************************************************************/
+/* scratch buffer slots: each slot is an int buffer private to the
+ calling thread that keeps its memory between uses */
+#define SCRATCHNODES      0 //close/candidate nodes of the active face
+#define SCRATCHELEMS      1 //broken triangles
+#define SCRATCHFACES      2 //candidate front faces of a new node
+#define SCRATCHNODEFACES  3 //front faces of a node
+#define SCRATCHNSLOT      4
+//initial length of a scratch buffer
+#define SCRATCHMINSIZE    64
+
+/******************************************************************/
+/* true if index i is marked in the current epoch of set S */
+#define ismarked(S,i) ((i) < (S)->Size && (S)->Mark[(i)] == (S)->Epoch)
+
+/******************************************************************/
+/* function:  mg_create_marks */
+/* creates empty node, face and element mark sets */
+int mg_create_marks(mg_Marks **pMarks);
+
+/******************************************************************/
+/* function:  mg_destroy_marks */
+void mg_destroy_marks(mg_Marks *Marks);
+
+/******************************************************************/
+/* function:  mg_new_epoch */
+/* unmarks every index of Set in O(1) */
+void mg_new_epoch(mg_MarkSet *Set);
+
+/******************************************************************/
+/* function:  mg_mark */
+/* marks index i, growing Set if needed. added (may be NULL) is set
+ to false if i was already marked */
+int mg_mark(mg_MarkSet *Set, int i, bool *added);
+
+/******************************************************************/
+/* function:  mg_unmark */
+void mg_unmark(mg_MarkSet *Set, int i);
+
+/******************************************************************/
+/* function:  mg_scratch_reserve */
+/* makes the buffer in "slot" hold at least n ints and points
+ (*pbuf) to it. Contents are kept when the buffer grows */
+int mg_scratch_reserve(int slot, int n, int **pbuf);
+
+/******************************************************************/
+/* function:  mg_scratch_release */
+/* frees the scratch buffers of the calling thread */
+void mg_scratch_release(void);
+
+/******************************************************************/
+/* function:  mg_add_2_marked_list */
+/* appends entry to List (held in scratch "slot") unless it is
+ already marked in Set. Replaces mg_add_2_ord_set for temporary
+ sets: the list keeps insertion order */
+int mg_add_2_marked_list(mg_MarkSet *Set, int slot, int entry,
+                         mg_List *List);
+
+/******************************************************************/
+/* function:  mg_rm_frm_marked_list */
+/* unmarks entry and removes it from List keeping the order of the
+ remaining items */
+void mg_rm_frm_marked_list(mg_MarkSet *Set, int entry, mg_List *List);
+
+#endif
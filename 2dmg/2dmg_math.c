@@ -10,6 +10,10 @@
 #include "2dmg_def.h"
 #include "2dmg_metric_analytic.h"
 #include "2dmg_struct.h"
+#include "2dmg_utils.h"
+#include "2dmg_spline.h"
+#include "2dmg_pred.h"
+#include <float.h>
 #include <gsl/gsl_integration.h>
 #include <gsl/gsl_interp.h>
 
@@ -133,7 +137,7 @@ int mg_binary_search(const int target, const int *set, int begin,
 /* builds a circulcircle from 3 coordinates listed in "coord" */
 int mg_circumcircle(double coord[3][2], double center[2], double *radius)
 {
-  double det, A[2], B[2], C[2], A2[2], B2[2], C2[2], D;
+  double A[2], B[2], C[2], A2[2], B2[2], C2[2], D;
   
   A[0] = coord[0][0];
   B[0] = coord[1][0];
@@ -142,10 +146,8 @@ int mg_circumcircle(double coord[3][2], double center[2], double *radius)
   B[1] = coord[1][1];
   C[1] = coord[2][1];
   
-  //check if nodes are colinear
-  det = A[0]*B[1]+B[0]*C[1]+A[1]*C[0];
-  det-= (C[0]*B[1]+A[1]*B[0]+A[0]*C[1]);
-  if (fabs(det) < MEPS) return error(err_INPUT_ERROR);
+  //check if nodes are colinear (exactly)
+  if (mg_orient2d(A, B, C) == 0.0) return error(err_INPUT_ERROR);
   
   A2[0] = A[0]*A[0];
   A2[1] = A[1]*A[1];
@@ -155,6 +157,8 @@ int mg_circumcircle(double coord[3][2], double center[2], double *radius)
   C2[1] = C[1]*C[1];
   
   D = 2.*(A[0]*(B[1]-C[1])+B[0]*(C[1]-A[1])+C[0]*(A[1]-B[1]));
+  //nearly colinear nodes: the circle does not fit in double
+  if (D == 0.0) return error(err_INPUT_ERROR);
   center[0] = ((A2[0]+A2[1])*(B[1]-C[1])+(B2[0]+B2[1])*(C[1]-A[1])+(C2[0]+C2[1])*(A[1]-B[1]))/D;
   center[1] = ((A2[0]+A2[1])*(C[0]-B[0])+(B2[0]+B2[1])*(A[0]-C[0])+(C2[0]+C2[1])*(B[0]-A[0]))/D;
   //radius computed from definition
@@ -164,174 +168,320 @@ int mg_circumcircle(double coord[3][2], double center[2], double *radius)
   return err_OK;
 }
 
+/******************************************************************/
+/* metric evaluators indexed by enum mge_Metric */
+static const mg_MetricFunc mg_MetricFuncTable[mge_Metric_Last] = {
+  mg_metric_uniform,
+  mg_metric_linx,
+  mg_metric_expx,
+  mg_metric_sqx
+};
+
 /******************************************************************/
 /* function: mg_get_metric */
-/* gets metric value at a (x,y) */
+/* gets metric value at np points (x,y) with a single call to the
+ evaluator of Metric->type */
 int mg_get_metric(mg_Metric *Metric, double *x, double *y, int np, double *M)
 {
-  switch (Metric->type) {
-    case mge_Metric_Uniform:
-      mg_metric_uniform(x, y, np, M);
-      break;
-    case mge_Metric_Analitic1:
-      mg_metric_linx(x, y, np, M);
-      break;
-    case mge_Metric_Analitic2:
-      mg_metric_expx(x, y, np, M);
-      break;
-    case mge_Metric_Analitic3:
-      mg_metric_sqx(x, y, np, M);
-      break;
-    default:
-      error(err_NOT_SUPPORTED);
-      break;
-  }
+  if (Metric->type < 0 || Metric->type >= mge_Metric_Last)
+    return error(err_NOT_SUPPORTED);
+  mg_MetricFuncTable[Metric->type](x, y, np, M);
+  
   return err_OK;
 }
 
 /******************************************************************/
-/* function: mg_metric_dist */
-/* computes metric distance between 2 points */
-int mg_metric_dist(mg_Metric *Metric, int order, double *coord,
-                   double *dist)
+/* function: mg_metric_isotropic */
+/* true if the metric type is h^-2*I everywhere */
+bool mg_metric_isotropic(mg_Metric *Metric)
 {
-  int ierr;
-  gsl_integration_glfixed_table *gltable;
-  double dx = coord[1]-coord[0], dy = coord[3]-coord[2];
-  double ab[2], M[3], x, y, ds2, xgl, wgl;
-  ab[0] = dx;
-  ab[1] = dy;
-  int ip;
-  
-  if ((gltable = gsl_integration_glfixed_table_alloc(order)) == NULL)
-    return error(err_GSL_ERROR);
+  //the analytic metrics may be isotropic at any set of sample points
+  //and still not in between
+  return (Metric->type == mge_Metric_Uniform);
+}
+
+/******************************************************************/
+/* Gauss-Kronrod 7-15 nodes on [-1,1] (positive half, Gauss nodes at
+ odd positions) and weights */
+static const double mg_gk15_x[8] = {
+  0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+  0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+  0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+  0.207784955007898467600689403773245, 0.000000000000000000000000000000000};
+static const double mg_gk15_wk[8] = {
+  0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+  0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+  0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+  0.204432940075298892414161999234649, 0.209482141084727828012999174891714};
+static const double mg_gk15_wg[4] = {
+  0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+  0.381830050505118944950369775488975, 0.417959183673469387755102040816327};
+//3 point Gauss node and weights (outer, center)
+static const double mg_g3_x = 0.774596669241483377035853079956480;
+static const double mg_g3_w[2] = {
+  0.555555555555555555555555555555556, 0.888888888888888888888888888888889};
+
+/******************************************************************/
+/* function: mg_metric_speed */
+/* metric speed sqrt(x'^T*M*x') at np parametric coordinates t of a
+ segment (Segment != NULL) or of the straight line given by coord */
+static int mg_metric_speed(mg_Metric *Metric, mg_Segment *Segment,
+                           double *coord, int np, double *t, double *sp)
+{
+  int ierr, k;
+  double X[30], dX[30], M[45], ab[2], dl2;
   
-  (*dist) = 0.0;
-  for (ip = 0; ip < gltable->n; ip++) {
-    gsl_integration_glfixed_point(0.0, 1.0, ip, &xgl, &wgl, gltable);
-    x = coord[0]+xgl*dx;
-    y = coord[2]+xgl*dy;
-    call(mg_get_metric(Metric, &x, &y, 1, M));
-    ds2   = metriclen(ab,M);
-    (*dist) += wgl*sqrt(ds2);
+  if (np > 15) return error(err_OUT_OF_BOUNDS);
+  if (Segment != NULL)
+    mg_spline_eval(Segment->Spline, np, t, X, dX, NULL);
+  else {
+    for (k = 0; k < np; k++) {
+      X[k]    = coord[0]+t[k]*(coord[1]-coord[0]);
+      X[np+k] = coord[2]+t[k]*(coord[3]-coord[2]);
+      dX[k]    = coord[1]-coord[0];
+      dX[np+k] = coord[3]-coord[2];
+    }
+  }
+  call(mg_get_metric(Metric, X, X+np, np, M));
+  for (k = 0; k < np; k++) {
+    ab[0] = dX[k];
+    ab[1] = dX[np+k];
+    dl2 = metriclen(ab, (M+3*k));
+    sp[k] = sqrt(max(dl2, 0.0));
   }
-  
-  gsl_integration_glfixed_table_free(gltable);
   
   return err_OK;
 }
 
 /******************************************************************/
-/* function: mg_metric_length */
-/* computes metric length of a segment */
-int mg_metric_length(mg_Metric *Metric, mg_Segment *Segment, int order,
-                     double *length)
+/* function: mg_metric_gk15 */
+/* estimate of the metric length over [a,b] and of its error. The 7
+ point Gauss rule is taken when it agrees with the 3 point one to
+ Metric->tol relative; otherwise the 15 point Kronrod extension is
+ evaluated and its difference to the Gauss rule scaled as in QUADPACK */
+static int mg_metric_gk15(mg_Metric *Metric, mg_Segment *Segment,
+                          double *coord, double a, double b,
+                          double *result, double *abserr)
 {
-  int ierr, iq;
-  gsl_integration_glfixed_table *gltable;
-  double tq, wq, xq, yq, dxq, dyq, Mq[3], ab[2], dl2;
-  
-  (*length) = 0.0;
-  
-  //integration table
-  if ((gltable = gsl_integration_glfixed_table_alloc(order)) == NULL)
-    return error(err_GSL_ERROR);
-  for (iq = 0; iq < gltable->n; iq++) {
-    //get parametric coordinate for quadrature point
-    gsl_integration_glfixed_point(0.0, 1.0, iq, &tq, &wq, gltable);
-    //evaluate global coordinate and tangent
-    xq = gsl_interp_eval(Segment->interp[0],Segment->s,
-                         Segment->Coord+0*Segment->nPoint, tq,
-                         Segment->accel[0]);
-    dxq = gsl_interp_eval_deriv(Segment->interp[0],Segment->s,
-                                Segment->Coord+0*Segment->nPoint, tq,
-                                Segment->accel[0]);
-    yq = gsl_interp_eval(Segment->interp[1],Segment->s,
-                         Segment->Coord+1*Segment->nPoint, tq,
-                         Segment->accel[1]);
-    dyq = gsl_interp_eval_deriv(Segment->interp[1],Segment->s,
-                                Segment->Coord+1*Segment->nPoint, tq,
-                                Segment->accel[1]);
-    //matrix value at quadrature point
-    call(mg_get_metric(Metric, &xq, &yq, 1, Mq));
-    ab[0] = dxq;
-    ab[1] = dyq;
-    //dl2 = ab^T*M*ab;
-    dl2 = metriclen(ab, Mq);
-    (*length) += wq*sqrt(dl2);
+  int ierr, k;
+  double c = 0.5*(a+b), h = 0.5*(b-a), t[9], fg[9], fk[8];
+  double rk, rg, r3, mean, resasc, err;
+  
+  //gauss nodes (odd kronrod positions), the center and the 3 point
+  //nodes in one evaluation
+  for (k = 0; k < 3; k++) {
+    t[2*k]   = c-h*mg_gk15_x[2*k+1];
+    t[2*k+1] = c+h*mg_gk15_x[2*k+1];
+  }
+  t[6] = c;
+  t[7] = c-h*mg_g3_x;
+  t[8] = c+h*mg_g3_x;
+  call(mg_metric_speed(Metric, Segment, coord, 9, t, fg));
+  rg = mg_gk15_wg[3]*fg[6];
+  for (k = 0; k < 3; k++)
+    rg += mg_gk15_wg[k]*(fg[2*k]+fg[2*k+1]);
+  r3 = mg_g3_w[1]*fg[6]+mg_g3_w[0]*(fg[7]+fg[8]);
+  //smooth speed, the error of G3 bounds that of G7
+  if (fabs(rg-r3) <= Metric->tol*fabs(rg)) {
+    (*result) = h*rg;
+    (*abserr) = fabs(h*(rg-r3));
+    return err_OK;
   }
   
-  gsl_integration_glfixed_table_free(gltable);
+  //remaining kronrod nodes
+  for (k = 0; k < 4; k++) {
+    t[2*k]   = c-h*mg_gk15_x[2*k];
+    t[2*k+1] = c+h*mg_gk15_x[2*k];
+  }
+  call(mg_metric_speed(Metric, Segment, coord, 8, t, fk));
+  rk = mg_gk15_wk[7]*fg[6];
+  for (k = 0; k < 3; k++)
+    rk += mg_gk15_wk[2*k+1]*(fg[2*k]+fg[2*k+1]);
+  for (k = 0; k < 4; k++)
+    rk += mg_gk15_wk[2*k]*(fk[2*k]+fk[2*k+1]);
+  //|K15-G7| overestimates the error by orders of magnitude on smooth
+  //integrands, scaled by the deviation from the mean (speed >= 0)
+  mean = 0.5*rk;
+  resasc = mg_gk15_wk[7]*fabs(fg[6]-mean);
+  for (k = 0; k < 3; k++)
+    resasc += mg_gk15_wk[2*k+1]*(fabs(fg[2*k]-mean)+fabs(fg[2*k+1]-mean));
+  for (k = 0; k < 4; k++)
+    resasc += mg_gk15_wk[2*k]*(fabs(fk[2*k]-mean)+fabs(fk[2*k+1]-mean));
+  err = fabs(rk-rg);
+  if (resasc != 0.0 && err != 0.0)
+    err = resasc*min(1.0, pow(200.0*err/resasc, 1.5));
+  //roundoff floor
+  if (rk > DBL_MIN/(50.0*DBL_EPSILON))
+    err = max(50.0*DBL_EPSILON*rk, err);
+  (*result) = h*rk;
+  (*abserr) = fabs(h)*err;
   
   return err_OK;
 }
 
 /******************************************************************/
-/* function: mg_lu */
-/* decomposes full matrix as A = L*U*/
-static int
-mg_lu(int n, double *a, double *l, double *u)
+/* function: mg_metric_adapt */
+/* globally adaptive Gauss-Kronrod integration of the metric speed over
+ [0,1] starting from ninit uniform subintervals. The subinterval with
+ the largest error is bisected until the total error is below
+ Metric->tol times the length or METRICQUADMAXINT is reached (the best
+ estimate is returned in that case) */
+static int mg_metric_adapt(mg_Metric *Metric, mg_Segment *Segment,
+                           double *coord, int ninit, double *length)
 {
+  int ierr, n, i, imax;
+  double a[METRICQUADMAXINT], b[METRICQUADMAXINT];
+  double r[METRICQUADMAXINT], e[METRICQUADMAXINT];
+  double res, err, m;
+  
+  ninit = min(max(ninit, 1), METRICQUADMAXINT);
+  res = err = 0.0;
+  for (n = 0; n < ninit; n++) {
+    a[n] = (double)n/ninit;
+    b[n] = (double)(n+1)/ninit;
+    call(mg_metric_gk15(Metric, Segment, coord, a[n], b[n], r+n, e+n));
+    res += r[n];
+    err += e[n];
+  }
   
-  int i, j, m;
-  
-  for(i = 0; i < n; i++) for(j = 0; j < n; j++) l[i*n+j] = u[i*n+j] = 0.0;
+  while (err > Metric->tol*fabs(res) && n < METRICQUADMAXINT) {
+    imax = 0;
+    for (i = 1; i < n; i++)
+      if (e[i] > e[imax]) imax = i;
+    m = 0.5*(a[imax]+b[imax]);
+    //stop refining once intervals can no longer be split
+    if (m <= a[imax] || m >= b[imax]) break;
+    res -= r[imax];
+    err -= e[imax];
+    a[n] = m;
+    b[n] = b[imax];
+    b[imax] = m;
+    call(mg_metric_gk15(Metric, Segment, coord, a[imax], b[imax],
+                        r+imax, e+imax));
+    call(mg_metric_gk15(Metric, Segment, coord, a[n], b[n], r+n, e+n));
+    res += r[imax]+r[n];
+    err += e[imax]+e[n];
+    n++;
+  }
+  (*length) = res;
   
-  for(i = 0; i < n; i++) l[i*n+i] = 1.0;
+  return err_OK;
+}
+
+/******************************************************************/
+/* Gauss-Legendre rules on [0,1], filled on first use */
+static double mg_gl_x[GLMAXORDER+1][GLMAXORDER];
+static double mg_gl_w[GLMAXORDER+1][GLMAXORDER];
+static bool mg_gl_set[GLMAXORDER+1];
+
+/******************************************************************/
+/* function: mg_gl_rule */
+/* points x and weights w of the Gauss-Legendre rule with "order"
+ points on [0,1]. The rule is computed once and shared by all calls */
+int mg_gl_rule(int order, const double **x, const double **w)
+{
+  int ip, ierr = err_OK;
+  bool set;
+  gsl_integration_glfixed_table *gltable;
   
-  for(m = 0; m < n; m++){
-    for(i = m; i < n; i++){
-      u[m*n+i] = a[m*n+i];
-      for(j = 0; j < m; j++){
-        u[m*n+i] -= l[m*n+j]*u[j*n+i];
-      }
-    }
-    for(i = m+1; i < n; i++){
-      l[i*n+m] = a[i*n+m];
-      for (j = 0; j < m; j++){
-        l[i*n+m] -= l[i*n+j]*u[j*n+m];
+  if (order < 1 || order > GLMAXORDER) return error(err_OUT_OF_BOUNDS);
+  
+#pragma omp flush
+  set = mg_gl_set[order];
+  if (!set) {
+#pragma omp critical (mg_gl_rule)
+    {
+      if (!mg_gl_set[order]) {
+        gltable = gsl_integration_glfixed_table_alloc(order);
+        if (gltable == NULL || (int)gltable->n != order)
+          ierr = err_GSL_ERROR;
+        else {
+          for (ip = 0; ip < order; ip++)
+            gsl_integration_glfixed_point(0.0, 1.0, ip, mg_gl_x[order]+ip,
+                                          mg_gl_w[order]+ip, gltable);
+#pragma omp flush
+          mg_gl_set[order] = true;
+        }
+        if (gltable != NULL) gsl_integration_glfixed_table_free(gltable);
       }
-      if (fabs(u[m*n+m]) < MEPS)
-        return error(err_SINGULAR);
-      l[i*n+m] = l[i*n+m]/u[m*n+m];
     }
+    if (ierr != err_OK) return error(ierr);
   }
+  (*x) = mg_gl_x[order];
+  (*w) = mg_gl_w[order];
   
   return err_OK;
 }
 
 /******************************************************************/
-/* function: mg_luinv */
-/* inverts L and U factors*/
-static void
-mg_luinv(int n, double *l, double *u, double *linv, double *uinv)
+/* function: mg_metric_dist */
+/* computes metric distance between 2 points. Uses Gauss-Legendre of
+ the given order if Metric->tol <= 0 and adaptive Gauss-Kronrod
+ otherwise (order is then ignored) */
+int mg_metric_dist(mg_Metric *Metric, int order, double *coord,
+                   double *dist)
 {
-  int i, j, k;
-  double sum;
-  //Computing inverse of U
-  for(j = n-1; j >= 0; j--){
-    for(i = n-1; i >= 0; i--){
-      if(i == j) uinv[i*n+j] = 1.0/u[i*n+j];
-      else {
-        sum = 0.0;
-        for(k = n-1; k > i; k--) sum += u[i*n+k]*uinv[k*n+j];
-        uinv[i*n+j] = -sum/u[i*n+i];
-      }
-    }
+  int ierr, ip;
+  double dx = coord[1]-coord[0], dy = coord[3]-coord[2];
+  double ab[2], x[GLMAXORDER], y[GLMAXORDER], M[3*GLMAXORDER], ds2;
+  const double *xgl, *wgl;
+  
+  if (Metric->tol > 0.0)
+    return mg_metric_adapt(Metric, NULL, coord, 1, dist);
+  
+  call(mg_gl_rule(order, &xgl, &wgl));
+  ab[0] = dx;
+  ab[1] = dy;
+  //all quadrature points in one metric evaluation
+  for (ip = 0; ip < order; ip++) {
+    x[ip] = coord[0]+xgl[ip]*dx;
+    y[ip] = coord[2]+xgl[ip]*dy;
+  }
+  call(mg_get_metric(Metric, x, y, order, M));
+  (*dist) = 0.0;
+  for (ip = 0; ip < order; ip++) {
+    ds2 = metriclen(ab, (M+3*ip));
+    (*dist) += wgl[ip]*sqrt(ds2);
   }
   
-  //Computing inverse of L
-  for(j = 0; j < n; j++){
-    for(i = 0; i < n; i++){
-      if(i == j) linv[i*n+j] = 1.0/l[i*n+j];
-      else {
-        sum = 0.0;
-        for(k = 0; k < i; k++) sum += l[i*n+k]*linv[k*n+j];
-        linv[i*n+j] = -sum/l[i*n+i];
-      }
-    }
+  return err_OK;
+}
+
+/******************************************************************/
+/* function: mg_metric_length */
+/* computes metric length of a segment (same quadrature rules as
+ mg_metric_dist) */
+int mg_metric_length(mg_Metric *Metric, mg_Segment *Segment, int order,
+                     double *length)
+{
+  int ierr, iq;
+  double Xq[2*GLMAXORDER], dXq[2*GLMAXORDER], Mq[3*GLMAXORDER];
+  double ab[2], dl2;
+  const double *tq, *wq;
+  
+  if (Metric->tol > 0.0)
+    return mg_metric_adapt(Metric, Segment, NULL, METRICQUADSEGINIT,
+                           length);
+  
+  (*length) = 0.0;
+  
+  //integration rule
+  call(mg_gl_rule(order, &tq, &wq));
+  //evaluate global coordinates and tangents in one pass
+  mg_spline_eval(Segment->Spline, order, tq, Xq, dXq, NULL);
+  //matrix values at quadrature points
+  call(mg_get_metric(Metric, Xq, Xq+order, order, Mq));
+  for (iq = 0; iq < order; iq++) {
+    ab[0] = dXq[iq];
+    ab[1] = dXq[order+iq];
+    //dl2 = ab^T*M*ab;
+    dl2 = metriclen(ab, (Mq+3*iq));
+    (*length) += wq[iq]*sqrt(dl2);
   }
+  
+  return err_OK;
 }
+
 /******************************************************************/
 /* function: mg_mxm */
 /* product of 2 full matrices*/
@@ -393,7 +543,7 @@ int
 mg_circumellipse(double *coord, mg_Ellipse *Ellipse)
 {
   //builds Steiner circumellipse
-  double x[3], y[3], M[4], L[4], U[4], Linv[4], Uinv[4];
+  double x[3], y[3], M[4];
   int i;
   double T, D, L1, L2, t, V1norm, V2norm;
   double Cp[4], Mt[4];
@@ -440,10 +590,12 @@ mg_circumellipse(double *coord, mg_Ellipse *Ellipse)
     Ellipse->V[2] = sxy/V1norm;
     Ellipse->V[3] = sxy/V2norm;
   }
-  //inverse rotation matrix
-  mg_lu(2, Ellipse->V, L, U);
-  mg_luinv(2, L, U, Linv, Uinv);
-  mg_mxm(2, 2, 2, Uinv, Linv, Ellipse->Vinv);
+  //inverse rotation matrix: the eigenvectors are orthonormal, so it is
+  //the transpose (an unpivoted LU breaks down when V[0] vanishes)
+  Ellipse->Vinv[0] = Ellipse->V[0];
+  Ellipse->Vinv[1] = Ellipse->V[2];
+  Ellipse->Vinv[2] = Ellipse->V[1];
+  Ellipse->Vinv[3] = Ellipse->V[3];
   //get semi-axis lengths
   mg_mxm(2, 2, 2, Ellipse->Vinv, M, Mt);
   for (i = 0; i < 4; i++) Mt[i] /= SQRT3;
@@ -467,25 +619,8 @@ mg_circumellipse(double *coord, mg_Ellipse *Ellipse)
 bool
 mg_inside_ellipse(double *coord, mg_Ellipse *Ellipse)
 {
-  bool inside;
-  double coord_p[2], ct[2], r;
-  
-  //shift coordinates by ellipse's center
-  coord_p[0] = coord[0]-Ellipse->Ot[0];
-  coord_p[1] = coord[1]-Ellipse->Ot[1];
-  
-  //rotate reference
-  mg_mxm(2, 2, 1, Ellipse->Vinv, coord_p, ct);
-  
-  //scale directions
-  ct[0] /= Ellipse->rho[0];
-  ct[1] /= Ellipse->rho[1];
-  
-  r = sqrt(ct[0]*ct[0]+ct[1]*ct[1]);
-  
-  inside = (r <= 1.0);
-  
-  return inside;
+  //points on the ellipse are inside
+  return (mg_inellipse(Ellipse, coord) >= 0.0);
 }
 
 /******************************************************************/
@@ -494,13 +629,16 @@ mg_inside_ellipse(double *coord, mg_Ellipse *Ellipse)
 int mg_ellipse_frm_face_p(mg_Mesh *Mesh, mg_FaceData *face,
                            double *Popt, mg_Ellipse *Ellipse)
 {
-  int ierr, dim = Mesh->Dim, i, d;
+  int ierr;
   double coord[6];
-  int *node = face->node;
-  
-  for (i = 0; i < 2; i++)
-    for (d = 0; d < dim; d++)
-      coord[i*dim+d] = Mesh->Coord[node[i]*dim+d];
+  const double *X0 = Mesh->Coord+2*face->node[0];
+  const double *X1 = Mesh->Coord+2*face->node[1];
+  
+  if (Mesh->Dim != 2) return error(err_NOT_SUPPORTED);
+  coord[0] = X0[0];
+  coord[1] = X0[1];
+  coord[2] = X1[0];
+  coord[3] = X1[1];
   coord[4] = Popt[0];
   coord[5] = Popt[1];
   
@@ -508,4 +646,3 @@ int mg_ellipse_frm_face_p(mg_Mesh *Mesh, mg_FaceData *face,
   
   return err_OK;
 }
-
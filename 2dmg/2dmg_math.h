@@ -14,6 +14,18 @@
 #include "2dmg_def.h"
 #include "2dmg_metric_struct.h"
 
+/******************************************************************/
+/* adaptive metric length quadrature */
+#define METRICQUADTOL     0.0 //default relative tolerance (<= 0: fixed order)
+#define METRICQUADMAXINT  128 //maximum number of subintervals
+#define METRICQUADSEGINIT 4 //initial subintervals along a segment
+//largest Gauss-Legendre rule kept by mg_gl_rule
+#define GLMAXORDER        32
+
+/******************************************************************/
+/* metric evaluator: M receives M11, M12, M22 at each of the np
+ points (x,y) */
+typedef void (*mg_MetricFunc)(double *x, double *y, int np, double *M);
 
 /******************************************************************/
 /* function:  mg_limited_pair */
@@ -43,18 +55,35 @@ int mg_circumcircle(double coord[3][2], double center[2], double *radius);
 
 /******************************************************************/
 /* function: mg_get_metric */
-/* gets metric value at a (x,y) */
+/* gets metric value at np points (x,y) with a single call to the
+ evaluator of Metric->type */
 int mg_get_metric(mg_Metric *Metric, double *x, double *y, int np, double *M);
 
+/******************************************************************/
+/* function: mg_metric_isotropic */
+/* true if the metric type is of the form h^-2*I everywhere (only
+ the uniform metric is) */
+bool mg_metric_isotropic(mg_Metric *Metric);
+
+/******************************************************************/
+/* function: mg_gl_rule */
+/* points x and weights w of the Gauss-Legendre rule with "order"
+ points (1 <= order <= GLMAXORDER) on [0,1]. The rule is computed
+ once and shared by all calls */
+int mg_gl_rule(int order, const double **x, const double **w);
+
 /******************************************************************/
 /* function: mg_metric_dist */
-/* computes metric distance between 2 points */
+/* computes metric distance between 2 points. Uses Gauss-Legendre of
+ the given order if Metric->tol <= 0 and adaptive Gauss-Kronrod
+ otherwise (order is then ignored) */
 int mg_metric_dist(mg_Metric *Metric, int order, double *coord,
                    double *dist);
 
 /******************************************************************/
 /* function: mg_metric_length */
-/* computes metric length of a segment */
+/* computes metric length of a segment (same quadrature rules as
+ mg_metric_dist) */
 int mg_metric_length(mg_Metric *Metric, mg_Segment *Segment, int order,
                      double *length);
 
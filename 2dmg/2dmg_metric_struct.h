@@ -30,13 +30,29 @@ static char *mge_MetricName[mge_Metric_Last] = {
   "MetricAnalytic3"
 };
 
+/******************************************************************/
+/* enumerators for front advancement engines */
+enum mge_Engine {
+  mge_Engine_Auto, //circle for the uniform metric, ellipse otherwise
+  mge_Engine_Ellipse, //Steiner ellipses and metric lengths
+  mge_Engine_Circle, //circumcircles and a pointwise isotropic size
+  mge_Engine_Last
+};
+static char *mge_EngineName[mge_Engine_Last] = {
+  "Auto",
+  "Ellipse",
+  "Circle"
+};
+
 /******************************************************************/
 /* mesh structure */
 typedef struct
 {
   enum mge_Metric type;
+  enum mge_Engine engine; //front advancement engine
   mg_Mesh *BGMesh;
   int order; //interpolation order (Lagrange basis)
+  double tol; //relative tolerance of adaptive length quadrature (<= 0: fixed order)
   double *M;
 }
 mg_Metric;
@@ -10,6 +10,7 @@
 #include "2dmg_utils.h"
 #include "2dmg_math.h"
 #include "2dmg_def.h"
+#include "2dmg_locate.h"
 
 
 /******************************************************************/
@@ -201,6 +202,7 @@ int mg_plot_mesh(mg_Mesh *Mesh, mg_Front *Front,
   }
   
   if (PlotInfo->tree_on){
+    call(mg_mesh_require(Mesh, MESHQTREE));
     if (Mesh->QuadTree != NULL)
       call(mg_plot_branch(Mesh->QuadTree));
   }
@@ -257,6 +259,7 @@ int mg_show_mesh(mg_Mesh *Mesh, mg_Front *Front)
   double range[4], coord[2], tri[8];
   int cursorval;
   mg_MeshPlot PlotInfo;
+  mg_Locator *Loc = NULL;
   
   static PLGraphicsIn gin;
   
@@ -319,11 +322,15 @@ int mg_show_mesh(mg_Mesh *Mesh, mg_Front *Front)
       cursorval = plGetCursor( &gin );
       coord[0] = gin.wX;
       coord[1] = gin.wY;
-      ierr = err_NOT_FOUND;
-      while (ierr == err_NOT_FOUND) {
-        ierr = mg_find_elem_frm_coord(Mesh, rand()%Mesh->nElem, coord, &elem);
+      if (Loc == NULL)
+        call(mg_create_locator(Mesh, &Loc));
+      ierr = mg_locate_point(Mesh, Loc, coord, &elem, &n);
+      if (ierr == err_NOT_FOUND) {
+        printf("point outside mesh\n");
+        continue;
       }
-      printf("elem: %d\n",elem);
+      if (ierr != err_OK) return error(ierr);
+      printf("elem: %d (walked %d)\n",elem,n);
       plcol0( 15 );
       for (n = 0; n < Mesh->Elem[elem].nNode; n++) {
         tri[n] = Mesh->Coord[Mesh->Elem[elem].node[n]*2+0];
@@ -360,6 +367,7 @@ int mg_show_mesh(mg_Mesh *Mesh, mg_Front *Front)
     
   }
   
+  mg_destroy_locator(Loc);
   mg_close_plot_mesh();
   
   return err_OK;
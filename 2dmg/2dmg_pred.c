@@ -0,0 +1,465 @@
+//
+//  2dmg_pred.c
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#include <float.h>
+#include "2dmg_pred.h"
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+
+/******************************************************************/
+/* error bounds of the filtered determinants (Shewchuk, 1997) in
+ units of the permanent (same products with absolute values) */
+#define PREDEPS           (0.5*DBL_EPSILON)
+#define ORIENTERRBOUND    ((3.0+16.0*PREDEPS)*PREDEPS)
+#define INCIRCERRBOUND    ((10.0+96.0*PREDEPS)*PREDEPS)
+#define INELLERRBOUND     (32.0*PREDEPS) //conservative
+
+/******************************************************************/
+/* expansions: arrays of non-overlapping doubles sorted by increasing
+ magnitude whose exact sum is the represented value */
+
+/******************************************************************/
+/* function:  mg_two_sum */
+/* x+y == a+b exactly, x = fl(a+b) */
+static void mg_two_sum(double a, double b, double *x, double *y)
+{
+  double bv, av;
+  
+  (*x) = a+b;
+  bv = (*x)-a;
+  av = (*x)-bv;
+  (*y) = (a-av)+(b-bv);
+}
+
+/******************************************************************/
+/* function:  mg_two_diff */
+/* e receives a-b as a 2 component expansion */
+static void mg_two_diff(double a, double b, double e[2])
+{
+  double bv, av;
+  
+  e[1] = a-b;
+  bv = a-e[1];
+  av = e[1]+bv;
+  e[0] = (a-av)+(bv-b);
+}
+
+/******************************************************************/
+/* function:  mg_grow_expansion */
+/* h = e+b, may be done in place (h == e). h holds up to elen+1
+ components, zeros are dropped. Returns the length of h */
+static int mg_grow_expansion(int elen, const double *e, double b,
+                             double *h)
+{
+  int i, hlen = 0;
+  double Q = b, hh;
+  
+  for (i = 0; i < elen; i++) {
+    mg_two_sum(Q, e[i], &Q, &hh);
+    if (hh != 0.0) h[hlen++] = hh;
+  }
+  if (Q != 0.0 || hlen == 0) h[hlen++] = Q;
+  
+  return hlen;
+}
+
+/******************************************************************/
+/* function:  mg_expansion_sum */
+/* h = e+f (h must not overlap f, may be e). h holds up to
+ elen+flen components. Returns the length of h */
+static int mg_expansion_sum(int elen, const double *e, int flen,
+                            const double *f, double *h)
+{
+  int i, hlen = elen;
+  
+  if (h != e) memcpy(h, e, elen*sizeof(double));
+  for (i = 0; i < flen; i++)
+    hlen = mg_grow_expansion(hlen, h, f[i], h);
+  
+  return hlen;
+}
+
+/******************************************************************/
+/* function:  mg_scale_expansion */
+/* h = e*b, h holds up to 2*elen components. Products are split with
+ fma. Returns the length of h */
+static int mg_scale_expansion(int elen, const double *e, double b,
+                              double *h)
+{
+  int i, hlen;
+  double p, perr;
+  
+  for (hlen = 0, i = 0; i < elen; i++) {
+    p = e[i]*b;
+    perr = fma(e[i], b, -p);
+    hlen = mg_grow_expansion(hlen, h, perr, h);
+    hlen = mg_grow_expansion(hlen, h, p, h);
+  }
+  if (hlen == 0) h[hlen++] = 0.0;
+  
+  return hlen;
+}
+
+/******************************************************************/
+/* function:  mg_expansion_product */
+/* h = e*f, h holds up to 2*elen*flen components and t is scratch of
+ 2*elen. Returns the length of h */
+static int mg_expansion_product(int elen, const double *e, int flen,
+                                const double *f, double *h, double *t)
+{
+  int j, tlen, hlen = 0;
+  
+  for (j = 0; j < flen; j++) {
+    tlen = mg_scale_expansion(elen, e, f[j], t);
+    hlen = mg_expansion_sum(hlen, h, tlen, t, h);
+  }
+  if (hlen == 0) h[hlen++] = 0.0;
+  
+  return hlen;
+}
+
+/******************************************************************/
+/* function:  mg_negate_expansion */
+static void mg_negate_expansion(int elen, double *e)
+{
+  int i;
+  
+  for (i = 0; i < elen; i++) e[i] = -e[i];
+}
+
+/******************************************************************/
+/* function:  mg_expansion_estimate */
+/* approximate value of the expansion with its exact sign, which is
+ the sign of the largest component */
+static double mg_expansion_estimate(int elen, const double *e)
+{
+  int i;
+  double Q = 0.0;
+  
+  for (i = 0; i < elen; i++) Q += e[i];
+  if (Q*e[elen-1] <= 0.0) Q = e[elen-1];
+  
+  return Q;
+}
+
+/******************************************************************/
+/* function:  mg_cross_expansion */
+/* h = a0*b1-a1*b0 for 2 component expansions, h holds up to 16
+ components */
+static int mg_cross_expansion(const double a0[2], const double a1[2],
+                              const double b0[2], const double b1[2],
+                              double *h)
+{
+  int len0, len1;
+  double p0[8], p1[8], t[4];
+  
+  len0 = mg_expansion_product(2, a0, 2, b1, p0, t);
+  len1 = mg_expansion_product(2, a1, 2, b0, p1, t);
+  mg_negate_expansion(len1, p1);
+  
+  return mg_expansion_sum(len0, p0, len1, p1, h);
+}
+
+/******************************************************************/
+/* function:  mg_orient2d_exact */
+static double mg_orient2d_exact(const double a[2], const double b[2],
+                                const double c[2])
+{
+  int len;
+  double acx[2], acy[2], bcx[2], bcy[2], det[16];
+  
+  mg_two_diff(a[0], c[0], acx);
+  mg_two_diff(a[1], c[1], acy);
+  mg_two_diff(b[0], c[0], bcx);
+  mg_two_diff(b[1], c[1], bcy);
+  len = mg_cross_expansion(acx, acy, bcx, bcy, det);
+  
+  return mg_expansion_estimate(len, det);
+}
+
+/******************************************************************/
+/* function:  mg_orient2d */
+double mg_orient2d(const double a[2], const double b[2], const double c[2])
+{
+  double detl, detr, det;
+  
+  detl = (a[0]-c[0])*(b[1]-c[1]);
+  detr = (a[1]-c[1])*(b[0]-c[0]);
+  det = detl-detr;
+  if (fabs(det) >= ORIENTERRBOUND*(fabs(detl)+fabs(detr)))
+    return det;
+  //expansions of non-finite values never shrink, nothing to resolve
+  if (!isfinite(det)) return det;
+  
+  return mg_orient2d_exact(a, b, c);
+}
+
+/******************************************************************/
+/* function:  mg_incircle_exact */
+static double mg_incircle_exact(const double a[2], const double b[2],
+                                const double c[2], const double d[2])
+{
+  int i, len, lift[3], cross[3], term[3];
+  double dx[3][2], dy[3][2], sq[2][8], L[3][16], C[3][16];
+  double T[3][512], det[1536], t[32];
+  const double *p[3] = {a, b, c};
+  
+  for (i = 0; i < 3; i++) {
+    mg_two_diff(p[i][0], d[0], dx[i]);
+    mg_two_diff(p[i][1], d[1], dy[i]);
+  }
+  for (i = 0; i < 3; i++) {
+    //lifted coordinate dx^2+dy^2
+    len = mg_expansion_product(2, dx[i], 2, dx[i], sq[0], t);
+    lift[i] = mg_expansion_product(2, dy[i], 2, dy[i], sq[1], t);
+    lift[i] = mg_expansion_sum(len, sq[0], lift[i], sq[1], L[i]);
+    //orientation of the two other points with respect to d
+    cross[i] = mg_cross_expansion(dx[(i+1)%3], dy[(i+1)%3],
+                                  dx[(i+2)%3], dy[(i+2)%3], C[i]);
+  }
+  for (i = 0; i < 3; i++)
+    term[i] = mg_expansion_product(lift[i], L[i], cross[i], C[i], T[i], t);
+  len = mg_expansion_sum(term[0], T[0], term[1], T[1], det);
+  len = mg_expansion_sum(len, det, term[2], T[2], det);
+  
+  return mg_expansion_estimate(len, det);
+}
+
+/******************************************************************/
+/* function:  mg_incircle_filter */
+/* floating-point incircle determinant and its error bound */
+static double mg_incircle_filter(const double a[2], const double b[2],
+                                 const double c[2], const double d[2],
+                                 double *errbound)
+{
+  double adx, ady, bdx, bdy, cdx, cdy, alift, blift, clift;
+  double bcl, bcr, cal, car, abl, abr, perm;
+  
+  adx = a[0]-d[0];
+  ady = a[1]-d[1];
+  bdx = b[0]-d[0];
+  bdy = b[1]-d[1];
+  cdx = c[0]-d[0];
+  cdy = c[1]-d[1];
+  alift = adx*adx+ady*ady;
+  blift = bdx*bdx+bdy*bdy;
+  clift = cdx*cdx+cdy*cdy;
+  bcl = bdx*cdy;
+  bcr = cdx*bdy;
+  cal = cdx*ady;
+  car = adx*cdy;
+  abl = adx*bdy;
+  abr = bdx*ady;
+  perm = (fabs(bcl)+fabs(bcr))*alift+(fabs(cal)+fabs(car))*blift+
+         (fabs(abl)+fabs(abr))*clift;
+  (*errbound) = INCIRCERRBOUND*perm;
+  
+  return alift*(bcl-bcr)+blift*(cal-car)+clift*(abl-abr);
+}
+
+/******************************************************************/
+/* function:  mg_incircle */
+double mg_incircle(const double a[2], const double b[2], const double c[2],
+                   const double d[2])
+{
+  double det, errbound;
+  
+  det = mg_incircle_filter(a, b, c, d, &errbound);
+  if (fabs(det) > errbound || !isfinite(errbound)) return det;
+  
+  return mg_incircle_exact(a, b, c, d);
+}
+
+/******************************************************************/
+/* function:  mg_inellipse_exact */
+/* rho0^2*rho1^2-rho1^2*u^2-rho0^2*v^2 with (u,v) = Vinv*(p-Ot) */
+static double mg_inellipse_exact(mg_Ellipse *Ellipse, const double p[2])
+{
+  int ulen, vlen, len, r0len, r1len, rlen, lenu, lenv, lenr;
+  double dx[2], dy[2], s0[4], s1[4], u[8], v[8], r[8];
+  double r0[2] = {0.0, 0.0}, r1[2] = {0.0, 0.0};
+  double u2[128], v2[128], U[512], V[512], R[8], det[1032], t[256];
+  const double *Vinv = Ellipse->Vinv;
+  
+  mg_two_diff(p[0], Ellipse->Ot[0], dx);
+  mg_two_diff(p[1], Ellipse->Ot[1], dy);
+  len = mg_scale_expansion(2, dx, Vinv[0], s0);
+  ulen = mg_scale_expansion(2, dy, Vinv[1], s1);
+  ulen = mg_expansion_sum(len, s0, ulen, s1, u);
+  len = mg_scale_expansion(2, dx, Vinv[2], s0);
+  vlen = mg_scale_expansion(2, dy, Vinv[3], s1);
+  vlen = mg_expansion_sum(len, s0, vlen, s1, v);
+  r0len = mg_scale_expansion(1, Ellipse->rho, Ellipse->rho[0], r0);
+  r1len = mg_scale_expansion(1, Ellipse->rho+1, Ellipse->rho[1], r1);
+  rlen = mg_expansion_product(r0len, r0, r1len, r1, r, t);
+  len = mg_expansion_product(ulen, u, ulen, u, u2, t);
+  lenu = mg_expansion_product(len, u2, r1len, r1, U, t);
+  len = mg_expansion_product(vlen, v, vlen, v, v2, t);
+  lenv = mg_expansion_product(len, v2, r0len, r0, V, t);
+  mg_negate_expansion(lenu, U);
+  mg_negate_expansion(lenv, V);
+  memcpy(R, r, rlen*sizeof(double));
+  lenr = mg_expansion_sum(rlen, R, lenu, U, det);
+  lenr = mg_expansion_sum(lenr, det, lenv, V, det);
+  
+  return mg_expansion_estimate(lenr, det);
+}
+
+/******************************************************************/
+/* function:  mg_inellipse */
+double mg_inellipse(mg_Ellipse *Ellipse, const double p[2])
+{
+  const double *Vinv = Ellipse->Vinv;
+  double dx, dy, u, v, r0, r1, perm, det;
+  
+  dx = p[0]-Ellipse->Ot[0];
+  dy = p[1]-Ellipse->Ot[1];
+  u = Vinv[0]*dx+Vinv[1]*dy;
+  v = Vinv[2]*dx+Vinv[3]*dy;
+  r0 = Ellipse->rho[0]*Ellipse->rho[0];
+  r1 = Ellipse->rho[1]*Ellipse->rho[1];
+  det = r0*r1-r1*u*u-r0*v*v;
+  u = fabs(Vinv[0]*dx)+fabs(Vinv[1]*dy);
+  v = fabs(Vinv[2]*dx)+fabs(Vinv[3]*dy);
+  perm = r0*r1+r1*u*u+r0*v*v;
+  if (fabs(det) > INELLERRBOUND*perm || !isfinite(perm)) return det;
+  
+  return mg_inellipse_exact(Ellipse, p);
+}
+
+/******************************************************************/
+/* function:  mg_orient2d_list */
+void mg_orient2d_list(const double a[2], const double b[2],
+                      const double *Coord, int n, const int *node,
+                      double *o)
+{
+  int i, i0, m, k;
+  double X[2*PREDBATCH], err[PREDBATCH], detl, detr;
+  double const ax = a[0], ay = a[1], bx = b[0], by = b[1];
+  
+  for (i0 = 0; i0 < n; i0 += PREDBATCH) {
+    m = min(PREDBATCH, n-i0);
+    for (i = 0; i < m; i++) {
+      k = (node == NULL) ? i0+i : node[i0+i];
+      X[2*i]   = Coord[2*k];
+      X[2*i+1] = Coord[2*k+1];
+    }
+    //filtered determinants of the whole chunk
+#pragma omp simd private(detl, detr)
+    for (i = 0; i < m; i++) {
+      detl = (ax-X[2*i])*(by-X[2*i+1]);
+      detr = (ay-X[2*i+1])*(bx-X[2*i]);
+      o[i0+i] = detl-detr;
+      err[i] = ORIENTERRBOUND*(fabs(detl)+fabs(detr));
+    }
+    for (i = 0; i < m; i++)
+      if (!(fabs(o[i0+i]) >= err[i]))
+        o[i0+i] = mg_orient2d_exact(a, b, X+2*i);
+  }
+}
+
+/******************************************************************/
+/* function:  mg_incircle_list */
+void mg_incircle_list(const double a[2], const double b[2],
+                      const double c[2], const double *Coord, int n,
+                      const int *node, double *o)
+{
+  int i, i0, m, k;
+  double X[2*PREDBATCH], err[PREDBATCH];
+  
+  for (i0 = 0; i0 < n; i0 += PREDBATCH) {
+    m = min(PREDBATCH, n-i0);
+    for (i = 0; i < m; i++) {
+      k = (node == NULL) ? i0+i : node[i0+i];
+      X[2*i]   = Coord[2*k];
+      X[2*i+1] = Coord[2*k+1];
+    }
+    for (i = 0; i < m; i++)
+      o[i0+i] = mg_incircle_filter(a, b, c, X+2*i, err+i);
+    for (i = 0; i < m; i++)
+      if (!(fabs(o[i0+i]) > err[i]))
+        o[i0+i] = mg_incircle_exact(a, b, c, X+2*i);
+  }
+}
+
+/******************************************************************/
+/* function:  mg_segs_intersect_exact */
+/* exact test of segment a0-a1 against b0-b1 */
+static bool mg_segs_intersect_exact(const double a0[2], const double a1[2],
+                                    const double b0[2], const double b1[2])
+{
+  double o0, o1, o2, o3;
+  
+  o0 = mg_orient2d(a0, a1, b0);
+  o1 = mg_orient2d(a0, a1, b1);
+  if ((o0 > 0.0 && o1 > 0.0) || (o0 < 0.0 && o1 < 0.0)) return false;
+  o2 = mg_orient2d(b0, b1, a0);
+  o3 = mg_orient2d(b0, b1, a1);
+  if ((o2 > 0.0 && o3 > 0.0) || (o2 < 0.0 && o3 < 0.0)) return false;
+  
+  return true;
+}
+
+/******************************************************************/
+/* function:  mg_segs_intersect_list */
+int mg_segs_intersect_list(const double Q[4], int n, const double *x0,
+                           const double *y0, const double *x1,
+                           const double *y1, unsigned char *hit)
+{
+  int i, i0, m, nhit = 0;
+  unsigned char unsure[PREDBATCH];
+  double const qx0 = Q[0], qy0 = Q[1], qx1 = Q[2], qy1 = Q[3];
+  double const qxmin = min(qx0, qx1), qxmax = max(qx0, qx1);
+  double const qymin = min(qy0, qy1), qymax = max(qy0, qy1);
+  double a0[2], a1[2];
+  
+  for (i0 = 0; i0 < n; i0 += PREDBATCH) {
+    m = min(PREDBATCH, n-i0);
+#pragma omp simd
+    for (i = 0; i < m; i++) {
+      double sx0 = x0[i0+i], sy0 = y0[i0+i], sx1 = x1[i0+i], sy1 = y1[i0+i];
+      double l0, r0, l1, r1, l2, r2, l3, r3, o0, o1, o2, o3;
+      int box, sure, apart;
+      //bounding boxes overlap
+      box = !(max(sx0, sx1) < qxmin || qxmax < min(sx0, sx1) ||
+              max(sy0, sy1) < qymin || qymax < min(sy0, sy1));
+      //query end points w.r.t. the segment and vice versa
+      l0 = (sx0-qx0)*(sy1-qy0);
+      r0 = (sy0-qy0)*(sx1-qx0);
+      l1 = (sx0-qx1)*(sy1-qy1);
+      r1 = (sy0-qy1)*(sx1-qx1);
+      l2 = (qx0-sx0)*(qy1-sy0);
+      r2 = (qy0-sy0)*(qx1-sx0);
+      l3 = (qx0-sx1)*(qy1-sy1);
+      r3 = (qy0-sy1)*(qx1-sx1);
+      o0 = l0-r0;
+      o1 = l1-r1;
+      o2 = l2-r2;
+      o3 = l3-r3;
+      sure = (fabs(o0) >= ORIENTERRBOUND*(fabs(l0)+fabs(r0))) &
+             (fabs(o1) >= ORIENTERRBOUND*(fabs(l1)+fabs(r1))) &
+             (fabs(o2) >= ORIENTERRBOUND*(fabs(l2)+fabs(r2))) &
+             (fabs(o3) >= ORIENTERRBOUND*(fabs(l3)+fabs(r3)));
+      apart = (o0 > 0.0 && o1 > 0.0) | (o0 < 0.0 && o1 < 0.0) |
+              (o2 > 0.0 && o3 > 0.0) | (o2 < 0.0 && o3 < 0.0);
+      hit[i0+i] = (unsigned char)(box & sure & !apart);
+      unsure[i] = (unsigned char)(box & !sure);
+    }
+    for (i = 0; i < m; i++) {
+      if (unsure[i]) {
+        a0[0] = x0[i0+i];
+        a0[1] = y0[i0+i];
+        a1[0] = x1[i0+i];
+        a1[1] = y1[i0+i];
+        hit[i0+i] = (unsigned char)mg_segs_intersect_exact(a0, a1, Q, Q+2);
+      }
+      nhit += hit[i0+i];
+    }
+  }
+  
+  return nhit;
+}
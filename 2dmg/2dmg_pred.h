@@ -0,0 +1,77 @@
+//
+//  2dmg_pred.h
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#ifndef ___dmg___dmg_pred__
+#define ___dmg___dmg_pred__
+
+#include <stdio.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+
+/******************************************************************/
+/* robust geometric predicates. Each predicate first evaluates the
+ determinant in floating point together with a bound on its rounding
+ error; only if the sign is not certain it is recomputed exactly with
+ floating-point expansions. The returned values have the sign of the
+ exact determinant, their magnitude is approximate. Requires IEEE
+ double arithmetic with round-to-nearest (no -ffast-math, no x87) */
+
+//points classified per filtered pass of the list predicates, also a
+//convenient size for callers' stack buffers
+#define PREDBATCH         64
+
+/******************************************************************/
+/* function:  mg_orient2d */
+/* positive if a, b, c are counter-clockwise, negative if clockwise
+ and zero if colinear. Equals twice the signed area of (a,b,c) */
+double mg_orient2d(const double a[2], const double b[2], const double c[2]);
+
+/******************************************************************/
+/* function:  mg_incircle */
+/* positive if d is inside the circle through a, b, c (given
+ counter-clockwise), negative if outside and zero if on it */
+double mg_incircle(const double a[2], const double b[2], const double c[2],
+                   const double d[2]);
+
+/******************************************************************/
+/* function:  mg_inellipse */
+/* positive if p is inside Ellipse, negative if outside and zero if on
+ it. Exact for the ellipse parameters as stored */
+double mg_inellipse(mg_Ellipse *Ellipse, const double p[2]);
+
+/******************************************************************/
+/* function:  mg_orient2d_list */
+/* mg_orient2d(a, b, X) for n points X taken from the interleaved
+ coordinates Coord: point i is node[i] or i if node == NULL. The
+ filtered pass is a single vectorizable loop, uncertain points are
+ then recomputed exactly */
+void mg_orient2d_list(const double a[2], const double b[2],
+                      const double *Coord, int n, const int *node,
+                      double *o);
+
+/******************************************************************/
+/* function:  mg_incircle_list */
+/* mg_incircle(a, b, c, X) for n points, same conventions as
+ mg_orient2d_list */
+void mg_incircle_list(const double a[2], const double b[2],
+                      const double c[2], const double *Coord, int n,
+                      const int *node, double *o);
+
+/******************************************************************/
+/* function:  mg_segs_intersect_list */
+/* tests the segment Q (x0,y0,x1,y1) against the n segments
+ (x0[i],y0[i])-(x1[i],y1[i]) given as separate arrays. hit[i] is set
+ to 1 if they intersect with the semantics of mg_edges_intersect
+ (touching and colinear overlapping segments included), 0 otherwise.
+ Bounding boxes and filtered orientations are evaluated for a whole
+ batch in one vectorizable loop, segments whose orientations are
+ uncertain are tested again exactly. Returns the number of hits */
+int mg_segs_intersect_list(const double Q[4], int n, const double *x0,
+                           const double *y0, const double *x1,
+                           const double *y1, unsigned char *hit);
+
+#endif
@@ -0,0 +1,451 @@
+//
+//  2dmg_proj.c
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#include <float.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_utils.h"
+#include "2dmg_math.h"
+#include "2dmg_spline.h"
+#include "2dmg_geo.h"
+#include "2dmg_facegeom.h"
+#include "2dmg_proj.h"
+
+/******************************************************************/
+/* function:  mg_create_proj_index */
+/* builds a spatial index over sample chunks of all segments of Geo */
+int mg_create_proj_index(mg_Geometry *Geo, mg_ProjIndex **pIndex)
+{
+  int ierr, iseg, ic, k, c, i, j, i0, i1, j0, j1, nc, ns = PROJNSAMPLE;
+  int *nChunkSeg;
+  mg_ProjIndex *Index;
+  mg_Segment *Seg;
+  double tb[2], *Xs, *Xm, *tm, l0, l1, sag, ax, ay, bx, by, u, len2, dx, dy;
+  double bbox[4], xg[2];
+
+  call(mg_alloc((void**)&Index, 1, sizeof(mg_ProjIndex)));
+  call(mg_alloc((void**)&nChunkSeg, Geo->nBoundary, sizeof(int)));
+  Index->nSample = ns;
+  Index->nChunk = 0;
+  for (iseg = 0; iseg < Geo->nBoundary; iseg++) {
+    Seg = Geo->Boundary[iseg];
+    if (Seg->Spline == NULL || Seg->Table == NULL)
+      return error(err_INPUT_ERROR);
+    nChunkSeg[iseg] = max(PROJCHUNKMIN, PROJCHUNKPERINT*Seg->Spline->nInt);
+    Index->nChunk += nChunkSeg[iseg];
+  }
+  nc = Index->nChunk;
+  call(mg_alloc((void**)&Index->Seg, nc, sizeof(int)));
+  call(mg_alloc((void**)&Index->t, nc*ns, sizeof(double)));
+  call(mg_alloc((void**)&Index->X, 2*nc*ns, sizeof(double)));
+  call(mg_alloc((void**)&Index->Box, 4*nc, sizeof(double)));
+  call(mg_alloc((void**)&Index->Sag, nc, sizeof(double)));
+  call(mg_alloc((void**)&Xs, 6*ns, sizeof(double)));
+  Xm = Xs+2*ns;
+  tm = Xs+4*ns;
+
+  bbox[0] = bbox[2] = DBL_MAX;
+  bbox[1] = bbox[3] = -DBL_MAX;
+  c = 0;
+  for (iseg = 0; iseg < Geo->nBoundary; iseg++) {
+    Seg = Geo->Boundary[iseg];
+    for (ic = 0; ic < nChunkSeg[iseg]; ic++, c++) {
+      Index->Seg[c] = iseg;
+      //chunks of equal arc length
+      l0 = Seg->Length*ic/nChunkSeg[iseg];
+      l1 = Seg->Length*(ic+1)/nChunkSeg[iseg];
+      call(mg_seg_table_param(Seg, false, l0, tb+0));
+      call(mg_seg_table_param(Seg, false, l1, tb+1));
+      if (ic == 0) tb[0] = Seg->s[0];
+      if (ic == nChunkSeg[iseg]-1) tb[1] = Seg->s[Seg->nPoint-1];
+      for (k = 0; k < ns; k++) {
+        Index->t[c*ns+k] = tb[0]+(tb[1]-tb[0])*k/(ns-1);
+        if (k < ns-1)
+          tm[k] = tb[0]+(tb[1]-tb[0])*(k+0.5)/(ns-1);
+      }
+      Index->t[c*ns+ns-1] = tb[1];
+      mg_spline_eval(Seg->Spline, ns, Index->t+c*ns, Xs, NULL, NULL);
+      //samples are stored interleaved
+      for (k = 0; k < ns; k++) {
+        Index->X[2*(c*ns+k)+0] = Xs[k];
+        Index->X[2*(c*ns+k)+1] = Xs[ns+k];
+      }
+      //sag: distance of the curve at mid-parameters to the polyline
+      mg_spline_eval(Seg->Spline, ns-1, tm, Xm, NULL, NULL);
+      sag = 0.0;
+      for (k = 0; k < ns-1; k++) {
+        ax = Index->X[2*(c*ns+k)+0];
+        ay = Index->X[2*(c*ns+k)+1];
+        bx = Index->X[2*(c*ns+k+1)+0]-ax;
+        by = Index->X[2*(c*ns+k+1)+1]-ay;
+        dx = Xm[k]-ax;
+        dy = Xm[ns-1+k]-ay;
+        len2 = bx*bx+by*by;
+        u = (len2 > 0.0) ? (dx*bx+dy*by)/len2 : 0.0;
+        u = max(0.0, min(1.0, u));
+        dx -= u*bx;
+        dy -= u*by;
+        sag = max(sag, sqrt(dx*dx+dy*dy));
+      }
+      //the maximum deviation of a cubic is not at the mid-parameter
+      Index->Sag[c] = 1.5*sag+1e-12*Seg->Length;
+      Index->Box[4*c+0] = Index->Box[4*c+2] = DBL_MAX;
+      Index->Box[4*c+1] = Index->Box[4*c+3] = -DBL_MAX;
+      for (k = 0; k < ns; k++) {
+        Index->Box[4*c+0] = min(Index->Box[4*c+0], Index->X[2*(c*ns+k)+0]);
+        Index->Box[4*c+1] = max(Index->Box[4*c+1], Index->X[2*(c*ns+k)+0]);
+        Index->Box[4*c+2] = min(Index->Box[4*c+2], Index->X[2*(c*ns+k)+1]);
+        Index->Box[4*c+3] = max(Index->Box[4*c+3], Index->X[2*(c*ns+k)+1]);
+      }
+      Index->Box[4*c+0] -= Index->Sag[c];
+      Index->Box[4*c+1] += Index->Sag[c];
+      Index->Box[4*c+2] -= Index->Sag[c];
+      Index->Box[4*c+3] += Index->Sag[c];
+      bbox[0] = min(bbox[0], Index->Box[4*c+0]);
+      bbox[1] = max(bbox[1], Index->Box[4*c+1]);
+      bbox[2] = min(bbox[2], Index->Box[4*c+2]);
+      bbox[3] = max(bbox[3], Index->Box[4*c+3]);
+    }
+  }
+  mg_free((void*)Xs);
+  mg_free((void*)nChunkSeg);
+
+  //uniform grid with roughly one chunk per cell
+  xg[0] = max(bbox[1]-bbox[0], MEPS);
+  xg[1] = max(bbox[3]-bbox[2], MEPS);
+  Index->nx = max(1, (int)ceil(sqrt(nc*xg[0]/xg[1])));
+  Index->ny = max(1, (int)ceil((double)nc/Index->nx));
+  Index->Origin[0] = bbox[0];
+  Index->Origin[1] = bbox[2];
+  Index->h[0] = xg[0]/Index->nx;
+  Index->h[1] = xg[1]/Index->ny;
+  //count and fill cells (CSR)
+  call(mg_alloc((void**)&Index->CellPtr, Index->nx*Index->ny+1,
+                sizeof(int)));
+  for (k = 0; k <= Index->nx*Index->ny; k++) Index->CellPtr[k] = 0;
+  for (i = 0; i < 2; i++) {
+    for (c = 0; c < nc; c++) {
+      i0 = (int)floor((Index->Box[4*c+0]-Index->Origin[0])/Index->h[0]);
+      i1 = (int)floor((Index->Box[4*c+1]-Index->Origin[0])/Index->h[0]);
+      j0 = (int)floor((Index->Box[4*c+2]-Index->Origin[1])/Index->h[1]);
+      j1 = (int)floor((Index->Box[4*c+3]-Index->Origin[1])/Index->h[1]);
+      i0 = max(0, min(i0, Index->nx-1));
+      i1 = max(0, min(i1, Index->nx-1));
+      j0 = max(0, min(j0, Index->ny-1));
+      j1 = max(0, min(j1, Index->ny-1));
+      for (j = j0; j <= j1; j++)
+        for (k = i0; k <= i1; k++) {
+          if (i == 0)
+            Index->CellPtr[j*Index->nx+k+1]++;
+          else
+            Index->CellChunk[Index->CellPtr[j*Index->nx+k]++] = c;
+        }
+    }
+    if (i == 0) {
+      for (k = 0; k < Index->nx*Index->ny; k++)
+        Index->CellPtr[k+1] += Index->CellPtr[k];
+      call(mg_alloc((void**)&Index->CellChunk,
+                    max(1, Index->CellPtr[Index->nx*Index->ny]), sizeof(int)));
+    }
+  }
+  //fill pass advanced CellPtr by one cell: shift back
+  for (k = Index->nx*Index->ny; k > 0; k--)
+    Index->CellPtr[k] = Index->CellPtr[k-1];
+  Index->CellPtr[0] = 0;
+
+  (*pIndex) = Index;
+
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_destroy_proj_index */
+/* frees a mg_ProjIndex structure */
+void mg_destroy_proj_index(mg_ProjIndex *Index)
+{
+  if (Index == NULL) return;
+  mg_free((void*)Index->Seg);
+  mg_free((void*)Index->t);
+  mg_free((void*)Index->X);
+  mg_free((void*)Index->Box);
+  mg_free((void*)Index->Sag);
+  mg_free((void*)Index->CellPtr);
+  mg_free((void*)Index->CellChunk);
+  mg_free((void*)Index);
+}
+
+/******************************************************************/
+/* function:  mg_proj_chunk */
+/* closest point of the sample polyline of chunk c to x: returns the
+ distance and the corresponding parametric coordinate */
+static double mg_proj_chunk(mg_ProjIndex *Index, int c, const double x[2],
+                            double *t)
+{
+  int k, ns = Index->nSample;
+  double const *X = Index->X+2*c*ns, *tc = Index->t+c*ns;
+  double ax, ay, bx, by, dx, dy, u, len2, d2, best = DBL_MAX;
+
+  for (k = 0; k < ns-1; k++) {
+    ax = X[2*k+0];
+    ay = X[2*k+1];
+    bx = X[2*k+2]-ax;
+    by = X[2*k+3]-ay;
+    dx = x[0]-ax;
+    dy = x[1]-ay;
+    len2 = bx*bx+by*by;
+    u = (len2 > 0.0) ? (dx*bx+dy*by)/len2 : 0.0;
+    u = max(0.0, min(1.0, u));
+    dx -= u*bx;
+    dy -= u*by;
+    d2 = dx*dx+dy*dy;
+    if (d2 < best) {
+      best = d2;
+      (*t) = tc[k]+u*(tc[k+1]-tc[k]);
+    }
+  }
+  return sqrt(best);
+}
+
+/******************************************************************/
+/* function:  mg_proj_newton */
+/* Newton refinement of the closest point on segment Seg starting from
+ t. Returns the distance, updates t and xp */
+static double mg_proj_newton(mg_Segment *Seg, const double x[2],
+                             double *t, double xp[2])
+{
+  int it;
+  double X[2], dX[2], d2X[2], rx, ry, f, fp, dt, tt = (*t);
+  double const t0 = Seg->s[0], t1 = Seg->s[Seg->nPoint-1];
+
+  for (it = 0; it < PROJNEWTONIT; it++) {
+    mg_spline_eval(Seg->Spline, 1, &tt, X, dX, d2X);
+    rx = X[0]-x[0];
+    ry = X[1]-x[1];
+    f  = rx*dX[0]+ry*dX[1];
+    fp = dX[0]*dX[0]+dX[1]*dX[1]+rx*d2X[0]+ry*d2X[1];
+    //fall back to Gauss-Newton away from the minimum
+    if (fp <= 0.0)
+      fp = dX[0]*dX[0]+dX[1]*dX[1];
+    if (fp <= 0.0) break;
+    dt = -f/fp;
+    dt = max(t0-tt, min(t1-tt, dt));
+    tt += dt;
+    if (fabs(dt) <= 1e-15*(t1-t0)) break;
+  }
+  mg_spline_eval(Seg->Spline, 1, &tt, X, NULL, NULL);
+  (*t) = tt;
+  xp[0] = X[0];
+  xp[1] = X[1];
+
+  return sqrt((X[0]-x[0])*(X[0]-x[0])+(X[1]-x[1])*(X[1]-x[1]));
+}
+
+/******************************************************************/
+/* function:  mg_proj_query */
+/* single closest point query (see mg_project_point) */
+static void mg_proj_query(mg_Geometry *Geo, mg_ProjIndex *Index,
+                          const double x[2], int iseg_only, int *iseg,
+                          double *t, double xp[2], double *dist)
+{
+  int r, ci, cj, i, j, k, c, ic[2] = {-1, -1}, rmax;
+  double bd, dp, tp = 0.0, bestd[2] = {DBL_MAX, DBL_MAX}, bestt[2], lb;
+  double xlo, xhi, ylo, yhi, d, tt, xx[2], dbest = DBL_MAX;
+  double const *B;
+
+  ci = (int)floor((x[0]-Index->Origin[0])/Index->h[0]);
+  cj = (int)floor((x[1]-Index->Origin[1])/Index->h[1]);
+  ci = max(0, min(ci, Index->nx-1));
+  cj = max(0, min(cj, Index->ny-1));
+  rmax = max(Index->nx, Index->ny);
+
+  for (r = 0; r <= rmax; r++) {
+    if (r > 0) {
+      //box of the cells visited so far
+      if (ci-r+1 <= 0 && ci+r-1 >= Index->nx-1 &&
+          cj-r+1 <= 0 && cj+r-1 >= Index->ny-1)
+        break;
+      xlo = Index->Origin[0]+(ci-r+1)*Index->h[0];
+      xhi = Index->Origin[0]+(ci+r)*Index->h[0];
+      ylo = Index->Origin[1]+(cj-r+1)*Index->h[1];
+      yhi = Index->Origin[1]+(cj+r)*Index->h[1];
+      lb = 0.0;
+      if (x[0] > xlo && x[0] < xhi && x[1] > ylo && x[1] < yhi)
+        lb = min(min(x[0]-xlo, xhi-x[0]), min(x[1]-ylo, yhi-x[1]));
+      if (ic[0] >= 0 && lb >= bestd[0]+Index->Sag[ic[0]])
+        break;
+    }
+    for (j = cj-r; j <= cj+r; j++) {
+      if (j < 0 || j >= Index->ny) continue;
+      for (i = ci-r; i <= ci+r; i++) {
+        if (i < 0 || i >= Index->nx) continue;
+        //ring cells only
+        if (r > 0 && j != cj-r && j != cj+r && i != ci-r && i != ci+r)
+          continue;
+        for (k = Index->CellPtr[j*Index->nx+i];
+             k < Index->CellPtr[j*Index->nx+i+1]; k++) {
+          c = Index->CellChunk[k];
+          if (iseg_only >= 0 && Index->Seg[c] != iseg_only) continue;
+          if (c == ic[0] || c == ic[1]) continue;
+          B = Index->Box+4*c;
+          xx[0] = max(0.0, max(B[0]-x[0], x[0]-B[1]));
+          xx[1] = max(0.0, max(B[2]-x[1], x[1]-B[3]));
+          bd = sqrt(xx[0]*xx[0]+xx[1]*xx[1]);
+          if (bd > bestd[1]) continue;
+          dp = mg_proj_chunk(Index, c, x, &tp);
+          //keep the two closest chunks
+          if (dp < bestd[0]) {
+            bestd[1] = bestd[0];
+            bestt[1] = bestt[0];
+            ic[1] = ic[0];
+            bestd[0] = dp;
+            bestt[0] = tp;
+            ic[0] = c;
+          }
+          else if (dp < bestd[1]) {
+            bestd[1] = dp;
+            bestt[1] = tp;
+            ic[1] = c;
+          }
+        }
+      }
+    }
+  }
+
+  //refine candidates on the spline
+  for (k = 0; k < 2; k++) {
+    if (ic[k] < 0) continue;
+    if (k == 1 && bestd[1] > bestd[0]+Index->Sag[ic[0]]+Index->Sag[ic[1]])
+      continue;
+    tt = bestt[k];
+    d = mg_proj_newton(Geo->Boundary[Index->Seg[ic[k]]], x, &tt, xx);
+    if (d < dbest) {
+      dbest = d;
+      if (iseg != NULL) (*iseg) = Index->Seg[ic[k]];
+      if (t != NULL) (*t) = tt;
+      if (xp != NULL) {
+        xp[0] = xx[0];
+        xp[1] = xx[1];
+      }
+    }
+  }
+  if (dist != NULL) (*dist) = dbest;
+  if (ic[0] < 0 && iseg != NULL) (*iseg) = -1;
+}
+
+/******************************************************************/
+/* function:  mg_project_point */
+/* closest point on the geometry boundary to x. If iseg_only >= 0 the
+ search is restricted to that segment. Returns segment (iseg),
+ parametric coordinate (t), projected point (xp) and distance (dist).
+ Any output may be NULL */
+int mg_project_point(mg_Geometry *Geo, mg_ProjIndex *Index,
+                     const double x[2], int iseg_only, int *iseg,
+                     double *t, double xp[2], double *dist)
+{
+  int is;
+
+  if (iseg_only >= Geo->nBoundary) return error(err_OUT_OF_BOUNDS);
+  mg_proj_query(Geo, Index, x, iseg_only, &is, t, xp, dist);
+  if (iseg != NULL) (*iseg) = is;
+  if (is < 0) return error(err_NOT_FOUND);
+
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_project_points */
+/* batch version of mg_project_point for n interleaved coordinates X.
+ Seg may be NULL (any segment) or hold one segment per point.
+ Outputs are per point (xp interleaved); any output may be NULL */
+int mg_project_points(mg_Geometry *Geo, mg_ProjIndex *Index, int n,
+                      const double *X, const int *Seg, int *iseg,
+                      double *t, double *Xp, double *dist)
+{
+  int i, is, nfail = 0;
+
+#pragma omp parallel for schedule(dynamic, 1024) private(is) reduction(+:nfail)
+  for (i = 0; i < n; i++) {
+    mg_proj_query(Geo, Index, X+2*i, (Seg != NULL) ? Seg[i] : -1, &is,
+                  (t != NULL) ? t+i : NULL, (Xp != NULL) ? Xp+2*i : NULL,
+                  (dist != NULL) ? dist+i : NULL);
+    if (iseg != NULL) iseg[i] = is;
+    if (is < 0) nfail++;
+  }
+  if (nfail > 0) return error(err_NOT_FOUND);
+
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_snap_boundary_nodes */
+/* projects every node of a boundary face of Mesh onto the segment of
+ its boundary group (boundary groups are geometry segments) */
+int mg_snap_boundary_nodes(mg_Geometry *Geo, mg_ProjIndex *Index,
+                           mg_Mesh *Mesh)
+{
+  int ierr, f, in, n, node, k, ibfg, nface, nsnap, *group, *list;
+  mg_FaceData *Face;
+  double *X, *Xp;
+
+  if (Geo->nBoundary != Mesh->nBfg || Mesh->Dim != 2)
+    return error(err_INCOMPATIBLE);
+  nface = Mesh->nFace+Mesh->Stack->Face->nItem;
+  //boundary group of each node (-2 if on more than one group)
+  call(mg_alloc((void**)&group, Mesh->nNode+Mesh->Stack->Node->nItem,
+                sizeof(int)));
+  for (n = 0; n < Mesh->nNode+Mesh->Stack->Node->nItem; n++)
+    group[n] = -1;
+  for (f = 0; f < nface; f++) {
+    Face = Mesh->Face[f];
+    if (Face->elem[RIGHTNEIGHINDEX] >= 0 ||
+        Face->elem[RIGHTNEIGHINDEX] == HOLLOWNEIGHTAG)
+      continue;
+    if (mg_is_stacked(Mesh->Stack->Face, f)) continue;
+    call(mg_limited_pair_inv(&k, &ibfg, -Face->elem[RIGHTNEIGHINDEX]-1,
+                             Mesh->nBfg));
+    for (in = 0; in < Face->nNode; in++) {
+      node = Face->node[in];
+      if (group[node] == -1)
+        group[node] = ibfg;
+      else if (group[node] != ibfg)
+        group[node] = -2;//corner: keep as is
+    }
+  }
+  nsnap = 0;
+  for (n = 0; n < Mesh->nNode+Mesh->Stack->Node->nItem; n++)
+    if (group[n] >= 0) nsnap++;
+  call(mg_alloc((void**)&list, 2*nsnap+1, sizeof(int)));
+  call(mg_alloc((void**)&X, 4*nsnap+1, sizeof(double)));
+  Xp = X+2*nsnap;
+  k = 0;
+  for (n = 0; n < Mesh->nNode+Mesh->Stack->Node->nItem; n++)
+    if (group[n] >= 0) {
+      list[k] = n;
+      list[nsnap+k] = group[n];
+      X[2*k+0] = Mesh->Coord[2*n+0];
+      X[2*k+1] = Mesh->Coord[2*n+1];
+      k++;
+    }
+  call(mg_project_points(Geo, Index, nsnap, X, list+nsnap, NULL, NULL,
+                         Xp, NULL));
+  for (k = 0; k < nsnap; k++) {
+    Mesh->Coord[2*list[k]+0] = Xp[2*k+0];
+    Mesh->Coord[2*list[k]+1] = Xp[2*k+1];
+  }
+  //face geometry of boundary faces is now stale
+  for (f = 0; f < nface; f++) {
+    Face = Mesh->Face[f];
+    if (Face->normal == NULL) continue;
+    if (group[Face->node[0]] >= 0 || group[Face->node[1]] >= 0)
+      call(mg_face_geom_touch(Mesh, f));
+  }
+  mg_free((void*)X);
+  mg_free((void*)list);
+  mg_free((void*)group);
+
+  return err_OK;
+}
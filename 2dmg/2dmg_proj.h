@@ -0,0 +1,58 @@
+//
+//  2dmg_proj.h
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#ifndef ___dmg___dmg_proj__
+#define ___dmg___dmg_proj__
+
+#include <stdio.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+
+/******************************************************************/
+/* projection index resolution */
+#define PROJCHUNKPERINT   2 //chunks per spline interval
+#define PROJCHUNKMIN      8 //minimum number of chunks per segment
+#define PROJNSAMPLE       9 //samples per chunk (including both ends)
+#define PROJNEWTONIT      12 //maximum Newton iterations
+
+/******************************************************************/
+/* function:  mg_create_proj_index */
+/* builds a spatial index over sample chunks of all segments of Geo */
+int mg_create_proj_index(mg_Geometry *Geo, mg_ProjIndex **pIndex);
+
+/******************************************************************/
+/* function:  mg_destroy_proj_index */
+/* frees a mg_ProjIndex structure */
+void mg_destroy_proj_index(mg_ProjIndex *Index);
+
+/******************************************************************/
+/* function:  mg_project_point */
+/* closest point on the geometry boundary to x. If iseg_only >= 0 the
+ search is restricted to that segment. Returns segment (iseg),
+ parametric coordinate (t), projected point (xp) and distance (dist).
+ Any output may be NULL */
+int mg_project_point(mg_Geometry *Geo, mg_ProjIndex *Index,
+                     const double x[2], int iseg_only, int *iseg,
+                     double *t, double xp[2], double *dist);
+
+/******************************************************************/
+/* function:  mg_project_points */
+/* batch version of mg_project_point for n interleaved coordinates X.
+ Seg may be NULL (any segment) or hold one segment per point.
+ Outputs are per point (xp interleaved); any output may be NULL */
+int mg_project_points(mg_Geometry *Geo, mg_ProjIndex *Index, int n,
+                      const double *X, const int *Seg, int *iseg,
+                      double *t, double *Xp, double *dist);
+
+/******************************************************************/
+/* function:  mg_snap_boundary_nodes */
+/* projects every node of a boundary face of Mesh onto the segment of
+ its boundary group (boundary groups are geometry segments) */
+int mg_snap_boundary_nodes(mg_Geometry *Geo, mg_ProjIndex *Index,
+                           mg_Mesh *Mesh);
+
+#endif
@@ -0,0 +1,309 @@
+//
+//  2dmg_segcache.c
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_metric_struct.h"
+#include "2dmg_utils.h"
+#include "2dmg_segcache.h"
+
+#define FNVOFFSET 14695981039346656037ULL
+#define FNVPRIME  1099511628211ULL
+#define SEGCACHEEXT ".seg"
+
+/******************************************************************/
+/* cache entry header (followed by np doubles and a checksum) */
+typedef struct
+{
+  char magic[8];
+  int version, np, nPoint, interp_type, metric_type, order, dim;
+  uint64_t key;
+  double scale, Lm;
+}
+mg_SegCacheHeader;
+
+/******************************************************************/
+/* function:  mg_fnv1a */
+/* FNV-1a hash of n bytes, continuing from h */
+static uint64_t mg_fnv1a(uint64_t h, const void *data, size_t n)
+{
+  size_t i;
+  const unsigned char *c = (const unsigned char*)data;
+
+  for (i = 0; i < n; i++) {
+    h ^= (uint64_t)c[i];
+    h *= FNVPRIME;
+  }
+  return h;
+}
+
+/******************************************************************/
+/* function:  mg_seg_cache_file */
+/* builds the cache file name for a given key */
+static void mg_seg_cache_file(mg_SegCache *Cache, uint64_t key,
+                              char FileName[MAXLONGLINELEN])
+{
+  snprintf(FileName, MAXLONGLINELEN, "%s/%016llx%s", Cache->Dir,
+           (unsigned long long)key, SEGCACHEEXT);
+}
+
+/******************************************************************/
+/* function:  mg_seg_cache_header */
+/* fills a header with the fields identifying a discretization */
+static void mg_seg_cache_header(mg_Segment *Seg, mg_Metric *Metric,
+                                int np, uint64_t key,
+                                mg_SegCacheHeader *Header)
+{
+  memset(Header, 0, sizeof(mg_SegCacheHeader));
+  memcpy(Header->magic, SEGCACHEMAGIC, 8);
+  Header->version = SEGCACHEVERSION;
+  Header->np = np;
+  Header->nPoint = Seg->nPoint;
+  Header->interp_type = (int)Seg->interp_type;
+  Header->metric_type = (int)Metric->type;
+  Header->order = Metric->order;
+  Header->dim = Metric->BGMesh->Dim;
+  Header->key = key;
+}
+
+/******************************************************************/
+/* function:  mg_create_seg_cache */
+/* creates a segment discretization cache stored in directory Dir */
+int mg_create_seg_cache(mg_SegCache **pCache, const char *Dir)
+{
+  int ierr;
+  struct stat st;
+
+  if (Dir == NULL || strlen(Dir) == 0 || strlen(Dir) >= MAXLINELEN)
+    return error(err_INPUT_ERROR);
+  //create directory if needed
+  if (stat(Dir, &st) != 0) {
+    if (mkdir(Dir, 0755) != 0 && errno != EEXIST)
+      return error(err_READWRITE_ERROR);
+  }
+  else if (!S_ISDIR(st.st_mode))
+    return error(err_INPUT_ERROR);
+
+  call(mg_alloc((void**)pCache, 1, sizeof(mg_SegCache)));
+  call(mg_alloc((void**)&(*pCache)->Dir, MAXLINELEN, sizeof(char)));
+  strcpy((*pCache)->Dir, Dir);
+  (*pCache)->nHit = 0;
+  (*pCache)->nMiss = 0;
+  (*pCache)->nStale = 0;
+  (*pCache)->nStore = 0;
+
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_destroy_seg_cache */
+/* destroys a mg_SegCache structure (files are kept on disk) */
+void mg_destroy_seg_cache(mg_SegCache *Cache)
+{
+  if (Cache == NULL) return;
+  mg_free((void*)Cache->Dir);
+  mg_free((void*)Cache);
+}
+
+/******************************************************************/
+/* function:  mg_seg_cache_key */
+/* hashes segment points, interpolation type, metric and node count
+ into a 64 bit key */
+int mg_seg_cache_key(mg_Segment *Seg, mg_Metric *Metric, int np,
+                     uint64_t *key)
+{
+  int field[6];
+  int const dim = Metric->BGMesh->Dim;
+  uint64_t h = FNVOFFSET;
+
+  if (Seg->Coord == NULL || Seg->s == NULL)
+    return error(err_INPUT_ERROR);
+
+  field[0] = SEGCACHEVERSION;
+  field[1] = Seg->nPoint;
+  field[2] = (int)Seg->interp_type;
+  field[3] = (int)Metric->type;
+  field[4] = Metric->order;
+  field[5] = np;
+  h = mg_fnv1a(h, field, sizeof(field));
+  h = mg_fnv1a(h, &Metric->tol, sizeof(double));
+  h = mg_fnv1a(h, Seg->s, Seg->nPoint*sizeof(double));
+  h = mg_fnv1a(h, Seg->Coord, dim*Seg->nPoint*sizeof(double));
+  (*key) = h;
+
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_seg_cache_load */
+/* looks up a segment discretization in the cache. returns err_OK on
+ a hit and err_NOT_FOUND on a miss or stale entry (not reported) */
+int mg_seg_cache_load(mg_SegCache *Cache, mg_Segment *Seg,
+                      mg_Metric *Metric, int np, double *scale,
+                      double **t)
+{
+  int ierr;
+  char FileName[MAXLONGLINELEN];
+  uint64_t key, sum, stored;
+  mg_SegCacheHeader Header, Ref;
+  double *tc;
+  FILE *fid;
+
+  call(mg_seg_cache_key(Seg, Metric, np, &key));
+  mg_seg_cache_file(Cache, key, FileName);
+  if ((fid = fopen(FileName, "rb")) == NULL){
+    Cache->nMiss++;
+    return err_NOT_FOUND;
+  }
+  mg_seg_cache_header(Seg, Metric, np, key, &Ref);
+  //any mismatch in the header or payload invalidates the entry
+  if (fread(&Header, sizeof(mg_SegCacheHeader), 1, fid) != 1 ||
+      memcmp(Header.magic, Ref.magic, 8) != 0 ||
+      Header.version != Ref.version || Header.np != Ref.np ||
+      Header.nPoint != Ref.nPoint ||
+      Header.interp_type != Ref.interp_type ||
+      Header.metric_type != Ref.metric_type ||
+      Header.order != Ref.order || Header.dim != Ref.dim ||
+      Header.key != Ref.key){
+    fclose(fid);
+    Cache->nStale++;
+    Cache->nMiss++;
+    return err_NOT_FOUND;
+  }
+  call(mg_alloc((void**)&tc, np, sizeof(double)));
+  if (fread(tc, sizeof(double), np, fid) != (size_t)np ||
+      fread(&stored, sizeof(uint64_t), 1, fid) != 1){
+    fclose(fid);
+    mg_free((void*)tc);
+    Cache->nStale++;
+    Cache->nMiss++;
+    return err_NOT_FOUND;
+  }
+  fclose(fid);
+  sum = mg_fnv1a(FNVOFFSET, &Header, sizeof(mg_SegCacheHeader));
+  sum = mg_fnv1a(sum, tc, np*sizeof(double));
+  if (sum != stored || tc[0] != 0.0 || tc[np-1] != 1.0) {
+    mg_free((void*)tc);
+    Cache->nStale++;
+    Cache->nMiss++;
+    return err_NOT_FOUND;
+  }
+
+  (*t) = tc;
+  (*scale) = Header.scale;
+  //restore metric length as mg_mesh_segment would have done
+  if (Seg->Lm < 0.0)
+    Seg->Lm = Header.Lm;
+  Cache->nHit++;
+
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_seg_cache_store */
+/* writes a segment discretization to the cache */
+int mg_seg_cache_store(mg_SegCache *Cache, mg_Segment *Seg,
+                       mg_Metric *Metric, int np, double scale,
+                       double *t)
+{
+  int ierr;
+  char FileName[MAXLONGLINELEN], TmpName[MAXLONGLINELEN+32];
+  uint64_t key, sum;
+  mg_SegCacheHeader Header;
+  FILE *fid;
+
+  call(mg_seg_cache_key(Seg, Metric, np, &key));
+  mg_seg_cache_header(Seg, Metric, np, key, &Header);
+  Header.scale = scale;
+  Header.Lm = Seg->Lm;
+  sum = mg_fnv1a(FNVOFFSET, &Header, sizeof(mg_SegCacheHeader));
+  sum = mg_fnv1a(sum, t, np*sizeof(double));
+
+  mg_seg_cache_file(Cache, key, FileName);
+  //write to a private file and rename so readers never see partial
+  //entries, even with concurrent runs sharing the cache
+  snprintf(TmpName, MAXLONGLINELEN+32, "%s.%d.tmp", FileName,
+           (int)getpid());
+  if ((fid = fopen(TmpName, "wb")) == NULL)
+    return error(err_READWRITE_ERROR);
+  if (fwrite(&Header, sizeof(mg_SegCacheHeader), 1, fid) != 1 ||
+      fwrite(t, sizeof(double), np, fid) != (size_t)np ||
+      fwrite(&sum, sizeof(uint64_t), 1, fid) != 1){
+    fclose(fid);
+    remove(TmpName);
+    return error(err_READWRITE_ERROR);
+  }
+  if (fclose(fid) != 0 || rename(TmpName, FileName) != 0){
+    remove(TmpName);
+    return error(err_READWRITE_ERROR);
+  }
+  Cache->nStore++;
+
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_mesh_segment_cached */
+/* same as mg_mesh_segment but goes through Cache first (if not NULL)
+ and stores the optimized discretization on a miss */
+int mg_mesh_segment_cached(mg_SegCache *Cache, mg_Segment *Seg,
+                           mg_Metric *Metric, int np, double *scale,
+                           double **t)
+{
+  int ierr;
+
+  if (Cache == NULL)
+    return mg_mesh_segment(Seg, Metric, np, scale, t);
+
+  if (mg_seg_cache_load(Cache, Seg, Metric, np, scale, t) == err_OK){
+    printf("Segment %s scale: %1.3e (cached)\n",Seg->Name,(*scale));
+    return err_OK;
+  }
+  call(mg_mesh_segment(Seg, Metric, np, scale, t));
+  //a failure to write the cache is not fatal
+  ierr = error(mg_seg_cache_store(Cache, Seg, Metric, np, (*scale), (*t)));
+
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_seg_cache_purge */
+/* removes every cache entry from the cache directory */
+int mg_seg_cache_purge(mg_SegCache *Cache)
+{
+  int len, ext = (int)strlen(SEGCACHEEXT);
+  char FileName[MAXLONGLINELEN];
+  DIR *dir;
+  struct dirent *ent;
+
+  if ((dir = opendir(Cache->Dir)) == NULL)
+    return error(err_READWRITE_ERROR);
+  while ((ent = readdir(dir)) != NULL) {
+    len = (int)strlen(ent->d_name);
+    if (len <= ext || strcmp(ent->d_name+len-ext, SEGCACHEEXT) != 0)
+      continue;
+    snprintf(FileName, MAXLONGLINELEN, "%s/%s", Cache->Dir, ent->d_name);
+    remove(FileName);
+  }
+  closedir(dir);
+
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_seg_cache_report */
+/* prints hit/miss statistics */
+void mg_seg_cache_report(mg_SegCache *Cache)
+{
+  if (Cache == NULL) return;
+  printf("Segment cache %s: %d hit(s), %d miss(es) (%d stale), %d stored\n",
+         Cache->Dir, Cache->nHit, Cache->nMiss, Cache->nStale,
+         Cache->nStore);
+}
@@ -0,0 +1,73 @@
+//
+//  2dmg_segcache.h
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#ifndef ___dmg___dmg_segcache__
+#define ___dmg___dmg_segcache__
+
+#include <stdio.h>
+#include <stdint.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_metric_struct.h"
+
+/******************************************************************/
+/* cache file layout version: bump whenever mg_mesh_segment or the
+ metric evaluation changes so that old entries are invalidated */
+#define SEGCACHEVERSION   3
+#define SEGCACHEMAGIC     "2DMGSEGC"
+
+/******************************************************************/
+/* function:  mg_create_seg_cache */
+/* creates a segment discretization cache stored in directory Dir */
+int mg_create_seg_cache(mg_SegCache **pCache, const char *Dir);
+
+/******************************************************************/
+/* function:  mg_destroy_seg_cache */
+/* destroys a mg_SegCache structure (files are kept on disk) */
+void mg_destroy_seg_cache(mg_SegCache *Cache);
+
+/******************************************************************/
+/* function:  mg_seg_cache_key */
+/* hashes segment points, interpolation type, metric and node count
+ into a 64 bit key */
+int mg_seg_cache_key(mg_Segment *Seg, mg_Metric *Metric, int np,
+                     uint64_t *key);
+
+/******************************************************************/
+/* function:  mg_seg_cache_load */
+/* looks up a segment discretization in the cache. returns err_OK on
+ a hit and err_NOT_FOUND on a miss or stale entry (not reported) */
+int mg_seg_cache_load(mg_SegCache *Cache, mg_Segment *Seg,
+                      mg_Metric *Metric, int np, double *scale,
+                      double **t);
+
+/******************************************************************/
+/* function:  mg_seg_cache_store */
+/* writes a segment discretization to the cache */
+int mg_seg_cache_store(mg_SegCache *Cache, mg_Segment *Seg,
+                       mg_Metric *Metric, int np, double scale,
+                       double *t);
+
+/******************************************************************/
+/* function:  mg_mesh_segment_cached */
+/* same as mg_mesh_segment but goes through Cache first (if not NULL)
+ and stores the optimized discretization on a miss */
+int mg_mesh_segment_cached(mg_SegCache *Cache, mg_Segment *Seg,
+                           mg_Metric *Metric, int np, double *scale,
+                           double **t);
+
+/******************************************************************/
+/* function:  mg_seg_cache_purge */
+/* removes every cache entry from the cache directory */
+int mg_seg_cache_purge(mg_SegCache *Cache);
+
+/******************************************************************/
+/* function:  mg_seg_cache_report */
+/* prints hit/miss statistics */
+void mg_seg_cache_report(mg_SegCache *Cache);
+
+#endif
@@ -0,0 +1,479 @@
+//
+//  2dmg_spline.c
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_utils.h"
+#include "2dmg_spline.h"
+#include <gsl/gsl_interp.h>
+
+/******************************************************************/
+/* function:  mg_spline_tridiag */
+/* solves a symmetric tridiagonal system (Thomas algorithm). diag and
+ rhs are overwritten, solution goes to x */
+static int mg_spline_tridiag(int n, double *diag, const double *offdiag,
+                             double *rhs, double *x)
+{
+  int i;
+  double m;
+
+  for (i = 1; i < n; i++) {
+    if (diag[i-1] == 0.0) return error(err_SINGULAR);
+    m = offdiag[i-1]/diag[i-1];
+    diag[i] -= m*offdiag[i-1];
+    rhs[i]  -= m*rhs[i-1];
+  }
+  if (diag[n-1] == 0.0) return error(err_SINGULAR);
+  x[n-1] = rhs[n-1]/diag[n-1];
+  for (i = n-2; i >= 0; i--)
+    x[i] = (rhs[i]-offdiag[i]*x[i+1])/diag[i];
+
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_spline_cyclic_tridiag */
+/* solves a symmetric cyclic tridiagonal system (n > 2) using
+ Sherman-Morrison. offdiag[n-1] couples unknowns n-1 and 0 */
+static int mg_spline_cyclic_tridiag(int n, const double *diag,
+                                    const double *offdiag,
+                                    const double *rhs, double *x)
+{
+  int ierr, i;
+  double *bb, *r, *u, *z, gamma, beta, fact;
+
+  call(mg_alloc((void**)&bb, 4*n, sizeof(double)));
+  r = bb+n;
+  u = bb+2*n;
+  z = bb+3*n;
+  beta  = offdiag[n-1];
+  gamma = -diag[0];
+  for (i = 0; i < n; i++) {
+    bb[i] = diag[i];
+    r[i]  = rhs[i];
+    u[i]  = 0.0;
+  }
+  bb[0]   -= gamma;
+  bb[n-1] -= beta*beta/gamma;
+  u[0]   = gamma;
+  u[n-1] = beta;
+  call(mg_spline_tridiag(n, bb, offdiag, r, x));
+  //bb was overwritten: rebuild it
+  for (i = 0; i < n; i++) bb[i] = diag[i];
+  bb[0]   -= gamma;
+  bb[n-1] -= beta*beta/gamma;
+  call(mg_spline_tridiag(n, bb, offdiag, u, z));
+  fact = (x[0]+beta*x[n-1]/gamma)/(1.0+z[0]+beta*z[n-1]/gamma);
+  for (i = 0; i < n; i++)
+    x[i] -= fact*z[i];
+  mg_free((void*)bb);
+
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_spline_cspline */
+/* second derivative coefficients (c[i] = y''/2) of natural or
+ periodic cubic splines, as in gsl_interp_cspline(_periodic) */
+static int mg_spline_cspline(int n, const double *x, const double *y,
+                             bool periodic, double *c)
+{
+  int ierr, i, sys;
+  double *diag, *offdiag, *g, h_i, h_ip1, A, B, g2[2], det;
+
+  for (i = 0; i < n; i++) c[i] = 0.0;
+  if (!periodic) {
+    sys = n-2;
+    if (sys < 1) return err_OK;
+    call(mg_alloc((void**)&diag, 3*sys, sizeof(double)));
+    offdiag = diag+sys;
+    g = diag+2*sys;
+    for (i = 0; i < sys; i++) {
+      h_i   = x[i+1]-x[i];
+      h_ip1 = x[i+2]-x[i+1];
+      offdiag[i] = h_ip1;
+      diag[i] = 2.0*(h_ip1+h_i);
+      g[i] = 3.0*((h_ip1 != 0.0 ? (y[i+2]-y[i+1])/h_ip1 : 0.0)-
+                  (h_i != 0.0 ? (y[i+1]-y[i])/h_i : 0.0));
+    }
+    call(mg_spline_tridiag(sys, diag, offdiag, g, c+1));
+    mg_free((void*)diag);
+    return err_OK;
+  }
+  sys = n-1;
+  if (sys < 2) return err_OK;
+  if (sys == 2) {
+    h_i   = x[1]-x[0];
+    h_ip1 = x[2]-x[1];
+    A = 2.0*(h_i+h_ip1);
+    B = h_i+h_ip1;
+    g2[0] = 3.0*((y[2]-y[1])/h_ip1-(y[1]-y[0])/h_i);
+    g2[1] = 3.0*((y[1]-y[2])/h_i-(y[2]-y[1])/h_ip1);
+    det = 3.0*(h_i+h_ip1)*(h_i+h_ip1);
+    c[1] = ( A*g2[0]-B*g2[1])/det;
+    c[2] = (-B*g2[0]+A*g2[1])/det;
+    c[0] = c[2];
+    return err_OK;
+  }
+  call(mg_alloc((void**)&diag, 3*sys, sizeof(double)));
+  offdiag = diag+sys;
+  g = diag+2*sys;
+  for (i = 0; i < sys; i++) {
+    h_i = x[i+1]-x[i];
+    //last row wraps around to the first interval
+    if (i < sys-1) {
+      h_ip1 = x[i+2]-x[i+1];
+      A = y[i+2]-y[i+1];
+    }
+    else {
+      h_ip1 = x[1]-x[0];
+      A = y[1]-y[0];
+    }
+    offdiag[i] = h_ip1;
+    diag[i] = 2.0*(h_ip1+h_i);
+    g[i] = 3.0*((h_ip1 != 0.0 ? A/h_ip1 : 0.0)-
+                (h_i != 0.0 ? (y[i+1]-y[i])/h_i : 0.0));
+  }
+  call(mg_spline_cyclic_tridiag(sys, diag, offdiag, g, c+1));
+  c[0] = c[sys];
+  mg_free((void*)diag);
+
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_spline_akima */
+/* Akima coefficients b, c, d per interval as in gsl_interp_akima */
+static int mg_spline_akima(int n, const double *x, const double *y,
+                           bool periodic, double *b, double *c,
+                           double *d)
+{
+  int ierr, i;
+  double *mm, *m, NE, NE_next, h_i, alpha_i, alpha_ip1, tL_ip1;
+
+  call(mg_alloc((void**)&mm, n+4, sizeof(double)));
+  m = mm+2;
+  for (i = 0; i < n-1; i++)
+    m[i] = (y[i+1]-y[i])/(x[i+1]-x[i]);
+  if (periodic) {
+    m[-2] = m[n-3];
+    m[-1] = m[n-2];
+    m[n-1] = m[0];
+    m[n]   = m[1];
+  }
+  else {
+    m[-2] = 3.0*m[0]-2.0*m[1];
+    m[-1] = 2.0*m[0]-m[1];
+    m[n-1] = 2.0*m[n-2]-m[n-3];
+    m[n]   = 3.0*m[n-2]-2.0*m[n-3];
+  }
+  for (i = 0; i < n-1; i++) {
+    NE = fabs(m[i+1]-m[i])+fabs(m[i-1]-m[i-2]);
+    if (NE == 0.0) {
+      b[i] = m[i];
+      c[i] = 0.0;
+      d[i] = 0.0;
+    }
+    else {
+      h_i = x[i+1]-x[i];
+      NE_next = fabs(m[i+2]-m[i+1])+fabs(m[i]-m[i-1]);
+      alpha_i = fabs(m[i-1]-m[i-2])/NE;
+      if (NE_next == 0.0)
+        tL_ip1 = m[i];
+      else {
+        alpha_ip1 = fabs(m[i]-m[i-1])/NE_next;
+        tL_ip1 = (1.0-alpha_ip1)*m[i]+alpha_ip1*m[i+1];
+      }
+      b[i] = (1.0-alpha_i)*m[i-1]+alpha_i*m[i];
+      c[i] = (3.0*m[i]-2.0*b[i]-tL_ip1)/h_i;
+      d[i] = (b[i]+tL_ip1-2.0*m[i])/(h_i*h_i);
+    }
+  }
+  mg_free((void*)mm);
+
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_create_spline */
+/* builds the native piecewise-cubic interpolant of a 2D segment
+ (Seg->Spline) reproducing the gsl_interp scheme of interp_type */
+int mg_create_spline(mg_Segment *Seg)
+{
+  int ierr, i, j, d, n = Seg->nPoint, nInt = n-1, nmin;
+  double *x = Seg->s, *y, *cs, h, dy, hunif;
+  mg_Spline *Spline;
+
+  switch (Seg->interp_type) {
+    case mge_Linear:          nmin = 2; break;
+    case mge_Polynomial:      nmin = 3; break;
+    case mge_CSpline:         nmin = 3; break;
+    case mge_CSplinePeriodic: nmin = 2; break;
+    case mge_Akima:           nmin = 5; break;
+    case mge_AkimaPeriodic:   nmin = 5; break;
+    default:
+      return error(err_NOT_SUPPORTED);
+  }
+  if (n < nmin) return error(err_INPUT_ERROR);
+  for (i = 0; i < nInt; i++)
+    if (x[i+1] <= x[i]) return error(err_INPUT_ERROR);
+
+  call(mg_alloc((void**)&Spline, 1, sizeof(mg_Spline)));
+  Spline->type = Seg->interp_type;
+  Spline->nInt = nInt;
+  Spline->s = x;
+  Spline->dd = NULL;
+  call(mg_alloc((void**)&Spline->c[0], 8*nInt, sizeof(double)));
+  for (i = 1; i < 4; i++)
+    Spline->c[i] = Spline->c[0]+i*2*nInt;
+  //uniform breakpoints allow O(1) interval lookup
+  hunif = (x[nInt]-x[0])/nInt;
+  Spline->hinv = 1.0/hunif;
+  for (i = 0; i < nInt; i++)
+    if (fabs((x[i+1]-x[i])-hunif) > 1e-12*hunif) {
+      Spline->hinv = 0.0;
+      break;
+    }
+
+  call(mg_alloc((void**)&cs, 3*n, sizeof(double)));
+  for (d = 0; d < 2; d++) {
+    y = Seg->Coord+d*n;
+    j = d*nInt;
+    switch (Seg->interp_type) {
+      case mge_Linear:
+      case mge_Polynomial:
+        for (i = 0; i < nInt; i++) {
+          Spline->c[0][j+i] = y[i];
+          Spline->c[1][j+i] = (y[i+1]-y[i])/(x[i+1]-x[i]);
+          Spline->c[2][j+i] = 0.0;
+          Spline->c[3][j+i] = 0.0;
+        }
+        break;
+      case mge_CSpline:
+      case mge_CSplinePeriodic:
+        call(mg_spline_cspline(n, x, y,
+                               Seg->interp_type == mge_CSplinePeriodic, cs));
+        for (i = 0; i < nInt; i++) {
+          h  = x[i+1]-x[i];
+          dy = y[i+1]-y[i];
+          Spline->c[0][j+i] = y[i];
+          Spline->c[1][j+i] = dy/h-h*(cs[i+1]+2.0*cs[i])/3.0;
+          Spline->c[2][j+i] = cs[i];
+          Spline->c[3][j+i] = (cs[i+1]-cs[i])/(3.0*h);
+        }
+        break;
+      case mge_Akima:
+      case mge_AkimaPeriodic:
+        call(mg_spline_akima(n, x, y,
+                             Seg->interp_type == mge_AkimaPeriodic,
+                             Spline->c[1]+j, Spline->c[2]+j,
+                             Spline->c[3]+j));
+        for (i = 0; i < nInt; i++)
+          Spline->c[0][j+i] = y[i];
+        break;
+      default:
+        break;
+    }
+  }
+  mg_free((void*)cs);
+
+  //global interpolating polynomial in Newton form
+  if (Seg->interp_type == mge_Polynomial) {
+    call(mg_alloc((void**)&Spline->dd, 2*n, sizeof(double)));
+    for (d = 0; d < 2; d++) {
+      cs = Spline->dd+d*n;
+      y = Seg->Coord+d*n;
+      for (i = 0; i < n; i++) cs[i] = y[i];
+      for (j = 1; j < n; j++)
+        for (i = n-1; i >= j; i--)
+          cs[i] = (cs[i]-cs[i-1])/(x[i]-x[i-j]);
+    }
+  }
+
+  if (Seg->Spline != NULL)
+    mg_destroy_spline(Seg->Spline);
+  Seg->Spline = Spline;
+
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_destroy_spline */
+/* frees a mg_Spline structure */
+void mg_destroy_spline(mg_Spline *Spline)
+{
+  if (Spline == NULL) return;
+  mg_free((void*)Spline->c[0]);
+  mg_free((void*)Spline->dd);
+  mg_free((void*)Spline);
+}
+
+/******************************************************************/
+/* function:  mg_spline_interval */
+/* returns interval i such that s[i] <= t < s[i+1], with the same
+ conventions as gsl_interp_bsearch (t == s[end] maps to last interval,
+ values outside the range are extrapolated from the end intervals) */
+int mg_spline_interval(mg_Spline *Spline, double t, int guess)
+{
+  int i, lo, hi;
+  int const nInt = Spline->nInt;
+  double const *s = Spline->s;
+
+  if (Spline->hinv > 0.0)
+    i = (int)((t-s[0])*Spline->hinv);
+  else
+    i = guess;
+  i = (i < 0) ? 0 : ((i >= nInt) ? nInt-1 : i);
+  //the guess is usually right or off by one
+  if (s[i] <= t && (i == nInt-1 || t < s[i+1]))
+    return i;
+  if (i > 0 && s[i-1] <= t && t < s[i])
+    return i-1;
+  if (i < nInt-1 && s[i+1] <= t && (i+1 == nInt-1 || t < s[i+2]))
+    return i+1;
+  if (t < s[0]) return 0;
+  //bisection
+  lo = 0;
+  hi = nInt;
+  while (hi > lo+1) {
+    i = (hi+lo)/2;
+    if (s[i] > t)
+      hi = i;
+    else
+      lo = i;
+  }
+  return lo;
+}
+
+/******************************************************************/
+/* function:  mg_spline_eval_poly */
+/* evaluates the Newton form of the interpolating polynomial */
+static void mg_spline_eval_poly(mg_Spline *Spline, int np, const double *t,
+                                double *X, double *dX, double *d2X)
+{
+  int ip, i, d, n = Spline->nInt+1;
+  double const *s = Spline->s, *dd;
+  double p, dp, d2p, w;
+
+  for (d = 0; d < 2; d++) {
+    dd = Spline->dd+d*n;
+    for (ip = 0; ip < np; ip++) {
+      p = dd[n-1];
+      dp = d2p = 0.0;
+      for (i = n-2; i >= 0; i--) {
+        w = t[ip]-s[i];
+        d2p = 2.0*dp+w*d2p;
+        dp  = p+w*dp;
+        p   = dd[i]+w*p;
+      }
+      if (X != NULL) X[d*np+ip] = p;
+      if (dX != NULL) dX[d*np+ip] = dp;
+      if (d2X != NULL) d2X[d*np+ip] = d2p;
+    }
+  }
+}
+
+/******************************************************************/
+/* function:  mg_spline_eval */
+/* evaluates position X, tangent dX and second derivative d2X at np
+ parametric coordinates t. Outputs are SoA: x values in [0,np) and
+ y values in [np,2*np). Any output may be NULL. */
+void mg_spline_eval(mg_Spline *Spline, int np, const double *t,
+                    double *X, double *dX, double *d2X)
+{
+  int ip, i, j, k, guess = 0;
+  int const nInt = Spline->nInt;
+  int idx[MAXLINELEN];
+  double ds;
+  double const *s = Spline->s, *c0 = Spline->c[0], *c1 = Spline->c[1];
+  double const *c2 = Spline->c[2], *c3 = Spline->c[3];
+
+  if (Spline->dd != NULL) {
+    mg_spline_eval_poly(Spline, np, t, X, dX, d2X);
+    return;
+  }
+  //work in blocks: interval lookup first, then branch-free evaluation
+  for (k = 0; k < np; k += MAXLINELEN) {
+    j = min(np-k, MAXLINELEN);
+    for (ip = 0; ip < j; ip++) {
+      guess = mg_spline_interval(Spline, t[k+ip], guess);
+      idx[ip] = guess;
+    }
+    if (X != NULL) {
+#pragma omp simd private(i, ds)
+      for (ip = 0; ip < j; ip++) {
+        i = idx[ip];
+        ds = t[k+ip]-s[i];
+        X[k+ip]    = c0[i]+ds*(c1[i]+ds*(c2[i]+ds*c3[i]));
+        X[np+k+ip] = c0[nInt+i]+ds*(c1[nInt+i]+ds*(c2[nInt+i]+ds*c3[nInt+i]));
+      }
+    }
+    if (dX != NULL) {
+#pragma omp simd private(i, ds)
+      for (ip = 0; ip < j; ip++) {
+        i = idx[ip];
+        ds = t[k+ip]-s[i];
+        dX[k+ip]    = c1[i]+ds*(2.0*c2[i]+3.0*c3[i]*ds);
+        dX[np+k+ip] = c1[nInt+i]+ds*(2.0*c2[nInt+i]+3.0*c3[nInt+i]*ds);
+      }
+    }
+    if (d2X != NULL) {
+#pragma omp simd private(i, ds)
+      for (ip = 0; ip < j; ip++) {
+        i = idx[ip];
+        ds = t[k+ip]-s[i];
+        d2X[k+ip]    = 2.0*c2[i]+6.0*c3[i]*ds;
+        d2X[np+k+ip] = 2.0*c2[nInt+i]+6.0*c3[nInt+i]*ds;
+      }
+    }
+  }
+}
+
+/******************************************************************/
+/* function:  mg_spline_eval_point */
+/* evaluates position X[2] and tangent dX[2] (may be NULL) at a single
+ parametric coordinate t */
+void mg_spline_eval_point(mg_Spline *Spline, double t, double X[2],
+                          double dX[2])
+{
+  mg_spline_eval(Spline, 1, &t, X, dX, NULL);
+}
+
+/******************************************************************/
+/* function:  mg_spline_check */
+/* compares the native interpolant against gsl_interp at n points
+ uniformly distributed over the segment and returns the maximum
+ absolute error in position and tangent */
+int mg_spline_check(mg_Segment *Seg, int n, double *errX, double *errdX)
+{
+  int ierr, ip, d, np = Seg->nPoint;
+  double *t, *X, *dX, s0 = Seg->s[0], s1 = Seg->s[np-1], v, dv;
+
+  if (Seg->Spline == NULL || Seg->interp == NULL || n < 2)
+    return error(err_INPUT_ERROR);
+  call(mg_alloc((void**)&t, 5*n, sizeof(double)));
+  X  = t+n;
+  dX = t+3*n;
+  for (ip = 0; ip < n; ip++)
+    t[ip] = s0+(s1-s0)*ip/(n-1);
+  //last point exactly on the end of the range
+  t[n-1] = s1;
+  mg_spline_eval(Seg->Spline, n, t, X, dX, NULL);
+  (*errX) = (*errdX) = 0.0;
+  for (d = 0; d < 2; d++)
+    for (ip = 0; ip < n; ip++) {
+      v  = gsl_interp_eval(Seg->interp[d], Seg->s, Seg->Coord+d*np,
+                           t[ip], Seg->accel[d]);
+      dv = gsl_interp_eval_deriv(Seg->interp[d], Seg->s, Seg->Coord+d*np,
+                                 t[ip], Seg->accel[d]);
+      (*errX)  = max((*errX), fabs(v-X[d*n+ip]));
+      (*errdX) = max((*errdX), fabs(dv-dX[d*n+ip]));
+    }
+  mg_free((void*)t);
+
+  return err_OK;
+}
@@ -0,0 +1,55 @@
+//
+//  2dmg_spline.h
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#ifndef ___dmg___dmg_spline__
+#define ___dmg___dmg_spline__
+
+#include <stdio.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+
+/******************************************************************/
+/* function:  mg_create_spline */
+/* builds the native piecewise-cubic interpolant of a 2D segment
+ (Seg->Spline) reproducing the gsl_interp scheme of interp_type */
+int mg_create_spline(mg_Segment *Seg);
+
+/******************************************************************/
+/* function:  mg_destroy_spline */
+/* frees a mg_Spline structure */
+void mg_destroy_spline(mg_Spline *Spline);
+
+/******************************************************************/
+/* function:  mg_spline_interval */
+/* returns interval i such that s[i] <= t < s[i+1], with the same
+ conventions as gsl_interp_bsearch (t == s[end] maps to last interval,
+ values outside the range are extrapolated from the end intervals) */
+int mg_spline_interval(mg_Spline *Spline, double t, int guess);
+
+/******************************************************************/
+/* function:  mg_spline_eval */
+/* evaluates position X, tangent dX and second derivative d2X at np
+ parametric coordinates t. Outputs are SoA: x values in [0,np) and
+ y values in [np,2*np). Any output may be NULL. */
+void mg_spline_eval(mg_Spline *Spline, int np, const double *t,
+                    double *X, double *dX, double *d2X);
+
+/******************************************************************/
+/* function:  mg_spline_eval_point */
+/* evaluates position X[2] and tangent dX[2] (may be NULL) at a single
+ parametric coordinate t */
+void mg_spline_eval_point(mg_Spline *Spline, double t, double X[2],
+                          double dX[2]);
+
+/******************************************************************/
+/* function:  mg_spline_check */
+/* compares the native interpolant against gsl_interp at n points
+ uniformly distributed over the segment and returns the maximum
+ absolute error in position and tangent */
+int mg_spline_check(mg_Segment *Seg, int n, double *errX, double *errdX);
+
+#endif
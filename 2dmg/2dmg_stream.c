@@ -0,0 +1,578 @@
+//
+//  2dmg_stream.c
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "2dmg_stream.h"
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_utils.h"
+#include "2dmg_math.h"
+
+/******************************************************************/
+/* function:  mg_free_stream_batch */
+static void mg_free_stream_batch(struct mg_StreamBatch *Batch)
+{
+  mg_free((void*)Batch->Coord);
+  mg_free((void*)Batch->ElemNode);
+  mg_free((void*)Batch);
+}
+
+/******************************************************************/
+/* function:  mg_destroy_mesh_stream */
+/* frees Stream, the writer thread must have been joined */
+static void mg_destroy_mesh_stream(mg_MeshStream *Stream)
+{
+  struct mg_StreamBatch *Batch;
+  
+  while ((Batch = Stream->Head) != NULL) {
+    Stream->Head = Batch->next;
+    mg_free_stream_batch(Batch);
+  }
+  if (Stream->fid != NULL) fclose(Stream->fid);
+  if (Stream->Spool != NULL) fclose(Stream->Spool);
+  pthread_mutex_destroy(&Stream->Lock);
+  pthread_cond_destroy(&Stream->Cond);
+  mg_free((void*)Stream->NodeOut);
+  mg_free((void*)Stream->OnFront);
+  mg_free((void*)Stream->ElemOut);
+  mg_free((void*)Stream->Pending);
+  mg_free((void*)Stream->Seg);
+  mg_free((void*)Stream->CellStart);
+  mg_free((void*)Stream->CellSeg);
+  mg_free((void*)Stream);
+}
+
+/******************************************************************/
+/* function:  mg_write_stream_batch */
+/* nodes go straight to the output file, elements to the spool */
+static int mg_write_stream_batch(mg_MeshStream *Stream,
+                                 struct mg_StreamBatch *Batch)
+{
+  int i, d;
+  
+  for (i = 0; i < Batch->nNode; i++) {
+    for (d = 0; d < Stream->Dim; d++)
+      fprintf(Stream->fid, "%1.12e ",Batch->Coord[i*Stream->Dim+d]);
+    fprintf(Stream->fid, "\n");
+  }
+  for (i = 0; i < Batch->nElem; i++)
+    fprintf(Stream->Spool, "%d %d %d \n",Batch->ElemNode[3*i],
+            Batch->ElemNode[3*i+1],Batch->ElemNode[3*i+2]);
+  if (ferror(Stream->fid) || ferror(Stream->Spool))
+    return err_READWRITE_ERROR;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_stream_writer */
+/* body of the writer thread: writes queued batches until the stream
+ is closed */
+static void *mg_stream_writer(void *arg)
+{
+  int ierr;
+  mg_MeshStream *Stream = (mg_MeshStream*)arg;
+  struct mg_StreamBatch *Batch;
+  
+  pthread_mutex_lock(&Stream->Lock);
+  while (true) {
+    while (Stream->Head == NULL && !Stream->Done)
+      pthread_cond_wait(&Stream->Cond, &Stream->Lock);
+    if ((Batch = Stream->Head) == NULL) break;
+    Stream->Head = Batch->next;
+    if (Stream->Head == NULL) Stream->Tail = NULL;
+    Stream->nQueued--;
+    pthread_cond_broadcast(&Stream->Cond);
+    pthread_mutex_unlock(&Stream->Lock);
+    //write without holding the lock
+    ierr = err_OK;
+    if (Stream->ierr == err_OK)
+      ierr = mg_write_stream_batch(Stream, Batch);
+    mg_free_stream_batch(Batch);
+    pthread_mutex_lock(&Stream->Lock);
+    if (ierr != err_OK && Stream->ierr == err_OK) Stream->ierr = ierr;
+  }
+  pthread_mutex_unlock(&Stream->Lock);
+  
+  return NULL;
+}
+
+/******************************************************************/
+/* function:  mg_stream_push */
+/* queues Batch for the writer, waits while the queue is full */
+static void mg_stream_push(mg_MeshStream *Stream,
+                           struct mg_StreamBatch *Batch)
+{
+  Batch->next = NULL;
+  pthread_mutex_lock(&Stream->Lock);
+  while (Stream->nQueued >= STREAMMAXQUEUE)
+    pthread_cond_wait(&Stream->Cond, &Stream->Lock);
+  if (Stream->Tail == NULL)
+    Stream->Head = Batch;
+  else
+    Stream->Tail->next = Batch;
+  Stream->Tail = Batch;
+  Stream->nQueued++;
+  pthread_cond_broadcast(&Stream->Cond);
+  pthread_mutex_unlock(&Stream->Lock);
+}
+
+/******************************************************************/
+/* function:  mg_stream_stop */
+/* lets the writer drain the queue and joins it (once) */
+static void mg_stream_stop(mg_MeshStream *Stream)
+{
+  bool done;
+  
+  pthread_mutex_lock(&Stream->Lock);
+  done = Stream->Done;
+  Stream->Done = true;
+  pthread_cond_broadcast(&Stream->Cond);
+  pthread_mutex_unlock(&Stream->Lock);
+  if (!done) pthread_join(Stream->Thread, NULL);
+}
+
+/******************************************************************/
+/* function:  mg_open_mesh_stream */
+/* creates FileName, writes its header and starts the writer thread */
+int mg_open_mesh_stream(mg_Mesh *Mesh, const char *FileName,
+                        double Bound, mg_MeshStream **pStream)
+{
+  int ierr;
+  mg_MeshStream *Stream;
+  
+  if (Mesh->Dim != 2) return error(err_NOT_SUPPORTED);
+  call(mg_alloc((void**)&Stream, 1, sizeof(mg_MeshStream)));
+  memset(Stream, 0, sizeof(mg_MeshStream));
+  Stream->Dim = Mesh->Dim;
+  Stream->Bound = (Bound > 0.0) ? Bound : STREAMBOUND;
+  pthread_mutex_init(&Stream->Lock, NULL);
+  pthread_cond_init(&Stream->Cond, NULL);
+  if ((Stream->fid = fopen(FileName, "w")) == NULL ||
+      (Stream->Spool = tmpfile()) == NULL) {
+    mg_destroy_mesh_stream(Stream);
+    return error(err_READWRITE_ERROR);
+  }
+  //counts are filled in by mg_close_mesh_stream (fixed width)
+  fprintf(Stream->fid, "%% Dim nNode nFace nElem nBfg\n");
+  Stream->HeaderPos = ftell(Stream->fid);
+  fprintf(Stream->fid, "%d %11d %11d %11d %d\n", Mesh->Dim, 0, 0, 0,
+          Mesh->nBfg);
+  fprintf(Stream->fid, "%% Node coordinates\n");
+  if (pthread_create(&Stream->Thread, NULL, mg_stream_writer,
+                     (void*)Stream) != 0) {
+    mg_destroy_mesh_stream(Stream);
+    return error(err_MEMORY_ERROR);
+  }
+  (*pStream) = Stream;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_stream_cell */
+/* cell index of x along direction d, clamped to the grid */
+static int mg_stream_cell(mg_MeshStream *Stream, int d, double x)
+{
+  double t = floor((x-Stream->Origin[d])/Stream->Cell);
+  
+  if (!(t > 0.0)) return 0;
+  if (t >= Stream->nCell[d]) return Stream->nCell[d]-1;
+  return (int)t;
+}
+
+/******************************************************************/
+/* function:  mg_stream_grid */
+/* bins the faces of Front on a uniform grid of about one face per
+ cell and flags their nodes */
+static int mg_stream_grid(mg_MeshStream *Stream, mg_Mesh *Mesh,
+                          mg_Front *Front)
+{
+  int ierr, iloop, n, k, c, i, j, i0, i1, j0, j1, nc;
+  bool first;
+  double *s, lo[2], hi[2], ext;
+  mg_FrontFace *FFace;
+  mg_Loop *Loop;
+  
+  //gather the front faces (walking the loops, as they are linked)
+  for (n = iloop = 0; iloop < Front->nloop; iloop++) {
+    Loop = Front->loop[iloop];
+    if (Loop->head == NULL) continue;
+    first = true;
+    for (FFace = Loop->head; first || FFace != Loop->head;
+         FFace = FFace->next, n++)
+      first = false;
+  }
+  Stream->nSeg = n;
+  memset(Stream->OnFront, 0, Stream->nNodeSlot);
+  if (n == 0) return err_OK;
+  call(mg_realloc((void**)&Stream->Seg, 4*n, sizeof(double)));
+  lo[0] = lo[1] = INFINITY;
+  hi[0] = hi[1] = -INFINITY;
+  for (k = iloop = 0; iloop < Front->nloop; iloop++) {
+    Loop = Front->loop[iloop];
+    if (Loop->head == NULL) continue;
+    first = true;
+    for (FFace = Loop->head; first || FFace != Loop->head;
+         FFace = FFace->next) {
+      first = false;
+      s = Stream->Seg+4*k++;
+      Stream->OnFront[FFace->face->node[0]] = 1;
+      Stream->OnFront[FFace->face->node[1]] = 1;
+      memcpy(s, Mesh->Coord+2*FFace->face->node[0], 2*sizeof(double));
+      memcpy(s+2, Mesh->Coord+2*FFace->face->node[1], 2*sizeof(double));
+      lo[0] = min(lo[0], min(s[0], s[2]));
+      lo[1] = min(lo[1], min(s[1], s[3]));
+      hi[0] = max(hi[0], max(s[0], s[2]));
+      hi[1] = max(hi[1], max(s[1], s[3]));
+    }
+  }
+  
+  //cell width from the longer side of the bounding box
+  nc = (int)ceil(sqrt((double)n));
+  ext = max(hi[0]-lo[0], hi[1]-lo[1]);
+  Stream->Cell = (ext > 0.0) ? ext/nc : 1.0;
+  Stream->Origin[0] = lo[0];
+  Stream->Origin[1] = lo[1];
+  Stream->nCell[0] = min(nc, (int)((hi[0]-lo[0])/Stream->Cell)+1);
+  Stream->nCell[1] = min(nc, (int)((hi[1]-lo[1])/Stream->Cell)+1);
+  nc = Stream->nCell[0]*Stream->nCell[1];
+  call(mg_realloc((void**)&Stream->CellStart, nc+1, sizeof(int)));
+  memset(Stream->CellStart, 0, (nc+1)*sizeof(int));
+  //a face goes in every cell its bounding box touches: count, then fill
+  for (k = 0; k < n; k++) {
+    s = Stream->Seg+4*k;
+    i0 = mg_stream_cell(Stream, 0, min(s[0], s[2]));
+    i1 = mg_stream_cell(Stream, 0, max(s[0], s[2]));
+    j0 = mg_stream_cell(Stream, 1, min(s[1], s[3]));
+    j1 = mg_stream_cell(Stream, 1, max(s[1], s[3]));
+    for (j = j0; j <= j1; j++)
+      for (i = i0; i <= i1; i++)
+        Stream->CellStart[j*Stream->nCell[0]+i+1]++;
+  }
+  for (c = 0; c < nc; c++)
+    Stream->CellStart[c+1] += Stream->CellStart[c];
+  call(mg_realloc((void**)&Stream->CellSeg, max(Stream->CellStart[nc], 1),
+                  sizeof(int)));
+  for (k = 0; k < n; k++) {
+    s = Stream->Seg+4*k;
+    i0 = mg_stream_cell(Stream, 0, min(s[0], s[2]));
+    i1 = mg_stream_cell(Stream, 0, max(s[0], s[2]));
+    j0 = mg_stream_cell(Stream, 1, min(s[1], s[3]));
+    j1 = mg_stream_cell(Stream, 1, max(s[1], s[3]));
+    for (j = j0; j <= j1; j++)
+      for (i = i0; i <= i1; i++)
+        Stream->CellSeg[Stream->CellStart[j*Stream->nCell[0]+i]++] = k;
+  }
+  //filling advanced every start to the next one
+  for (c = nc; c > 0; c--)
+    Stream->CellStart[c] = Stream->CellStart[c-1];
+  Stream->CellStart[0] = 0;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_stream_clear */
+/* true if no front face comes closer than R to center */
+static bool mg_stream_clear(mg_MeshStream *Stream, const double center[2],
+                            double R)
+{
+  int i, j, i0, i1, j0, j1, c, k;
+  double *s, dx, dy, ex, ey, t, L2;
+  
+  if (Stream->nSeg == 0) return true;
+  i0 = mg_stream_cell(Stream, 0, center[0]-R);
+  i1 = mg_stream_cell(Stream, 0, center[0]+R);
+  j0 = mg_stream_cell(Stream, 1, center[1]-R);
+  j1 = mg_stream_cell(Stream, 1, center[1]+R);
+  for (j = j0; j <= j1; j++) {
+    for (i = i0; i <= i1; i++) {
+      c = j*Stream->nCell[0]+i;
+      for (k = Stream->CellStart[c]; k < Stream->CellStart[c+1]; k++) {
+        //distance from center to the closest point of the face
+        s = Stream->Seg+4*Stream->CellSeg[k];
+        ex = s[2]-s[0];
+        ey = s[3]-s[1];
+        dx = center[0]-s[0];
+        dy = center[1]-s[1];
+        L2 = ex*ex+ey*ey;
+        t = (L2 > 0.0) ? (dx*ex+dy*ey)/L2 : 0.0;
+        t = max(0.0, min(1.0, t));
+        dx -= t*ex;
+        dy -= t*ey;
+        if (dx*dx+dy*dy <= R*R) return false;
+      }
+    }
+  }
+  
+  return true;
+}
+
+/******************************************************************/
+/* function:  mg_stream_elem_disk */
+/* disk that contains the region in which a new node breaks elem: the
+ circumcircle, or the circle around the Steiner circumellipse. Fails
+ (not reported) for degenerate elements */
+static int mg_stream_elem_disk(mg_Mesh *Mesh, int elem, bool ellipse,
+                               double center[2], double *R)
+{
+  int i, *node = Mesh->Elem[elem].node;
+  double X[6], D, A2, B2, C2;
+  mg_Ellipse Ellipse;
+  
+  for (i = 0; i < 3; i++) {
+    X[2*i] = Mesh->Coord[2*node[i]];
+    X[2*i+1] = Mesh->Coord[2*node[i]+1];
+  }
+  if (ellipse) {
+    mg_circumellipse(X, &Ellipse);
+    center[0] = Ellipse.Ot[0];
+    center[1] = Ellipse.Ot[1];
+    (*R) = max(Ellipse.rho[0], Ellipse.rho[1]);
+  }
+  else {
+    //same construction as mg_circumcircle
+    D = 2.*(X[0]*(X[3]-X[5])+X[2]*(X[5]-X[1])+X[4]*(X[1]-X[3]));
+    if (D == 0.0) return err_INPUT_ERROR;
+    A2 = X[0]*X[0]+X[1]*X[1];
+    B2 = X[2]*X[2]+X[3]*X[3];
+    C2 = X[4]*X[4]+X[5]*X[5];
+    center[0] = (A2*(X[3]-X[5])+B2*(X[5]-X[1])+C2*(X[1]-X[3]))/D;
+    center[1] = (A2*(X[4]-X[2])+B2*(X[0]-X[4])+C2*(X[2]-X[0]))/D;
+    (*R) = sqrt((X[0]-center[0])*(X[0]-center[0])+
+                (X[1]-center[1])*(X[1]-center[1]));
+  }
+  if (!isfinite(center[0]) || !isfinite(center[1]) || !isfinite(*R))
+    return err_INPUT_ERROR;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_stream_collect */
+/* numbers the pending elements that are final (all of them if Front
+ is NULL) and queues them with their new nodes */
+static int mg_stream_collect(mg_MeshStream *Stream, mg_Mesh *Mesh,
+                             mg_Metric *Metric, mg_Front *Front)
+{
+  int ierr, nSlot, e, i, n, k, nf, nNew, node0, elem, node, *Final;
+  bool final, ellipse;
+  double center[2], R;
+  struct mg_StreamBatch *Batch;
+  
+  //new element slots start out pending
+  nSlot = Mesh->nElem+Mesh->Stack->Elem->nItem;
+  if (nSlot > Stream->nElemSlot) {
+    call(mg_realloc((void**)&Stream->ElemOut, nSlot, sizeof(int)));
+    call(mg_realloc((void**)&Stream->Pending,
+                    Stream->nPending+nSlot-Stream->nElemSlot, sizeof(int)));
+    for (e = Stream->nElemSlot; e < nSlot; e++) {
+      Stream->ElemOut[e] = -1;
+      Stream->Pending[Stream->nPending++] = e;
+    }
+    Stream->nElemSlot = nSlot;
+  }
+  nSlot = Mesh->nNode+Mesh->Stack->Node->nItem;
+  if (nSlot > Stream->nNodeSlot) {
+    call(mg_realloc((void**)&Stream->NodeOut, nSlot, sizeof(int)));
+    call(mg_realloc((void**)&Stream->OnFront, nSlot, sizeof(unsigned char)));
+    for (n = Stream->nNodeSlot; n < nSlot; n++) {
+      Stream->NodeOut[n] = -1;
+      Stream->OnFront[n] = 0;
+    }
+    Stream->nNodeSlot = nSlot;
+  }
+  if (Stream->nPending == 0) return err_OK;
+  if (Front != NULL)
+    call(mg_stream_grid(Stream, Mesh, Front));
+  ellipse = (Metric != NULL && Metric->engine != mge_Engine_Circle);
+  
+  //number the final elements and the nodes they see first
+  call(mg_alloc((void**)&Final, Stream->nPending, sizeof(int)));
+  node0 = Stream->nNodeOut;
+  for (i = k = nf = 0; i < Stream->nPending; i++) {
+    elem = Stream->Pending[i];
+    //removed elements stay pending, their slot will be reused
+    final = !mg_is_stacked(Mesh->Stack->Elem, elem);
+    //a cavity always starts at a front face, so an element that still
+    //has a front node is kept even if the front is far from its disk
+    for (n = 0; final && Front != NULL && n < 3; n++)
+      final = !Stream->OnFront[Mesh->Elem[elem].node[n]];
+    if (final && Front != NULL) {
+      final = (mg_stream_elem_disk(Mesh, elem, ellipse, center, &R) == err_OK &&
+               mg_stream_clear(Stream, center, Stream->Bound*R));
+    }
+    if (!final) {
+      Stream->Pending[k++] = elem;
+      continue;
+    }
+    Final[nf++] = elem;
+    Stream->ElemOut[elem] = Stream->nElemOut++;
+    for (n = 0; n < 3; n++) {
+      node = Mesh->Elem[elem].node[n];
+      if (Stream->NodeOut[node] < 0)
+        Stream->NodeOut[node] = Stream->nNodeOut++;
+    }
+  }
+  Stream->nPending = k;
+  if (nf == 0) {
+    mg_free((void*)Final);
+    return err_OK;
+  }
+  
+  //copy them out in the same order
+  nNew = Stream->nNodeOut-node0;
+  call(mg_alloc((void**)&Batch, 1, sizeof(struct mg_StreamBatch)));
+  Batch->nNode = nNew;
+  Batch->nElem = nf;
+  Batch->Coord = NULL;
+  Batch->ElemNode = NULL;
+  if ((ierr = error(mg_alloc((void**)&Batch->Coord, max(nNew, 1)*Stream->Dim,
+                             sizeof(double)))) != err_OK ||
+      (ierr = error(mg_alloc((void**)&Batch->ElemNode, 3*nf,
+                             sizeof(int)))) != err_OK) {
+    mg_free_stream_batch(Batch);
+    mg_free((void*)Final);
+    return ierr;
+  }
+  for (i = 0, k = node0; i < nf; i++) {
+    elem = Final[i];
+    for (n = 0; n < 3; n++) {
+      node = Mesh->Elem[elem].node[n];
+      Batch->ElemNode[3*i+n] = Stream->NodeOut[node];
+      if (Stream->NodeOut[node] == k) {
+        memcpy(Batch->Coord+(k-node0)*Stream->Dim,
+               Mesh->Coord+node*Stream->Dim, Stream->Dim*sizeof(double));
+        k++;
+      }
+    }
+  }
+  mg_free((void*)Final);
+  mg_stream_push(Stream, Batch);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_stream_written */
+/* true if elem has been handed to the writer */
+bool mg_stream_written(mg_MeshStream *Stream, int elem)
+{
+  return (elem >= 0 && elem < Stream->nElemSlot &&
+          Stream->ElemOut[elem] >= 0);
+}
+
+/******************************************************************/
+/* function:  mg_stream_sweep */
+/* queues the elements that became final since the last sweep */
+int mg_stream_sweep(mg_MeshStream *Stream, mg_Mesh *Mesh,
+                    mg_Metric *Metric, mg_Front *Front)
+{
+  int ierr;
+  
+  if (Front == NULL) return error(err_INPUT_ERROR);
+  call(mg_stream_collect(Stream, Mesh, Metric, Front));
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_stream_finish */
+/* queues the nodes no element references, stops the writer and
+ completes the file */
+static int mg_stream_finish(mg_MeshStream *Stream, mg_Mesh *Mesh)
+{
+  int ierr, n, i, f, e, nFace, elem[2];
+  char buf[BUFSIZ];
+  size_t len;
+  struct mg_StreamBatch *Batch;
+  mg_FaceData *Face;
+  
+  //left over nodes
+  for (i = n = 0; i < Stream->nNodeSlot; i++)
+    if (Stream->NodeOut[i] < 0 && !mg_is_stacked(Mesh->Stack->Node, i))
+      n++;
+  if (n > 0) {
+    call(mg_alloc((void**)&Batch, 1, sizeof(struct mg_StreamBatch)));
+    Batch->nNode = n;
+    Batch->nElem = 0;
+    Batch->ElemNode = NULL;
+    if ((ierr = error(mg_alloc((void**)&Batch->Coord, n*Stream->Dim,
+                               sizeof(double)))) != err_OK) {
+      mg_free((void*)Batch);
+      return ierr;
+    }
+    for (i = n = 0; i < Stream->nNodeSlot; i++) {
+      if (Stream->NodeOut[i] < 0 && !mg_is_stacked(Mesh->Stack->Node, i)) {
+        Stream->NodeOut[i] = Stream->nNodeOut++;
+        memcpy(Batch->Coord+(n++)*Stream->Dim, Mesh->Coord+i*Stream->Dim,
+               Stream->Dim*sizeof(double));
+      }
+    }
+    mg_stream_push(Stream, Batch);
+  }
+  //stop the writer, the files are ours from here on
+  mg_stream_stop(Stream);
+  if (Stream->ierr != err_OK) return error(Stream->ierr);
+  
+  //boundary groups
+  fprintf(Stream->fid, "%% BGroup nBface\n");
+  for (i = 0; i < Mesh->nBfg; i++)
+    fprintf(Stream->fid, "%s %d\n",Mesh->BNames[i],Mesh->nBface[i]);
+  //elements from the spool
+  fprintf(Stream->fid, "%% Element to node connectivity\n");
+  rewind(Stream->Spool);
+  while ((len = fread(buf, 1, sizeof(buf), Stream->Spool)) > 0)
+    if (fwrite(buf, 1, len, Stream->fid) != len)
+      return error(err_READWRITE_ERROR);
+  if (ferror(Stream->Spool)) return error(err_READWRITE_ERROR);
+  //faces, renumbered
+  fprintf(Stream->fid, "%% n0 n1 eL eR\n");
+  nFace = Mesh->nFace+Mesh->Stack->Face->nItem;
+  for (i = n = 0; i < nFace; i++) {
+    if (mg_is_stacked(Mesh->Stack->Face, i)) continue;
+    Face = Mesh->Face[i];
+    for (f = 0; f < 2; f++) {
+      e = Face->elem[f];
+      //negative tags (boundaries, hollow) are kept
+      elem[f] = (e >= 0 && e < Stream->nElemSlot) ? Stream->ElemOut[e] : e;
+    }
+    fprintf(Stream->fid, "%d %d %d %d\n",Stream->NodeOut[Face->node[0]],
+            Stream->NodeOut[Face->node[1]],elem[LEFTNEIGHINDEX],
+            elem[RIGHTNEIGHINDEX]);
+    n++;
+  }
+  //counts, same width as the placeholders
+  if (fseek(Stream->fid, Stream->HeaderPos, SEEK_SET) != 0)
+    return error(err_READWRITE_ERROR);
+  fprintf(Stream->fid, "%d %11d %11d %11d %d\n", Stream->Dim,
+          Stream->nNodeOut, n, Stream->nElemOut, Mesh->nBfg);
+  if (fflush(Stream->fid) != 0 || ferror(Stream->fid))
+    return error(err_READWRITE_ERROR);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_close_mesh_stream */
+/* writes the rest of Mesh, completes the header and frees Stream */
+int mg_close_mesh_stream(mg_MeshStream *Stream, mg_Mesh *Mesh)
+{
+  int ierr;
+  
+  //without a front every remaining element is final
+  ierr = error(mg_stream_collect(Stream, Mesh, NULL, NULL));
+  if (ierr == err_OK)
+    ierr = error(mg_stream_finish(Stream, Mesh));
+  mg_stream_stop(Stream);
+  mg_destroy_mesh_stream(Stream);
+  
+  return ierr;
+}
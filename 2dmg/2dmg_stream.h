@@ -0,0 +1,64 @@
+//
+//  2dmg_stream.h
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#ifndef ___dmg___dmg_stream__
+#define ___dmg___dmg_stream__
+
+#include <stdio.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_metric_struct.h"
+
+/******************************************************************/
+/* streaming mesh output. Elements far behind the front are final: a
+ new node is always placed in the hollow and a cavity starts at a
+ front face, so an element with no node on the front whose
+ circumcircle (circumellipse with the ellipse engine) stays clear of
+ every front face is not broken in practice. mg_rm_broken_elems fails
+ with err_LOGIC_ERROR rather than remove an element already written.
+ mg_stream_sweep hands final elements and their nodes to a writer
+ thread that appends them to the output file while the front keeps
+ advancing. Nodes and elements are renumbered in the order they
+ become final; the file is a regular mesh text file (see
+ mg_write_mesh) once mg_close_mesh_stream adds the rest of the mesh
+ and the face section */
+
+//an element is final if no front face is closer to the center of its
+//circumcircle than STREAMBOUND circumradii
+#define STREAMBOUND       2.0
+//front advancement steps between sweeps
+#define STREAMSWEEP       64
+//batches queued before mg_stream_sweep waits for the writer
+#define STREAMMAXQUEUE    8
+
+/******************************************************************/
+/* function:  mg_open_mesh_stream */
+/* creates FileName, writes its header and starts the writer thread.
+ Bound <= 0 takes STREAMBOUND */
+int mg_open_mesh_stream(mg_Mesh *Mesh, const char *FileName,
+                        double Bound, mg_MeshStream **pStream);
+
+/******************************************************************/
+/* function:  mg_stream_sweep */
+/* queues the elements of Mesh that became final since the last sweep
+ (and the nodes they reference first) for writing */
+int mg_stream_sweep(mg_MeshStream *Stream, mg_Mesh *Mesh,
+                    mg_Metric *Metric, mg_Front *Front);
+
+/******************************************************************/
+/* function:  mg_stream_written */
+/* true if elem has been handed to the writer, it may not change any
+ more */
+bool mg_stream_written(mg_MeshStream *Stream, int elem);
+
+/******************************************************************/
+/* function:  mg_close_mesh_stream */
+/* writes everything not streamed yet, the boundary groups and the
+ faces of Mesh, completes the header and frees Stream */
+int mg_close_mesh_stream(mg_MeshStream *Stream, mg_Mesh *Mesh);
+
+#endif
@@ -9,10 +9,13 @@
 #ifndef _dmg__dmg_struct_h
 #define _dmg__dmg_struct_h
 
+#include <stdbool.h>
+#include <pthread.h>
 #include <gsl/gsl_interp.h>
 #include <gsl/gsl_multimin.h>
 #include <gsl/gsl_blas.h>
 #include "2dmg_qtree.h"
+#include "2dmg_lqtree.h"
 
 /******************************************************************/
 /* List structure */
@@ -74,6 +77,7 @@ struct mg_FrontFace
 {
   int ID; //global number for this face
   int iloop; //loop index within front
+  int Slot; //entry in the coordinate mirror of the front (-1 if none)
   mg_FaceData *face; //pointer to face in mesh
   struct mg_FrontFace *next, *prev; // links to keep loop contigous
 };
@@ -88,6 +92,37 @@ typedef struct
 }
 mg_Loop;
 
+/******************************************************************/
+/* structure-of-arrays copy of the front face end points, in no
+ particular order. Faces added or moved since the last sync are queued
+ in Dirty, removed faces give their entry to the last one */
+typedef struct
+{
+  int n, Size; //number of faces and allocated length
+  double *x0, *y0, *x1, *y1; //node[0] and node[1] coordinates
+  mg_FrontFace **FFace; //front face of each entry
+  unsigned char *Hit; //output of batched tests, one per entry
+  int nDirty, DirtySize; //queued faces and allocated length
+  mg_FrontFace **Dirty; //faces whose entry is missing or stale
+  unsigned int Version; //front version the copy was built at
+}
+mg_FrontCoord;
+
+/******************************************************************/
+/* pooled storage of front faces (see 2dmg_frontpool.h). Records are
+ carved from large blocks and recycled through a free list, so they
+ stay put until the pool is compacted into loop order */
+typedef struct
+{
+  int nBlock; //number of blocks
+  mg_FrontFace **Block; //blocks of records
+  int nRecord; //records in all blocks
+  int nActive; //records in use
+  int nRelease; //records released since the last compaction
+  mg_FrontFace *Free; //free records linked through next
+}
+mg_FrontPool;
+
 /******************************************************************/
 /* front structure: single structure containing possibly more than
  one loop (front) */
@@ -95,6 +130,10 @@ typedef struct
 {
   int nloop;
   mg_Loop **loop;
+  unsigned int Version; //incremented when the front faces move in memory
+  mg_FrontCoord *Coord; //coordinate mirror (NULL until first used)
+  mg_FrontPool *Pool; //storage of the front faces
+  struct mg_MeshStream *Stream; //elements written out (NULL if none)
 }
 mg_Front;
 
@@ -126,6 +165,37 @@ typedef struct
 }
 mg_Ellipse;
 
+/******************************************************************/
+/* native piecewise-cubic interpolant of a segment (2dmg_spline.h).
+ On interval i, with ds = t-s[i]:
+ x(t) = c[0][i]+ds*(c[1][i]+ds*(c[2][i]+ds*c[3][i]))
+ y(t) uses the same arrays offset by nInt (SoA) */
+typedef struct
+{
+  enum mge_GeoInterp type;
+  int nInt; //number of intervals
+  double *s; //breakpoints (points to the segment's s)
+  double hinv; //inverse spacing if breakpoints are uniform, else 0
+  double *c[4]; //coefficients, 2*nInt each
+  double *dd; //divided differences (mge_Polynomial only)
+}
+mg_Spline;
+
+/******************************************************************/
+/* arc-length and metric-length tables of a segment (2dmg_geo.h).
+ Cumulative lengths and their derivatives w.r.t. the parametric
+ coordinate at n+1 uniformly spaced breakpoints t[k] */
+typedef struct
+{
+  int n; //number of table intervals
+  double *t; //breakpoints
+  double *L, *dL; //physical arc length and dL/dt
+  double *Lm, *dLm; //metric length and dLm/dt (NULL if no metric set)
+  void *Metric; //metric used for Lm
+  int MetricType, MetricOrder;
+}
+mg_SegTable;
+
 /******************************************************************/
 /* segment structure */
 typedef struct
@@ -137,6 +207,8 @@ typedef struct
   //Geometry interpolation
   gsl_interp **interp;
   gsl_interp_accel **accel;
+  mg_Spline *Spline; //native evaluator of the same interpolant
+  mg_SegTable *Table; //parameter <-> length tables
   //metric interpolation
   //interpolation object for metric values (stored as SPD)
   double *Mij;
@@ -147,6 +219,31 @@ typedef struct
 }
 mg_Segment;
 
+/******************************************************************/
+/* segment discretization cache (see 2dmg_segcache.h) */
+typedef struct
+{
+  char *Dir; //directory holding the cache files
+  int nHit, nMiss, nStale, nStore; //statistics
+}
+mg_SegCache;
+
+/******************************************************************/
+/* point-to-boundary projection index (see 2dmg_proj.h) */
+typedef struct
+{
+  int nChunk, nSample; //number of chunks and samples per chunk
+  int *Seg; //segment of each chunk
+  double *t; //parametric coordinates of samples (nSample per chunk)
+  double *X; //sample coordinates (interleaved, nSample per chunk)
+  double *Box; //xmin, xmax, ymin, ymax per chunk (inflated by Sag)
+  double *Sag; //bound on curve to sample polyline distance per chunk
+  //uniform grid over chunk boxes in CSR form
+  int nx, ny, *CellPtr, *CellChunk;
+  double Origin[2], h[2];
+}
+mg_ProjIndex;
+
 /******************************************************************/
 /* geometry structure */
 typedef struct
@@ -154,6 +251,7 @@ typedef struct
   int nBoundary, nPoint, Dim;
   double *Coord;
   mg_Segment **Boundary;
+  mg_SegCache *Cache; //optional, not owned by the geometry
 }
 mg_Geometry;
 
@@ -164,6 +262,38 @@ struct mg_Item {
   struct mg_Item *next;
 };
 
+/******************************************************************/
+/* visitation marks (see 2dmg_marks.h): index i is marked if
+ Mark[i] == Epoch, starting a new epoch clears all marks at once */
+typedef struct
+{
+  unsigned int Epoch; //current generation, never 0
+  int Size; //allocated length of Mark
+  unsigned int *Mark; //epoch at which each index was marked
+}
+mg_MarkSet;
+
+typedef struct
+{
+  mg_MarkSet Node, Face, Elem;
+}
+mg_Marks;
+
+/******************************************************************/
+/* face geometry by face slot (see 2dmg_facegeom.h) */
+typedef struct
+{
+  int Size; //allocated face slots
+  int nSlot; //face slots when last updated
+  double *Normal, *Centroid; //Dim per face
+  double *Length, *MLength; //length and metric length (-1 if unknown)
+  void *Metric; //metric used for MLength (NULL: not computed)
+  int nDirty, DirtySize, *Dirty; //faces touched since the last update
+  unsigned char *IsDirty; //whether a face is in Dirty
+  bool All; //every face has to be computed
+}
+mg_FaceGeom;
+
 /******************************************************************/
 /* mesh structure */
 typedef struct
@@ -177,8 +307,142 @@ typedef struct
   mg_List *Node2Elem, *Node2Face;
   mg_MeshComponentStack *Stack;
   mg_qtree *QuadTree;
+  mg_Marks *Marks; //scratch marks for front advancement (created lazily)
+  int Pending; //derived data not built yet (see mg_mesh_require)
+  mg_FaceGeom *FaceGeom; //storage of the face geometry (NULL until set)
 }
 mg_Mesh;
 
+/******************************************************************/
+/* point locator structure */
+typedef struct
+{
+  mg_lqtree *Tree; //element centroids (data holds the element index)
+  int Last; //last element found
+  int nLocate; //number of locations
+  int MaxStep; //longest walk
+  long nStep; //total walk length
+}
+mg_Locator;
+
+/******************************************************************/
+/* memory-mapped text file (see 2dmg_text.h) */
+typedef struct
+{
+  char *Base; //mapped file, not NUL terminated (NULL if empty)
+  size_t Size; //file length in bytes
+  int nLine; //number of lines
+  size_t *Line; //line i spans [Line[i], Line[i+1]), line break included
+}
+mg_TextMap;
+
+/******************************************************************/
+/* read-only view of a mapped binary mesh file (see 2dmg_bmesh.h) */
+typedef struct
+{
+  void *Base; //start of the mapping
+  size_t Size; //mapped length in bytes
+  int Dim, nNode, nFace, nElem, nBfg;
+  int nElemNode; //nodes per element
+  const char *BNames; //boundary group names, MAXSTRLEN chars each
+  const int *nBface; //number of faces in each boundary group
+  const double *Coord; //nodal coordinates (Dim per node)
+  const int *ElemNode; //element-to-node (nElemNode per element)
+  const int *FaceNode; //face-to-node (2 per face)
+  const int *FaceElem; //left and right element of each face
+}
+mg_BMesh;
+
+/******************************************************************/
+/* batch of final nodes and elements handed to the writer thread of
+ a mesh stream */
+struct mg_StreamBatch
+{
+  int nNode, nElem;
+  double *Coord; //nodal coordinates (Dim per node)
+  int *ElemNode; //element-to-node in output numbering (3 per element)
+  struct mg_StreamBatch *next;
+};
+
+/******************************************************************/
+/* streaming mesh output (see 2dmg_stream.h) */
+typedef struct mg_MeshStream
+{
+  FILE *fid; //output file: header and nodes go in place
+  FILE *Spool; //element rows until the node section is complete
+  long HeaderPos; //offset of the line with the counts
+  int Dim;
+  double Bound; //front clearance in circumradii
+  int nNodeOut, nElemOut; //nodes and elements given a number so far
+  int nNodeSlot, *NodeOut; //output number of each node (-1: none yet)
+  unsigned char *OnFront; //whether a node was on the front at the last sweep
+  int nElemSlot, *ElemOut; //output number of each element (-1: none yet)
+  int nPending, *Pending; //elements not final yet
+  //front faces of the last sweep binned on a uniform grid
+  int nSeg; //number of front faces
+  double *Seg; //x0 y0 x1 y1 of each front face
+  int nCell[2];
+  double Origin[2], Cell; //lower corner and cell width
+  int *CellStart, *CellSeg; //faces of cell c: [CellStart[c],CellStart[c+1])
+  //writer thread
+  pthread_t Thread;
+  pthread_mutex_t Lock;
+  pthread_cond_t Cond;
+  struct mg_StreamBatch *Head, *Tail; //queued batches
+  int nQueued;
+  bool Done; //no more batches will be queued
+  int ierr; //first error of the writer
+}
+mg_MeshStream;
+
+/******************************************************************/
+/* buffered byte stream of a compressed mesh file (see 2dmg_cmesh.h) */
+typedef struct
+{
+  FILE *fid;
+  unsigned char *Buf; //Cap bytes
+  size_t Cap, Len; //capacity and bytes held
+  size_t Pos; //next byte to decode (reading only)
+  size_t Total; //bytes moved to or from the file so far
+}
+mg_CMeshIO;
+
+/******************************************************************/
+/* size and timing of a compressed mesh write or read */
+typedef struct
+{
+  size_t RawBytes; //the same arrays uncompressed (as in a .bmsh file)
+  size_t PackedBytes; //file length
+  double Seconds; //wall time of the encode or decode
+}
+mg_CMeshStats;
+
+/******************************************************************/
+/* asynchronous checkpoint writer (see 2dmg_checkpoint.h) */
+typedef struct
+{
+  char *FileName; //checkpoint file, replaced atomically
+  unsigned char *Data; //snapshot handed to the writer thread
+  size_t Len, Cap; //bytes in Data and allocated length
+  pthread_t Thread;
+  pthread_mutex_t Lock;
+  bool Busy; //the writer thread is still writing Data
+  bool Started; //a writer thread was started and not joined yet
+  int ierr; //first error of the writer
+  int nWrite, nSkip; //snapshots taken and skipped (writer busy)
+  double Seconds; //time spent taking snapshots
+}
+mg_Checkpoint;
+
+/******************************************************************/
+/* compressed row connectivity (see 2dmg_csr.h) */
+typedef struct
+{
+  int nRow;
+  int *Offset; //row i is Index[Offset[i]..Offset[i+1]), nRow+1 entries
+  int *Index;
+}
+mg_CSR;
+
 
 #endif
@@ -0,0 +1,396 @@
+//
+//  2dmg_text.c
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <float.h>
+#include <limits.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <omp.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_utils.h"
+#include "2dmg_text.h"
+
+#define textblank(c) ((c) == ' ' || (c) == '\t' || (c) == '\r' || (c) == '\n')
+#define textdigit(c) ((c) >= '0' && (c) <= '9')
+
+//the fast path needs every operation rounded to double
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD != 0
+#define TEXTFASTREAL 0
+#else
+#define TEXTFASTREAL 1
+#endif
+
+//powers of ten that are exact in double precision
+static const double mg_exact_pow10[23] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/******************************************************************/
+/* function:  mg_text_index */
+/* builds the line index of Text, chunks are counted and filled in
+ parallel */
+static int mg_text_index(mg_TextMap *Text)
+{
+  int ierr, nchunk, c, n;
+  size_t p, b, e, *cb;
+  int *count;
+  const char *q, *Base = Text->Base;
+  
+  nchunk = (int)min(Text->Size/TEXTCHUNKBYTES+1, (size_t)1024);
+  call(mg_alloc((void**)&cb, nchunk+1, sizeof(size_t)));
+  call(mg_alloc((void**)&count, nchunk+1, sizeof(int)));
+  //chunks start right after a line break
+  cb[0] = 0;
+  for (c = 1; c < nchunk; c++) {
+    p = max(Text->Size/nchunk*c, cb[c-1]);
+    q = (p < Text->Size) ? memchr(Base+p, '\n', Text->Size-p) : NULL;
+    cb[c] = (q == NULL) ? Text->Size : (size_t)(q-Base)+1;
+  }
+  cb[nchunk] = Text->Size;
+  
+  //a line starts at the beginning of a chunk and after every line
+  //break that is not the last byte of it
+#pragma omp parallel for schedule(static) private(p, e, q, n)
+  for (c = 0; c < nchunk; c++) {
+    n = 0;
+    if (cb[c] < cb[c+1]) {
+      n = 1;
+      e = cb[c+1]-1;
+      for (p = cb[c]; p < e; p = (size_t)(q-Base)+1) {
+        if ((q = memchr(Base+p, '\n', e-p)) == NULL) break;
+        n++;
+      }
+    }
+    count[c+1] = n;
+  }
+  count[0] = 0;
+  for (c = 0; c < nchunk; c++)
+    count[c+1] += count[c];
+  Text->nLine = count[nchunk];
+  
+  if ((ierr = error(mg_alloc((void**)&Text->Line, Text->nLine+1,
+                             sizeof(size_t)))) != err_OK) {
+    mg_free((void*)cb);
+    mg_free((void*)count);
+    return ierr;
+  }
+#pragma omp parallel for schedule(static) private(p, b, e, q, n)
+  for (c = 0; c < nchunk; c++) {
+    if (cb[c] == cb[c+1]) continue;
+    n = count[c];
+    Text->Line[n++] = b = cb[c];
+    e = cb[c+1]-1;
+    for (p = b; p < e; p = (size_t)(q-Base)+1) {
+      if ((q = memchr(Base+p, '\n', e-p)) == NULL) break;
+      Text->Line[n++] = (size_t)(q-Base)+1;
+    }
+  }
+  Text->Line[Text->nLine] = Text->Size;
+  
+  mg_free((void*)cb);
+  mg_free((void*)count);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_map_text */
+/* maps FileName read-only and builds its line index */
+int mg_map_text(const char *FileName, mg_TextMap **pText)
+{
+  int ierr, fd;
+  struct stat st;
+  mg_TextMap *Text;
+  
+  if ((fd = open(FileName, O_RDONLY)) < 0)
+    return error(err_READWRITE_ERROR);
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return error(err_READWRITE_ERROR);
+  }
+  if ((ierr = error(mg_alloc((void**)&Text, 1, sizeof(mg_TextMap)))) != err_OK){
+    close(fd);
+    return ierr;
+  }
+  Text->Base = NULL;
+  Text->Size = (size_t)st.st_size;
+  Text->nLine = 0;
+  Text->Line = NULL;
+  //an empty file cannot be mapped but is a valid text
+  if (Text->Size > 0) {
+    Text->Base = mmap(NULL, Text->Size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (Text->Base == MAP_FAILED) {
+      close(fd);
+      mg_free((void*)Text);
+      return error(err_READWRITE_ERROR);
+    }
+    //lines are read front to back
+    madvise(Text->Base, Text->Size, MADV_SEQUENTIAL);
+  }
+  close(fd);
+  if ((ierr = error(mg_text_index(Text))) != err_OK) {
+    mg_unmap_text(Text);
+    return ierr;
+  }
+  (*pText) = Text;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_unmap_text */
+void mg_unmap_text(mg_TextMap *Text)
+{
+  if (Text == NULL) return;
+  if (Text->Base != NULL)
+    munmap(Text->Base, Text->Size);
+  mg_free((void*)Text->Line);
+  mg_free((void*)Text);
+}
+
+/******************************************************************/
+/* function:  mg_text_skip_comments */
+/* advances (*piline) past lines starting with '%' */
+int mg_text_skip_comments(mg_TextMap *Text, int *piline)
+{
+  while ((*piline) < Text->nLine &&
+         Text->Base[Text->Line[(*piline)]] == '%')
+    (*piline)++;
+  
+  return ((*piline) < Text->nLine) ? err_OK : err_NOT_FOUND;
+}
+
+/******************************************************************/
+/* function:  mg_text_get_line */
+/* copies line iline (without the line break) into line */
+int mg_text_get_line(mg_TextMap *Text, int iline, char *line, int len)
+{
+  size_t b, e;
+  
+  if (iline < 0 || iline >= Text->nLine) return error(err_READWRITE_ERROR);
+  b = Text->Line[iline];
+  e = Text->Line[iline+1];
+  while (e > b && (Text->Base[e-1] == '\n' || Text->Base[e-1] == '\r'))
+    e--;
+  if (e-b >= (size_t)len) return error(err_OUT_OF_BOUNDS);
+  memcpy(line, Text->Base+b, e-b);
+  line[e-b] = '\0';
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_text_token */
+/* delimits the next token in [(*ps), end) as [(*pb), (*ps)) */
+static int mg_text_token(const char **ps, const char *end, const char **pb)
+{
+  const char *s = (*ps);
+  
+  while (s < end && textblank(*s)) s++;
+  if (s == end) {
+    (*ps) = s;
+    return err_NOT_FOUND;
+  }
+  (*pb) = s;
+  while (s < end && !textblank(*s)) s++;
+  (*ps) = s;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_strtod_token */
+/* converts the token [b,e) with strtod, all of it must be consumed */
+static int mg_strtod_token(const char *b, const char *e, double *v)
+{
+  char buf[TEXTMAXTOKEN], *stop;
+  
+  if (e-b >= TEXTMAXTOKEN) return err_READWRITE_ERROR;
+  memcpy(buf, b, e-b);
+  buf[e-b] = '\0';
+  (*v) = strtod(buf, &stop);
+  
+  return (stop == buf+(e-b)) ? err_OK : err_READWRITE_ERROR;
+}
+
+/******************************************************************/
+/* function:  mg_parse_real */
+/* parses the next token in [(*ps), end) as a double */
+int mg_parse_real(const char **ps, const char *end, double *v)
+{
+  int ierr, nd = 0, ndig = 0, e10 = 0, x, esign;
+  bool neg = false, exact = true;
+  uint64_t m = 0;
+  double d;
+  const char *b, *e, *p;
+  
+  if ((ierr = mg_text_token(ps, end, &b)) != err_OK) return ierr;
+  e = (*ps);
+  if (!TEXTFASTREAL) return mg_strtod_token(b, e, v);
+  
+  //decimal mantissa, up to 19 significant digits
+  p = b;
+  if (*p == '+' || *p == '-') neg = (*p++ == '-');
+  for (; p < e && textdigit(*p); p++, ndig++) {
+    if (m == 0 && *p == '0') continue;
+    if (nd < 19) {
+      m = 10*m+(uint64_t)(*p-'0');
+      nd++;
+    }
+    else {
+      e10++;
+      exact = false;
+    }
+  }
+  if (p < e && *p == '.') {
+    for (p++; p < e && textdigit(*p); p++, ndig++) {
+      if (m == 0 && *p == '0') {
+        e10--;
+        continue;
+      }
+      if (nd < 19) {
+        m = 10*m+(uint64_t)(*p-'0');
+        nd++;
+        e10--;
+      }
+      else
+        exact = false;
+    }
+  }
+  if (ndig == 0) return mg_strtod_token(b, e, v);
+  //exponent
+  if (p < e && (*p == 'e' || *p == 'E')) {
+    p++;
+    esign = 1;
+    if (p < e && (*p == '+' || *p == '-')) esign = (*p++ == '-') ? -1 : 1;
+    if (p == e || !textdigit(*p)) return mg_strtod_token(b, e, v);
+    for (x = 0; p < e && textdigit(*p); p++)
+      if (x < 100000) x = 10*x+(*p-'0');
+    e10 += esign*x;
+  }
+  //anything else (hex, inf, nan, junk) is left to strtod
+  if (p != e || !exact) return mg_strtod_token(b, e, v);
+  
+  if (m == 0) {
+    (*v) = neg ? -0.0 : 0.0;
+    return err_OK;
+  }
+  //m and 10^|e10| are exact, so one correctly rounded operation gives
+  //the correctly rounded result (Clinger's fast path)
+  if (m <= ((uint64_t)1 << 53) && e10 >= -22 && e10 <= 22) {
+    d = (double)m;
+    d = (e10 < 0) ? d/mg_exact_pow10[-e10] : d*mg_exact_pow10[e10];
+    (*v) = neg ? -d : d;
+    return err_OK;
+  }
+  
+  return mg_strtod_token(b, e, v);
+}
+
+/******************************************************************/
+/* function:  mg_parse_int */
+/* same as mg_parse_real for an integer token */
+int mg_parse_int(const char **ps, const char *end, int *v)
+{
+  int ierr;
+  bool neg = false;
+  long long x = 0;
+  const char *b, *e, *p;
+  
+  if ((ierr = mg_text_token(ps, end, &b)) != err_OK) return ierr;
+  e = (*ps);
+  p = b;
+  if (*p == '+' || *p == '-') neg = (*p++ == '-');
+  if (p == e) return err_READWRITE_ERROR;
+  for (; p < e; p++) {
+    if (!textdigit(*p)) return err_READWRITE_ERROR;
+    x = 10*x+(*p-'0');
+    if (x > (long long)INT_MAX+1) return err_READWRITE_ERROR;
+  }
+  if (neg) x = -x;
+  if (x > INT_MAX) return err_READWRITE_ERROR;
+  (*v) = (int)x;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_text_scan_n_int */
+/* parses up to nmax integers from line iline */
+int mg_text_scan_n_int(mg_TextMap *Text, int iline, int nmax, int *n,
+                       int *vi)
+{
+  int ierr, k, dummy;
+  const char *s, *end;
+  
+  if (iline < 0 || iline >= Text->nLine) return error(err_READWRITE_ERROR);
+  s = Text->Base+Text->Line[iline];
+  end = Text->Base+Text->Line[iline+1];
+  for (k = 0; (ierr = mg_parse_int(&s, end, (k < nmax) ? vi+k : &dummy))
+       == err_OK; k++);
+  if (ierr != err_NOT_FOUND || k > nmax) return error(err_READWRITE_ERROR);
+  (*n) = k;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_text_read_real */
+/* parses nLine lines of nPer reals into v in parallel */
+int mg_text_read_real(mg_TextMap *Text, int line0, int nLine, int nPer,
+                      double *v)
+{
+  int i, k, nbad = 0;
+  double extra;
+  const char *s, *end;
+  
+  if (line0 < 0 || nLine < 0 || line0+nLine > Text->nLine)
+    return error(err_READWRITE_ERROR);
+#pragma omp parallel for schedule(static) private(k, s, end, extra) reduction(+:nbad) if(nLine > TEXTPARMINLINES)
+  for (i = 0; i < nLine; i++) {
+    s = Text->Base+Text->Line[line0+i];
+    end = Text->Base+Text->Line[line0+i+1];
+    for (k = 0; k < nPer; k++)
+      if (mg_parse_real(&s, end, v+(size_t)i*nPer+k) != err_OK) break;
+    //exactly nPer numbers per line
+    if (k < nPer || mg_parse_real(&s, end, &extra) != err_NOT_FOUND)
+      nbad++;
+  }
+  if (nbad > 0) return error(err_READWRITE_ERROR);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_text_read_int */
+/* same as mg_text_read_real for integers */
+int mg_text_read_int(mg_TextMap *Text, int line0, int nLine, int nPer,
+                     int *v)
+{
+  int i, k, nbad = 0, extra;
+  const char *s, *end;
+  
+  if (line0 < 0 || nLine < 0 || line0+nLine > Text->nLine)
+    return error(err_READWRITE_ERROR);
+#pragma omp parallel for schedule(static) private(k, s, end, extra) reduction(+:nbad) if(nLine > TEXTPARMINLINES)
+  for (i = 0; i < nLine; i++) {
+    s = Text->Base+Text->Line[line0+i];
+    end = Text->Base+Text->Line[line0+i+1];
+    for (k = 0; k < nPer; k++)
+      if (mg_parse_int(&s, end, v+(size_t)i*nPer+k) != err_OK) break;
+    if (k < nPer || mg_parse_int(&s, end, &extra) != err_NOT_FOUND)
+      nbad++;
+  }
+  if (nbad > 0) return error(err_READWRITE_ERROR);
+  
+  return err_OK;
+}
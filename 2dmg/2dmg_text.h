@@ -0,0 +1,84 @@
+//
+//  2dmg_text.h
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#ifndef ___dmg___dmg_text__
+#define ___dmg___dmg_text__
+
+#include <stdio.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+
+/******************************************************************/
+/* memory-mapped text files. The file is mapped whole and indexed by
+ line in parallel. Blocks of lines holding a fixed number of numbers
+ are then parsed in parallel. Tokens are separated by blanks, tabs or
+ carriage returns; there is no limit on the line length.
+ Reals are converted exactly as strtod does. Tokens that fit a double
+ mantissa and need at most a power of ten up to 1e22 take an exact
+ fast path, the rest are handed to strtod */
+
+//bytes indexed per parallel chunk (approximately)
+#define TEXTCHUNKBYTES    (1<<20)
+//blocks with fewer lines are parsed serially
+#define TEXTPARMINLINES   4096
+//longest token handed to strtod
+#define TEXTMAXTOKEN      MAXSTRLEN
+
+/******************************************************************/
+/* function:  mg_map_text */
+/* maps FileName read-only and builds its line index */
+int mg_map_text(const char *FileName, mg_TextMap **pText);
+
+/******************************************************************/
+/* function:  mg_unmap_text */
+void mg_unmap_text(mg_TextMap *Text);
+
+/******************************************************************/
+/* function:  mg_text_skip_comments */
+/* advances (*piline) past lines starting with '%'. Returns
+ err_NOT_FOUND (not reported) at the end of the file */
+int mg_text_skip_comments(mg_TextMap *Text, int *piline);
+
+/******************************************************************/
+/* function:  mg_text_get_line */
+/* copies line iline (without the line break) into line, a buffer of
+ len characters, for parsing with sscanf */
+int mg_text_get_line(mg_TextMap *Text, int iline, char *line, int len);
+
+/******************************************************************/
+/* function:  mg_parse_real */
+/* parses the next token in [(*ps), end) as a double and advances
+ (*ps) past it. Returns err_NOT_FOUND (not reported) if only blanks
+ are left and err_READWRITE_ERROR if the token is not a number */
+int mg_parse_real(const char **ps, const char *end, double *v);
+
+/******************************************************************/
+/* function:  mg_parse_int */
+/* same as mg_parse_real for an integer token */
+int mg_parse_int(const char **ps, const char *end, int *v);
+
+/******************************************************************/
+/* function:  mg_text_scan_n_int */
+/* parses up to nmax integers from line iline, (*n) receives their
+ number. Counterpart of mg_scan_n_num */
+int mg_text_scan_n_int(mg_TextMap *Text, int iline, int nmax, int *n,
+                       int *vi);
+
+/******************************************************************/
+/* function:  mg_text_read_real */
+/* parses nLine lines starting at line0, each holding exactly nPer
+ reals, into v (row by row) in parallel */
+int mg_text_read_real(mg_TextMap *Text, int line0, int nLine, int nPer,
+                      double *v);
+
+/******************************************************************/
+/* function:  mg_text_read_int */
+/* same as mg_text_read_real for integers */
+int mg_text_read_int(mg_TextMap *Text, int line0, int nLine, int nPer,
+                     int *v);
+
+#endif
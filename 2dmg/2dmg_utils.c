@@ -11,6 +11,15 @@
 #include "2dmg_struct.h"
 #include "2dmg_metric_struct.h"
 #include "2dmg_math.h"
+#include "2dmg_spline.h"
+#include "2dmg_geo.h"
+#include "2dmg_locate.h"
+#include "2dmg_marks.h"
+#include "2dmg_pred.h"
+#include "2dmg_io.h"
+#include "2dmg_csr.h"
+#include "2dmg_edge.h"
+#include "2dmg_facegeom.h"
 
 /******************************************************************/
 /* function:  mg_alloc*/
@@ -148,6 +157,9 @@ int mg_create_mesh(mg_Mesh **pMesh)
   
   call(mg_alloc((void**)&(*pMesh)->QuadTree, 1, sizeof(mg_qtree)));
   call(mg_init_branch((*pMesh)->QuadTree));
+  (*pMesh)->Marks = NULL;
+  (*pMesh)->Pending = 0;
+  (*pMesh)->FaceGeom = NULL;
   
   return err_OK;
 }
@@ -171,16 +183,15 @@ void mg_destroy_mesh(mg_Mesh *Mesh)
     mg_free((void*)Mesh->Elem[i].face);
   }
   mg_free((void*)Mesh->Elem);
-  //faces
+  //faces (their normals and centroids are in FaceGeom)
   for (i = 0; i < Mesh->nFace; i++) {
     mg_free((void*)Mesh->Face[i]->node);
-    mg_free((void*)Mesh->Face[i]->normal);
-    mg_free((void*)Mesh->Face[i]->centroid);
     Mesh->Face[i]->node = NULL;
     Mesh->Face[i]->normal = Mesh->Face[i]->centroid = NULL;
     mg_free((void*)Mesh->Face[i]);
   }
   mg_free((void*)Mesh->Face);
+  mg_destroy_face_geom(Mesh->FaceGeom);
   //destroy connectivities
   for (i = 0; i < Mesh->nNode; i++) {
     if (Mesh->Node2Elem != NULL)
@@ -201,7 +212,8 @@ void mg_destroy_mesh(mg_Mesh *Mesh)
   mg_free((void*)Mesh->Stack);
   //destroy quadtree
   mg_destroy_branch(Mesh->QuadTree);
-  
+  //destroy marks
+  mg_destroy_marks(Mesh->Marks);
   
   mg_free((void*)Mesh);
 }
@@ -315,7 +327,7 @@ int mg_rm_frm_ord_set(const int entry, int *set_size, int **set,
       rank--;
     rank++;
     dest = rank;
-    while ((*set)[rank] == entry && n2Rm >= 0 && rank < (*set_size)) {
+    while (rank < (*set_size) && (*set)[rank] == entry && n2Rm >= 0) {
       rank++;
       n2Rm--;
     }
@@ -333,53 +345,131 @@ int mg_rm_frm_ord_set(const int entry, int *set_size, int **set,
   return err_OK;
 }
 
+/******************************************************************/
+/* function: mg_is_stacked */
+/* true if id is in the ordered set of removed components Stack */
+bool mg_is_stacked(mg_List *Stack, int id)
+{
+  return (Stack != NULL && Stack->nItem > 0 &&
+          mg_binary_search(id, Stack->Item, 0, Stack->nItem-1,
+                           NULL) == err_OK);
+}
+
+/******************************************************************/
+/* function: mg_live_slots */
+/* lists in Live the component slots below nSlot that are not in
+ Stack and sets Map[slot] to their position in Live (-1 if stacked) */
+int mg_live_slots(mg_List *Stack, int nSlot, int *Live, int *Map)
+{
+  int i, k, n;
+  
+  //the stack is ordered, walk it along the slots
+  for (i = k = n = 0; i < nSlot; i++) {
+    while (Stack != NULL && k < Stack->nItem && Stack->Item[k] < i) k++;
+    if (Stack != NULL && k < Stack->nItem && Stack->Item[k] == i) {
+      if (Map != NULL) Map[i] = -1;
+      continue;
+    }
+    if (Map != NULL) Map[i] = n;
+    if (Live != NULL) Live[n] = i;
+    n++;
+  }
+  
+  return n;
+}
+
+/******************************************************************/
+/* function: mg_build_node2elem */
+/* builds the Node2Elem connectivity through its CSR */
+static int mg_build_node2elem(mg_Mesh *Mesh)
+{
+  int ierr;
+  mg_CSR *CSR;
+  
+  call(mg_build_node2elem_csr(Mesh, &CSR));
+  ierr = error(mg_csr_2_lists(CSR, &Mesh->Node2Elem));
+  mg_destroy_csr(CSR);
+  if (ierr != err_OK) return ierr;
+  Mesh->Pending &= ~MESHNODE2ELEM;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function: mg_build_node2face */
+/* builds the Node2Face connectivity through its CSR */
+static int mg_build_node2face(mg_Mesh *Mesh)
+{
+  int ierr;
+  mg_CSR *CSR;
+  
+  call(mg_build_node2face_csr(Mesh, &CSR));
+  ierr = error(mg_csr_2_lists(CSR, &Mesh->Node2Face));
+  mg_destroy_csr(CSR);
+  if (ierr != err_OK) return ierr;
+  Mesh->Pending &= ~MESHNODE2FACE;
+  
+  return err_OK;
+}
+
 /******************************************************************/
 /* function: mg_build_connectivity */
 /* builds Node2Elem and Node2Face connectivities */
 int mg_build_connectivity(mg_Mesh *Mesh)
 {
-  int ierr, elem, node, in, face, istack;
+  int ierr;
   
-  //Node2Elem
-  if (Mesh->Node2Elem == NULL){
-    call(mg_alloc((void**)&Mesh->Node2Elem, Mesh->nNode, sizeof(mg_List)));
-    for (node = 0; node < Mesh->nNode; node++)
-      mg_init_list(&Mesh->Node2Elem[node]);
-  }
-  istack = 0;
-  for (elem = 0; elem < Mesh->nElem; elem++) {
-    //skip if on stack
-    if (Mesh->Stack->Elem->nItem >0)
-      if (elem == Mesh->Stack->Elem->Item[istack]){
-        istack++;
-        continue;
-      }
-    for (in = 0; in < Mesh->Elem[elem].nNode; in++) {
-      node = Mesh->Elem[elem].node[in];
-      call(mg_add_2_ord_set(elem, &Mesh->Node2Elem[node].nItem,
-                            &Mesh->Node2Elem[node].Item, NULL, false));
+  call(mg_build_node2elem(Mesh));
+  call(mg_build_node2face(Mesh));
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function: mg_mesh_require */
+/* builds the derived data in What that Mesh does not have yet */
+int mg_mesh_require(mg_Mesh *Mesh, int What)
+{
+  int ierr, i, j, nopen;
+  mg_ElemData *Elem;
+  
+  What &= Mesh->Pending;
+  //the quadtree stores pointers to the node-to-face lists
+  if (What & MESHQTREE) What |= (Mesh->Pending & MESHNODE2FACE);
+  //links go first: they rebuild the faces of an incomplete face table
+  if (What & MESHLINKS) {
+    for (i = 0; i < Mesh->nElem; i++) {
+      Elem = Mesh->Elem+i;
+      if (Elem->face == NULL)
+        call(mg_alloc((void**)&Elem->face, Elem->nNode, sizeof(int)));
+      if (Elem->nbor == NULL)
+        call(mg_alloc((void**)&Elem->nbor, Elem->nNode, sizeof(int)));
+      for (j = 0; j < Elem->nNode; j++)
+        Elem->face[j] = Elem->nbor[j] = -1;
     }
-  }
-  //Node2Face
-  if (Mesh->Node2Face == NULL){
-    call(mg_alloc((void**)&Mesh->Node2Face, Mesh->nNode, sizeof(mg_List)));
-    for (node = 0; node < Mesh->nNode; node++)
-      mg_init_list(&Mesh->Node2Face[node]);
-  }
-  istack = 0;
-  for (face = 0; face < Mesh->nFace; face++) {
-    //skip if on stack
-    if (Mesh->Stack->Face->nItem >0)
-      if (face == Mesh->Stack->Face->Item[istack]){
-        istack++;
-        continue;
-      }
-    for (in = 0; in < Mesh->Face[face]->nNode; in++) {
-      node = Mesh->Face[face]->node[in];
-      call(mg_add_2_ord_set(face, &Mesh->Node2Face[node].nItem,
-                            &Mesh->Node2Face[node].Item, NULL, false));
+    for (i = 0; i < Mesh->nFace; i++)
+      call(mg_link_face(Mesh, i));
+    Mesh->Pending &= ~MESHLINKS;
+    //sides no face covers: the file gave elements and at most their
+    //boundary faces
+    for (i = 0, nopen = 0; i < Mesh->nElem && nopen == 0; i++)
+      for (j = 0; j < Mesh->Elem[i].nNode; j++)
+        if (Mesh->Elem[i].face[j] < 0) nopen++;
+    if (nopen > 0) {
+      call(mg_build_faces(Mesh));
+      What |= (Mesh->Pending & MESHFACEGEOM);
     }
   }
+  if (What & MESHNODE2ELEM)
+    call(mg_build_node2elem(Mesh));
+  if (What & MESHNODE2FACE)
+    call(mg_build_node2face(Mesh));
+  if (What & MESHFACEGEOM)
+    call(mg_calc_face_info(Mesh));
+  if (What & MESHQTREE) {
+    call(mg_build_node_qtree(Mesh));
+    Mesh->Pending &= ~MESHQTREE;
+  }
   
   return err_OK;
 }
@@ -497,70 +587,84 @@ int mg_add_2_ord_data_list(int entry, void **Data,
 
 /******************************************************************/
 /* function: mg_coord_inside_elem */
-/* checks if a coordinate is inside an element */
+/* checks if a coordinate is inside an element or on its boundary
+ (exact orientation tests) */
 bool mg_coord_inside_elem(mg_Mesh *Mesh, int elem, double coord[2])
 {
-  bool inside;
-  int nleft = 0, sgn, i, d, dim = Mesh->Dim;
-  double proj;
-  mg_FaceData *face;
-  //loop around element and if coord is to the left of all faces,
-  //element contains coord.
-  for (i = 0; i < Mesh->Elem[elem].nNode; i++) {
-    face = Mesh->Face[Mesh->Elem[elem].face[i]];
-    if (elem == face->elem[LEFTNEIGHINDEX]) sgn = 1;
-    else sgn = -1;
-    for (proj = 0.0, d = 0; d < dim; d++)
-      proj+=sgn*face->normal[d]*(coord[d]-face->centroid[d]);
-    if (proj > 1.0e-6) nleft++;
-  }
-  inside = (nleft == 3);
+  int i, n = Mesh->Elem[elem].nNode, *node = Mesh->Elem[elem].node;
+  double const *X = Mesh->Coord;
   
-  return inside;
+  if (Mesh->Dim != 2) return false;
+  //elements are counter-clockwise: coord must not be to the right
+  //of any edge
+  for (i = 0; i < n; i++)
+    if (mg_orient2d(X+2*node[i], X+2*node[(i+1)%n], coord) < 0.0)
+      return false;
+  
+  return true;
 }
 
 /******************************************************************/
 /* function: mg_edges_intersect */
-/* checks if edges defined by *X0 and *X1 intersect, if so,
- xint receives the intersection point*/
+/* checks if edges defined by *X0 and *X1 (x0,y0,x1,y1) intersect,
+ touching and overlapping edges included, if so, xint receives the
+ intersection point. Uses exact orientation tests*/
 bool mg_edges_intersect(double X0[4], double X1[4], double *xint)
 {
-  double det, m11, m12, m21, m22, b0, b1, x00, x01, x10, x11;
-  double y00, y01, y10, y11, qsi0, qsi1;
+  int i;
+  double det, m11, m12, m21, m22, b0, b1, qsi0, o[4], lo, hi;
   
-  x00 = X0[0];
-  x01 = X0[2];
-  x10 = X1[0];
-  x11 = X1[2];
+  //bounding boxes of the edges do not overlap
+  for (i = 0; i < 2; i++)
+    if (max(X0[i], X0[2+i]) < min(X1[i], X1[2+i]) ||
+        max(X1[i], X1[2+i]) < min(X0[i], X0[2+i]))
+      return false;
   
-  y00 = X0[1];
-  y01 = X0[3];
-  y10 = X1[1];
-  y11 = X1[3];
+  //exact sides of each edge's end points w.r.t. the other edge
+  o[0] = mg_orient2d(X0, X0+2, X1);
+  o[1] = mg_orient2d(X0, X0+2, X1+2);
+  if ((o[0] > 0.0 && o[1] > 0.0) || (o[0] < 0.0 && o[1] < 0.0))
+    return false;
+  o[2] = mg_orient2d(X1, X1+2, X0);
+  o[3] = mg_orient2d(X1, X1+2, X0+2);
+  if ((o[2] > 0.0 && o[3] > 0.0) || (o[2] < 0.0 && o[3] < 0.0))
+    return false;
   
-  m11 = x01-x00;
-  m12 = -x11+x10;
-  m21 = y01-y00;
-  m22 = -y11+y10;
+  if (o[0] == 0.0 && o[1] == 0.0) {
+    //colinear and, since the boxes overlap, overlapping: report an
+    //end point of one edge lying on the other
+    i = (fabs(X0[2]-X0[0]) >= fabs(X0[3]-X0[1])) ? 0 : 1;
+    lo = min(X0[i], X0[2+i]);
+    hi = max(X0[i], X0[2+i]);
+    if (X1[i] >= lo && X1[i] <= hi) {
+      xint[0] = X1[0];
+      xint[1] = X1[1];
+    }
+    else if (X1[2+i] >= lo && X1[2+i] <= hi) {
+      xint[0] = X1[2];
+      xint[1] = X1[3];
+    }
+    else {
+      xint[0] = X0[0];
+      xint[1] = X0[1];
+    }
+    return true;
+  }
   
+  m11 = X0[2]-X0[0];
+  m12 = X1[0]-X1[2];
+  m21 = X0[3]-X0[1];
+  m22 = X1[1]-X1[3];
   det = m11*m22-m21*m12;
-  //check if edges are approximately parallel
-  if (fabs(det) <= 1e-7) return false;
+  b0 = X1[0]-X0[0];
+  b1 = X1[1]-X0[1];
+  //edges cross or touch, keep the point on X0 despite roundoff
+  qsi0 = (det != 0.0) ? (m22*b0-m12*b1)/det : 0.0;
+  qsi0 = min(max(qsi0, 0.0), 1.0);
+  xint[0] = X0[0]*(1.0-qsi0)+X0[2]*qsi0;
+  xint[1] = X0[1]*(1.0-qsi0)+X0[3]*qsi0;
   
-  b0 = -x00+x10;
-  b1 = -y00+y10;
-  
-  qsi0 = (m22*b0-m12*b1)/det;
-  qsi1 = (-m21*b0+m11*b1)/det;
-  
-  if ((qsi0 >= 0.0 && qsi0 <= 1.0) &&
-      (qsi1 >= 0.0 && qsi1 <= 1.0)){
-    xint[0] = x00*(1.0-qsi0)+x01*qsi0;
-    xint[1] = y00*(1.0-qsi0)+y01*qsi0;
-    return true;
-  }
-  else
-    return false;
+  return true;
 }
 
 /******************************************************************/
@@ -569,50 +673,15 @@ bool mg_edges_intersect(double X0[4], double X1[4], double *xint)
 int mg_find_elem_frm_coord(mg_Mesh *Mesh, int elem_start,
                            double coord[2], int *pelem)
 {
-  int ierr, iface, i, dim, node0, node1;
-  double X0[4], X1[4], Xint[2];
-  bool intersect = false;
+  int ierr;
   
-  dim = Mesh->Dim;
+  //iterative walk (no recursion depth limit on large meshes)
+  ierr = mg_walk_to_point(Mesh, elem_start, coord, pelem, NULL);
+  if (ierr != err_OK) return ierr;
+  //found the element but let's verify
+  if (!mg_coord_inside_elem(Mesh, (*pelem), coord))
+    return error(err_LOGIC_ERROR);
   
-  X0[0] = coord[0]; X0[1] = coord[1];
-  X0[2] = X0[3] = 0.0;
-  //get elem centroid
-  for (i = 0; i < Mesh->Elem[elem_start].nNode; i++) {
-    node0 = Mesh->Elem[elem_start].node[i];
-    X0[2] += Mesh->Coord[node0*dim+0];
-    X0[3] += Mesh->Coord[node0*dim+1];
-  }
-  X0[2] /= Mesh->Elem[elem_start].nNode;
-  X0[3] /= Mesh->Elem[elem_start].nNode;
-//  printf("%d %1.6e %1.6e %1.6e %1.6e\n",elem_start,X0[0],X0[1],X0[2],X0[3]);
-  
-  for (iface = 0; iface < Mesh->Elem[elem_start].nNode; iface++) {
-    node0 = Mesh->Face[Mesh->Elem[elem_start].face[iface]]->node[0];
-    node1 = Mesh->Face[Mesh->Elem[elem_start].face[iface]]->node[1];
-    X1[0] = Mesh->Coord[node0*dim+0];
-    X1[1] = Mesh->Coord[node0*dim+1];
-    X1[2] = Mesh->Coord[node1*dim+0];
-    X1[3] = Mesh->Coord[node1*dim+1];
-    if ((intersect = mg_edges_intersect(X0, X1, Xint)) == true)
-      break;
-  }
-  //if edges intersect, change elem_start to its neighbor accross iface
-  //and continue recurrence
-  if (intersect) {
-    if (Mesh->Elem[elem_start].nbor[iface] < 0) {
-      (*pelem) = elem_start;
-      return err_NOT_FOUND;
-    }
-    elem_start = Mesh->Elem[elem_start].nbor[iface];
-    call(mg_find_elem_frm_coord(Mesh, elem_start, coord, pelem));
-  }
-  else {
-    //found the element but let's verify
-    if (!mg_coord_inside_elem(Mesh, elem_start, coord))
-      return error(err_LOGIC_ERROR);
-    (*pelem) = elem_start;
-  }
   return err_OK;
 }
 
@@ -656,33 +725,33 @@ int mg_value_2_enum(const char value[], char *EName[], int ELast,
 int mg_calc_seg_obj(mg_Segment *Seg, mg_Metric *Metric, double *t,
                     int np, double *pJ, double *J_t, double *scale)
 {
-  int ierr, k, d;
-  int const dim = Metric->BGMesh->Dim;
+  int ierr, k;
   double const eps = 1.e-8;
-  double coord[2*dim], lk, lkp_pe, lkp_me, lkm_pe, lkm_me;
-  double xkp[dim], xkm[dim], xk[dim];
+  double coord[4], lk, lkp_pe, lkp_me, lkm_pe, lkm_me;
+  double *X, *Xp, *Xm, *tpm;
   
   if (Seg->Lm < 0.0){
     call(mg_metric_length(Metric, Seg, np, &Seg->Lm));
   }
   (*scale) = Seg->Lm/np;
   
+  //global coordinates of all nodes and of their perturbations
+  call(mg_alloc((void**)&X, 8*np, sizeof(double)));
+  Xp  = X+2*np;
+  Xm  = X+4*np;
+  tpm = X+6*np;
+  mg_spline_eval(Seg->Spline, np, t, X, NULL, NULL);
+  
   //objective function
   if (pJ != NULL){
     (*pJ) = 0.0;
     //loop over elements
     for (k = 1; k < np; k++) {
-      //get global coordinates
-      for (d = 0; d < dim; d++){
-        //k-1 extremity
-        coord[2*d+0] = gsl_interp_eval(Seg->interp[d], Seg->s,
-                                       Seg->Coord+d*Seg->nPoint, t[k-1],
-                                       Seg->accel[d]);
-        //k extremity
-        coord[2*d+1] = gsl_interp_eval(Seg->interp[d], Seg->s,
-                                       Seg->Coord+d*Seg->nPoint, t[k],
-                                       Seg->accel[d]);
-      }
+      //k-1 and k extremities
+      coord[0] = X[k-1];
+      coord[1] = X[k];
+      coord[2] = X[np+k-1];
+      coord[3] = X[np+k];
       //calculate metric length of k'th edge
       call(mg_metric_dist(Metric, 2*Metric->order, coord, &lk));
       //add to objective function
@@ -693,6 +762,15 @@ int mg_calc_seg_obj(mg_Segment *Seg, mg_Metric *Metric, double *t,
   if (J_t != NULL) {
     //zero contribution from segement extremities
     J_t[0] = J_t[np-1] = 0.0;
+    //"plus" and "minus" pertubations of every node
+    for (k = 0; k < np; k++) {
+      tpm[k]    = t[k]+eps;
+      tpm[np+k] = t[k]-eps;
+    }
+    tpm[0] = t[0];
+    tpm[np-1] = tpm[2*np-1] = t[np-1];
+    mg_spline_eval(Seg->Spline, np, tpm, Xp, NULL, NULL);
+    mg_spline_eval(Seg->Spline, np, tpm+np, Xm, NULL, NULL);
     //loop over interior nodes and calculate derivatives
     for (k = 1; k < np-1; k++) {
       /* node arrangement: 
@@ -701,54 +779,30 @@ int mg_calc_seg_obj(mg_Segment *Seg, mg_Metric *Metric, double *t,
             lk  lk+1
        */
       //"plus" pertubation
-      t[k] += eps;
-      //get global coordinates
-      for (d = 0; d < dim; d++){
-        //k-1 extremity
-        xkm[d] = gsl_interp_eval(Seg->interp[d], Seg->s,
-                                 Seg->Coord+d*Seg->nPoint, t[k-1],
-                                 Seg->accel[d]);
-        //k+1 extremity
-        xkp[d] = gsl_interp_eval(Seg->interp[d], Seg->s,
-                                 Seg->Coord+d*Seg->nPoint, t[k+1],
-                                 Seg->accel[d]);
-        //center point
-        xk[d] = gsl_interp_eval(Seg->interp[d], Seg->s,
-                                Seg->Coord+d*Seg->nPoint, t[k],
-                                Seg->accel[d]);
-      }
       //lkp1
-      coord[0] = xk[0];
-      coord[1] = xkp[0];
-      coord[2] = xk[1];
-      coord[3] = xkp[1];
+      coord[0] = Xp[k];
+      coord[1] = X[k+1];
+      coord[2] = Xp[np+k];
+      coord[3] = X[np+k+1];
       call(mg_metric_dist(Metric, Metric->order, coord, &lkp_pe));
       //lkm1
-      coord[0] = xkm[0];
-      coord[1] = xk[0];
-      coord[2] = xkm[1];
-      coord[3] = xk[1];
+      coord[0] = X[k-1];
+      coord[1] = Xp[k];
+      coord[2] = X[np+k-1];
+      coord[3] = Xp[np+k];
       call(mg_metric_dist(Metric, Metric->order, coord, &lkm_pe));
       //"minus" pertubation
-      t[k] -= 2.0*eps;
-      //only need to update center point
-      for (d = 0; d < dim; d++){
-        //center point
-        xk[d] = gsl_interp_eval(Seg->interp[d], Seg->s,
-                                Seg->Coord+d*Seg->nPoint, t[k],
-                                Seg->accel[d]);
-      }
       //lkp1
-      coord[0] = xk[0];
-      coord[1] = xkp[0];
-      coord[2] = xk[1];
-      coord[3] = xkp[1];
+      coord[0] = Xm[k];
+      coord[1] = X[k+1];
+      coord[2] = Xm[np+k];
+      coord[3] = X[np+k+1];
       call(mg_metric_dist(Metric, Metric->order, coord, &lkp_me));
       //lkm1
-      coord[0] = xkm[0];
-      coord[1] = xk[0];
-      coord[2] = xkm[1];
-      coord[3] = xk[1];
+      coord[0] = X[k-1];
+      coord[1] = Xm[k];
+      coord[2] = X[np+k-1];
+      coord[3] = Xm[np+k];
       call(mg_metric_dist(Metric, Metric->order, coord, &lkm_me));
       
       //(k+1)'th edge contribution
@@ -757,10 +811,9 @@ int mg_calc_seg_obj(mg_Segment *Seg, mg_Metric *Metric, double *t,
       //k'th edge contribution
       J_t[k] += ((lkm_pe-(*scale))*(lkm_pe-(*scale))-
                  (lkm_me-(*scale))*(lkm_me-(*scale)))/(2.0*eps);
-      //revert parametric coordinate back to its original value
-      t[k] += eps;
     }
   }
+  mg_free((void*)X);
   
   return err_OK;
 }
@@ -824,12 +877,11 @@ static void mg_seg_fdf(const gsl_vector *x, void *params, double *f,
 /* function: mg_init_seg_mesh */
 static int mg_init_seg_mesh(mg_gsl_multimin_params *Params, gsl_vector *x)
 {
-  int ierr, ip, np = (int)x->size, d, it=0;
+  int ierr, ip, np = (int)x->size, it=0;
   mg_Segment *Seg = Params->Segment;
   mg_Metric *Metric = Params->Metric;
-  double lstar, dl, t0, coord[4], dt, ti, l;
+  double lstar, dl, t0, coord[4], dt, ti, l, tt[2];
   double const e = 1e-6;
-  int dim = Metric->BGMesh->Dim;
   
   //over integrate length
   if (Seg->Lm < 0.0){
@@ -838,6 +890,16 @@ static int mg_init_seg_mesh(mg_gsl_multimin_params *Params, gsl_vector *x)
   lstar = Seg->Lm/np;
   //first point
   x->data[0] = 0.0;
+  //equidistribute using the metric-length table if built for Metric
+  if (Seg->Table != NULL && Seg->Table->Lm != NULL &&
+      Seg->Table->Metric == (void*)Metric) {
+    for (ip = 1; ip < np-1; ip++) {
+      call(mg_seg_table_param(Seg, true, ip*lstar, x->data+ip));
+      x->data[ip] = min(x->data[ip], 1.0-e);
+    }
+    x->data[np-1] = 1.0;
+    return err_OK;
+  }
   for (ip = 1; ip < np-1; ip++) {
     //starting reference
     t0 = x->data[ip-1];
@@ -847,27 +909,17 @@ static int mg_init_seg_mesh(mg_gsl_multimin_params *Params, gsl_vector *x)
       //estimate length sentitivity
       //dt = ti+e;
       //physical location
-      for (d = 0; d < dim; d++){
-        coord[dim*d+0] = gsl_interp_eval(Seg->interp[d], Seg->s,
-                                         Seg->Coord+d*Seg->nPoint,
-                                         ti, Seg->accel[d]);
-        coord[dim*d+1] = gsl_interp_eval(Seg->interp[d], Seg->s,
-                                         Seg->Coord+d*Seg->nPoint,
-                                         ti+e, Seg->accel[d]);
-      }
+      tt[0] = ti;
+      tt[1] = ti+e;
+      mg_spline_eval(Seg->Spline, 2, tt, coord, NULL, NULL);
       call(mg_metric_dist(Metric, Metric->order, coord, &dl));
       dt = -(l-lstar)/(dl/e);
       ti  = min(ti+dt, 1.0-e);
       //update length
       //physical location
-      for (d = 0; d < dim; d++){
-        coord[dim*d+0] = gsl_interp_eval(Seg->interp[d], Seg->s,
-                                         Seg->Coord+d*Seg->nPoint,
-                                         t0, Seg->accel[d]);
-        coord[dim*d+1] = gsl_interp_eval(Seg->interp[d], Seg->s,
-                                         Seg->Coord+d*Seg->nPoint,
-                                         ti, Seg->accel[d]);
-      }
+      tt[0] = t0;
+      tt[1] = ti;
+      mg_spline_eval(Seg->Spline, 2, tt, coord, NULL, NULL);
       call(mg_metric_dist(Metric, Metric->order, coord, &l));
       it++;
     }
@@ -963,49 +1015,18 @@ void mg_free_linked_list(struct mg_Item *Item)
 
 /******************************************************************/
 /* function: mg_calc_face_info */
-/* calculates face properties */
+/* calculates face properties of the faces that need them (see
+ mg_face_geom_update), metric lengths with the metric set by
+ mg_face_geom_set_metric */
 int mg_calc_face_info(mg_Mesh *Mesh)
 {
-  int ierr, f, i, *node, in, istack;
-  double delta[3];
-  mg_FaceData *face;
-  
-  istack = 0;
-  for (f = 0; f < Mesh->nFace+Mesh->Stack->Face->nItem; f++) {
-    face = Mesh->Face[f];
-    //if face normal is null, assume all face data is stale or uninitialized
-    //do not calculate if on stack
-    if (Mesh->Stack->Face->nItem >0)
-      if (f == Mesh->Stack->Face->Item[istack]){
-        istack++;
-        continue;
-      }
-    if (face->normal == NULL) {
-      node = face->node;
-      call(mg_alloc((void**)&face->normal, Mesh->Dim, sizeof(double)));
-      call(mg_alloc((void**)&face->centroid, Mesh->Dim, sizeof(double)));
-      switch (Mesh->Dim) {
-        case 2:
-          face->area = 0.0;
-          for (i=0;i<Mesh->Dim;i++){
-            delta[i] = Mesh->Coord[node[1]*Mesh->Dim+i]-Mesh->Coord[node[0]*Mesh->Dim+i];
-            face->area += delta[i]*delta[i];
-            face->centroid[i] = 0.0;
-            for (in = 0; in < face->nNode; in++)
-              face->centroid[i] += Mesh->Coord[node[in]*Mesh->Dim+i]/face->nNode;
-          }
-          face->area = sqrt(face->area);
-          face->normal[0] = -delta[1]/face->area;
-          face->normal[1] = delta[0]/face->area;
-          break;
-        case 3:
-          return error(err_NOT_SUPPORTED);
-          break;
-        default:
-          break;
-      }
-    }
-  }
+  int ierr;
+  mg_Metric *Metric = NULL;
+  
+  if (Mesh->FaceGeom != NULL)
+    Metric = (mg_Metric*)Mesh->FaceGeom->Metric;
+  call(mg_face_geom_update(Mesh, Metric));
+  Mesh->Pending &= ~MESHFACEGEOM;
   
   return err_OK;
 }
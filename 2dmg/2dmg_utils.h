@@ -13,6 +13,16 @@
 #include "2dmg_struct.h"
 #include "2dmg_metric_struct.h"
 
+/******************************************************************/
+/* derived data of a mesh read from file, built on first use (see
+ mg_mesh_require). Meshes built by the generator keep theirs current */
+#define MESHNODE2ELEM     1
+#define MESHNODE2FACE     2
+#define MESHLINKS         4 //face and neighbor entries of the elements
+#define MESHFACEGEOM      8 //face normals, centroids and lengths
+#define MESHQTREE         16 //node quadtree (uses Node2Face)
+#define MESHALL           31
+
 /******************************************************************/
 /* function:  mg_alloc*/
 /* wrapper for malloc with error handling*/
@@ -75,11 +85,34 @@ int mg_add_2_ord_set(const int entry, int *set_size, int **set,
 int mg_rm_frm_ord_set(const int entry, int *set_size, int **set,
                       int n2Rm, int *nRmd);
 
+/******************************************************************/
+/* function: mg_is_stacked */
+/* true if id is in the ordered set of removed components Stack (may
+ be NULL) */
+bool mg_is_stacked(mg_List *Stack, int id);
+
+/******************************************************************/
+/* function: mg_live_slots */
+/* lists in Live the component slots below nSlot that are not in the
+ ordered Stack of removed ones and sets Map[slot] to their position in
+ Live (-1 if stacked). Live or Map may be NULL. Returns the number of
+ live slots */
+int mg_live_slots(mg_List *Stack, int nSlot, int *Live, int *Map);
+
 /******************************************************************/
 /* function: mg_build_connectivity */
 /* builds Node2Elem and Node2Face connectivities */
 int mg_build_connectivity(mg_Mesh *Mesh);
 
+/******************************************************************/
+/* function: mg_mesh_require */
+/* builds the derived data in What (MESH* flags) that Mesh does not
+ have yet. Tools that only need coordinates and elements never pay
+ for the rest. If the faces leave element sides uncovered, the links
+ replace them by the element edges (see mg_build_faces). Not thread
+ safe: call it before sharing Mesh */
+int mg_mesh_require(mg_Mesh *Mesh, int What);
+
 /******************************************************************/
 /* function: mg_init_ord_data_list */
 /* initializes an ordered data list*/
@@ -106,13 +139,15 @@ int mg_add_2_ord_data_list(int entry, void **Data,
 
 /******************************************************************/
 /* function: mg_edges_intersect */
-/* checks if edges defined by *X0 and *X1 intersect, if so,
- xint receives the intersection point*/
+/* checks if edges defined by *X0 and *X1 (x0,y0,x1,y1) intersect,
+ touching and overlapping edges included, if so, xint receives the
+ intersection point. Uses exact orientation tests*/
 bool mg_edges_intersect(double X0[4], double X1[4], double *xint);
 
 /******************************************************************/
 /* function: mg_coord_inside_elem */
-/* checks if a coordinate is inside an element */
+/* checks if a coordinate is inside an element or on its boundary
+ (exact orientation tests) */
 bool mg_coord_inside_elem(mg_Mesh *Mesh, int elem, double coord[2]);
 
 /******************************************************************/
@@ -154,7 +189,9 @@ void mg_free_linked_list(struct mg_Item *Item);
 
 /******************************************************************/
 /* function: mg_calc_face_info */
-/* calculates face properties */
+/* calculates face properties of the faces that need them (see
+ mg_face_geom_update), metric lengths with the metric set by
+ mg_face_geom_set_metric */
 int mg_calc_face_info(mg_Mesh *Mesh);
 
 #endif /* defined(___dmg___dmg_utils__) */
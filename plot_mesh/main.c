@@ -18,10 +18,9 @@ int main(int argc, const char * argv[])
   int ierr;
   mg_Mesh *Mesh;
   
+  //connectivities and face geometry are built only if the plot needs them
   call(mg_read_mesh(&Mesh, "rae2822.gri"));
   
-  call(mg_calc_face_info(Mesh));
-  
   call(mg_show_mesh(Mesh, NULL));
   
   mg_destroy_mesh(Mesh);
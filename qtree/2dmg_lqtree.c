@@ -0,0 +1,501 @@
+//
+//  2dmg_lqtree.c
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include <memory.h>
+#include "2dmg_lqtree.h"
+#include "2dmg_error.h"
+
+#ifndef max
+#define max(a,b)  (((a) > (b)) ? (a) : (b))
+#endif
+
+/******************************************************************/
+/* function:  mg_morton_spread */
+/* spreads the bits of v over the even bits of the result */
+static uint64_t mg_morton_spread(uint32_t v)
+{
+  uint64_t x = v;
+  x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+  x = (x | (x << 8))  & 0x00FF00FF00FF00FFULL;
+  x = (x | (x << 4))  & 0x0F0F0F0F0F0F0F0FULL;
+  x = (x | (x << 2))  & 0x3333333333333333ULL;
+  x = (x | (x << 1))  & 0x5555555555555555ULL;
+  return x;
+}
+
+/******************************************************************/
+/* function:  mg_lqtree_reserve */
+/* makes room for nnode more nodes and nbucket more buckets */
+static int mg_lqtree_reserve(mg_lqtree *Tree, int nnode, int nbucket)
+{
+  int n;
+  void *p;
+  
+  if (Tree->nNode+nnode > Tree->maxNode) {
+    n = 2*Tree->maxNode;
+    if (n < Tree->nNode+nnode) n = Tree->nNode+nnode;
+    if ((p = realloc(Tree->child, 3*n*sizeof(int))) == NULL)
+      return error(err_MEMORY_ERROR);
+    //child, bucket and count share one block
+    Tree->child = (int*)p;
+    memmove(Tree->child+2*n, Tree->child+2*Tree->maxNode,
+            Tree->nNode*sizeof(int));
+    memmove(Tree->child+n, Tree->child+Tree->maxNode,
+            Tree->nNode*sizeof(int));
+    Tree->bucket = Tree->child+n;
+    Tree->count = Tree->child+2*n;
+    Tree->maxNode = n;
+  }
+  if (Tree->nBucket+nbucket > Tree->maxBucket) {
+    n = 2*Tree->maxBucket;
+    if (n < Tree->nBucket+nbucket) n = Tree->nBucket+nbucket;
+    if ((p = realloc(Tree->key, n*Tree->capacity*sizeof(uint64_t))) == NULL)
+      return error(err_MEMORY_ERROR);
+    Tree->key = (uint64_t*)p;
+    if ((p = realloc(Tree->data, n*Tree->capacity*sizeof(mg_data_entry)))
+        == NULL)
+      return error(err_MEMORY_ERROR);
+    Tree->data = (mg_data_entry*)p;
+    Tree->maxBucket = n;
+  }
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_lqtree_branch */
+/* appends 4 children (leaves without buckets) to node */
+static int mg_lqtree_branch(mg_lqtree *Tree, int node)
+{
+  int ierr, i, first;
+  
+  call(mg_lqtree_reserve(Tree, 4, 0));
+  first = Tree->nNode;
+  for (i = 0; i < 4; i++) {
+    Tree->child[first+i] = -1;
+    Tree->bucket[first+i] = -1;
+    Tree->count[first+i] = 0;
+  }
+  Tree->nNode += 4;
+  Tree->child[node] = first;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_lqtree_split */
+/* splits a full leaf at a given level and moves its entries to the
+ children. The first child inherits the bucket of the leaf. */
+static int mg_lqtree_split(mg_lqtree *Tree, int node, int level)
+{
+  int ierr, i, k, n, b0, first, src, dst, cap = Tree->capacity;
+  
+  call(mg_lqtree_reserve(Tree, 0, 3));
+  call(mg_lqtree_branch(Tree, node));
+  first = Tree->child[node];
+  b0 = Tree->bucket[node];
+  n = Tree->count[node];
+  Tree->bucket[first] = b0;
+  for (i = 1; i < 4; i++)
+    Tree->bucket[first+i] = Tree->nBucket++;
+  Tree->bucket[node] = -1;
+  Tree->count[node] = 0;
+  //entries going to the first child are compacted in place
+  for (i = 0; i < n; i++) {
+    src = b0*cap+i;
+    k = first+mortonquad(Tree->key[src], level);
+    dst = Tree->bucket[k]*cap+Tree->count[k];
+    Tree->key[dst] = Tree->key[src];
+    Tree->data[dst] = Tree->data[src];
+    Tree->count[k]++;
+  }
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_create_lqtree */
+/* creates an empty linear quadtree covering c +- ds. capacity <= 0
+ uses LQTREECAPACITY */
+int mg_create_lqtree(mg_lqtree **pTree, double c[2], double ds[2],
+                     int capacity)
+{
+  int ierr;
+  mg_lqtree *Tree;
+  
+  if (ds[0] <= 0.0 || ds[1] <= 0.0) return error(err_INPUT_ERROR);
+  if ((Tree = malloc(sizeof(mg_lqtree))) == NULL)
+    return error(err_MEMORY_ERROR);
+  Tree->capacity = (capacity > 0) ? capacity : LQTREECAPACITY;
+  Tree->nNode = Tree->maxNode = 0;
+  Tree->nBucket = Tree->maxBucket = 0;
+  Tree->nEntry = 0;
+  Tree->c[0] = c[0];
+  Tree->c[1] = c[1];
+  Tree->ds[0] = ds[0];
+  Tree->ds[1] = ds[1];
+  Tree->child = Tree->bucket = Tree->count = NULL;
+  Tree->key = NULL;
+  Tree->data = NULL;
+  (*pTree) = Tree;
+  //root is an empty leaf
+  call(mg_lqtree_reserve(Tree, 64, 16));
+  Tree->child[0] = -1;
+  Tree->bucket[0] = 0;
+  Tree->count[0] = 0;
+  Tree->nNode = 1;
+  Tree->nBucket = 1;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_destroy_lqtree */
+void mg_destroy_lqtree(mg_lqtree *Tree)
+{
+  if (Tree == NULL) return;
+  free(Tree->child);
+  free(Tree->key);
+  free(Tree->data);
+  free(Tree);
+}
+
+/******************************************************************/
+/* function:  mg_lqtree_key */
+/* Morton code of coord in Tree */
+int mg_lqtree_key(mg_lqtree *Tree, double coord[2], uint64_t *key)
+{
+  int i;
+  uint32_t q[2];
+  uint32_t const qmax = (1U << LQTREEMAXLEVEL)-1;
+  double u;
+  
+  for (i = 0; i < 2; i++) {
+    //first check if within bounds
+    if (coord[i] < Tree->c[i]-Tree->ds[i] ||
+        coord[i] > Tree->c[i]+Tree->ds[i])
+      return err_OUT_OF_BOUNDS;
+    u = 0.5*(coord[i]-Tree->c[i]+Tree->ds[i])/Tree->ds[i];
+    q[i] = (uint32_t)(u*(qmax+1.0));
+    if (q[i] > qmax) q[i] = qmax;
+  }
+  (*key) = mg_morton_spread(q[0]) | (mg_morton_spread(q[1]) << 1);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_lqtree_insert */
+/* inserts an entry with known Morton code */
+static int mg_lqtree_insert(mg_lqtree *Tree, uint64_t key, double coord[2],
+                            void *data)
+{
+  int ierr, node = 0, level = 0, dst;
+  
+  while (true) {
+    //descend to leaf
+    while (Tree->child[node] >= 0) {
+      node = Tree->child[node]+mortonquad(key, level);
+      level++;
+    }
+    if (Tree->count[node] < Tree->capacity) break;
+    //more than capacity coincident entries
+    if (level == LQTREEMAXLEVEL) return error(err_OUT_OF_BOUNDS);
+    call(mg_lqtree_split(Tree, node, level));
+  }
+  if (Tree->bucket[node] < 0) {
+    call(mg_lqtree_reserve(Tree, 0, 1));
+    Tree->bucket[node] = Tree->nBucket++;
+  }
+  dst = Tree->bucket[node]*Tree->capacity+Tree->count[node];
+  Tree->key[dst] = key;
+  Tree->data[dst].coord[0] = coord[0];
+  Tree->data[dst].coord[1] = coord[1];
+  Tree->data[dst].data = data;
+  Tree->count[node]++;
+  Tree->nEntry++;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_lqtree_add_entry */
+/* inserts an entry without recursion, splitting full buckets */
+int mg_lqtree_add_entry(mg_lqtree *Tree, double coord[2], void *data)
+{
+  int ierr;
+  uint64_t key;
+  
+  if ((ierr = mg_lqtree_key(Tree, coord, &key)) != err_OK)
+    return error(ierr);
+  call(mg_lqtree_insert(Tree, key, coord, data));
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_lqtree_sort */
+/* LSD radix sort of n Morton codes carrying a permutation. key and
+ perm must have room for 2*n values (second half is scratch) */
+static void mg_lqtree_sort(int n, uint64_t *key, int *perm)
+{
+  int i, pass, d, cnt[1 << LQTREERADIXBITS], sum, t;
+  uint64_t *ksrc = key, *kdst = key+n, *ktmp;
+  uint64_t const mask = (1 << LQTREERADIXBITS)-1;
+  int *psrc = perm, *pdst = perm+n, *ptmp;
+  int const nd = 1 << LQTREERADIXBITS;
+  int const npass = (2*LQTREEMAXLEVEL+LQTREERADIXBITS-1)/LQTREERADIXBITS;
+  
+  for (pass = 0; pass < npass; pass++) {
+    memset(cnt, 0, nd*sizeof(int));
+    for (i = 0; i < n; i++)
+      cnt[(ksrc[i] >> (LQTREERADIXBITS*pass)) & mask]++;
+    //skip digit if every code shares it
+    if (cnt[(ksrc[0] >> (LQTREERADIXBITS*pass)) & mask] == n) continue;
+    for (sum = 0, d = 0; d < nd; d++) {
+      t = cnt[d];
+      cnt[d] = sum;
+      sum += t;
+    }
+    for (i = 0; i < n; i++) {
+      d = (int)((ksrc[i] >> (LQTREERADIXBITS*pass)) & mask);
+      kdst[cnt[d]] = ksrc[i];
+      pdst[cnt[d]] = psrc[i];
+      cnt[d]++;
+    }
+    ktmp = ksrc; ksrc = kdst; kdst = ktmp;
+    ptmp = psrc; psrc = pdst; pdst = ptmp;
+  }
+  if (ksrc != key) {
+    memcpy(key, ksrc, n*sizeof(uint64_t));
+    memcpy(perm, psrc, n*sizeof(int));
+  }
+}
+
+/******************************************************************/
+/* function:  mg_lqtree_bulk_load */
+/* inserts n entries with interleaved coordinates coord (data may be
+ NULL). The entries are radix sorted by Morton code and, if Tree is
+ empty, the tree is built top-down from the sorted array */
+int mg_lqtree_bulk_load(mg_lqtree *Tree, int n, double *coord,
+                        void **data)
+{
+  int ierr, i, q, lo, hi, mid, node, level, nstack, spare, dst;
+  int *perm, range[5];
+  int snode[3*LQTREEMAXLEVEL+4], slo[3*LQTREEMAXLEVEL+4];
+  int shi[3*LQTREEMAXLEVEL+4], slevel[3*LQTREEMAXLEVEL+4];
+  uint64_t *key;
+  
+  if (n <= 0) return err_OK;
+  if ((key = malloc(2*n*sizeof(uint64_t))) == NULL)
+    return error(err_MEMORY_ERROR);
+  if ((perm = malloc(2*n*sizeof(int))) == NULL)
+    return error(err_MEMORY_ERROR);
+  for (i = 0; i < n; i++) {
+    if ((ierr = mg_lqtree_key(Tree, coord+2*i, key+i)) != err_OK)
+      return error(ierr);
+    perm[i] = i;
+  }
+  mg_lqtree_sort(n, key, perm);
+  
+  if (Tree->nEntry > 0) {
+    //insertion in Morton order keeps the descent paths in cache
+    for (i = 0; i < n; i++)
+      call(mg_lqtree_insert(Tree, key[i], coord+2*perm[i],
+                            (data == NULL) ? NULL : data[perm[i]]));
+    free(key);
+    free(perm);
+    return err_OK;
+  }
+  
+  //top-down build: every node owns a range of the sorted codes
+  call(mg_lqtree_reserve(Tree, 2*(n/Tree->capacity)+1, n/Tree->capacity+1));
+  spare = Tree->bucket[0];
+  Tree->bucket[0] = -1;
+  nstack = 1;
+  snode[0] = 0;
+  slo[0] = 0;
+  shi[0] = n;
+  slevel[0] = 0;
+  while (nstack > 0) {
+    nstack--;
+    node = snode[nstack];
+    lo = slo[nstack];
+    hi = shi[nstack];
+    level = slevel[nstack];
+    if (hi-lo <= Tree->capacity) {
+      if (hi == lo) continue;
+      if (spare >= 0) {
+        Tree->bucket[node] = spare;
+        spare = -1;
+      }
+      else {
+        call(mg_lqtree_reserve(Tree, 0, 1));
+        Tree->bucket[node] = Tree->nBucket++;
+      }
+      for (i = lo; i < hi; i++) {
+        dst = Tree->bucket[node]*Tree->capacity+i-lo;
+        Tree->key[dst] = key[i];
+        Tree->data[dst].coord[0] = coord[2*perm[i]];
+        Tree->data[dst].coord[1] = coord[2*perm[i]+1];
+        Tree->data[dst].data = (data == NULL) ? NULL : data[perm[i]];
+      }
+      Tree->count[node] = hi-lo;
+      continue;
+    }
+    //more than capacity coincident entries
+    if (level == LQTREEMAXLEVEL) return error(err_OUT_OF_BOUNDS);
+    call(mg_lqtree_branch(Tree, node));
+    //quadrant boundaries by bisection on the sorted codes
+    range[0] = lo;
+    range[4] = hi;
+    for (q = 1; q < 4; q++) {
+      range[q] = range[q-1];
+      i = hi;
+      while (range[q] < i) {
+        mid = range[q]+(i-range[q])/2;
+        if (mortonquad(key[mid], level) < q)
+          range[q] = mid+1;
+        else
+          i = mid;
+      }
+    }
+    for (q = 3; q >= 0; q--) {
+      snode[nstack] = Tree->child[node]+q;
+      slo[nstack] = range[q];
+      shi[nstack] = range[q+1];
+      slevel[nstack] = level+1;
+      nstack++;
+    }
+  }
+  //root bucket unused by the build
+  if (spare >= 0) Tree->bucket[0] = spare;
+  Tree->nEntry = n;
+  
+  free(key);
+  free(perm);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_lqtree_find_leaf */
+/* leaf node containing coord */
+int mg_lqtree_find_leaf(mg_lqtree *Tree, double coord[2], int *leaf)
+{
+  int ierr, node = 0, level = 0;
+  uint64_t key;
+  
+  if ((ierr = mg_lqtree_key(Tree, coord, &key)) != err_OK)
+    return error(ierr);
+  while (Tree->child[node] >= 0) {
+    node = Tree->child[node]+mortonquad(key, level);
+    level++;
+  }
+  (*leaf) = node;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_lqtree_find_entry */
+/* same as mg_find_entry: looks in the leaf containing coord for
+ target_data (if not NULL) or for an entry within tol of coord */
+int mg_lqtree_find_entry(mg_lqtree *Tree, double coord[2],
+                         void *target_data, double tol,
+                         mg_data_entry **data)
+{
+  int ierr, i, leaf;
+  mg_data_entry *entry;
+  
+  call(mg_lqtree_find_leaf(Tree, coord, &leaf));
+  if (Tree->count[leaf] == 0) return err_NOT_FOUND;
+  entry = Tree->data+Tree->bucket[leaf]*Tree->capacity;
+  
+  //check if match will be exact or by distance
+  for (i = 0; i < Tree->count[leaf]; i++) {
+    if ((target_data != NULL && entry[i].data == target_data) ||
+        (target_data == NULL && distance(coord, entry[i].coord) <= tol)) {
+      (*data) = entry+i;
+      return err_OK;
+    }
+  }
+  
+  return err_NOT_FOUND;
+}
+
+/******************************************************************/
+/* function:  mg_lqtree_nearest */
+/* entry closest to coord (which may lie outside the tree). Branches
+ are visited closest first and pruned by the distance to their extent */
+int mg_lqtree_nearest(mg_lqtree *Tree, double coord[2],
+                      mg_data_entry **data)
+{
+  int i, j, q, node, level, nstack, order[4], t;
+  int snode[3*LQTREEMAXLEVEL+4], slevel[3*LQTREEMAXLEVEL+4];
+  double sc[2*(3*LQTREEMAXLEVEL+4)], c[2], h[2], cc[4][2], dc[4], d, dx;
+  double best = INFINITY;
+  mg_data_entry *entry;
+  
+  (*data) = NULL;
+  nstack = 1;
+  snode[0] = 0;
+  slevel[0] = 0;
+  sc[0] = Tree->c[0];
+  sc[1] = Tree->c[1];
+  while (nstack > 0) {
+    nstack--;
+    node = snode[nstack];
+    level = slevel[nstack];
+    c[0] = sc[2*nstack];
+    c[1] = sc[2*nstack+1];
+    h[0] = ldexp(Tree->ds[0], -level);
+    h[1] = ldexp(Tree->ds[1], -level);
+    //prune by extent
+    for (d = 0.0, i = 0; i < 2; i++) {
+      dx = fabs(coord[i]-c[i])-h[i];
+      if (dx > 0.0) d += dx*dx;
+    }
+    if (d >= best) continue;
+    if (Tree->child[node] < 0) {
+      entry = Tree->data+max(Tree->bucket[node], 0)*Tree->capacity;
+      for (i = 0; i < Tree->count[node]; i++) {
+        d = (entry[i].coord[0]-coord[0])*(entry[i].coord[0]-coord[0])+
+            (entry[i].coord[1]-coord[1])*(entry[i].coord[1]-coord[1]);
+        if (d < best) {
+          best = d;
+          (*data) = entry+i;
+        }
+      }
+      continue;
+    }
+    //children pushed farthest first so that the closest is popped first
+    for (q = 0; q < 4; q++) {
+      cc[q][0] = c[0]+((q & 1) ? 0.5 : -0.5)*h[0];
+      cc[q][1] = c[1]+((q & 2) ? 0.5 : -0.5)*h[1];
+      dc[q] = (cc[q][0]-coord[0])*(cc[q][0]-coord[0])+
+              (cc[q][1]-coord[1])*(cc[q][1]-coord[1]);
+      order[q] = q;
+      for (j = q; j > 0 && dc[order[j]] > dc[order[j-1]]; j--) {
+        t = order[j]; order[j] = order[j-1]; order[j-1] = t;
+      }
+    }
+    for (q = 0; q < 4; q++) {
+      snode[nstack] = Tree->child[node]+order[q];
+      slevel[nstack] = level+1;
+      sc[2*nstack] = cc[order[q]][0];
+      sc[2*nstack+1] = cc[order[q]][1];
+      nstack++;
+    }
+  }
+  if ((*data) == NULL) return err_NOT_FOUND;
+  
+  return err_OK;
+}
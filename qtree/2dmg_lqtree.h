@@ -0,0 +1,94 @@
+//
+//  2dmg_lqtree.h
+//  2dmg
+//
+//  https://github.com/mceze/2dmg
+//
+
+#ifndef ___dmg__lqtree__
+#define ___dmg__lqtree__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include "2dmg_qtree.h"
+
+//bits per coordinate in Morton codes (maximum tree depth)
+#define LQTREEMAXLEVEL 30
+//digit size of the radix sort used by bulk loads
+#define LQTREERADIXBITS 10
+//default bucket capacity
+#define LQTREECAPACITY 8
+//quadrant of a Morton code at a given level (same numbering as quadrant)
+#define mortonquad(key,l) (int)(((key)>>(2*(LQTREEMAXLEVEL-1-(l))))&3)
+
+/******************************************************************/
+/* Linear quadtree: nodes and leaf buckets live in pool arrays. The
+ children of a node are 4 consecutive nodes starting at child[node];
+ leaves own one bucket of "capacity" entries. Entries carry the Morton
+ code of their coordinates so that splitting never touches floats. */
+typedef struct
+{
+  int capacity; //max number of entries in each bucket
+  int nNode, maxNode; //nodes in use and allocated
+  int nBucket, maxBucket; //buckets in use and allocated
+  int nEntry; //total number of entries
+  double c[2], ds[2]; //center and half dimension of root
+  int *child; //first child of each node (-1 for leaves)
+  int *bucket; //bucket of each leaf (-1 for branches)
+  int *count; //number of entries in each leaf
+  uint64_t *key; //Morton codes of bucket entries
+  mg_data_entry *data; //bucket entries
+}
+mg_lqtree;
+
+/******************************************************************/
+/* function:  mg_create_lqtree */
+/* creates an empty linear quadtree covering c +- ds. capacity <= 0
+ uses LQTREECAPACITY */
+int mg_create_lqtree(mg_lqtree **pTree, double c[2], double ds[2],
+                     int capacity);
+
+/******************************************************************/
+/* function:  mg_destroy_lqtree */
+void mg_destroy_lqtree(mg_lqtree *Tree);
+
+/******************************************************************/
+/* function:  mg_lqtree_key */
+/* Morton code of coord in Tree */
+int mg_lqtree_key(mg_lqtree *Tree, double coord[2], uint64_t *key);
+
+/******************************************************************/
+/* function:  mg_lqtree_add_entry */
+/* inserts an entry without recursion, splitting full buckets */
+int mg_lqtree_add_entry(mg_lqtree *Tree, double coord[2], void *data);
+
+/******************************************************************/
+/* function:  mg_lqtree_bulk_load */
+/* inserts n entries with interleaved coordinates coord (data may be
+ NULL). The entries are radix sorted by Morton code and, if Tree is
+ empty, the tree is built top-down from the sorted array */
+int mg_lqtree_bulk_load(mg_lqtree *Tree, int n, double *coord,
+                        void **data);
+
+/******************************************************************/
+/* function:  mg_lqtree_find_leaf */
+/* leaf node containing coord */
+int mg_lqtree_find_leaf(mg_lqtree *Tree, double coord[2], int *leaf);
+
+/******************************************************************/
+/* function:  mg_lqtree_find_entry */
+/* same as mg_find_entry: looks in the leaf containing coord for
+ target_data (if not NULL) or for an entry within tol of coord */
+int mg_lqtree_find_entry(mg_lqtree *Tree, double coord[2],
+                         void *target_data, double tol,
+                         mg_data_entry **data);
+
+/******************************************************************/
+/* function:  mg_lqtree_nearest */
+/* entry closest to coord (which may lie outside the tree). Branches
+ are visited closest first and pruned by the distance to their extent */
+int mg_lqtree_nearest(mg_lqtree *Tree, double coord[2],
+                      mg_data_entry **data);
+
+#endif /* defined(___dmg__lqtree__) */
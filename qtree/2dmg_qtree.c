@@ -15,6 +15,8 @@
 #include "plConfig.h"
 #include "plplot.h"
 
+#define swap(a,b, t)  {t = a; a = b; b = t;}
+
 /******************************************************************/
 /* function:  mg_init_branch */
 int mg_init_branch(mg_qtree *branch)
@@ -106,7 +108,8 @@ int mg_add_qtree_entry(double coord[2], void **data, mg_qtree *qtree)
     //loop over old entries and redistribute amongst the children
     for (i = 0; i < qtree->n_entry; i++){
       quad = quadrant(qtree->data[i].coord, qtree->c);
-      call(mg_add_qtree_entry(qtree->data[i].coord, &qtree->data[i].data,
+      call(mg_add_qtree_entry(qtree->data[i].coord,
+                              (void**)qtree->data[i].data,
                               qtree->child[quad]));
     }
     qtree->n_entry = 0;
@@ -140,20 +143,70 @@ int mg_find_branch(mg_qtree *trunk, mg_qtree **pbranch, double coord[2])
   return err_OK;
 }
 
+/******************************************************************/
+/* function:  mg_box_dist */
+/* squared distance from coord to the extent of a branch */
+static double mg_box_dist(mg_qtree *branch, double coord[2])
+{
+  int i;
+  double d, d2 = 0.0;
+  
+  for (i = 0; i < 2; i++) {
+    d = fabs(coord[i]-branch->c[i])-branch->ds[i];
+    if (d > 0.0) d2 += d*d;
+  }
+  return d2;
+}
+
+/******************************************************************/
+/* function:  mg_qtree_closest_rec */
+/* closest entry to x with squared distance at most (*d2), visiting the
+ closest child first. best and d2 are updated when one is found */
+static void mg_qtree_closest_rec(mg_qtree *branch, double x[2], double *d2,
+                                 mg_data_entry **best)
+{
+  int i, j, p, order[4];
+  double dc[4], e2;
+  
+  if (mg_box_dist(branch, x) > (*d2)) return;
+  if (branch->child[0] != NULL) {
+    for (i = 0; i < 4; i++) {
+      dc[i] = mg_box_dist(branch->child[i], x);
+      order[i] = i;
+      for (j = i; j > 0 && dc[order[j]] < dc[order[j-1]]; j--)
+        swap(order[j], order[j-1], p);
+    }
+    for (i = 0; i < 4; i++)
+      mg_qtree_closest_rec(branch->child[order[i]], x, d2, best);
+    return;
+  }
+  for (i = 0; i < branch->n_entry; i++) {
+    e2 = (branch->data[i].coord[0]-x[0])*(branch->data[i].coord[0]-x[0])+
+         (branch->data[i].coord[1]-x[1])*(branch->data[i].coord[1]-x[1]);
+    if (e2 < (*d2) || (e2 == (*d2) && (*best) == NULL)) {
+      (*d2) = e2;
+      (*best) = branch->data+i;
+    }
+  }
+}
+
 /******************************************************************/
 /* function:  mg_find_entry */
+/* entry pointing to target_data or, if target_data is NULL, the entry
+ closest to coord within tol. Allocates no memory */
 int mg_find_entry(mg_qtree *trunk, double coord[2], void *target_data,
                   double tol, mg_data_entry **data)
 {
   int ierr, i;
   bool found = false;
+  double d2;
   mg_qtree *branch;
+  mg_data_entry *best = NULL;
   
-  //find branch containing coord
-  call(mg_find_branch(trunk, &branch, coord));
-
   //check if match will be exact or by distance
   if (target_data != NULL ) {
+    //find branch containing coord
+    call(mg_find_branch(trunk, &branch, coord));
     //looking for exact match by pointer
     for (i = 0; i < branch->n_entry; i++) {
       if (branch->data[i].data == target_data) {
@@ -164,12 +217,12 @@ int mg_find_entry(mg_qtree *trunk, double coord[2], void *target_data,
     }
   }
   else {
-    for (i = 0; i < branch->n_entry; i++) {
-      if (distance(coord, branch->data[i].coord) <= tol) {
-        (*data) = branch->data+i;
-        found = true;
-        break;
-      }
+    //closest entry within tol (may be in a neighboring branch)
+    d2 = tol*tol;
+    mg_qtree_closest_rec(trunk, coord, &d2, &best);
+    if (best != NULL) {
+      (*data) = best;
+      found = true;
     }
   }
   if (!found) return err_NOT_FOUND;
@@ -179,19 +232,273 @@ int mg_find_entry(mg_qtree *trunk, double coord[2], void *target_data,
 
 /******************************************************************/
 /* function:  mg_del_entry */
+/* removes the entry pointing to data from a branch */
 int mg_del_entry(mg_qtree *branch, void *data)
 {
   int i;
   
+  for (i = 0; i < branch->n_entry; i++)
+    if (branch->data[i].data == data) break;
+  if (i == branch->n_entry) return err_NOT_FOUND;
+  //ensure continuity of data array
+  memmove(branch->data+i, branch->data+i+1,
+          (branch->n_entry-i-1)*sizeof(mg_data_entry));
+  branch->n_entry--;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_del_qtree_entry */
+/* finds the branch containing coord and removes the entry pointing to
+ data from it */
+int mg_del_qtree_entry(mg_qtree *trunk, double coord[2], void *data)
+{
+  int ierr;
+  mg_qtree *branch;
+  
+  call(mg_find_branch(trunk, &branch, coord));
+  
+  return mg_del_entry(branch, data);
+}
+
+/******************************************************************/
+/* function:  mg_init_qtree_query */
+void mg_init_qtree_query(mg_qtree_query *Q)
+{
+  Q->n_entry = Q->capacity = 0;
+  Q->entry = NULL;
+  Q->dist = NULL;
+}
+
+/******************************************************************/
+/* function:  mg_free_qtree_query */
+void mg_free_qtree_query(mg_qtree_query *Q)
+{
+  free(Q->entry);
+  free(Q->dist);
+  mg_init_qtree_query(Q);
+}
+
+/******************************************************************/
+/* function:  mg_qtree_query_add */
+/* appends an entry and its distance to a query result */
+static int mg_qtree_query_add(mg_qtree_query *Q, mg_data_entry *entry,
+                              double dist)
+{
+  void *p;
+  
+  if (Q->n_entry == Q->capacity) {
+    Q->capacity = (Q->capacity == 0) ? 16 : 2*Q->capacity;
+    if ((p = realloc(Q->entry, Q->capacity*sizeof(mg_data_entry*))) == NULL)
+      return error(err_MEMORY_ERROR);
+    Q->entry = (mg_data_entry**)p;
+    if ((p = realloc(Q->dist, Q->capacity*sizeof(double))) == NULL)
+      return error(err_MEMORY_ERROR);
+    Q->dist = (double*)p;
+  }
+  Q->entry[Q->n_entry] = entry;
+  Q->dist[Q->n_entry] = dist;
+  Q->n_entry++;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_qtree_box_rec */
+static int mg_qtree_box_rec(mg_qtree *branch, double lo[2], double hi[2],
+                            mg_qtree_query *Q)
+{
+  int ierr, i;
+  
+  //prune by extent
+  for (i = 0; i < 2; i++)
+    if (branch->c[i]+branch->ds[i] < lo[i] ||
+        branch->c[i]-branch->ds[i] > hi[i])
+      return err_OK;
+  if (branch->child[0] != NULL) {
+    for (i = 0; i < 4; i++)
+      call(mg_qtree_box_rec(branch->child[i], lo, hi, Q));
+    return err_OK;
+  }
+  for (i = 0; i < branch->n_entry; i++)
+    if (branch->data[i].coord[0] >= lo[0] &&
+        branch->data[i].coord[0] <= hi[0] &&
+        branch->data[i].coord[1] >= lo[1] &&
+        branch->data[i].coord[1] <= hi[1])
+      call(mg_qtree_query_add(Q, branch->data+i, 0.0));
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_qtree_box */
+/* entries with lo <= coord <= hi */
+int mg_qtree_box(mg_qtree *trunk, double lo[2], double hi[2],
+                 mg_qtree_query *Q)
+{
+  Q->n_entry = 0;
+  return mg_qtree_box_rec(trunk, lo, hi, Q);
+}
+
+/******************************************************************/
+/* function:  mg_qtree_disk_rec */
+static int mg_qtree_disk_rec(mg_qtree *branch, double c[2], double r2,
+                             mg_qtree_query *Q)
+{
+  int ierr, i;
+  double dx, dy, d2;
+  
+  if (mg_box_dist(branch, c) > r2) return err_OK;
+  if (branch->child[0] != NULL) {
+    for (i = 0; i < 4; i++)
+      call(mg_qtree_disk_rec(branch->child[i], c, r2, Q));
+    return err_OK;
+  }
+  for (i = 0; i < branch->n_entry; i++) {
+    dx = branch->data[i].coord[0]-c[0];
+    dy = branch->data[i].coord[1]-c[1];
+    d2 = dx*dx+dy*dy;
+    if (d2 <= r2)
+      call(mg_qtree_query_add(Q, branch->data+i, sqrt(d2)));
+  }
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_qtree_disk */
+/* entries within distance r of c */
+int mg_qtree_disk(mg_qtree *trunk, double c[2], double r,
+                  mg_qtree_query *Q)
+{
+  Q->n_entry = 0;
+  return mg_qtree_disk_rec(trunk, c, r*r, Q);
+}
+
+/******************************************************************/
+/* function:  mg_qtree_ellipse_rec */
+static int mg_qtree_ellipse_rec(mg_qtree *branch, double c[2],
+                                double M[3], double r2, double h[2],
+                                mg_qtree_query *Q)
+{
+  int ierr, i;
+  double ab[2], d2;
+  
+  //prune by extent against the bounding box of the ellipse
+  for (i = 0; i < 2; i++)
+    if (fabs(branch->c[i]-c[i]) > branch->ds[i]+h[i])
+      return err_OK;
+  if (branch->child[0] != NULL) {
+    for (i = 0; i < 4; i++)
+      call(mg_qtree_ellipse_rec(branch->child[i], c, M, r2, h, Q));
+    return err_OK;
+  }
+  for (i = 0; i < branch->n_entry; i++) {
+    ab[0] = branch->data[i].coord[0]-c[0];
+    ab[1] = branch->data[i].coord[1]-c[1];
+    d2 = ab[0]*(M[0]*ab[0]+M[1]*ab[1])+ab[1]*(M[1]*ab[0]+M[2]*ab[1]);
+    if (d2 <= r2)
+      call(mg_qtree_query_add(Q, branch->data+i, sqrt(fmax(d2, 0.0))));
+  }
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_qtree_ellipse */
+/* entries with metric distance sqrt((x-c)^T*M*(x-c)) <= r, where M is
+ symmetric positive definite stored as {M11, M12, M22} */
+int mg_qtree_ellipse(mg_qtree *trunk, double c[2], double M[3], double r,
+                     mg_qtree_query *Q)
+{
+  double det = M[0]*M[2]-M[1]*M[1], h[2];
+  
+  if (M[0] <= 0.0 || det <= 0.0) return error(err_INPUT_ERROR);
+  //half extents of the ellipse: r*sqrt(diag(M^-1))
+  h[0] = r*sqrt(M[2]/det);
+  h[1] = r*sqrt(M[0]/det);
+  Q->n_entry = 0;
+  
+  return mg_qtree_ellipse_rec(trunk, c, M, r*r, h, Q);
+}
+
+/******************************************************************/
+/* function:  mg_qtree_knn_rec */
+/* depth-first search visiting the closest child first; Q holds the
+ current k best as a max-heap on squared distance */
+static int mg_qtree_knn_rec(mg_qtree *branch, double x[2], int k,
+                            mg_qtree_query *Q)
+{
+  int ierr, i, j, p, order[4];
+  double d2, dc[4], tmp;
+  mg_data_entry *etmp;
+  
+  if (Q->n_entry == k && mg_box_dist(branch, x) >= Q->dist[0])
+    return err_OK;
+  if (branch->child[0] != NULL) {
+    for (i = 0; i < 4; i++) {
+      dc[i] = mg_box_dist(branch->child[i], x);
+      order[i] = i;
+      for (j = i; j > 0 && dc[order[j]] < dc[order[j-1]]; j--)
+        swap(order[j], order[j-1], p);
+    }
+    for (i = 0; i < 4; i++)
+      call(mg_qtree_knn_rec(branch->child[order[i]], x, k, Q));
+    return err_OK;
+  }
   for (i = 0; i < branch->n_entry; i++) {
-    if (branch->data[i].data == data) {
-      branch->data[i].data = NULL;
-      break;
+    d2 = (branch->data[i].coord[0]-x[0])*(branch->data[i].coord[0]-x[0])+
+         (branch->data[i].coord[1]-x[1])*(branch->data[i].coord[1]-x[1]);
+    if (Q->n_entry < k) {
+      //sift up
+      call(mg_qtree_query_add(Q, branch->data+i, d2));
+      for (j = Q->n_entry-1; j > 0 && Q->dist[(j-1)/2] < Q->dist[j];
+           j = (j-1)/2) {
+        swap(Q->dist[j], Q->dist[(j-1)/2], tmp);
+        swap(Q->entry[j], Q->entry[(j-1)/2], etmp);
+      }
+    }
+    else if (d2 < Q->dist[0]) {
+      //replace root and sift down
+      Q->dist[0] = d2;
+      Q->entry[0] = branch->data+i;
+      j = 0;
+      while (2*j+1 < k) {
+        p = 2*j+1;
+        if (p+1 < k && Q->dist[p+1] > Q->dist[p]) p++;
+        if (Q->dist[p] <= Q->dist[j]) break;
+        swap(Q->dist[j], Q->dist[p], tmp);
+        swap(Q->entry[j], Q->entry[p], etmp);
+        j = p;
+      }
     }
   }
-  //ensure continuity of data array
-  memmove(branch->data+i,branch->data+i+1,i+1-branch->n_entry);
-  branch->n_entry--;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  mg_qtree_knn */
+/* k entries closest to x sorted by increasing distance (fewer if the
+ tree holds less than k entries) */
+int mg_qtree_knn(mg_qtree *trunk, double x[2], int k, mg_qtree_query *Q)
+{
+  int ierr, i, j;
+  double tmp;
+  mg_data_entry *etmp;
+  
+  Q->n_entry = 0;
+  if (k <= 0) return error(err_INPUT_ERROR);
+  call(mg_qtree_knn_rec(trunk, x, k, Q));
+  //heap to sorted list
+  for (i = 1; i < Q->n_entry; i++)
+    for (j = i; j > 0 && Q->dist[j] < Q->dist[j-1]; j--) {
+      swap(Q->dist[j], Q->dist[j-1], tmp);
+      swap(Q->entry[j], Q->entry[j-1], etmp);
+    }
+  for (i = 0; i < Q->n_entry; i++)
+    Q->dist[i] = sqrt(Q->dist[i]);
   
   return err_OK;
 }
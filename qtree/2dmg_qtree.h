@@ -45,6 +45,17 @@ struct mg_qtree
 };
 typedef struct mg_qtree mg_qtree;
 
+/******************************************************************/
+/* query result: entries and their distances to the query point */
+typedef struct
+{
+  int n_entry;  // number of entries found
+  int capacity; // allocated size of entry and dist
+  mg_data_entry **entry; //entries found
+  double *dist; //distance of each entry
+}
+mg_qtree_query;
+
 /******************************************************************/
 /* function:  mg_init_branch */
 int mg_init_branch(mg_qtree *branch);
@@ -67,9 +78,55 @@ int mg_find_branch(mg_qtree *trunk, mg_qtree **pbranch, double coord[2]);
 
 /******************************************************************/
 /* function:  mg_find_entry */
+/* entry pointing to target_data or, if target_data is NULL, the entry
+ closest to coord within tol. Allocates no memory */
 int mg_find_entry(mg_qtree *trunk, double coord[2], void *target_data,
                   double tol, mg_data_entry **data);
 
+/******************************************************************/
+/* function:  mg_del_entry */
+/* removes the entry pointing to data from a branch */
+int mg_del_entry(mg_qtree *branch, void *data);
+
+/******************************************************************/
+/* function:  mg_del_qtree_entry */
+/* finds the branch containing coord and removes the entry pointing to
+ data from it */
+int mg_del_qtree_entry(mg_qtree *trunk, double coord[2], void *data);
+
+/******************************************************************/
+/* function:  mg_init_qtree_query */
+void mg_init_qtree_query(mg_qtree_query *Q);
+
+/******************************************************************/
+/* function:  mg_free_qtree_query */
+void mg_free_qtree_query(mg_qtree_query *Q);
+
+/******************************************************************/
+/* function:  mg_qtree_box */
+/* entries with lo <= coord <= hi */
+int mg_qtree_box(mg_qtree *trunk, double lo[2], double hi[2],
+                 mg_qtree_query *Q);
+
+/******************************************************************/
+/* function:  mg_qtree_disk */
+/* entries within distance r of c */
+int mg_qtree_disk(mg_qtree *trunk, double c[2], double r,
+                  mg_qtree_query *Q);
+
+/******************************************************************/
+/* function:  mg_qtree_ellipse */
+/* entries with metric distance sqrt((x-c)^T*M*(x-c)) <= r, where M is
+ symmetric positive definite stored as {M11, M12, M22} */
+int mg_qtree_ellipse(mg_qtree *trunk, double c[2], double M[3], double r,
+                     mg_qtree_query *Q);
+
+/******************************************************************/
+/* function:  mg_qtree_knn */
+/* k entries closest to x sorted by increasing distance (fewer if the
+ tree holds less than k entries) */
+int mg_qtree_knn(mg_qtree *trunk, double x[2], int k, mg_qtree_query *Q);
+
 /******************************************************************/
 /* function:  mg_plot_branch */
 int mg_plot_branch(mg_qtree *branch);
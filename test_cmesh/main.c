@@ -0,0 +1,397 @@
+//
+//  main.c
+//  test_cmesh
+//
+//  https://github.com/mceze/2dmg
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_utils.h"
+#include "2dmg_cmesh.h"
+
+/* Writes a triangulated, jittered grid in the compressed mesh format
+ with every combination of flags, reads it back and compares it with
+ the original. Every tenth slot of the nodes, elements and faces is a
+ removed one on the stacks, which the writer has to leave out. The
+ faces on the grid boundary carry one tag per side and a few interior
+ faces have a hollow side (HOLLOWNEIGHTAG). Nodes are matched by the
+ bits of their coordinates (the format is lossless), elements by their
+ nodes up to a rotation and faces by their oriented nodes */
+
+//a removed slot every STACKEVERY slots
+#define STACKEVERY 10
+
+static const double *SortCoord;
+
+/******************************************************************/
+/* function:  cmp_node */
+/* orders node indices by the bits of x, then of y */
+static int cmp_node(const void *a, const void *b)
+{
+  const double *x = SortCoord+2*(*(const int*)a);
+  const double *y = SortCoord+2*(*(const int*)b);
+  int c = memcmp(x, y, sizeof(double));
+  
+  return (c != 0) ? c : memcmp(x+1, y+1, sizeof(double));
+}
+
+/******************************************************************/
+/* function:  cmp_row */
+/* orders rows of 4 ints lexicographically on the first 3, the last
+ one is the row index */
+static int cmp_row(const void *a, const void *b)
+{
+  int k;
+  const int *x = (const int*)a, *y = (const int*)b;
+  
+  for (k = 0; k < 3; k++)
+    if (x[k] != y[k]) return (x[k] < y[k]) ? -1 : 1;
+  return 0;
+}
+
+/******************************************************************/
+/* function:  slot_of */
+/* slot of the i-th live component when every STACKEVERY-th slot is a
+ removed one */
+static int slot_of(int i)
+{
+  return i+i/(STACKEVERY-1);
+}
+
+/******************************************************************/
+/* function:  stack_slots */
+/* puts the removed slots among the first nLive+n of them on Stack,
+ (*pnSlot) receives the number of slots */
+static int stack_slots(mg_List *Stack, int nLive, int *pnSlot)
+{
+  int ierr, s, n = 0, nSlot = slot_of(nLive-1)+1;
+  
+  call(mg_alloc((void**)&Stack->Item, nSlot, sizeof(int)));
+  for (s = 0; s < nSlot; s++)
+    if ((s+1)%STACKEVERY == 0) Stack->Item[n++] = s;
+  Stack->nItem = n;
+  (*pnSlot) = nSlot;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  grid_mesh */
+/* nx by ny nodes, two triangles per cell, with removed slots */
+static int grid_mesh(int nx, int ny, mg_Mesh **pMesh)
+{
+  int ierr, i, j, k, e, f, nSlot, nNode = nx*ny, nElem = 2*(nx-1)*(ny-1);
+  int nFace = 3*(nx-1)*(ny-1)+(nx-1)+(ny-1), *node, *Map, n[4];
+  int side[4] = {0, 0, 0, 0};
+  const char *Names[4] = {"Bottom", "Right", "Top", "Left"};
+  mg_Mesh *Mesh;
+  mg_FaceData *Face;
+  
+  call(mg_create_mesh(&Mesh));
+  Mesh->Dim = 2;
+  Mesh->nBfg = 4;
+  call(mg_alloc2((void***)&Mesh->BNames, 4, MAXSTRLEN, sizeof(char)));
+  call(mg_alloc((void**)&Mesh->nBface, 4, sizeof(int)));
+  for (k = 0; k < 4; k++)
+    strcpy(Mesh->BNames[k], Names[k]);
+  Mesh->nBface[0] = Mesh->nBface[2] = nx-1;
+  Mesh->nBface[1] = Mesh->nBface[3] = ny-1;
+  
+  //nodes: exact on the boundary, jittered inside
+  call(stack_slots(Mesh->Stack->Node, nNode, &nSlot));
+  call(mg_alloc((void**)&Mesh->Coord, 2*nSlot, sizeof(double)));
+  for (k = 0; k < 2*nSlot; k++) Mesh->Coord[k] = -1.0e300;
+  for (j = 0; j < ny; j++)
+    for (i = 0; i < nx; i++) {
+      k = slot_of(j*nx+i);
+      Mesh->Coord[2*k] = (double)i/(nx-1);
+      Mesh->Coord[2*k+1] = (double)j/(ny-1);
+      if (i > 0 && i < nx-1 && j > 0 && j < ny-1) {
+        Mesh->Coord[2*k] += (rand()/(RAND_MAX+1.0)-0.5)*0.3/(nx-1);
+        Mesh->Coord[2*k+1] += (rand()/(RAND_MAX+1.0)-0.5)*0.3/(ny-1);
+      }
+    }
+  Mesh->nNode = nNode;
+  
+  //elements, removed slots point at removed nodes
+  call(stack_slots(Mesh->Stack->Elem, nElem, &nSlot));
+  call(mg_alloc((void**)&Mesh->Elem, nSlot, sizeof(mg_ElemData)));
+  for (e = 0; e < nSlot; e++) {
+    Mesh->Elem[e].nNode = 3;
+    call(mg_alloc((void**)&Mesh->Elem[e].node, 3, sizeof(int)));
+    Mesh->Elem[e].face = Mesh->Elem[e].nbor = NULL;
+    for (k = 0; k < 3; k++)
+      Mesh->Elem[e].node[k] = Mesh->Stack->Node->Item[0];
+  }
+  for (j = 0, e = 0; j < ny-1; j++)
+    for (i = 0; i < nx-1; i++, e += 2) {
+      n[0] = slot_of(j*nx+i);
+      n[1] = slot_of(j*nx+i+1);
+      n[2] = slot_of((j+1)*nx+i+1);
+      n[3] = slot_of((j+1)*nx+i);
+      node = Mesh->Elem[slot_of(e)].node;
+      node[0] = n[0];
+      node[1] = n[1];
+      node[2] = n[2];
+      node = Mesh->Elem[slot_of(e+1)].node;
+      node[0] = n[0];
+      node[1] = n[2];
+      node[2] = n[3];
+    }
+  Mesh->nElem = nElem;
+  
+  //faces: cell bottom, cell left and cell diagonal, then the top and
+  //right rows; the left element is the one the face is counter-
+  //clockwise in
+  call(stack_slots(Mesh->Stack->Face, nFace, &nSlot));
+  call(mg_alloc((void**)&Mesh->Face, nSlot, sizeof(mg_FaceData*)));
+  for (f = 0; f < nSlot; f++) {
+    call(mg_alloc((void**)&Face, 1, sizeof(mg_FaceData)));
+    mg_init_face(Face);
+    Face->nNode = 2;
+    call(mg_alloc((void**)&Face->node, 2, sizeof(int)));
+    Face->node[0] = Face->node[1] = Mesh->Stack->Node->Item[0];
+    Face->elem[0] = Face->elem[1] = 0;
+    Mesh->Face[f] = Face;
+  }
+  call(mg_alloc((void**)&Map, nFace, sizeof(int)));
+  for (f = 0; f < nFace; f++) Map[f] = slot_of(f);
+  f = 0;
+  for (j = 0; j < ny-1; j++)
+    for (i = 0; i < nx-1; i++) {
+      e = 2*(j*(nx-1)+i);
+      //bottom
+      Face = Mesh->Face[Map[f++]];
+      Face->node[0] = slot_of(j*nx+i);
+      Face->node[1] = slot_of(j*nx+i+1);
+      Face->elem[0] = slot_of(e);
+      Face->elem[1] = (j == 0) ? -1 : slot_of(e-2*(nx-1)+1);
+      side[0] += (j == 0);
+      //left
+      Face = Mesh->Face[Map[f++]];
+      Face->node[0] = slot_of((j+1)*nx+i);
+      Face->node[1] = slot_of(j*nx+i);
+      Face->elem[0] = slot_of(e+1);
+      Face->elem[1] = (i == 0) ? -4 : slot_of(e-2);
+      side[3] += (i == 0);
+      //diagonal, hollow on one side now and then
+      Face = Mesh->Face[Map[f++]];
+      Face->node[0] = slot_of(j*nx+i);
+      Face->node[1] = slot_of((j+1)*nx+i+1);
+      Face->elem[0] = slot_of(e+1);
+      Face->elem[1] = (e%14 == 0) ? HOLLOWNEIGHTAG : slot_of(e);
+    }
+  for (i = 0; i < nx-1; i++) {
+    Face = Mesh->Face[Map[f++]];
+    Face->node[0] = slot_of((ny-1)*nx+i+1);
+    Face->node[1] = slot_of((ny-1)*nx+i);
+    Face->elem[0] = slot_of(2*((ny-2)*(nx-1)+i)+1);
+    Face->elem[1] = -3;
+    side[2]++;
+  }
+  for (j = 0; j < ny-1; j++) {
+    Face = Mesh->Face[Map[f++]];
+    Face->node[0] = slot_of(j*nx+nx-1);
+    Face->node[1] = slot_of((j+1)*nx+nx-1);
+    Face->elem[0] = slot_of(2*(j*(nx-1)+nx-2));
+    Face->elem[1] = -2;
+    side[1]++;
+  }
+  mg_free((void*)Map);
+  Mesh->nFace = nFace;
+  if (f != nFace || side[0] != nx-1 || side[3] != ny-1)
+    return error(err_LOGIC_ERROR);
+  (*pMesh) = Mesh;
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  destroy_slots */
+/* destroys Mesh including its removed slots */
+static void destroy_slots(mg_Mesh *Mesh)
+{
+  Mesh->nNode += Mesh->Stack->Node->nItem;
+  Mesh->nElem += Mesh->Stack->Elem->nItem;
+  Mesh->nFace += Mesh->Stack->Face->nItem;
+  Mesh->Stack->Node->nItem = 0;
+  Mesh->Stack->Elem->nItem = 0;
+  Mesh->Stack->Face->nItem = 0;
+  mg_destroy_mesh(Mesh);
+}
+
+/******************************************************************/
+/* function:  compare */
+/* compares the mesh R read back with the live part of Mesh, R in the
+ order of the live slots unless reordered. (*pnbad) receives the
+ number of mismatches */
+static int compare(mg_Mesh *Mesh, mg_Mesh *R, bool reordered, int *pnbad)
+{
+  int ierr, i, k, r, nbad = 0, nNode, nElem, nFace, *Live, *NodeMap;
+  int *OrderM, *OrderR, *ElemMap, *RowM, *RowR, *row, *key, e, m, n;
+  
+  if (R->nNode != Mesh->nNode || R->nElem != Mesh->nElem ||
+      R->nFace != Mesh->nFace || R->nBfg != Mesh->nBfg) {
+    printf("sizes: %d %d %d %d read, %d %d %d %d written\n", R->nNode,
+           R->nElem, R->nFace, R->nBfg, Mesh->nNode, Mesh->nElem,
+           Mesh->nFace, Mesh->nBfg);
+    (*pnbad) = 1;
+    return err_OK;
+  }
+  for (i = 0; i < Mesh->nBfg; i++)
+    if (strcmp(R->BNames[i], Mesh->BNames[i]) != 0 ||
+        R->nBface[i] != Mesh->nBface[i]) nbad++;
+  nNode = Mesh->nNode;
+  nElem = Mesh->nElem;
+  nFace = Mesh->nFace;
+  
+  //nodes: live slots of Mesh and nodes of R, both sorted by bits
+  n = max(nNode+Mesh->Stack->Node->nItem, nElem+Mesh->Stack->Elem->nItem);
+  n = max(n, nFace+Mesh->Stack->Face->nItem);
+  call(mg_alloc((void**)&Live, n, sizeof(int)));
+  call(mg_alloc((void**)&OrderM, nNode, sizeof(int)));
+  call(mg_alloc((void**)&OrderR, nNode, sizeof(int)));
+  call(mg_alloc((void**)&NodeMap, nNode+Mesh->Stack->Node->nItem,
+                sizeof(int)));
+  if (mg_live_slots(Mesh->Stack->Node, nNode+Mesh->Stack->Node->nItem, Live,
+                    NULL) != nNode) return error(err_LOGIC_ERROR);
+  for (i = 0; i < nNode; i++) OrderM[i] = Live[i];
+  for (i = 0; i < nNode; i++) OrderR[i] = i;
+  SortCoord = Mesh->Coord;
+  qsort(OrderM, nNode, sizeof(int), cmp_node);
+  SortCoord = R->Coord;
+  qsort(OrderR, nNode, sizeof(int), cmp_node);
+  for (i = 0; i < nNode; i++) {
+    if (memcmp(Mesh->Coord+2*OrderM[i], R->Coord+2*OrderR[i],
+               2*sizeof(double)) != 0) {
+      if (nbad < 10) printf("node %d unmatched\n", OrderR[i]);
+      nbad++;
+    }
+    //slot of Mesh to node of R
+    NodeMap[OrderM[i]] = OrderR[i];
+  }
+  if (!reordered)
+    for (i = 0; i < nNode; i++)
+      if (NodeMap[Live[i]] != i) nbad++;
+  
+  //elements: rows of sorted nodes in R numbers, then the row index
+  call(mg_alloc((void**)&RowM, 4*nElem, sizeof(int)));
+  call(mg_alloc((void**)&RowR, 4*nElem, sizeof(int)));
+  if (mg_live_slots(Mesh->Stack->Elem, nElem+Mesh->Stack->Elem->nItem, Live,
+                    NULL) != nElem) return error(err_LOGIC_ERROR);
+  for (i = 0; i < nElem; i++) {
+    for (k = 0; k < 3; k++) {
+      RowM[4*i+k] = NodeMap[Mesh->Elem[Live[i]].node[k]];
+      RowR[4*i+k] = R->Elem[i].node[k];
+    }
+    RowM[4*i+3] = Live[i];
+    RowR[4*i+3] = i;
+  }
+  //the same orientation: rotated so that the lowest node is first
+  for (i = 0; i < 2*nElem; i++) {
+    row = (i < nElem) ? RowM+4*i : RowR+4*(i-nElem);
+    while (row[0] > row[1] || row[0] > row[2])
+      cycle3(row[0], row[1], row[2], k);
+  }
+  qsort(RowM, nElem, 4*sizeof(int), cmp_row);
+  qsort(RowR, nElem, 4*sizeof(int), cmp_row);
+  call(mg_alloc((void**)&ElemMap, nElem+Mesh->Stack->Elem->nItem,
+                sizeof(int)));
+  for (i = 0; i < nElem; i++) {
+    if (cmp_row(RowM+4*i, RowR+4*i) != 0) {
+      if (nbad < 10) printf("element %d unmatched\n", RowR[4*i+3]);
+      nbad++;
+    }
+    ElemMap[RowM[4*i+3]] = RowR[4*i+3];
+  }
+  if (!reordered)
+    for (i = 0; i < nElem; i++)
+      if (ElemMap[Live[i]] != i) nbad++;
+  mg_free((void*)RowM);
+  mg_free((void*)RowR);
+  
+  //faces: oriented nodes in R numbers, then both sides
+  call(mg_alloc((void**)&RowM, 4*nFace, sizeof(int)));
+  call(mg_alloc((void**)&RowR, 4*nFace, sizeof(int)));
+  if (mg_live_slots(Mesh->Stack->Face, nFace+Mesh->Stack->Face->nItem, Live,
+                    NULL) != nFace) return error(err_LOGIC_ERROR);
+  for (i = 0; i < nFace; i++) {
+    RowM[4*i] = NodeMap[Mesh->Face[Live[i]]->node[0]];
+    RowM[4*i+1] = NodeMap[Mesh->Face[Live[i]]->node[1]];
+    RowM[4*i+2] = 0;
+    RowM[4*i+3] = Live[i];
+    RowR[4*i] = R->Face[i]->node[0];
+    RowR[4*i+1] = R->Face[i]->node[1];
+    RowR[4*i+2] = 0;
+    RowR[4*i+3] = i;
+  }
+  qsort(RowM, nFace, 4*sizeof(int), cmp_row);
+  qsort(RowR, nFace, 4*sizeof(int), cmp_row);
+  for (i = 0; i < nFace; i++) {
+    key = RowM+4*i;
+    m = key[3];
+    r = RowR[4*i+3];
+    if (cmp_row(key, RowR+4*i) != 0) {
+      if (nbad < 10) printf("face %d unmatched\n", r);
+      nbad++;
+      continue;
+    }
+    for (k = 0; k < 2; k++) {
+      e = Mesh->Face[m]->elem[k];
+      if (e >= 0) e = ElemMap[e];
+      if (e != R->Face[r]->elem[k]) {
+        if (nbad < 10)
+          printf("face %d side %d: %d read, %d written\n", r, k,
+                 R->Face[r]->elem[k], e);
+        nbad++;
+      }
+    }
+    if (!reordered && Live[r] != m) nbad++;
+  }
+  mg_free((void*)RowM);
+  mg_free((void*)RowR);
+  mg_free((void*)Live);
+  mg_free((void*)OrderM);
+  mg_free((void*)OrderR);
+  mg_free((void*)NodeMap);
+  mg_free((void*)ElemMap);
+  (*pnbad) = nbad;
+  
+  return err_OK;
+}
+
+int main(int argc, const char * argv[]) {
+  int ierr, nx, ny, Flags, nbad = 0, n = 0;
+  const char *FileName = (argc > 3) ? argv[3] : "test_cmesh.cmsh";
+  mg_Mesh *Mesh = NULL, *R;
+  mg_CMeshStats Stats;
+  
+  //test_cmesh [nx] [ny] [scratch file]
+  nx = (argc > 1) ? atoi(argv[1]) : 300;
+  ny = (argc > 2) ? atoi(argv[2]) : 200;
+  if (nx < 2 || ny < 2) return error(err_INPUT_ERROR);
+  srand(1);
+  call(grid_mesh(nx, ny, &Mesh));
+  printf("%d nodes, %d elements, %d faces, %d %d %d removed slots\n",
+         Mesh->nNode, Mesh->nElem, Mesh->nFace, Mesh->Stack->Node->nItem,
+         Mesh->Stack->Elem->nItem, Mesh->Stack->Face->nItem);
+  for (Flags = 0; Flags <= (CMESHFLOATS|CMESHREORDER); Flags++) {
+    call(mg_write_cmesh(Mesh, FileName, Flags, &Stats));
+    mg_cmesh_report("written", &Stats);
+    call(mg_read_cmesh(FileName, &R, &Stats));
+    call(compare(Mesh, R, (Flags & CMESHREORDER) != 0, &n));
+    printf("flags %d: %d mismatches\n", Flags, n);
+    nbad += n;
+    mg_destroy_mesh(R);
+  }
+  remove(FileName);
+  destroy_slots(Mesh);
+  printf("%s: %d mismatches\n", (nbad == 0) ? "PASS" : "FAIL", nbad);
+  
+  return (nbad == 0) ? err_OK : err_LOGIC_ERROR;
+}
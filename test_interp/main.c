@@ -13,15 +13,23 @@
 #include "2dmg_struct.h"
 #include "2dmg_geo.h"
 #include "2dmg_io.h"
+#include "2dmg_math.h"
 
 int main(int argc, const char * argv[]) {
   int ierr, d,b, i, np = 15;
   double xi,yi,dxi,dyi,t=.25, coord[]={0.0,1.0,0.0,1.0}, dist;
-  double *tref, scale;
+  double *tref, scale, errX, errdX, adist;
   mg_Geometry *Geo;
   mg_Metric *Metric;
   
   call(mg_read_geo(&Geo, "box.geo"));
+  //validate native spline evaluator against gsl
+  for (b = 0; b < Geo->nBoundary; b++) {
+    call(mg_spline_check(Geo->Boundary[b], 1001, &errX, &errdX));
+    printf("%s (%s): max error x: %1.3e dx/ds: %1.3e\n",
+           Geo->Boundary[b]->Name,
+           mge_GeoInterpName[Geo->Boundary[b]->interp_type], errX, errdX);
+  }
   b=0;
   d=0;
   xi = gsl_interp_eval(Geo->Boundary[b]->interp[d],
@@ -46,6 +54,7 @@ int main(int argc, const char * argv[]) {
   Metric = malloc(sizeof(mg_Metric));
   Metric->type = mge_Metric_Analitic2;
   Metric->order = 8;
+  Metric->tol = 0.0;
 //  Metric.type = mge_Metric_Uniform;
 //  Metric.order = 1;
   call(mg_create_mesh(&Metric->BGMesh));
@@ -71,6 +80,10 @@ int main(int argc, const char * argv[]) {
 //  call(mg_metric_length(&Metric, Geo->Boundary[b], 32, &dist));
 //  printf("dist: %1.12e\n",dist);
   call(mg_metric_length(Metric, Geo->Boundary[b], 64, &dist));
+  //adaptive quadrature against the fixed order reference
+  Metric->tol = METRICQUADTOL;
+  call(mg_metric_length(Metric, Geo->Boundary[b], 64, &adist));
+  printf("metric length: fixed %1.12e adaptive %1.12e\n",dist,adist);
   
   call(mg_mesh_segment(Geo->Boundary[b], Metric, np, &scale, &tref));
   for (i = 0; i < np; i++) {
@@ -0,0 +1,244 @@
+//
+//  main.c
+//  test_pred
+//
+//  https://github.com/mceze/2dmg
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_pred.h"
+
+/* Checks the signs of mg_orient2d and mg_incircle, and of their list
+ versions, on near-degenerate input against exact integer arithmetic.
+ Every coordinate used is an integer multiple of 2^-SCALE below 2^11,
+ so the determinants are computed exactly in 128 bit integers. The
+ number of signs a plain double evaluation gets wrong is printed to
+ show how degenerate the input is */
+
+//coordinates times 2^SCALE are integers
+#define SCALE 53
+//inputs per list call
+#define NLIST 64
+
+typedef __int128 i128;
+
+/******************************************************************/
+/* function:  fixed */
+/* x*2^s as an integer, x has to be a multiple of 2^-s */
+static long long fixed(double x, int s)
+{
+  return (long long)ldexp(x, s);
+}
+
+/******************************************************************/
+/* function:  sign128 */
+static int sign128(i128 v)
+{
+  return (v > 0) - (v < 0);
+}
+
+/******************************************************************/
+/* function:  sgn */
+static int sgn(double v)
+{
+  return (v > 0.0) - (v < 0.0);
+}
+
+/******************************************************************/
+/* function:  exact_orient */
+/* sign of orient2d(a,b,c) for coordinates scaled by 2^s */
+static int exact_orient(const double a[2], const double b[2],
+                        const double c[2], int s)
+{
+  i128 bx = fixed(b[0], s)-fixed(a[0], s), by = fixed(b[1], s)-fixed(a[1], s);
+  i128 cx = fixed(c[0], s)-fixed(a[0], s), cy = fixed(c[1], s)-fixed(a[1], s);
+  
+  return sign128(bx*cy-by*cx);
+}
+
+/******************************************************************/
+/* function:  naive_orient */
+static double naive_orient(const double a[2], const double b[2],
+                           const double c[2])
+{
+  return (b[0]-a[0])*(c[1]-a[1])-(b[1]-a[1])*(c[0]-a[0]);
+}
+
+/******************************************************************/
+/* function:  naive_incircle */
+static double naive_incircle(const double a[2], const double b[2],
+                             const double c[2], const double d[2])
+{
+  double adx = a[0]-d[0], ady = a[1]-d[1], bdx = b[0]-d[0];
+  double bdy = b[1]-d[1], cdx = c[0]-d[0], cdy = c[1]-d[1];
+  
+  return (adx*adx+ady*ady)*(bdx*cdy-cdx*bdy)+
+  (bdx*bdx+bdy*bdy)*(cdx*ady-adx*cdy)+(cdx*cdx+cdy*cdy)*(adx*bdy-bdx*ady);
+}
+
+/******************************************************************/
+/* function:  ulps */
+/* x moved by k units in the last place */
+static double ulps(double x, int k)
+{
+  for (; k > 0; k--) x = nextafter(x, INFINITY);
+  for (; k < 0; k++) x = nextafter(x, -INFINITY);
+  return x;
+}
+
+/******************************************************************/
+/* function:  check_orient */
+/* n cases in which c is on the line ab rounded to double and moved by
+ a few ulps (a and b change every NLIST cases, which are classified
+ by the list version as well), and the 256x256 grid of points around
+ (0.5,0.5) spaced by one ulp against the line (12,12)-(24,24) */
+static int check_orient(int n)
+{
+  int i, k, nbad = 0, nnaive = 0, nzero = 0, s, ncase = 0;
+  int node[NLIST], S[NLIST];
+  double a[2], b[2], *c, t, X[2*NLIST], o[NLIST];
+  double p[2], q[2] = {12.0, 12.0}, r[2] = {24.0, 24.0};
+  
+  srand(1);
+  for (i = 0; i < n; i++) {
+    if (i%NLIST == 0)
+      for (k = 0; k < 2; k++) {
+        a[k] = 1.0+15.0*(rand()/(RAND_MAX+1.0));
+        b[k] = 1.0+15.0*(rand()/(RAND_MAX+1.0));
+      }
+    t = rand()/(RAND_MAX+1.0);
+    c = X+2*(i%NLIST);
+    c[0] = ulps(a[0]+t*(b[0]-a[0]), rand()%5-2);
+    c[1] = ulps(a[1]+t*(b[1]-a[1]), rand()%5-2);
+    S[i%NLIST] = s = exact_orient(a, b, c, SCALE);
+    nzero += (s == 0);
+    nnaive += (sgn(naive_orient(a, b, c)) != s);
+    //every permutation of the three points
+    if (sgn(mg_orient2d(a, b, c)) != s || sgn(mg_orient2d(b, c, a)) != s ||
+        sgn(mg_orient2d(c, a, b)) != s || sgn(mg_orient2d(b, a, c)) != -s ||
+        sgn(mg_orient2d(a, c, b)) != -s || sgn(mg_orient2d(c, b, a)) != -s) {
+      if (nbad < 10)
+        printf("orient2d (%.17g %.17g) (%.17g %.17g) (%.17g %.17g): "
+               "exact %d\n", a[0], a[1], b[0], b[1], c[0], c[1], s);
+      nbad++;
+    }
+    ncase++;
+    if (i%NLIST < NLIST-1) continue;
+    //the block in order and reversed through node
+    mg_orient2d_list(a, b, X, NLIST, NULL, o);
+    for (k = 0; k < NLIST; k++) {
+      nbad += (sgn(o[k]) != S[k]);
+      node[k] = NLIST-1-k;
+    }
+    mg_orient2d_list(a, b, X, NLIST, node, o);
+    for (k = 0; k < NLIST; k++)
+      nbad += (sgn(o[k]) != S[node[k]]);
+  }
+  for (i = 0; i < 256*256; i++) {
+    p[0] = 0.5+ldexp(i%256, -53);
+    p[1] = 0.5+ldexp(i/256, -53);
+    s = exact_orient(p, q, r, SCALE);
+    nzero += (s == 0);
+    nnaive += (sgn(naive_orient(p, q, r)) != s);
+    if (sgn(mg_orient2d(p, q, r)) != s) {
+      if (nbad < 10)
+        printf("orient2d grid (%.17g %.17g): exact %d\n", p[0], p[1], s);
+      nbad++;
+    }
+    ncase++;
+  }
+  printf("orient2d: %d cases (%d colinear), %d wrong in plain double, "
+         "%d mismatches\n", ncase, nzero, nnaive, nbad);
+  
+  return nbad;
+}
+
+/******************************************************************/
+/* function:  check_incircle */
+/* n cases of three points of a lattice circle of radius 65 and a
+ fourth lattice point of it moved by up to two ulps per coordinate.
+ The circles are centered away from the origin (coordinates in
+ [512,2048), multiples of 2^-43) so that their points are rounded.
+ The circle changes every NLIST cases, which are classified by the
+ list version as well */
+static int check_incircle(int n)
+{
+  int i, k, j, nL = 0, nbad = 0, nnaive = 0, nzero = 0, s;
+  int L[4*65+4][2], id[3], node[NLIST], S[NLIST];
+  double C[2] = {0.0, 0.0}, P[3][2], *d, X[2*NLIST], o[NLIST], tmp;
+  i128 dx, dy, r2 = (i128)fixed(65.0, 43)*fixed(65.0, 43);
+  
+  //lattice points of x^2+y^2 = 65^2
+  for (i = -65; i <= 65; i++)
+    for (j = -65; j <= 65; j++)
+      if (i*i+j*j == 65*65) {
+        L[nL][0] = i;
+        L[nL++][1] = j;
+      }
+  srand(2);
+  for (i = 0; i < n; i++) {
+    if (i%NLIST == 0) {
+      C[0] = 1024+rand()%512;
+      C[1] = 1024+rand()%512;
+      //three distinct points counter-clockwise
+      id[0] = rand()%nL;
+      do id[1] = rand()%nL; while (id[1] == id[0]);
+      do id[2] = rand()%nL; while (id[2] == id[0] || id[2] == id[1]);
+      for (k = 0; k < 3; k++) {
+        P[k][0] = C[0]+L[id[k]][0];
+        P[k][1] = C[1]+L[id[k]][1];
+      }
+      if (exact_orient(P[0], P[1], P[2], 43) < 0)
+        for (k = 0; k < 2; k++) swap(P[1][k], P[2][k], tmp);
+    }
+    k = rand()%nL;
+    d = X+2*(i%NLIST);
+    d[0] = ulps(C[0]+L[k][0], rand()%5-2);
+    d[1] = ulps(C[1]+L[k][1], rand()%5-2);
+    //inside if d is closer to the center than the radius
+    dx = fixed(d[0], 43)-fixed(C[0], 43);
+    dy = fixed(d[1], 43)-fixed(C[1], 43);
+    S[i%NLIST] = s = sign128(r2-dx*dx-dy*dy);
+    nzero += (s == 0);
+    nnaive += (sgn(naive_incircle(P[0], P[1], P[2], d)) != s);
+    //even permutations keep the sign, odd ones flip it
+    if (sgn(mg_incircle(P[0], P[1], P[2], d)) != s ||
+        sgn(mg_incircle(P[1], P[2], P[0], d)) != s ||
+        sgn(mg_incircle(P[1], P[0], P[2], d)) != -s) {
+      if (nbad < 10)
+        printf("incircle center (%g %g) d (%.17g %.17g): exact %d\n",
+               C[0], C[1], d[0], d[1], s);
+      nbad++;
+    }
+    if (i%NLIST < NLIST-1) continue;
+    //the block in order and reversed through node
+    mg_incircle_list(P[0], P[1], P[2], X, NLIST, NULL, o);
+    for (k = 0; k < NLIST; k++) {
+      nbad += (sgn(o[k]) != S[k]);
+      node[k] = NLIST-1-k;
+    }
+    mg_incircle_list(P[0], P[1], P[2], X, NLIST, node, o);
+    for (k = 0; k < NLIST; k++)
+      nbad += (sgn(o[k]) != S[node[k]]);
+  }
+  printf("incircle: %d cases (%d cocircular), %d wrong in plain double, "
+         "%d mismatches\n", n, nzero, nnaive, nbad);
+  
+  return nbad;
+}
+
+int main(int argc, const char * argv[]) {
+  int nbad, n = (argc > 1) ? atoi(argv[1]) : 1000000;
+  
+  //test_pred [n]
+  nbad = check_orient(n);
+  nbad += check_incircle(n);
+  printf("%s: %d mismatches\n", (nbad == 0) ? "PASS" : "FAIL", nbad);
+  
+  return (nbad == 0) ? err_OK : err_LOGIC_ERROR;
+}
@@ -8,18 +8,257 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include "2dmg_qtree.h"
+#include "2dmg_lqtree.h"
 #include "2dmg_error.h"
 #include "plConfig.h"
 #include "plplot.h"
 
 
+/******************************************************************/
+/* function:  bench_qtree */
+/* times insertion and lookup of np uniformly random points in mg_qtree
+ and in mg_lqtree (incremental and bulk-loaded) */
+static int bench_qtree(int np, int capacity)
+{
+  int ierr, i;
+  double *X, c[2] = {0.0,0.0}, ds[2] = {1.0,1.0};
+  clock_t t0;
+  mg_qtree *qtree;
+  mg_lqtree *lqtree;
+  mg_data_entry *D;
+  
+  if ((X = malloc(2*np*sizeof(double))) == NULL)
+    return error(err_MEMORY_ERROR);
+  srand(1);
+  for (i = 0; i < 2*np; i++)
+    X[i] = 2.0*(rand()/(RAND_MAX+1.0))-1.0;
+  
+  //pointer based tree
+  qtree = malloc(sizeof(mg_qtree));
+  call(mg_init_branch(qtree));
+  qtree->ds[0] = qtree->ds[1] = 1.0;
+  t0 = clock();
+  for (i = 0; i < np; i++)
+    call(mg_add_qtree_entry(X+2*i, (void**)(X+2*i), qtree));
+  printf("mg_qtree  (capacity %d) insert: %8.3f s\n", MAXCAPACITY,
+         (double)(clock()-t0)/CLOCKS_PER_SEC);
+  t0 = clock();
+  for (i = 0; i < np; i++)
+    call(mg_find_entry(qtree, X+2*i, NULL, 0.0, &D));
+  printf("mg_qtree  (capacity %d) lookup: %8.3f s\n", MAXCAPACITY,
+         (double)(clock()-t0)/CLOCKS_PER_SEC);
+  mg_destroy_branch(qtree);
+  free(qtree);
+  
+  //linear tree, incremental
+  call(mg_create_lqtree(&lqtree, c, ds, capacity));
+  t0 = clock();
+  for (i = 0; i < np; i++)
+    call(mg_lqtree_add_entry(lqtree, X+2*i, X+2*i));
+  printf("mg_lqtree (capacity %d) insert: %8.3f s\n", lqtree->capacity,
+         (double)(clock()-t0)/CLOCKS_PER_SEC);
+  t0 = clock();
+  for (i = 0; i < np; i++)
+    call(mg_lqtree_find_entry(lqtree, X+2*i, NULL, 0.0, &D));
+  printf("mg_lqtree (capacity %d) lookup: %8.3f s\n", lqtree->capacity,
+         (double)(clock()-t0)/CLOCKS_PER_SEC);
+  mg_destroy_lqtree(lqtree);
+  
+  //linear tree, bulk load
+  call(mg_create_lqtree(&lqtree, c, ds, capacity));
+  t0 = clock();
+  call(mg_lqtree_bulk_load(lqtree, np, X, NULL));
+  printf("mg_lqtree (capacity %d) bulk:   %8.3f s (%d nodes)\n",
+         lqtree->capacity, (double)(clock()-t0)/CLOCKS_PER_SEC,
+         lqtree->nNode);
+  t0 = clock();
+  for (i = 0; i < np; i++)
+    call(mg_lqtree_find_entry(lqtree, X+2*i, NULL, 0.0, &D));
+  printf("mg_lqtree (capacity %d) lookup: %8.3f s\n", lqtree->capacity,
+         (double)(clock()-t0)/CLOCKS_PER_SEC);
+  mg_destroy_lqtree(lqtree);
+  free(X);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  cmp_ptr */
+static int cmp_ptr(const void *a, const void *b)
+{
+  const char *x = *(char* const*)a, *y = *(char* const*)b;
+  
+  return (x < y) ? -1 : (x > y);
+}
+
+/******************************************************************/
+/* function:  cmp_dbl */
+static int cmp_dbl(const void *a, const void *b)
+{
+  double x = *(const double*)a, y = *(const double*)b;
+  
+  return (x < y) ? -1 : (x > y);
+}
+
+/******************************************************************/
+/* function:  same_set */
+/* true if the n entries found in Q point to the same data as the n
+ pointers in P (both lists are sorted in place) */
+static int same_set(mg_qtree_query *Q, void **P, int n, void **tmp)
+{
+  int i;
+  
+  if (Q->n_entry != n) return 0;
+  for (i = 0; i < n; i++) tmp[i] = Q->entry[i]->data;
+  qsort(tmp, n, sizeof(void*), cmp_ptr);
+  qsort(P, n, sizeof(void*), cmp_ptr);
+  for (i = 0; i < n; i++)
+    if (tmp[i] != P[i]) return 0;
+  return 1;
+}
+
+/******************************************************************/
+/* function:  check_qtree */
+/* compares box, disk, ellipse, k-NN and nearest entry queries on np
+ random points (a tenth of them repeated once) with brute force over nq
+ random queries. Returns err_LOGIC_ERROR on any mismatch */
+static int check_qtree(int np, int nq)
+{
+  int ierr, i, q, n, k, nbad = 0;
+  double *X, *D2, lo[2], hi[2], c[2], M[3], r, dx, dy, d2, t;
+  void **P, **tmp;
+  mg_qtree *qtree;
+  mg_qtree_query Q;
+  mg_data_entry *E;
+  
+  X = malloc(2*np*sizeof(double));
+  D2 = malloc(np*sizeof(double));
+  P = malloc(np*sizeof(void*));
+  tmp = malloc(np*sizeof(void*));
+  if (X == NULL || D2 == NULL || P == NULL || tmp == NULL)
+    return error(err_MEMORY_ERROR);
+  srand(7);
+  for (i = 0; i < np; i++) {
+    //pairs only: a branch holds at most MAXCAPACITY equal points
+    if (i%10 == 9) {
+      X[2*i] = X[2*(i-1)];
+      X[2*i+1] = X[2*(i-1)+1];
+      continue;
+    }
+    X[2*i] = 2.0*(rand()/(RAND_MAX+1.0))-1.0;
+    X[2*i+1] = 2.0*(rand()/(RAND_MAX+1.0))-1.0;
+  }
+  qtree = malloc(sizeof(mg_qtree));
+  call(mg_init_branch(qtree));
+  qtree->ds[0] = qtree->ds[1] = 1.0;
+  for (i = 0; i < np; i++)
+    call(mg_add_qtree_entry(X+2*i, (void**)(X+2*i), qtree));
+  mg_init_qtree_query(&Q);
+  
+  for (q = 0; q < nq; q++) {
+    c[0] = 2.4*(rand()/(RAND_MAX+1.0))-1.2;
+    c[1] = 2.4*(rand()/(RAND_MAX+1.0))-1.2;
+    r = 0.3*(rand()/(RAND_MAX+1.0));
+    //box
+    lo[0] = c[0]-r;
+    hi[0] = c[0]+0.5*r;
+    lo[1] = c[1]-0.5*r;
+    hi[1] = c[1]+r;
+    call(mg_qtree_box(qtree, lo, hi, &Q));
+    for (n = 0, i = 0; i < np; i++)
+      if (X[2*i] >= lo[0] && X[2*i] <= hi[0] &&
+          X[2*i+1] >= lo[1] && X[2*i+1] <= hi[1])
+        P[n++] = X+2*i;
+    if (!same_set(&Q, P, n, tmp)) {
+      printf("box query %d: %d found, %d expected\n", q, Q.n_entry, n);
+      nbad++;
+    }
+    //disk
+    call(mg_qtree_disk(qtree, c, r, &Q));
+    for (n = 0, i = 0; i < np; i++) {
+      dx = X[2*i]-c[0];
+      dy = X[2*i+1]-c[1];
+      if (dx*dx+dy*dy <= r*r) P[n++] = X+2*i;
+    }
+    if (!same_set(&Q, P, n, tmp)) {
+      printf("disk query %d: %d found, %d expected\n", q, Q.n_entry, n);
+      nbad++;
+    }
+    //ellipse: random rotation and aspect ratio up to 10
+    t = 3.14159265358979*(rand()/(RAND_MAX+1.0));
+    d2 = 1.0+99.0*(rand()/(RAND_MAX+1.0));
+    M[0] = cos(t)*cos(t)+d2*sin(t)*sin(t);
+    M[1] = (1.0-d2)*cos(t)*sin(t);
+    M[2] = sin(t)*sin(t)+d2*cos(t)*cos(t);
+    call(mg_qtree_ellipse(qtree, c, M, r, &Q));
+    for (n = 0, i = 0; i < np; i++) {
+      dx = X[2*i]-c[0];
+      dy = X[2*i+1]-c[1];
+      if (dx*(M[0]*dx+M[1]*dy)+dy*(M[1]*dx+M[2]*dy) <= r*r)
+        P[n++] = X+2*i;
+    }
+    if (!same_set(&Q, P, n, tmp)) {
+      printf("ellipse query %d: %d found, %d expected\n", q, Q.n_entry, n);
+      nbad++;
+    }
+    //k nearest: the same distances in the same order
+    k = 1+q%20;
+    call(mg_qtree_knn(qtree, c, k, &Q));
+    for (i = 0; i < np; i++) {
+      dx = X[2*i]-c[0];
+      dy = X[2*i+1]-c[1];
+      D2[i] = dx*dx+dy*dy;
+    }
+    qsort(D2, np, sizeof(double), cmp_dbl);
+    for (i = 0; i < k && i < Q.n_entry; i++)
+      if (Q.dist[i] != sqrt(D2[i])) break;
+    if (Q.n_entry != k || i < k) {
+      printf("knn query %d (k = %d): entry %d differs\n", q, k, i);
+      nbad++;
+    }
+    //closest entry within r
+    ierr = mg_find_entry(qtree, c, NULL, r, &E);
+    if (ierr != err_OK && ierr != err_NOT_FOUND) return error(ierr);
+    d2 = (ierr == err_OK) ? (E->coord[0]-c[0])*(E->coord[0]-c[0])+
+                            (E->coord[1]-c[1])*(E->coord[1]-c[1]) : -1.0;
+    if ((D2[0] <= r*r) != (ierr == err_OK) ||
+        (ierr == err_OK && d2 != D2[0])) {
+      printf("nearest query %d: distance %e, expected %e\n", q,
+             sqrt(fabs(d2)), sqrt(D2[0]));
+      nbad++;
+    }
+  }
+  printf("%d points, %d queries: %d mismatches\n", np, nq, nbad);
+  
+  mg_free_qtree_query(&Q);
+  mg_destroy_branch(qtree);
+  free(qtree);
+  free(X);
+  free(D2);
+  free(P);
+  free(tmp);
+  
+  return (nbad == 0) ? err_OK : err_LOGIC_ERROR;
+}
+
 int main(int argc, const char * argv[]) {
   int ierr, np = 100, i;
   double x[2],r;
   mg_qtree *qtree, *branch;
   mg_data_entry *D;
   
+  //test_qtree bench [np] [capacity]
+  if (argc > 1 && strcmp(argv[1], "bench") == 0)
+    return bench_qtree((argc > 2) ? atoi(argv[2]) : 1000000,
+                       (argc > 3) ? atoi(argv[3]) : LQTREECAPACITY);
+  //test_qtree check [np] [nq]
+  if (argc > 1 && strcmp(argv[1], "check") == 0)
+    return check_qtree((argc > 2) ? atoi(argv[2]) : 20000,
+                       (argc > 3) ? atoi(argv[3]) : 2000);
+  
   qtree = malloc(sizeof(mg_qtree));
   call(mg_init_branch(qtree));
   qtree->c[0] = 0.0;
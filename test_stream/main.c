@@ -0,0 +1,204 @@
+//
+//  main.c
+//  test_stream
+//
+//  https://github.com/mceze/2dmg
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_utils.h"
+#include "2dmg_io.h"
+
+/* Compares a mesh written through a mesh stream (StreamBound set) with
+ the mesh mg_write_mesh writes for the same run. The stream numbers
+ nodes and elements in the order they became final, so nodes are
+ matched by their coordinates (both files print them alike) and
+ elements and faces by their nodes. Run 2dmg twice on a parameter file
+ whose front removes elements (ellipse engine, e.g. MetricType linx on
+ box.geo), once with StreamBound and once without, and pass both
+ output files. */
+
+static double *SortCoord;
+
+/******************************************************************/
+/* function:  cmp_node */
+/* orders node indices by x, then y */
+static int cmp_node(const void *a, const void *b)
+{
+  const double *x = SortCoord+2*(*(const int*)a);
+  const double *y = SortCoord+2*(*(const int*)b);
+  
+  if (x[0] != y[0]) return (x[0] < y[0]) ? -1 : 1;
+  if (x[1] != y[1]) return (x[1] < y[1]) ? -1 : 1;
+  return 0;
+}
+
+/******************************************************************/
+/* function:  cmp_row */
+/* orders rows of 5 ints lexicographically on the first 4, the last
+ one is the row index */
+static int cmp_row(const void *a, const void *b)
+{
+  int k;
+  const int *x = (const int*)a, *y = (const int*)b;
+  
+  for (k = 0; k < 4; k++)
+    if (x[k] != y[k]) return (x[k] < y[k]) ? -1 : 1;
+  return 0;
+}
+
+/******************************************************************/
+/* function:  node_order */
+/* node indices of Mesh sorted by coordinates */
+static int node_order(mg_Mesh *Mesh, int **pOrder)
+{
+  int ierr, i;
+  
+  call(mg_alloc((void**)pOrder, Mesh->nNode, sizeof(int)));
+  for (i = 0; i < Mesh->nNode; i++) (*pOrder)[i] = i;
+  SortCoord = Mesh->Coord;
+  qsort(*pOrder, Mesh->nNode, sizeof(int), cmp_node);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  elem_rows */
+/* elements of Mesh as sorted node triples in the numbering Map */
+static int elem_rows(mg_Mesh *Mesh, int *Map, int **pRow)
+{
+  int ierr, i, k, t, *r;
+  
+  call(mg_alloc((void**)pRow, 5*Mesh->nElem, sizeof(int)));
+  for (i = 0; i < Mesh->nElem; i++) {
+    r = (*pRow)+5*i;
+    for (k = 0; k < 3; k++) r[k] = Map[Mesh->Elem[i].node[k]];
+    if (r[0] > r[1]) swap(r[0], r[1], t);
+    if (r[1] > r[2]) swap(r[1], r[2], t);
+    if (r[0] > r[1]) swap(r[0], r[1], t);
+    r[3] = 0;
+    r[4] = i;
+  }
+  qsort(*pRow, Mesh->nElem, 5*sizeof(int), cmp_row);
+  
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  face_rows */
+/* oriented faces of Mesh in the node numbering NodeMap and the element
+ numbering ElemMap (boundary and hollow tags are kept) */
+static int face_rows(mg_Mesh *Mesh, int *NodeMap, int *ElemMap, int **pRow)
+{
+  int ierr, i, k, e, *r;
+  
+  call(mg_alloc((void**)pRow, 5*Mesh->nFace, sizeof(int)));
+  for (i = 0; i < Mesh->nFace; i++) {
+    r = (*pRow)+5*i;
+    r[0] = NodeMap[Mesh->Face[i]->node[0]];
+    r[1] = NodeMap[Mesh->Face[i]->node[1]];
+    for (k = 0; k < 2; k++) {
+      e = Mesh->Face[i]->elem[k];
+      r[2+k] = (e >= 0) ? ElemMap[e] : e;
+    }
+    r[4] = i;
+  }
+  qsort(*pRow, Mesh->nFace, 5*sizeof(int), cmp_row);
+  
+  return err_OK;
+}
+
+int main(int argc, const char * argv[]) {
+  int ierr, i, nbad = 0, *OrderS, *OrderW, *NodeMap, *ElemMap, *Ident;
+  int *RowS, *RowW;
+  char FileS[MAXSTRLEN], FileW[MAXSTRLEN];
+  mg_Mesh *S, *W;
+  
+  if (argc != 3) {
+    printf("Usage: test_stream <streamed mesh> <written mesh>\n");
+    return error(err_INPUT_ERROR);
+  }
+  strncpy(FileS, argv[1], MAXSTRLEN-1);
+  FileS[MAXSTRLEN-1] = '\0';
+  strncpy(FileW, argv[2], MAXSTRLEN-1);
+  FileW[MAXSTRLEN-1] = '\0';
+  call(mg_read_mesh(&S, FileS));
+  call(mg_read_mesh(&W, FileW));
+  printf("streamed: %d nodes %d elements %d faces\n", S->nNode, S->nElem,
+         S->nFace);
+  printf("written:  %d nodes %d elements %d faces\n", W->nNode, W->nElem,
+         W->nFace);
+  if (S->nNode != W->nNode || S->nElem != W->nElem ||
+      S->nFace != W->nFace || S->nBfg != W->nBfg) {
+    printf("FAIL: sizes differ\n");
+    return err_LOGIC_ERROR;
+  }
+  for (i = 0; i < S->nBfg; i++) {
+    if (strcmp(S->BNames[i], W->BNames[i]) != 0 ||
+        S->nBface[i] != W->nBface[i]) {
+      printf("FAIL: boundary group %d differs\n", i);
+      nbad++;
+    }
+  }
+  
+  //nodes: the same coordinates in another order
+  call(node_order(S, &OrderS));
+  call(node_order(W, &OrderW));
+  call(mg_alloc((void**)&NodeMap, S->nNode, sizeof(int)));
+  for (i = 0; i < S->nNode; i++) {
+    if (S->Coord[2*OrderS[i]] != W->Coord[2*OrderW[i]] ||
+        S->Coord[2*OrderS[i]+1] != W->Coord[2*OrderW[i]+1] ||
+        (i > 0 && W->Coord[2*OrderW[i]] == W->Coord[2*OrderW[i-1]] &&
+         W->Coord[2*OrderW[i]+1] == W->Coord[2*OrderW[i-1]+1])) {
+      printf("FAIL: node %d (%1.12e %1.12e) unmatched\n", OrderS[i],
+             S->Coord[2*OrderS[i]], S->Coord[2*OrderS[i]+1]);
+      return err_LOGIC_ERROR;
+    }
+    NodeMap[OrderS[i]] = OrderW[i];
+  }
+  
+  //elements: the same node triples
+  call(mg_alloc((void**)&Ident, max(W->nNode, W->nElem), sizeof(int)));
+  for (i = 0; i < max(W->nNode, W->nElem); i++) Ident[i] = i;
+  call(elem_rows(S, NodeMap, &RowS));
+  call(elem_rows(W, Ident, &RowW));
+  call(mg_alloc((void**)&ElemMap, S->nElem, sizeof(int)));
+  for (i = 0; i < S->nElem; i++) {
+    if (cmp_row(RowS+5*i, RowW+5*i) != 0) {
+      printf("FAIL: element %d (%d %d %d) unmatched\n", RowS[5*i+4],
+             RowS[5*i], RowS[5*i+1], RowS[5*i+2]);
+      return err_LOGIC_ERROR;
+    }
+    ElemMap[RowS[5*i+4]] = RowW[5*i+4];
+  }
+  mg_free((void*)RowS);
+  mg_free((void*)RowW);
+  
+  //faces: the same nodes, orientation and neighbours
+  call(face_rows(S, NodeMap, ElemMap, &RowS));
+  call(face_rows(W, Ident, Ident, &RowW));
+  for (i = 0; i < S->nFace; i++) {
+    if (cmp_row(RowS+5*i, RowW+5*i) != 0) {
+      printf("FAIL: face %d (%d %d %d %d) unmatched\n", RowS[5*i+4],
+             RowS[5*i], RowS[5*i+1], RowS[5*i+2], RowS[5*i+3]);
+      nbad++;
+    }
+  }
+  printf("%s: %d mismatches\n", (nbad == 0) ? "PASS" : "FAIL", nbad);
+  
+  mg_free((void*)RowS);
+  mg_free((void*)RowW);
+  mg_free((void*)OrderS);
+  mg_free((void*)OrderW);
+  mg_free((void*)NodeMap);
+  mg_free((void*)ElemMap);
+  mg_free((void*)Ident);
+  mg_destroy_mesh(S);
+  mg_destroy_mesh(W);
+  
+  return (nbad == 0) ? err_OK : err_LOGIC_ERROR;
+}
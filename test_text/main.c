@@ -0,0 +1,274 @@
+//
+//  main.c
+//  test_text
+//
+//  https://github.com/mceze/2dmg
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include "2dmg_def.h"
+#include "2dmg_struct.h"
+#include "2dmg_utils.h"
+#include "2dmg_text.h"
+
+/* Checks that mg_parse_real converts tokens bit for bit as strtod
+ does and mg_parse_int as strtol does, both on single tokens and
+ through a mapped file read in parallel. Tokens are printed doubles in
+ every precision, random digit strings (long mantissas, leading zeros,
+ large exponents) and a list of edge cases. A token is valid if strtod
+ consumes all of it */
+
+//edge cases, including ones the fast path has to leave to strtod
+static const char *EdgeReal[] = {
+  "0", "-0", "+0", "0.0", "-0.0e5", "00000", ".5", "5.", "-.5", "+5.",
+  "1e22", "1e23", "-1e-22", "1e-23", "9007199254740992", "9007199254740993",
+  "9007199254740994", "18014398509481985", "1.7976931348623157e308",
+  "1.7976931348623159e308", "1e309", "-1e309", "2.2250738585072011e-308",
+  "2.2250738585072014e-308", "4.9406564584124654e-324", "2e-324",
+  "1e-400", "123456789012345678901234567890", "0.1234567890123456789012",
+  "1.000000000000000000000000000001", "0.000000000000000000000000000001",
+  "1E+05", "1e05", "1e+0", "7e-0", "0x1p3", "0X1.8P1", "inf", "-INF",
+  "nan", "NaN", "infinity", "1e", "1e+", "e5", ".", "-", "+", "1.2.3",
+  "--1", "1-", "1e5.0", "12a", "0..1", "1,5", "3.14159265358979323846",
+  "2.718281828459045235360287", "99999999999999999999e-20",
+  "100000000000000000000000", "1e99999999", "1e-99999999"
+};
+static const char *EdgeInt[] = {
+  "0", "-0", "+7", "2147483647", "-2147483648", "2147483648",
+  "-2147483649", "99999999999999999999", "007", "1.0", "1e3", "-", "+",
+  "12a", "--1", " "
+};
+
+/******************************************************************/
+/* function:  ref_real */
+/* strtod on the whole token */
+static int ref_real(const char *tok, double *v)
+{
+  char *stop;
+  
+  (*v) = strtod(tok, &stop);
+  return (stop != tok && *stop == '\0') ? err_OK : err_READWRITE_ERROR;
+}
+
+/******************************************************************/
+/* function:  ref_int */
+/* strtol on the whole token, in the range of int */
+static int ref_int(const char *tok, int *v)
+{
+  char *stop;
+  long long x;
+  
+  x = strtoll(tok, &stop, 10);
+  if (stop == tok || *stop != '\0' || x < INT_MIN || x > INT_MAX)
+    return err_READWRITE_ERROR;
+  (*v) = (int)x;
+  return err_OK;
+}
+
+/******************************************************************/
+/* function:  same_bits */
+static bool same_bits(double a, double b)
+{
+  return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+/******************************************************************/
+/* function:  check_real */
+/* compares mg_parse_real with strtod on tok, returns 1 on a
+ mismatch */
+static int check_real(const char *tok)
+{
+  int r, t;
+  double vr = 0.0, vt = 0.0;
+  const char *s = tok;
+  
+  r = ref_real(tok, &vr);
+  t = mg_parse_real(&s, tok+strlen(tok), &vt);
+  if (r == t && (r != err_OK || same_bits(vr, vt))) return 0;
+  printf("real \"%s\": strtod %d %.17g, mg_parse_real %d %.17g\n", tok, r,
+         vr, t, vt);
+  return 1;
+}
+
+/******************************************************************/
+/* function:  check_int */
+/* compares mg_parse_int with strtol on tok, returns 1 on a
+ mismatch */
+static int check_int(const char *tok)
+{
+  int r, t, vr = 0, vt = 0;
+  const char *s = tok;
+  
+  r = ref_int(tok, &vr);
+  t = mg_parse_int(&s, tok+strlen(tok), &vt);
+  //a blank token is no number for either
+  if (r != err_OK && t == err_NOT_FOUND) return 0;
+  if (r == t && (r != err_OK || vr == vt)) return 0;
+  printf("int \"%s\": strtol %d %d, mg_parse_int %d %d\n", tok, r, vr, t,
+         vt);
+  return 1;
+}
+
+/******************************************************************/
+/* function:  rand_double */
+/* any finite double, from random bits */
+static double rand_double(void)
+{
+  uint64_t u = 0;
+  double d;
+  int k;
+  
+  do {
+    for (k = 0; k < 4; k++) u = (u << 16)|(uint64_t)(rand() & 0xffff);
+    memcpy(&d, &u, sizeof(double));
+  } while (d != d || d-d != 0.0);
+  return d;
+}
+
+/******************************************************************/
+/* function:  rand_token */
+/* random decimal token: optional sign, up to 25 digits before and
+ after the point (often leading zeros) and an optional exponent */
+static void rand_token(char *tok)
+{
+  int k, n;
+  char *p = tok;
+  
+  if (rand()%4 == 0) *p++ = (rand()%2) ? '-' : '+';
+  n = rand()%26;
+  for (k = 0; k < n; k++)
+    *p++ = (k < 3 && rand()%3 == 0) ? '0' : (char)('0'+rand()%10);
+  if (n == 0 || rand()%3 != 0) {
+    *p++ = '.';
+    n = rand()%26;
+    for (k = 0; k < n; k++)
+      *p++ = (k < 8 && rand()%3 == 0) ? '0' : (char)('0'+rand()%10);
+  }
+  if (rand()%2) {
+    *p++ = (rand()%2) ? 'e' : 'E';
+    if (rand()%2) *p++ = (rand()%2) ? '-' : '+';
+    p += sprintf(p, "%d", (rand()%3 == 0) ? rand()%400 : rand()%30);
+  }
+  *p = '\0';
+}
+
+/******************************************************************/
+/* function:  check_tokens */
+/* n random doubles in every precision and n random digit strings */
+static int check_tokens(int n)
+{
+  int i, k, nbad = 0, ncase = 0;
+  unsigned int e;
+  char tok[MAXSTRLEN];
+  double d;
+  
+  for (i = 0; i < (int)(sizeof(EdgeReal)/sizeof(EdgeReal[0])); i++, ncase++)
+    nbad += check_real(EdgeReal[i]);
+  for (i = 0; i < (int)(sizeof(EdgeInt)/sizeof(EdgeInt[0])); i++, ncase++)
+    nbad += check_int(EdgeInt[i]);
+  srand(1);
+  for (i = 0; i < n; i++) {
+    d = rand_double();
+    k = 1+i%17;
+    sprintf(tok, "%.*g", k, d);
+    nbad += check_real(tok);
+    sprintf(tok, "%.*e", i%21, d);
+    nbad += check_real(tok);
+    //values of a mesh file: moderate exponents
+    e = (unsigned int)(rand()%40);
+    d = (rand()-RAND_MAX/2.0)*1e-10*(double)(1u << (e%31));
+    sprintf(tok, "%.*g", k, d);
+    nbad += check_real(tok);
+    sprintf(tok, "%.*f", i%20, d);
+    nbad += check_real(tok);
+    rand_token(tok);
+    nbad += check_real(tok);
+    sprintf(tok, "%d", rand()-RAND_MAX/2);
+    nbad += check_int(tok);
+    ncase += 6;
+  }
+  printf("tokens: %d cases, %d mismatches\n", ncase, nbad);
+  
+  return nbad;
+}
+
+/******************************************************************/
+/* function:  check_file */
+/* writes nLine lines of three reals and nLine lines of three integers
+ separated by various blanks to FileName, and reads them back with
+ mg_text_read_real and mg_text_read_int */
+static int check_file(const char *FileName, int nLine)
+{
+  int ierr, i, nbad = 0, *vi, *ri;
+  char tok[MAXSTRLEN];
+  const char *sep[4] = {" ", "\t", "   ", " \t "}, *eol[3] = {"\n", "\r\n",
+    " \n"};
+  double *v, *r;
+  FILE *fid;
+  mg_TextMap *Text;
+  
+  call(mg_alloc((void**)&v, 3*nLine, sizeof(double)));
+  call(mg_alloc((void**)&r, 3*nLine, sizeof(double)));
+  call(mg_alloc((void**)&vi, 3*nLine, sizeof(int)));
+  call(mg_alloc((void**)&ri, 3*nLine, sizeof(int)));
+  if ((fid = fopen(FileName, "w")) == NULL)
+    return error(err_READWRITE_ERROR);
+  srand(2);
+  for (i = 0; i < 3*nLine; i++) {
+    do rand_token(tok); while (ref_real(tok, r+i) != err_OK);
+    fprintf(fid, "%s%s", (i%3 == 0) ? sep[rand()%4]+1 : sep[rand()%4], tok);
+    if (i%3 == 2) fprintf(fid, "%s", eol[rand()%3]);
+  }
+  for (i = 0; i < 3*nLine; i++) {
+    ri[i] = rand()-RAND_MAX/2;
+    fprintf(fid, "%s%d", sep[rand()%4], ri[i]);
+    if (i%3 == 2) fprintf(fid, "%s", eol[rand()%3]);
+  }
+  fclose(fid);
+  
+  call(mg_map_text(FileName, &Text));
+  if (Text->nLine != 2*nLine) {
+    printf("file: %d lines, expected %d\n", Text->nLine, 2*nLine);
+    return err_LOGIC_ERROR;
+  }
+  call(mg_text_read_real(Text, 0, nLine, 3, v));
+  call(mg_text_read_int(Text, nLine, nLine, 3, vi));
+  for (i = 0; i < 3*nLine; i++) {
+    if (!same_bits(v[i], r[i])) {
+      if (nbad < 10)
+        printf("file real %d: strtod %.17g, mg_text_read_real %.17g\n", i,
+               r[i], v[i]);
+      nbad++;
+    }
+    if (vi[i] != ri[i]) {
+      if (nbad < 10)
+        printf("file int %d: %d, mg_text_read_int %d\n", i, ri[i], vi[i]);
+      nbad++;
+    }
+  }
+  mg_unmap_text(Text);
+  remove(FileName);
+  printf("file: %d lines, %d mismatches\n", 2*nLine, nbad);
+  
+  mg_free((void*)v);
+  mg_free((void*)r);
+  mg_free((void*)vi);
+  mg_free((void*)ri);
+  
+  return nbad;
+}
+
+int main(int argc, const char * argv[]) {
+  int nbad, n = (argc > 1) ? atoi(argv[1]) : 200000;
+  
+  //test_text [n] [scratch file]
+  nbad = check_tokens(n);
+  nbad += check_file((argc > 2) ? argv[2] : "test_text.tmp", n/10);
+  printf("%s: %d mismatches\n", (nbad == 0) ? "PASS" : "FAIL", nbad);
+  
+  return (nbad == 0) ? err_OK : err_LOGIC_ERROR;
+}